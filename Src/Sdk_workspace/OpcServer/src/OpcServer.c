@@ -15,6 +15,7 @@
 #include "xil_printf.h"
 
 #include "xgpio.h"
+#include "xtmrctr_l.h"
 #include "iicNs.h"
 
 #define THREAD_STACKSIZE 102400
@@ -61,6 +62,30 @@ int main(){
     return 0;
 }
 
+// Counter 1 of the tick timer is free-running (see vApplicationSetupTimerInterrupt)
+#define CLOCK_TIMER_COUNTER 1
+
+static UA_UInt64
+readClockCounter(void *context) {
+    return XTmrCtr_GetTimerCounterReg(XPAR_TMRCTR_0_BASEADDR, CLOCK_TIMER_COUNTER);
+}
+
+// The tick count adds the wrap-arounds (every ~43s) missed between readings
+static UA_DateTime
+readClockTicks(void *context) {
+    return (((UA_DateTime)xTaskGetTickCount()) * 1000 / configTICK_RATE_HZ) * UA_DATETIME_MSEC;
+}
+
+static void
+lockClock(void *context) {
+    taskENTER_CRITICAL();
+}
+
+static void
+unlockClock(void *context) {
+    taskEXIT_CRITICAL();
+}
+
 UA_NodeId connectionIdent, publishedDataSetIdent, dataSetFieldIdent, writerGroupIdent;
 UA_UInt16 *ApplicationSequenceNr;
 UA_UInt32 *AsOffsetCounter;
@@ -265,6 +290,11 @@ static int opcua_pubsub() {
 
     xil_printf("--------- Init OPC UA Server (pub/sub) ---------\r\n");
 
+    // Use the AXI timer for microsecond timestamps instead of the 10ms tick
+    UA_ClockSource clockSource = {readClockCounter, NULL, XPAR_TMRCTR_0_CLOCK_FREQ_HZ, 0xFFFFFFFF,
+                                  readClockTicks, lockClock, unlockClock};
+    UA_DateTime_setClockSource(&clockSource);
+
     UA_Server *server = UA_Server_new();
     xil_printf("--------- Get Server Config---------\r\n");
     UA_ServerConfig *config = UA_Server_getConfig(server);
@@ -295,8 +325,16 @@ static int opcua_pubsub() {
     config->pubsubTransportLayersSize++;
 
     UA_StatusCode retval;
-    /* create nodes from nodeset */
-    if (iicNs(server) != UA_STATUSCODE_GOOD) {
+    /* create nodes from nodeset. The generated nodes are finished in a
+     * single sweep at the end of the bulk load. */
+    retval = UA_Server_bulkLoad_begin(server);
+    if (retval == UA_STATUSCODE_GOOD) {
+        retval = iicNs(server);
+        UA_StatusCode endRetval = UA_Server_bulkLoad_end(server);
+        if (retval == UA_STATUSCODE_GOOD)
+            retval = endRetval;
+    }
+    if (retval != UA_STATUSCODE_GOOD) {
         UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_SERVER, "Could not add the example nodeset. "
             "Check previous output for any error.");
         retval = UA_STATUSCODE_BADUNEXPECTEDERROR;
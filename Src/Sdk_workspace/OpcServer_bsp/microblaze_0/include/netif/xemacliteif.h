@@ -42,6 +42,21 @@ extern "C" {
 #include "xemaclite_i.h"
 #include "xstatus.h"
 
+/* receive statistics of an emaclite instance. The receive interrupt only
+ * wakes up the input thread, which then polls the receive buffers. The
+ * average number of frames per wakeup is frames / wakeups.
+ */
+typedef struct {
+	u32_t wakeups;			/* receive interrupts that started polling */
+	u32_t frames;			/* frames passed to lwIP */
+	u32_t max_frames_per_wakeup;
+	u32_t budget_exhausted;		/* polls that stopped at the budget */
+	u32_t drop_nomem;		/* no pbuf for a received frame */
+	u32_t drop_recv;		/* frame could not be read from the buffer */
+	u32_t drop_type;		/* unsupported ethernet type */
+	u32_t drop_input;		/* rejected by netif->input */
+} xemacliteif_rx_stats;
+
 /* structure within each netif, encapsulating all information required for
  * using a particular emaclite instance
  */
@@ -49,14 +64,20 @@ typedef struct {
         XEmacLite *instance;
 
 	/* queue to store overflow packets */
-	pq_queue_t *recv_q;
 	pq_queue_t *send_q;
+
+	/* set while the receive interrupt is masked and the receive buffers
+	 * are polled by the input thread */
+	volatile int rx_polling;
+	u32_t rx_frames;		/* frames of the current polling round */
+	xemacliteif_rx_stats rx_stats;
 } xemacliteif_s;
 
 void 	xemacliteif_setmac(u32_t index, u8_t *addr);
 u8_t*	xemacliteif_getmac(u32_t index);
 err_t 	xemacliteif_init(struct netif *netif);
 int 	xemacliteif_input(struct netif *netif);
+void	xemacliteif_get_rx_stats(struct netif *netif, xemacliteif_rx_stats *stats);
 
 #ifdef __cplusplus
 }
@@ -70,6 +70,14 @@
 #include "xintc.h"
 #endif
 
+/* Maximum number of frames passed to lwIP per call of xemacliteif_input.
+ * If more frames are pending, the input thread is signalled again so that
+ * other threads of the same priority get to run in between.
+ */
+#ifndef XEMACLITEIF_RX_BUDGET
+#define XEMACLITEIF_RX_BUDGET	8
+#endif
+
 /* Define those to better describe your network interface. */
 #define IFNAME0 'x'
 #define IFNAME1 'e'
@@ -129,10 +137,10 @@ static err_t xemacliteif_output(struct netif *netif, struct pbuf *p,
 unsigned get_IEEE_phy_speed_emaclite(XEmacLite *xemaclitep);
 unsigned configure_IEEE_phy_speed_emaclite(XEmacLite *xemaclitep, unsigned speed);
 
-/* The payload from multiple pbufs is assembled into a single contiguous
- * area for transmission. Currently this is a global variable (it should really
- * belong in the per netif structure), but that is ok since this can be used
- * only in a protected context
+/* Scratch area for received frames that are dropped because no pbuf is
+ * available. Currently this is a global variable (it should really belong in
+ * the per netif structure), but that is ok since it is only used by the input
+ * thread.
  */
 unsigned char xemac_tx_frame[XEL_MAX_FRAME_SIZE] __attribute__((aligned(64)));
 
@@ -159,13 +167,41 @@ XEmacLite *xemaclitep_fast;
 #endif
 #endif
 
+/* The receive interrupt enable bit of the ping buffer controls both
+ * receive buffers */
+static void
+xemaclite_set_rx_interrupt(XEmacLite *instance, int enable)
+{
+	UINTPTR baseaddr = instance->EmacLiteConfig.BaseAddress;
+	u32 reg = XEmacLite_GetRxStatus(baseaddr);
+
+	if (enable)
+		reg |= XEL_RSR_RECV_IE_MASK;
+	else
+		reg &= ~XEL_RSR_RECV_IE_MASK;
+	XEmacLite_SetRxStatus(baseaddr, reg);
+}
+
+static int
+xemaclite_rx_pending(XEmacLite *instance)
+{
+	UINTPTR baseaddr = instance->EmacLiteConfig.BaseAddress;
+
+	return XEmacLite_IsRxEmpty(baseaddr) != TRUE ||
+		(instance->EmacLiteConfig.RxPingPong != 0 &&
+		 XEmacLite_IsRxEmpty(baseaddr + XEL_BUFFER_OFFSET) != TRUE);
+}
+
+/*
+ * The receive interrupt only starts a polling round: it is masked and the
+ * input thread is woken up, which reads the frames from the receive buffers
+ * until they are empty and then unmasks the interrupt again. This way a burst
+ * of frames costs one interrupt and one wakeup instead of one per frame.
+ */
 static void
 xemacif_recv_handler(void *arg) {
 	struct xemac_s *xemac = (struct xemac_s *)(arg);
 	xemacliteif_s *xemacliteif = (xemacliteif_s *)(xemac->state);
-	XEmacLite *instance = xemacliteif->instance;
-	struct pbuf *p;
-	int len = 0;
 	struct xtopology_t *xtopologyp = &xtopology[xemac->topology_index];
 
 #ifdef OS_IS_FREERTOS
@@ -176,54 +212,18 @@ xemacif_recv_handler(void *arg) {
 #else
 	XIntc_AckIntr(xtopologyp->intc_baseaddr, 1 << xtopologyp->intc_emac_intr);
 #endif
-	p = pbuf_alloc(PBUF_RAW, XEL_MAX_FRAME_SIZE, PBUF_POOL);
-	if (!p) {
-#if LINK_STATS
-		lwip_stats.link.memerr++;
-		lwip_stats.link.drop++;
-#endif
-		/* receive and just ignore the frame.
-		 * we need to receive the frame because otherwise emaclite will
-		 * not generate any other interrupts since it cannot receive,
-		 * and we do not actively poll the emaclite
-		 */
-		XEmacLite_Recv(instance, xemac_tx_frame);
-#ifdef OS_IS_FREERTOS
-		xInsideISR--;
-#endif
-		return;
-	}
-
-	/* receive the packet */
-	len = XEmacLite_Recv(instance, p->payload);
-
-	if (len == 0) {
-#if LINK_STATS
-		lwip_stats.link.drop++;
-#endif
-		pbuf_free(p);
-#ifdef OS_IS_FREERTOS
-		xInsideISR--;
-#endif
-		return;
-	}
 
-	/* store it in the receive queue, where it'll be processed by xemacif input thread */
-	if (pq_enqueue(xemacliteif->recv_q, (void*)p) < 0) {
-#if LINK_STATS
-		lwip_stats.link.memerr++;
-		lwip_stats.link.drop++;
-#endif
-		pbuf_free(p);
-#ifdef OS_IS_FREERTOS
-		xInsideISR--;
+	/* XEmacLite_InterruptHandler also calls this handler on a transmit
+	 * interrupt while received frames are pending */
+	if (!xemacliteif->rx_polling) {
+		xemaclite_set_rx_interrupt(xemacliteif->instance, 0);
+		xemacliteif->rx_polling = 1;
+		xemacliteif->rx_stats.wakeups++;
+#if !NO_SYS
+		sys_sem_signal(&xemac->sem_rx_data_available);
 #endif
-		return;
 	}
 
-#if !NO_SYS
-	sys_sem_signal(&xemac->sem_rx_data_available);
-#endif
 #ifdef OS_IS_FREERTOS
 	xInsideISR--;
 #endif
@@ -243,43 +243,135 @@ int transmit_packet(XEmacLite *instancep, void *packet, unsigned len)
 	return 0;
 }
 
+/*
+ * Write the frame held in the pbuf chain p straight into a free emaclite TX
+ * buffer and start its transmission. The ping/pong buffer selection follows
+ * XEmacLite_Send. The device buffers only accept 32-bit accesses, so the
+ * bytes of the pbuf segments are gathered into whole words on the fly
+ * instead of first assembling the frame in xemac_tx_frame.
+ *
+ * Returns -1 if no TX buffer is free.
+ */
+static int
+xemaclite_write_frame(XEmacLite *instancep, struct pbuf *p)
+{
+	UINTPTR baseaddr = XEmacLite_NextTransmitAddr(instancep);
+	volatile u32 *dst;
+	struct pbuf *q;
+	u32 word = 0;
+	u8 *wordp = (u8 *)&word;
+	unsigned fill = 0;
+	u32 reg;
+
+	if (XEmacLite_GetTxStatus(baseaddr) &
+	    (XEL_TSR_XMIT_BUSY_MASK | XEL_TSR_XMIT_ACTIVE_MASK)) {
+		/* try the other buffer, but do not switch the expected one */
+		if (instancep->EmacLiteConfig.TxPingPong == 0)
+			return -1;
+		baseaddr ^= XEL_BUFFER_OFFSET;
+		if (XEmacLite_GetTxStatus(baseaddr) &
+		    (XEL_TSR_XMIT_BUSY_MASK | XEL_TSR_XMIT_ACTIVE_MASK))
+			return -1;
+	} else if (instancep->EmacLiteConfig.TxPingPong != 0) {
+		instancep->NextTxBufferToUse ^= XEL_BUFFER_OFFSET;
+	}
+
+	dst = (volatile u32 *)baseaddr;
+	for (q = p; q != NULL; q = q->next) {
+		const u8 *src = (const u8 *)q->payload;
+		u16_t len = q->len;
+
+		/* complete the word left open by the previous segment */
+		while (fill != 0 && len > 0) {
+			wordp[fill++] = *src++;
+			len--;
+			if (fill == 4) {
+				*dst++ = word;
+				fill = 0;
+			}
+		}
+
+		if (((UINTPTR)src & 3) == 0) {
+			for (; len >= 4; len -= 4, src += 4)
+				*dst++ = *(const u32 *)src;
+		} else {
+			for (; len >= 4; len -= 4, src += 4) {
+				memcpy(&word, src, 4);
+				*dst++ = word;
+			}
+		}
+
+		while (len > 0) {
+			wordp[fill++] = *src++;
+			len--;
+		}
+	}
+	if (fill != 0)
+		*dst = word;
+
+	XEmacLite_WriteReg(baseaddr, XEL_TPLR_OFFSET,
+			   (p->tot_len & (XEL_TPLR_LENGTH_MASK_HI |
+					  XEL_TPLR_LENGTH_MASK_LO)));
+
+	/* see XEmacLite_Send for the ACTIVE flag */
+	reg = XEmacLite_GetTxStatus(baseaddr) | XEL_TSR_XMIT_BUSY_MASK;
+	if (XEmacLite_GetTxStatus(instancep->EmacLiteConfig.BaseAddress) &
+	    XEL_TSR_XMIT_IE_MASK)
+		reg |= XEL_TSR_XMIT_ACTIVE_MASK;
+	XEmacLite_SetTxStatus(baseaddr, reg);
+
+	return 0;
+}
+
 /*
  * this function is always called with interrupts off
- * this function also assumes that there is space to send in the Emaclite buffer
+ * returns ERR_IF if both Emaclite TX buffers are busy
  */
 static err_t
 _unbuffered_low_level_output(XEmacLite *instancep, struct pbuf *p)
 {
-	struct pbuf *q;
-	int total_len = 0;
+	err_t err = ERR_OK;
 
 #if ETH_PAD_SIZE
 	pbuf_header(p, -ETH_PAD_SIZE);			/* drop the padding word */
 #endif
 
-	for(q = p, total_len = 0; q != NULL; q = q->next) {
-		/* Send the data from the pbuf to the interface, one pbuf at a
-		   time. The size of the data in each pbuf is kept in the ->len
-		   variable. */
-		memcpy(xemac_tx_frame + total_len, q->payload, q->len);
-		total_len += q->len;
-	}
-
-	if (transmit_packet(instancep, xemac_tx_frame, total_len) < 0) {
+	if (p->tot_len > XEL_MAX_TX_FRAME_SIZE) {
 #if LINK_STATS
+		lwip_stats.link.lenerr++;
 		lwip_stats.link.drop++;
 #endif
+	} else if (xemaclite_write_frame(instancep, p) < 0) {
+		err = ERR_IF;
+	} else {
+#if LINK_STATS
+		lwip_stats.link.xmit++;
+#endif /* LINK_STATS */
 	}
 
 #if ETH_PAD_SIZE
 	pbuf_header(p, ETH_PAD_SIZE);			/* reclaim the padding word */
 #endif
 
-#if LINK_STATS
-	lwip_stats.link.xmit++;
-#endif /* LINK_STATS */
+	return err;
+}
 
-	return ERR_OK;
+/*
+ * Move frames from send_q into the free Emaclite TX buffers. Both the ping
+ * and the pong buffer are refilled when they are available.
+ * Must be called with interrupts off.
+ */
+static void
+xemaclite_drain_send_q(xemacliteif_s *xemacliteif)
+{
+	struct pbuf *p;
+
+	while (pq_qlength(xemacliteif->send_q) &&
+	       XEmacLite_TxBufferAvailable(xemacliteif->instance) == TRUE) {
+		p = (struct pbuf *)pq_dequeue(xemacliteif->send_q);
+		_unbuffered_low_level_output(xemacliteif->instance, p);
+		pbuf_free(p);
+	}
 }
 
 /*
@@ -296,27 +388,33 @@ low_level_output(struct netif *netif, struct pbuf *p)
 	SYS_ARCH_DECL_PROTECT(lev);
 	struct xemac_s *xemac = (struct xemac_s *)(netif->state);
 	xemacliteif_s *xemacliteif = (xemacliteif_s *)(xemac->state);
-	XEmacLite *instance = xemacliteif->instance;
 	struct pbuf *q;
 
 	SYS_ARCH_PROTECT(lev);
 
-	/* check if space is available to send */
-        if (XEmacLite_TxBufferAvailable(instance) == TRUE) {
-		if (pq_qlength(xemacliteif->send_q)) {  	/* send backlog */
-			_unbuffered_low_level_output(instance, (struct pbuf *)pq_dequeue(xemacliteif->send_q));
-		} else { 				/* send current */
-			_unbuffered_low_level_output(instance, p);
-			SYS_ARCH_UNPROTECT(lev);
-			return ERR_OK;
-		}
+	/* send the backlog first to keep the frame order */
+	xemaclite_drain_send_q(xemacliteif);
+	if (pq_qlength(xemacliteif->send_q) == 0 &&
+	    _unbuffered_low_level_output(xemacliteif->instance, p) == ERR_OK) {
+		SYS_ARCH_UNPROTECT(lev);
+		return ERR_OK;
 	}
 
-	/* if we cannot send the packet immediately, then make a copy of the whole packet
-	 * into a separate pbuf and store it in send_q. We cannot enqueue the pbuf as is
-	 * since parts of the pbuf may be modified inside lwIP.
+	/* if we cannot send the packet immediately, store a reference in send_q.
+	 * lwIP does not modify a referenced pbuf (TCP checks the reference count
+	 * before a retransmission). Only pbufs pointing to volatile memory
+	 * (PBUF_REF) are copied, as etharp does for its queue.
 	 */
-	q = pbuf_alloc(PBUF_RAW, p->tot_len, PBUF_POOL);
+	for (q = p; q != NULL; q = q->next) {
+		if (PBUF_NEEDS_COPY(q))
+			break;
+	}
+	if (q != NULL) {
+		q = pbuf_clone(PBUF_RAW, PBUF_POOL, p);
+	} else {
+		pbuf_ref(p);
+		q = p;
+	}
 	if (!q) {
 #if LINK_STATS
 		lwip_stats.link.drop++;
@@ -325,14 +423,11 @@ low_level_output(struct netif *netif, struct pbuf *p)
 		return ERR_MEM;
 	}
 
-	for (q->len = 0; p; p = p->next) {
-		memcpy(q->payload + q->len, p->payload, p->len);
-		q->len += p->len;
-	}
 	if (pq_enqueue(xemacliteif->send_q, (void *)q) < 0) {
 #if LINK_STATS
 		lwip_stats.link.drop++;
 #endif
+		pbuf_free(q);
 		SYS_ARCH_UNPROTECT(lev);
 		return ERR_MEM;
 	}
@@ -346,7 +441,6 @@ static void
 xemacif_send_handler(void *arg) {
 	struct xemac_s *xemac = (struct xemac_s *)(arg);
 	xemacliteif_s *xemacliteif = (xemacliteif_s *)(xemac->state);
-	XEmacLite *instance = xemacliteif->instance;
 	struct xtopology_t *xtopologyp = &xtopology[xemac->topology_index];
 
 #ifdef OS_IS_FREERTOS
@@ -357,11 +451,7 @@ xemacif_send_handler(void *arg) {
 	XIntc_AckIntr(xtopologyp->intc_baseaddr, 1 << xtopologyp->intc_emac_intr);
 #endif
 
-	if (pq_qlength(xemacliteif->send_q) && (XEmacLite_TxBufferAvailable(instance) == TRUE)) {
-		struct pbuf *p = pq_dequeue(xemacliteif->send_q);
-		_unbuffered_low_level_output(instance, p);
-		pbuf_free(p);
-	}
+	xemaclite_drain_send_q(xemacliteif);
 #ifdef OS_IS_FREERTOS
 	xInsideISR--;
 #endif
@@ -379,13 +469,38 @@ low_level_input(struct netif *netif)
 {
 	struct xemac_s *xemac = (struct xemac_s *)(netif->state);
 	xemacliteif_s *xemacliteif = (xemacliteif_s *)(xemac->state);
+	XEmacLite *instance = xemacliteif->instance;
+	struct pbuf *p;
+	u16 len;
 
 	/* see if there is data to process */
-	if (pq_qlength(xemacliteif->recv_q) == 0)
+	if (!xemaclite_rx_pending(instance))
 		return NULL;
 
-	/* return one packet from receive q */
-	return (struct pbuf *)pq_dequeue(xemacliteif->recv_q);
+	p = pbuf_alloc(PBUF_RAW, XEL_MAX_FRAME_SIZE, PBUF_POOL);
+	if (!p) {
+#if LINK_STATS
+		lwip_stats.link.memerr++;
+		lwip_stats.link.drop++;
+#endif
+		xemacliteif->rx_stats.drop_nomem++;
+		/* receive and just ignore the frame to free the buffer */
+		XEmacLite_Recv(instance, xemac_tx_frame);
+		return NULL;
+	}
+
+	len = XEmacLite_Recv(instance, p->payload);
+	if (len == 0) {
+#if LINK_STATS
+		lwip_stats.link.drop++;
+#endif
+		xemacliteif->rx_stats.drop_recv++;
+		pbuf_free(p);
+		return NULL;
+	}
+	pbuf_realloc(p, len);
+
+	return p;
 }
 
 /*
@@ -413,29 +528,37 @@ xemacliteif_output(struct netif *netif, struct pbuf *p,
  * should handle the actual reception of bytes from the network
  * interface.
  *
- * Returns the number of packets read (max 1 packet on success,
- * 0 if there are no packets)
+ * Returns the number of packets read from the receive buffers, at most
+ * XEMACLITEIF_RX_BUDGET (0 if there are no packets). Only the packets
+ * that were passed to lwIP are counted in the receive statistics.
  *
  */
 int
 xemacliteif_input(struct netif *netif)
 {
+	struct xemac_s *xemac = (struct xemac_s *)(netif->state);
+	xemacliteif_s *xemacliteif = (xemacliteif_s *)(xemac->state);
 	struct eth_hdr *ethhdr;
 	struct pbuf *p;
+	int n_packets = 0;
+	int n_passed = 0;
+	int budget;
 	SYS_ARCH_DECL_PROTECT(lev);
 
-#ifdef OS_IS_FREERTOS
-	while (1)
-#endif
-	{
-		SYS_ARCH_PROTECT(lev);
+	for (budget = XEMACLITEIF_RX_BUDGET; budget > 0; budget--) {
 		/* move received packet into a new pbuf */
 		p = low_level_input(netif);
-		SYS_ARCH_UNPROTECT(lev);
 
-		/* no packet could be read, silently ignore this */
-		if (p == NULL)
-			return 0;
+		/* no packet could be read */
+		if (p == NULL) {
+			/* a frame dropped for lack of pbufs leaves a free
+			 * buffer, so keep polling */
+			if (xemaclite_rx_pending(xemacliteif->instance))
+				continue;
+			break;
+		}
+
+		n_packets++;
 
 		/* points to packet payload, which starts with an Ethernet header */
 		ethhdr = p->payload;
@@ -456,19 +579,99 @@ xemacliteif_input(struct netif *netif)
 				/* full packet send to tcpip_thread to process */
 				if (netif->input(p, netif) != ERR_OK) {
 					LWIP_DEBUGF(NETIF_DEBUG, ("xlltemacif_input: IP input error\r\n"));
+					xemacliteif->rx_stats.drop_input++;
 					pbuf_free(p);
 					p = NULL;
+				} else {
+					n_passed++;
+				}
+				break;
+
+			/* 802.1Q tagged frame. Only tagged UADP frames are passed
+			 * on, unless lwIP itself is built with VLAN support. */
+			case ETHTYPE_VLAN:
+				if (!ETHARP_SUPPORT_VLAN &&
+				    (p->len < SIZEOF_ETH_HDR + SIZEOF_VLAN_HDR ||
+				     htons(((struct eth_vlan_hdr *)((u8_t *)ethhdr +
+				            SIZEOF_ETH_HDR))->tpid) != 0xB62C)) {
+					xemacliteif->rx_stats.drop_type++;
+					pbuf_free(p);
+					p = NULL;
+					break;
+				}
+				/* fall through */
+			/* OPC UA PubSub UADP frame, taken from netif->input by
+			 * the Ethernet transport of open62541 */
+			case 0xB62C:
+				/* full packet send to tcpip_thread to process */
+				if (netif->input(p, netif) != ERR_OK) {
+					LWIP_DEBUGF(NETIF_DEBUG, ("xlltemacif_input: IP input error\r\n"));
+					xemacliteif->rx_stats.drop_input++;
+					pbuf_free(p);
+					p = NULL;
+				} else {
+					n_passed++;
 				}
 				break;
 
 			default:
+				xemacliteif->rx_stats.drop_type++;
 				pbuf_free(p);
 				p = NULL;
 				break;
 			}
 	}
 
-	return 1;
+	SYS_ARCH_PROTECT(lev);
+	xemacliteif->rx_stats.frames += n_passed;
+	xemacliteif->rx_frames += n_passed;
+	if (!xemacliteif->rx_polling) {
+		/* polled without a receive interrupt (NO_SYS main loop) */
+		SYS_ARCH_UNPROTECT(lev);
+		return n_packets;
+	}
+
+	if (budget == 0) {
+		/* more frames may be pending, continue in the next call */
+		xemacliteif->rx_stats.budget_exhausted++;
+		SYS_ARCH_UNPROTECT(lev);
+#if !NO_SYS
+		sys_sem_signal(&xemac->sem_rx_data_available);
+#endif
+		return n_packets;
+	}
+
+	/* the receive buffers are empty, end the polling round. A frame that
+	 * completed before the interrupt was unmasked raised no interrupt, so
+	 * check once more afterwards. */
+	xemaclite_set_rx_interrupt(xemacliteif->instance, 1);
+	if (xemaclite_rx_pending(xemacliteif->instance)) {
+		xemaclite_set_rx_interrupt(xemacliteif->instance, 0);
+		SYS_ARCH_UNPROTECT(lev);
+#if !NO_SYS
+		sys_sem_signal(&xemac->sem_rx_data_available);
+#endif
+		return n_packets;
+	}
+	if (xemacliteif->rx_frames > xemacliteif->rx_stats.max_frames_per_wakeup)
+		xemacliteif->rx_stats.max_frames_per_wakeup = xemacliteif->rx_frames;
+	xemacliteif->rx_frames = 0;
+	xemacliteif->rx_polling = 0;
+	SYS_ARCH_UNPROTECT(lev);
+
+	return n_packets;
+}
+
+void
+xemacliteif_get_rx_stats(struct netif *netif, xemacliteif_rx_stats *stats)
+{
+	struct xemac_s *xemac = (struct xemac_s *)(netif->state);
+	xemacliteif_s *xemacliteif = (xemacliteif_s *)(xemac->state);
+	SYS_ARCH_DECL_PROTECT(lev);
+
+	SYS_ARCH_PROTECT(lev);
+	*stats = xemacliteif->rx_stats;
+	SYS_ARCH_UNPROTECT(lev);
 }
 
 #if !NO_SYS
@@ -602,6 +805,10 @@ static err_t low_level_init(struct netif *netif)
 	/* flush any frames already received */
 	XEmacLite_FlushReceive(xemaclitep);
 
+	xemacliteif->rx_polling = 0;
+	xemacliteif->rx_frames = 0;
+	memset(&xemacliteif->rx_stats, 0, sizeof xemacliteif->rx_stats);
+
 	/* set Rx, Tx interrupt handlers */
 	XEmacLite_SetRecvHandler(xemaclitep, (void *)(xemac), xemacif_recv_handler);
 	XEmacLite_SetSendHandler(xemaclitep, (void *)(xemac), xemacif_send_handler);
@@ -622,10 +829,6 @@ static err_t low_level_init(struct netif *netif)
 	netif->state = (void *)xemac;
 
 	xemacliteif->instance = xemaclitep;
-	xemacliteif->recv_q = pq_create_queue();
-	if (!xemacliteif->recv_q)
-		return ERR_MEM;
-
 	xemacliteif->send_q = pq_create_queue();
 	if (!xemacliteif->send_q)
 		return ERR_MEM;
@@ -0,0 +1,537 @@
+/*
+ * Host test of the emaclite transmit path with a register model, and of the
+ * EtherType dispatch of the receive path.
+ *
+ * The driver source is included, the EmacLite registers are an array in host
+ * memory. The test plays the part of the hardware by clearing the busy bits of
+ * a TX buffer. Received frames are handed out by a model of XEmacLite_Recv
+ * that signals them in the RX status register. Build and run from this
+ * directory with:
+ *
+ *   gcc -std=gnu99 -I. -I../../../../../../../include \
+ *       -ffunction-sections -Wl,--gc-sections \
+ *       check_xemaclite_tx.c ../netif/xpqueue.c \
+ *       ../../../../../../emaclite_v4_4/src/xemaclite.c \
+ *       ../../../../../../standalone_v7_0/src/xil_assert.c \
+ *       -o check_xemaclite_tx
+ *   ./check_xemaclite_tx
+ *
+ * The pbufs are built by the test, only the pbuf functions used by the
+ * transmit and the receive path are modelled.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* The interrupt lock of the target is not needed with a single thread */
+#define SYS_ARCH_DECL_PROTECT(lev)
+#define SYS_ARCH_PROTECT(lev)
+#define SYS_ARCH_UNPROTECT(lev)
+
+/* The interrupt controller is not modelled */
+#include "xintc.h"
+#undef XIntc_AckIntr
+#define XIntc_AckIntr(BaseAddress, AckMask)
+
+/* Received frames come from the model below */
+#define XEmacLite_Recv model_recv
+#include "xemaclite.h"
+
+#include "../netif/xemacliteif.c"
+
+#define TSR(buf)	((buf) + XEL_TSR_OFFSET)
+#define TPLR(buf)	((buf) + XEL_TPLR_OFFSET)
+#define PING		0
+#define PONG		XEL_BUFFER_OFFSET
+
+static int failures = 0;
+
+#define CHECK(cond) do {						\
+		if (!(cond)) {						\
+			printf("%s:%d: check failed: %s\n",		\
+			       __FILE__, __LINE__, #cond);		\
+			failures++;					\
+		}							\
+	} while (0)
+
+/* EmacLite register space: ping and pong TX buffers, then the RX buffers.
+ * The pong buffer is found by toggling XEL_BUFFER_OFFSET in the address, so
+ * the space is aligned as the address range of the IP. */
+static u32 regs[0x2000 / 4] __attribute__ ((aligned (0x2000)));
+static u8 *const regbytes = (u8 *)regs;
+
+static XEmacLite instance;
+static xemacliteif_s xemacliteif;
+static struct xemac_s xemac;
+static struct netif netif;
+
+struct xtopology_t xtopology[1];
+
+#if LWIP_STATS
+struct stats_ lwip_stats;
+#endif
+
+static int live_clones = 0;
+
+/* Frames waiting in the receive model and frames passed to netif->input */
+#define RX_FRAMES 8
+static const u8 *rx_frame[RX_FRAMES];
+static u16 rx_len[RX_FRAMES];
+static int rx_head, rx_tail;
+static int input_frames;
+static u16 input_type[RX_FRAMES];
+
+/*
+ * pbuf model
+ */
+
+static void
+make_pbuf(struct pbuf *p, u8_t type, void *payload, u16_t len)
+{
+	memset(p, 0, sizeof(*p));
+	p->payload = payload;
+	p->len = len;
+	p->tot_len = len;
+	p->type_internal = type;
+	p->ref = 1;
+}
+
+static void
+chain_pbuf(struct pbuf *h, struct pbuf *t)
+{
+	struct pbuf *q;
+
+	for (q = h; q->next != NULL; q = q->next)
+		q->tot_len += t->tot_len;
+	q->tot_len += t->tot_len;
+	q->next = t;
+}
+
+void
+pbuf_ref(struct pbuf *p)
+{
+	p->ref++;
+}
+
+u8_t
+pbuf_free(struct pbuf *p)
+{
+	u8_t count = 0;
+
+	while (p != NULL && --p->ref == 0) {
+		struct pbuf *next = p->next;
+		if (p->type_internal == (u8_t)PBUF_POOL) {
+			live_clones--;
+			free(p);
+		}
+		count++;
+		p = next;
+	}
+	return count;
+}
+
+struct pbuf *
+pbuf_clone(pbuf_layer layer, pbuf_type type, struct pbuf *p)
+{
+	struct pbuf *c = malloc(sizeof(struct pbuf) + p->tot_len);
+	struct pbuf *q;
+	u16_t offset = 0;
+
+	(void)layer;
+	make_pbuf(c, (u8_t)type, c + 1, p->tot_len);
+	for (q = p; q != NULL; q = q->next) {
+		memcpy((u8 *)c->payload + offset, q->payload, q->len);
+		offset += q->len;
+	}
+	live_clones++;
+	return c;
+}
+
+struct pbuf *
+pbuf_alloc(pbuf_layer layer, u16_t length, pbuf_type type)
+{
+	struct pbuf *p = malloc(sizeof(struct pbuf) + length);
+
+	(void)layer;
+	make_pbuf(p, (u8_t)type, p + 1, length);
+	live_clones++;
+	return p;
+}
+
+void
+pbuf_realloc(struct pbuf *p, u16_t new_len)
+{
+	p->len = new_len;
+	p->tot_len = new_len;
+}
+
+void
+xil_printf(const char8 *ctrl1, ...)
+{
+	(void)ctrl1;
+}
+
+/* The host is little endian like the MicroBlaze of the board */
+u16_t
+lwip_htons(u16_t n)
+{
+	return (u16_t)(((n & 0xff) << 8) | ((n & 0xff00) >> 8));
+}
+
+/* Wakeups of the input thread */
+static int rx_wakeups;
+
+void
+sys_sem_signal(sys_sem_t *sem)
+{
+	(void)sem;
+	rx_wakeups++;
+}
+
+/*
+ * hardware model
+ */
+
+static void
+rx_signal(void)
+{
+	if (rx_head != rx_tail)
+		regs[XEL_RSR_OFFSET / 4] |= XEL_RSR_RECV_DONE_MASK;
+	else
+		regs[XEL_RSR_OFFSET / 4] &= ~XEL_RSR_RECV_DONE_MASK;
+}
+
+static void
+rx_push(const u8 *frame, u16 len)
+{
+	rx_frame[rx_tail % RX_FRAMES] = frame;
+	rx_len[rx_tail % RX_FRAMES] = len;
+	rx_tail++;
+	rx_signal();
+}
+
+u16
+model_recv(XEmacLite *instancep, u8 *frame)
+{
+	u16 len;
+
+	(void)instancep;
+	if (rx_head == rx_tail)
+		return 0;
+	len = rx_len[rx_head % RX_FRAMES];
+	memcpy(frame, rx_frame[rx_head % RX_FRAMES], len);
+	rx_head++;
+	rx_signal();
+	return len;
+}
+
+static err_t
+model_input(struct pbuf *p, struct netif *inp)
+{
+	const u8 *frame = p->payload;
+
+	(void)inp;
+	input_type[input_frames % RX_FRAMES] = (u16)((frame[12] << 8) | frame[13]);
+	input_frames++;
+	pbuf_free(p);
+	return ERR_OK;
+}
+
+static void
+complete(UINTPTR buf)
+{
+	regs[TSR(buf) / 4] &= ~(XEL_TSR_XMIT_BUSY_MASK |
+				XEL_TSR_XMIT_ACTIVE_MASK);
+}
+
+static int
+busy(UINTPTR buf)
+{
+	return (regs[TSR(buf) / 4] & XEL_TSR_XMIT_BUSY_MASK) != 0;
+}
+
+static int
+sent(UINTPTR buf, const u8 *frame, u16_t len)
+{
+	return regs[TPLR(buf) / 4] == len &&
+	       memcmp(regbytes + buf, frame, len) == 0;
+}
+
+static void
+fill(u8 *data, size_t len, u8 seed)
+{
+	size_t i;
+
+	for (i = 0; i < len; i++)
+		data[i] = (u8)(seed + i * 7);
+}
+
+static void
+setup(void)
+{
+	memset(regs, 0, sizeof(regs));
+	/* the interrupts are enabled in the TSR of the ping buffer */
+	regs[TSR(PING) / 4] = XEL_TSR_XMIT_IE_MASK;
+
+	memset(&instance, 0, sizeof(instance));
+	instance.EmacLiteConfig.BaseAddress = (UINTPTR)regs;
+	instance.EmacLiteConfig.TxPingPong = 1;
+	instance.NextTxBufferToUse = 0;
+	instance.IsReady = XIL_COMPONENT_IS_READY;
+
+	xemacliteif.instance = &instance;
+	if (xemacliteif.send_q == NULL)
+		xemacliteif.send_q = pq_create_queue();
+	while (pq_qlength(xemacliteif.send_q))
+		pbuf_free(pq_dequeue(xemacliteif.send_q));
+
+	xemac.state = &xemacliteif;
+	xemac.topology_index = 0;
+	netif.state = &xemac;
+	netif.input = model_input;
+
+	memset(&xemacliteif.rx_stats, 0, sizeof(xemacliteif.rx_stats));
+	xemacliteif.rx_frames = 0;
+	xemacliteif.rx_polling = 1;
+	rx_head = rx_tail = 0;
+	input_frames = 0;
+}
+
+static void
+make_frame(u8 *frame, size_t len, u16 type, u16 inner)
+{
+	memset(frame, 0, len);
+	memset(frame, 0xff, 6);
+	frame[12] = (u8)(type >> 8);
+	frame[13] = (u8)type;
+	if (type == ETHTYPE_VLAN) {
+		frame[14] = 0x00;	/* priority 0, VLAN 5 */
+		frame[15] = 0x05;
+		frame[16] = (u8)(inner >> 8);
+		frame[17] = (u8)inner;
+	} else {
+		/* first payload bytes, e.g. IP version and total length */
+		frame[14] = 0x45;
+		frame[16] = 0x00;
+		frame[17] = 0x2e;
+	}
+}
+
+/* A chain with unaligned segments is gathered into whole words */
+static void
+test_gather(void)
+{
+	static u8 data[128];
+	u8 frame[62];
+	struct pbuf a, b, c;
+
+	setup();
+	fill(data, sizeof(data), 1);
+	make_pbuf(&a, (u8_t)PBUF_RAM, data + 1, 5);
+	make_pbuf(&b, (u8_t)PBUF_RAM, data + 9, 7);
+	make_pbuf(&c, (u8_t)PBUF_RAM, data + 19, 50);
+	chain_pbuf(&a, &b);
+	chain_pbuf(&a, &c);
+	memcpy(frame, data + 1, 5);
+	memcpy(frame + 5, data + 9, 7);
+	memcpy(frame + 12, data + 19, 50);
+
+	CHECK(low_level_output(&netif, &a) == ERR_OK);
+	CHECK(sent(PING, frame, sizeof(frame)));
+	CHECK(regs[TSR(PING) / 4] == (XEL_TSR_XMIT_IE_MASK |
+				      XEL_TSR_XMIT_BUSY_MASK |
+				      XEL_TSR_XMIT_ACTIVE_MASK));
+	CHECK(instance.NextTxBufferToUse == XEL_BUFFER_OFFSET);
+	CHECK(a.ref == 1);
+	CHECK(pq_qlength(xemacliteif.send_q) == 0);
+}
+
+/* Frames alternate between the ping and the pong buffer. Once both are busy,
+ * frames are queued by reference and sent in order from the send
+ * interrupt. */
+static void
+test_pingpong(void)
+{
+	static u8 data[4][64];
+	static u8 volatile_data[64];
+	struct pbuf p[4];
+	int i;
+
+	setup();
+	for (i = 0; i < 4; i++) {
+		fill(data[i], sizeof(data[i]), (u8)(0x40 * i));
+		make_pbuf(&p[i], (u8_t)PBUF_RAM, data[i], sizeof(data[i]));
+	}
+	/* the last frame points to memory that lwIP reuses */
+	memcpy(volatile_data, data[3], sizeof(volatile_data));
+	make_pbuf(&p[3], (u8_t)PBUF_REF, volatile_data, sizeof(volatile_data));
+
+	CHECK(low_level_output(&netif, &p[0]) == ERR_OK);
+	CHECK(low_level_output(&netif, &p[1]) == ERR_OK);
+	CHECK(sent(PING, data[0], 64) && busy(PING));
+	CHECK(sent(PONG, data[1], 64) && busy(PONG));
+
+	/* both busy: a reference is queued, the volatile frame is cloned */
+	CHECK(low_level_output(&netif, &p[2]) == ERR_OK);
+	CHECK(p[2].ref == 2);
+	CHECK(low_level_output(&netif, &p[3]) == ERR_OK);
+	CHECK(p[3].ref == 1);
+	CHECK(live_clones == 1);
+	CHECK(pq_qlength(xemacliteif.send_q) == 2);
+	memset(volatile_data, 0, sizeof(volatile_data));
+
+	/* the ping buffer completes: the first queued frame follows */
+	complete(PING);
+	xemacif_send_handler(&xemac);
+	CHECK(sent(PING, data[2], 64) && busy(PING));
+	CHECK(p[2].ref == 1);
+	CHECK(pq_qlength(xemacliteif.send_q) == 1);
+
+	/* the clone goes out of the pong buffer and is freed */
+	complete(PONG);
+	xemacif_send_handler(&xemac);
+	CHECK(sent(PONG, data[3], 64) && busy(PONG));
+	CHECK(live_clones == 0);
+	CHECK(pq_qlength(xemacliteif.send_q) == 0);
+}
+
+/* Both buffers are refilled from the queue in a single send interrupt */
+static void
+test_refill_both(void)
+{
+	static u8 data[4][60];
+	struct pbuf p[4];
+	int i;
+
+	setup();
+	for (i = 0; i < 4; i++) {
+		fill(data[i], sizeof(data[i]), (u8)(0x11 * i));
+		make_pbuf(&p[i], (u8_t)PBUF_RAM, data[i], sizeof(data[i]));
+		CHECK(low_level_output(&netif, &p[i]) == ERR_OK);
+	}
+	CHECK(pq_qlength(xemacliteif.send_q) == 2);
+
+	complete(PING);
+	complete(PONG);
+	xemacif_send_handler(&xemac);
+	CHECK(sent(PING, data[2], 60) && busy(PING));
+	CHECK(sent(PONG, data[3], 60) && busy(PONG));
+	CHECK(p[2].ref == 1 && p[3].ref == 1);
+	CHECK(pq_qlength(xemacliteif.send_q) == 0);
+}
+
+/* The backlog is sent before a new frame */
+static void
+test_order(void)
+{
+	static u8 data[4][60];
+	struct pbuf p[4];
+	int i;
+
+	setup();
+	for (i = 0; i < 4; i++) {
+		fill(data[i], sizeof(data[i]), (u8)(0x23 * i));
+		make_pbuf(&p[i], (u8_t)PBUF_RAM, data[i], sizeof(data[i]));
+	}
+	for (i = 0; i < 3; i++)
+		CHECK(low_level_output(&netif, &p[i]) == ERR_OK);
+
+	/* a buffer is free, but the queued frame goes first */
+	complete(PING);
+	CHECK(low_level_output(&netif, &p[3]) == ERR_OK);
+	CHECK(sent(PING, data[2], 60));
+	CHECK(p[2].ref == 1);
+	CHECK(p[3].ref == 2);
+	CHECK(pq_qlength(xemacliteif.send_q) == 1);
+	CHECK(pq_dequeue(xemacliteif.send_q) == &p[3]);
+	pbuf_free(&p[3]);
+}
+
+/* A frame that does not fit into a TX buffer is dropped */
+static void
+test_oversized(void)
+{
+	static u8 data[XEL_MAX_TX_FRAME_SIZE + 1];
+	struct pbuf p;
+
+	setup();
+	make_pbuf(&p, (u8_t)PBUF_RAM, data, sizeof(data));
+	CHECK(low_level_output(&netif, &p) == ERR_OK);
+	CHECK(!busy(PING) && !busy(PONG));
+	CHECK(instance.NextTxBufferToUse == 0);
+	CHECK(p.ref == 1);
+	CHECK(pq_qlength(xemacliteif.send_q) == 0);
+}
+
+/* IP, ARP and UADP frames, tagged or not, are passed to netif->input.
+ * Tagged frames of other EtherTypes and unknown EtherTypes are dropped. */
+static void
+test_rx_dispatch(void)
+{
+	static u8 frames[6][60];
+	static const u16 types[6][2] = {
+		{ ETHTYPE_IP, 0 },
+		{ ETHTYPE_ARP, 0 },
+		{ 0xB62C, 0 },
+		{ ETHTYPE_VLAN, 0xB62C },
+		{ ETHTYPE_VLAN, ETHTYPE_IP },
+		{ 0x88CC, 0 },		/* LLDP */
+	};
+	int i;
+
+	setup();
+	for (i = 0; i < 6; i++) {
+		make_frame(frames[i], sizeof(frames[i]), types[i][0], types[i][1]);
+		rx_push(frames[i], sizeof(frames[i]));
+	}
+
+	CHECK(xemacliteif_input(&netif) == 6);
+	CHECK(input_frames == 4);
+	CHECK(input_type[0] == ETHTYPE_IP);
+	CHECK(input_type[1] == ETHTYPE_ARP);
+	CHECK(input_type[2] == 0xB62C);
+	CHECK(input_type[3] == ETHTYPE_VLAN);
+	CHECK(xemacliteif.rx_stats.drop_type == 2);
+	CHECK(xemacliteif.rx_stats.drop_input == 0);
+	CHECK(xemacliteif.rx_stats.frames == 4);
+	CHECK(xemacliteif.rx_stats.max_frames_per_wakeup == 4);
+	CHECK(live_clones == 0);
+	CHECK(!xemaclite_rx_pending(&instance));
+}
+
+/* A frame that XEmacLite_Recv cannot read (returns 0) is counted as
+ * dropped and does not stop the frames behind it */
+static void
+test_rx_unreadable(void)
+{
+	static u8 frames[3][60];
+	int i;
+
+	setup();
+	for (i = 0; i < 3; i++) {
+		make_frame(frames[i], sizeof(frames[i]), ETHTYPE_IP, 0);
+		rx_push(frames[i], i == 1 ? 0 : sizeof(frames[i]));
+	}
+
+	CHECK(xemacliteif_input(&netif) == 2);
+	CHECK(input_frames == 2);
+	CHECK(xemacliteif.rx_stats.drop_recv == 1);
+	CHECK(xemacliteif.rx_stats.frames == 2);
+	CHECK(live_clones == 0);
+	CHECK(!xemaclite_rx_pending(&instance));
+}
+
+int
+main(void)
+{
+	test_gather();
+	test_pingpong();
+	test_refill_both();
+	test_order();
+	test_oversized();
+	test_rx_dispatch();
+	test_rx_unreadable();
+	if (failures == 0)
+		printf("All checks passed\n");
+	return failures != 0;
+}
@@ -0,0 +1,8 @@
+/*
+ * Host stand-in for the MicroBlaze special purpose register intrinsics.
+ * xil_io.h includes it, but the host tests in this directory only use the
+ * plain memory accessors of xil_io.h.
+ */
+#ifndef XPSEUDO_ASM_H
+#define XPSEUDO_ASM_H
+#endif
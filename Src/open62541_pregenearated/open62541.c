@@ -4766,9 +4766,14 @@ UA_SecureChannel_sendSymmetricMessage(UA_SecureChannel *channel, UA_UInt32 reque
                                       UA_MessageType messageType, void *payload,
                                       const UA_DataType *payloadType);
 
+#ifndef UA_MESSAGECONTEXT_PENDINGCHUNKS
+# define UA_MESSAGECONTEXT_PENDINGCHUNKS 8
+#endif
+
 /* The MessageContext is forwarded into the encoding layer so that we can send
  * chunks before continuing to encode. This lets us reuse a fixed chunk-sized
- * messages buffer. */
+ * messages buffer. If the connection supports sendMany, finished chunks are
+ * queued and handed to the network layer together. */
 typedef struct {
     UA_SecureChannel *channel;
     UA_UInt32 requestId;
@@ -4781,6 +4786,10 @@ typedef struct {
     UA_Byte *buf_pos;
     const UA_Byte *buf_end;
 
+    /* Finished (signed and encrypted) chunks that are not yet sent */
+    UA_ByteString pendingChunks[UA_MESSAGECONTEXT_PENDINGCHUNKS];
+    size_t pendingChunksSize;
+
     UA_Boolean final;
 } UA_MessageContext;
 
@@ -4796,6 +4805,11 @@ UA_StatusCode
 UA_MessageContext_encode(UA_MessageContext *mc, const void *content,
                          const UA_DataType *contentType);
 
+/* Append content that is already binary encoded. Full chunks are sent out.
+ * The error handling is the same as for _encode. */
+UA_StatusCode
+UA_MessageContext_encodeRaw(UA_MessageContext *mc, const UA_ByteString *encoded);
+
 /* Sends a symmetric message already encoded in the context. The context is
  * cleaned up, also in case of errors. */
 UA_StatusCode
@@ -5025,11 +5039,32 @@ typedef struct UA_WorkQueue UA_WorkQueue;
 
 #if UA_MULTITHREADING >= 200
 
-/* Workers take out callbacks from the work queue and execute them.
- *
- * Future Plans: Use work-stealing to load-balance between cores.
- * Le, Nhat Minh, et al. "Correct and efficient work-stealing for weak memory
- * models." ACM SIGPLAN Notices. Vol. 48. No. 8. ACM, 2013. */
+/* Bounded lock-free multi-producer/multi-consumer ring after D. Vyukov. Every
+ * slot carries a sequence number that tells producers and consumers whether
+ * the slot is free or filled for the current lap. The callbacks are stored
+ * inline, so enqueueing work does not allocate. */
+#ifndef UA_WORKRING_SIZE
+# define UA_WORKRING_SIZE 512 /* Must be a power of two */
+#endif
+
+typedef struct {
+    volatile size_t sequence;
+    UA_ApplicationCallback callback;
+    void *application;
+    void *data;
+} UA_WorkSlot;
+
+typedef struct {
+    volatile size_t enqueuePos;
+    char padding1[64 - sizeof(size_t)]; /* separate cache lines */
+    volatile size_t dequeuePos;
+    char padding2[64 - sizeof(size_t)];
+    UA_WorkSlot slots[UA_WORKRING_SIZE];
+} UA_WorkRing;
+
+/* Workers take out callbacks from the work queue and execute them. Every
+ * worker has its own ring. When the own ring is empty, the worker steals from
+ * the rings of the other workers before it goes to sleep. */
 typedef struct {
     pthread_t thread;
     volatile UA_Boolean running;
@@ -5041,6 +5076,8 @@ typedef struct {
     /* separate cache lines */
     char padding[64 - sizeof(void*) - sizeof(pthread_t) -
                  sizeof(UA_UInt32) - sizeof(UA_Boolean)];
+
+    UA_WorkRing ring;
 } UA_Worker;
 
 #endif
@@ -5052,9 +5089,12 @@ struct UA_WorkQueue {
     UA_Worker *workers;
     size_t workersSize;
 
-    /* Work queue */
-    SIMPLEQ_HEAD(, UA_DelayedCallback) dispatchQueue; /* Dispatch queue for the worker threads */
-    UA_LOCK_TYPE(dispatchQueue_accessMutex) /* mutex for access to queue */
+    /* Work is distributed round-robin over the worker rings */
+    volatile size_t nextWorker;
+
+    /* Workers sleep on the condition when there is no work in any ring. The
+     * producer only signals if a worker is sleeping. */
+    volatile size_t sleepingWorkers;
     pthread_cond_t dispatchQueue_condition; /* so the workers don't spin if the queue is empty */
     UA_LOCK_TYPE(dispatchQueue_conditionMutex) /* mutex for access to condition variable */
 #endif
@@ -5091,7 +5131,8 @@ UA_StatusCode UA_WorkQueue_start(UA_WorkQueue *wq, size_t workersCount);
 
 void UA_WorkQueue_stop(UA_WorkQueue *wq);
 
-/* Enqueue work for the worker threads */
+/* Enqueue work for the worker threads. If no worker is running or all rings
+ * are full, the callback is executed in the calling thread. */
 void UA_WorkQueue_enqueue(UA_WorkQueue *wq, UA_ApplicationCallback cb,
                           void *application, void *data);
 
@@ -5336,6 +5377,43 @@ _UA_BEGIN_DECLS
 struct UA_TimerEntry;
 typedef struct UA_TimerEntry UA_TimerEntry;
 
+#ifdef UA_ENABLE_TIMER_WHEEL
+
+/* Hashed timing wheel. Every entry is linked into the slot of the tick where
+ * it is due (modulo the number of slots). Insert, remove and re-arm are O(1).
+ * The entries are taken from a slab and the callback identifier encodes the
+ * slab index. So no lookup structure is needed for removal. The entries due in
+ * the same tick are executed in the order of their time. Entries with the same
+ * time are executed in the order in which they were added. */
+
+#ifndef UA_TIMERWHEEL_SLOTS
+# define UA_TIMERWHEEL_SLOTS 1024 /* Must be a power of two */
+#endif
+
+#ifndef UA_TIMERWHEEL_TICK
+# define UA_TIMERWHEEL_TICK UA_DATETIME_MSEC /* Resolution of a slot */
+#endif
+
+#define UA_TIMERWHEEL_CHUNKSIZE 64 /* Entries per slab chunk */
+
+TAILQ_HEAD(UA_TimerSlot, UA_TimerEntry);
+
+/* Only for a single thread. Protect by a mutex if required. */
+typedef struct {
+    struct UA_TimerSlot slots[UA_TIMERWHEEL_SLOTS];
+    UA_UInt64 occupied[UA_TIMERWHEEL_SLOTS / 64]; /* Bitmap of non-empty slots */
+    struct UA_TimerSlot due; /* Entries taken out of a slot for execution */
+    UA_DateTime currentTick; /* The last processed tick */
+
+    /* Slab of entries. The chunks are never moved, so pointers to the
+     * entries remain stable. */
+    UA_TimerEntry **chunks;
+    size_t chunksSize;
+    UA_TimerEntry *freeEntries;
+} UA_Timer;
+
+#else
+
 ZIP_HEAD(UA_TimerZip, UA_TimerEntry);
 typedef struct UA_TimerZip UA_TimerZip;
 
@@ -5349,6 +5427,8 @@ typedef struct {
     UA_UInt64 idCounter;
 } UA_Timer;
 
+#endif
+
 void UA_Timer_init(UA_Timer *t);
 
 UA_StatusCode
@@ -5692,11 +5772,73 @@ void UA_Notification_enqueue(UA_Server *server, UA_Subscription *sub,
  * global queue. Reduce the respective counters. */
 void UA_Notification_dequeue(UA_Server *server, UA_Notification *n);
 
-/* Delete the notification. Must be dequeued first. */
-void UA_Notification_delete(UA_Notification *n);
+/* Take a notification from the server's notification pool. Returns NULL if no
+ * more memory is available. */
+UA_Notification * UA_Notification_new(UA_Server *server);
+
+/* Delete the notification and return it to the pool. Must be dequeued
+ * first. */
+void UA_Notification_delete(UA_Server *server, UA_Notification *n);
 
 typedef TAILQ_HEAD(NotificationQueue, UA_Notification) NotificationQueue;
 
+/* Notifications are taken from slabs that are kept until the server is
+ * deleted. Unused notifications are linked in a free list via their listEntry.
+ * So the notification churn of bursty data changes does not fragment the
+ * heap. The pool grows up to config.maxNotifications (rounded up to whole
+ * slabs). */
+#ifndef UA_NOTIFICATION_SLABSIZE
+# define UA_NOTIFICATION_SLABSIZE 64
+#endif
+
+typedef struct UA_NotificationSlab {
+    struct UA_NotificationSlab *next;
+    UA_Notification notifications[UA_NOTIFICATION_SLABSIZE];
+} UA_NotificationSlab;
+
+typedef struct {
+    UA_NotificationSlab *slabs;
+    UA_Notification *freeList;
+    size_t size;           /* Notifications in all slabs */
+    size_t freeCount;      /* Notifications in the free list */
+    size_t poolExhausted;  /* The free list was empty */
+    size_t queueOverflows; /* Notifications discarded from a full queue */
+} UA_NotificationPool;
+
+void UA_NotificationPool_clear(UA_NotificationPool *pool);
+
+/* MonitoredItems with the same sampling interval share one repeated callback.
+ * The MonitoredItems of a group are sampled in the order of their NodeId. So
+ * the node is looked up only once for MonitoredItems on the same node. */
+typedef struct UA_SamplingGroup {
+    LIST_ENTRY(UA_SamplingGroup) listEntry;
+    UA_Double samplingInterval;
+    UA_UInt64 callbackId;
+    UA_MonitoredItem **items; /* Removed items are set to NULL while the group
+                               * is processed and compacted afterwards */
+    size_t itemsSize;
+    size_t itemsCapacity;
+    size_t sortedSize; /* The items before are sorted. New items are
+                        * appended and merged before the next sampling. */
+    UA_Boolean processing;
+} UA_SamplingGroup;
+
+/* The last sample of a fixed-size value (scalar or array) without the value
+ * content. The content is kept in lastSampledValue in its memory
+ * representation. */
+typedef struct {
+    UA_Boolean valid;
+    UA_Boolean hasValue;
+    UA_Boolean hasStatus;
+    UA_Boolean hasSourceTimestamp;
+    UA_Boolean hasSourcePicoseconds;
+    UA_UInt16 sourcePicoseconds;
+    UA_StatusCode status;
+    UA_DateTime sourceTimestamp;
+    const UA_DataType *type;
+    size_t arrayLength;
+} UA_SampledValueHeader;
+
 struct UA_MonitoredItem {
     UA_DelayedCallback delayedFreePointers;
     LIST_ENTRY(UA_MonitoredItem) listEntry;
@@ -5736,8 +5878,11 @@ struct UA_MonitoredItem {
     UA_Variant lastValue; // TODO: dataEncoding is hardcoded to UA binary
 
     /* Sample Callback */
-    UA_UInt64 sampleCallbackId;
-    UA_ByteString lastSampledValue;
+    UA_SamplingGroup *samplingGroup;
+    UA_ByteString lastSampledValue; /* Binary encoding of the last sample. Or
+                                     * the memory representation if
+                                     * lastSampledHeader is valid. */
+    UA_SampledValueHeader lastSampledHeader;
     UA_Boolean sampleCallbackIsRegistered;
 
     /* Notification Queue */
@@ -5770,6 +5915,13 @@ UA_StatusCode UA_Event_generateEventId(UA_ByteString *generatedId);
  * data if required. */
 UA_StatusCode UA_MonitoredItem_ensureQueueSpace(UA_Server *server, UA_MonitoredItem *mon);
 
+/* Take the notification for a data change when the notification pool has
+ * reached its size limit. A queued notification of the MonitoredItem is
+ * discarded as if the queue had overflown. Returns NULL if the queue is
+ * empty. */
+UA_Notification *
+UA_MonitoredItem_recycleNotification(UA_Server *server, UA_MonitoredItem *mon);
+
 UA_StatusCode UA_MonitoredItem_removeNodeEventCallback(UA_Server *server, UA_Session *session,
                                                        UA_Node *node, void *data);
 
@@ -5777,9 +5929,14 @@ UA_StatusCode UA_MonitoredItem_removeNodeEventCallback(UA_Server *server, UA_Ses
 /* Subscription */
 /****************/
 
+/* NotificationMessages are kept for retransmission in their binary encoding.
+ * That is more compact than the decoded structure and is sent out without
+ * encoding the notifications again. */
 typedef struct UA_NotificationMessageEntry {
     TAILQ_ENTRY(UA_NotificationMessageEntry) listEntry;
-    UA_NotificationMessage message;
+    UA_UInt32 sequenceNumber;
+    UA_DateTime publishTime;
+    UA_ByteString encoded; /* Encoded UA_NotificationMessage */
 } UA_NotificationMessageEntry;
 
 /* We use only a subset of the states defined in the standard */
@@ -6024,6 +6181,11 @@ typedef struct {
         UA_DateTime *timestamp;
     } offsetData;
     size_t offset;
+    /* Set by UA_NetworkMessage_compileBufferedMessage if the value can be
+     * copied into the buffer without encoding */
+    const void *directSource;
+    size_t directOffset;
+    size_t directSize;
 } UA_NetworkMessageOffset;
 
 typedef struct {
@@ -6171,6 +6333,11 @@ typedef struct {
     UA_ByteString signature;
 } UA_NetworkMessage;
 
+/* Prepare the offsets of a pre-encoded message for direct copies. The buffer
+ * must contain the complete encoded message. */
+void
+UA_NetworkMessage_compileBufferedMessage(UA_NetworkMessageOffsetBuffer *buffer);
+
 UA_StatusCode
 UA_NetworkMessage_updateBufferedMessage(UA_NetworkMessageOffsetBuffer *buffer);
 
@@ -6338,6 +6505,7 @@ struct UA_WriterGroup{
     UA_UInt32 writersCount;
     UA_UInt64 publishCallbackId;
     UA_Boolean publishCallbackIsRegistered;
+    UA_Boolean publishCallbackIsScheduled; /* In the PubSubScheduler */
     UA_PubSubState state;
     UA_NetworkMessageOffsetBuffer bufferedMessage;
     UA_UInt16 sequenceNumber; /* Increased after every succressuly sent message */
@@ -6381,6 +6549,22 @@ typedef enum {
     UA_PUBSUB_SDS_MIRROR
 }UA_SubscribedDataSetEnumType;
 
+/* Byte range inside an encoded message */
+typedef struct {
+    size_t offset;
+    size_t length;
+} UA_PubSubBufferRange;
+
+/* Precomputed layout of the NetworkMessage expected by a DataSetReader
+ * (ReaderGroup frozen with rtLevel UA_PUBSUB_RT_FIXED_SIZE) */
+typedef struct {
+    UA_ByteString message; /* Template of the encoded message */
+    UA_PubSubBufferRange *staticRanges; /* Must be equal to the template */
+    size_t staticRangesSize;
+    UA_PubSubBufferRange *fieldRanges; /* One per field of the DataSetMetaData */
+    size_t fieldRangesSize;
+} UA_DataSetReaderBufferedMessage;
+
 /* DataSetReader Type definition */
 typedef struct UA_DataSetReader {
     UA_DataSetReaderConfig config;
@@ -6391,6 +6575,8 @@ typedef struct UA_DataSetReader {
     UA_SubscribedDataSetEnumType subscribedDataSetType;
     UA_TargetVariablesDataType subscribedDataSetTarget;
     /* To Do UA_SubscribedDataSetMirrorDataType subscribedDataSetMirror */
+    UA_DataValue **externalDataValues; /* One per field of the DataSetMetaData */
+    UA_DataSetReaderBufferedMessage bufferedMessage;
 }UA_DataSetReader;
 
 /* Delete DataSetReader */
@@ -6421,6 +6607,8 @@ struct UA_ReaderGroup {
     UA_UInt32 readersCount;
     UA_UInt64 subscribeCallbackId;
     UA_Boolean subscribeCallbackIsRegistered;
+    /* Receive buffer of the frozen ReaderGroup (rtLevel FIXED_SIZE) */
+    UA_ByteString bufferedMessage;
 };
 
 /* Delete ReaderGroup */
@@ -6446,6 +6634,8 @@ UA_DataSetReader *UA_ReaderGroup_findDSRbyId(UA_Server *server, UA_NodeId identi
 UA_StatusCode
 UA_WriterGroup_addPublishCallback(UA_Server *server, UA_WriterGroup *writerGroup);
 void
+UA_WriterGroup_removePublishCallback(UA_Server *server, UA_WriterGroup *writerGroup);
+void
 UA_WriterGroup_publishCallback(UA_Server *server, UA_WriterGroup *writerGroup);
 
 /*********************************************************/
@@ -6455,6 +6645,8 @@ UA_WriterGroup_publishCallback(UA_Server *server, UA_WriterGroup *writerGroup);
 UA_StatusCode
 UA_ReaderGroup_addSubscribeCallback(UA_Server *server, UA_ReaderGroup *readerGroup);
 void
+UA_ReaderGroup_removeSubscribeCallback(UA_Server *server, UA_ReaderGroup *readerGroup);
+void
 UA_ReaderGroup_subscribeCallback(UA_Server *server, UA_ReaderGroup *readerGroup);
 
 #endif /* UA_ENABLE_PUBSUB */
@@ -6629,6 +6821,29 @@ typedef enum {
     UA_SERVERLIFECYLE_RUNNING
 } UA_ServerLifecycle;
 
+/* Index of the ReferenceType hierarchy. Every ReferenceType below References
+ * gets a small integer (its position in the index). For each ReferenceType, a
+ * bitset over these integers is precomputed for the type alone and for the
+ * type with all its subtypes. So testing whether a reference is of a relevant
+ * type is a hash lookup and a bit test. The index is rebuilt lazily after a
+ * ReferenceType node or a HasSubtype reference between ReferenceTypes has
+ * changed. */
+typedef struct {
+    UA_Boolean valid;
+    UA_UInt32 generation; /* Incremented on every rebuild */
+    size_t typesSize;
+    UA_NodeId *types;
+    size_t words;         /* Length of a bitset in UA_UInt32 */
+    UA_UInt32 *sets;      /* Two bitsets per type: alone and with subtypes */
+    size_t tableSize;     /* Power of two */
+    UA_UInt32 *table;     /* Open addressing from the NodeId hash to the
+                           * position in the index + 1. Zero is empty. */
+    size_t rootsSize;     /* ReferenceTypes that were looked up but are not */
+    UA_NodeId *roots;     /* connected to References (during bootstrapping) */
+} UA_ReferenceTypeIndex;
+
+void UA_ReferenceTypeIndex_clear(UA_ReferenceTypeIndex *ri);
+
 struct UA_Server {
     /* Config */
     UA_ServerConfig config;
@@ -6665,6 +6880,17 @@ struct UA_Server {
      * the parent and member instantiation */
     UA_Boolean bootstrapNS0;
 
+    /* Bulk loading of a generated nodeset. The _finish part of the nodes is
+     * deferred until the end of the bulk load. */
+    UA_Boolean bulkLoading;
+    UA_Boolean bulkChildrenAdded; /* Set when a child is copied from a type */
+    size_t bulkNodesSize;
+    size_t bulkNodesCapacity;
+    UA_NodeId *bulkNodes;
+
+    /* Cached hierarchy of the ReferenceTypes */
+    UA_ReferenceTypeIndex refTypeIndex;
+
     /* Discovery */
 #ifdef UA_ENABLE_DISCOVERY
     UA_DiscoveryManager discoveryManager;
@@ -6679,6 +6905,10 @@ struct UA_Server {
     /* To be cast to UA_LocalMonitoredItem to get the callback and context */
     LIST_HEAD(LocalMonitoredItems, UA_MonitoredItem) localMonitoredItems;
     UA_UInt32 lastLocalMonitoredItemId;
+    /* MonitoredItems grouped by the sampling interval */
+    LIST_HEAD(SamplingGroups, UA_SamplingGroup) samplingGroups;
+    /* Preallocated notifications for all subscriptions */
+    UA_NotificationPool notificationPool;
 
 #ifdef UA_ENABLE_SUBSCRIPTIONS_ALARMS_CONDITIONS
     LIST_HEAD(conditionSourcelisthead, UA_ConditionSource_nodeListElement) headConditionSource;
@@ -6734,6 +6964,14 @@ UA_StatusCode UA_Server_editNode(UA_Server *server, UA_Session *session,
                                  UA_EditNodeCallback callback,
                                  void *data);
 
+/* Same as UA_Server_editNode. But the callback changes only the value of a
+ * VariableNode or VariableTypeNode. With immutable nodes, the nodestore can
+ * then copy only the value instead of the entire node. */
+UA_StatusCode UA_Server_editNodeValue(UA_Server *server, UA_Session *session,
+                                      const UA_NodeId *nodeId,
+                                      UA_EditNodeCallback callback,
+                                      void *data);
+
 /*********************/
 /* Utility Functions */
 /*********************/
@@ -6770,6 +7008,29 @@ UA_StatusCode
 referenceSubtypes(UA_Server *server, const UA_NodeId *refType,
                   size_t *refTypesSize, UA_NodeId **refTypes);
 
+/* The ReferenceType index is rebuilt when it is used next */
+void
+invalidateReferenceTypeIndex(UA_Server *server);
+
+/* Returns the bitset over the ReferenceType index for the ReferenceType alone
+ * or including its subtypes. The bitset points into the index and remains
+ * valid until the index is rebuilt. Returns BadReferenceTypeIdInvalid if
+ * refType is not a ReferenceType. */
+UA_StatusCode
+getReferenceTypeSet(UA_Server *server, const UA_NodeId *refType,
+                    UA_Boolean includeSubtypes, const UA_UInt32 **set);
+
+/* Is the ReferenceType part of the bitset? A NULL bitset matches all
+ * ReferenceTypes. */
+UA_Boolean
+isInReferenceTypeSet(const UA_Server *server, const UA_UInt32 *set,
+                     const UA_NodeId *refType);
+
+/* Is refType equal to superType or one of its subtypes? */
+UA_Boolean
+isReferenceSubtype(UA_Server *server, const UA_NodeId *refType,
+                   const UA_NodeId *superType);
+
 /* Returns the recursive type and interface hierarchy of the node */ 
 UA_StatusCode
 getParentTypeAndInterfaceHierarchy(UA_Server *server, const UA_NodeId *typeNode,
@@ -6871,6 +7132,11 @@ translateBrowsePathToNodeIds(UA_Server *server, const UA_BrowsePath *browsePath)
 #ifdef UA_ENABLE_SUBSCRIPTIONS
 void
 monitoredItem_sampleCallback(UA_Server *server, UA_MonitoredItem *monitoredItem);
+
+/* The node can be NULL if it was not found */
+void
+monitoredItem_sampleCallbackWithNode(UA_Server *server, UA_MonitoredItem *monitoredItem,
+                                     const UA_Node *node);
 #endif
 
 UA_BrowsePathResult
@@ -7013,6 +7279,10 @@ UA_StatusCode writeNs0VariableArray(UA_Server *server, UA_UInt32 id, void *v,
     server->config.nodestore.getNodeCopy(server->config.nodestore.context, \
                                          nodeid, outnode)
 
+#define UA_NODESTORE_GETVALUECOPY(server, nodeid, outnode)                 \
+    server->config.nodestore.getNodeValueCopy(server->config.nodestore.context, \
+                                              nodeid, outnode)
+
 #define UA_NODESTORE_INSERT(server, node, addedNodeId)                    \
     server->config.nodestore.insertNode(server->config.nodestore.context, \
                                         node, addedNodeId)
@@ -8157,6 +8427,98 @@ UA_DateTime_fromStruct(UA_DateTimeStruct ts) {
     return t;
 }
 
+/* Clock Source */
+static UA_Boolean clockSourceSet = false;
+static UA_ClockSource clockSource;
+static UA_UInt64 clockLastCount;   /* Extended count of the last reading */
+static UA_DateTime clockLastCoarse; /* Coarse time of the last reading */
+static UA_UInt64 clockStartCount;  /* Extended count when the source was set */
+static UA_DateTime clockStartTime;  /* Monotonic time when the source was set */
+
+/* Convert between counter increments and DateTime without overflowing the
+ * product */
+static UA_DateTime
+clockCountToDateTime(UA_UInt64 count) {
+    UA_UInt64 seconds = count / clockSource.frequency;
+    UA_UInt64 rest = count % clockSource.frequency;
+    return (UA_DateTime)(seconds * (UA_UInt64)UA_DATETIME_SEC) +
+        (UA_DateTime)((rest * (UA_UInt64)UA_DATETIME_SEC) / clockSource.frequency);
+}
+
+static UA_UInt64
+dateTimeToClockCount(UA_DateTime time) {
+    UA_UInt64 seconds = (UA_UInt64)time / (UA_UInt64)UA_DATETIME_SEC;
+    UA_UInt64 rest = (UA_UInt64)time % (UA_UInt64)UA_DATETIME_SEC;
+    return (seconds * clockSource.frequency) +
+        ((rest * clockSource.frequency) / (UA_UInt64)UA_DATETIME_SEC);
+}
+
+/* The extended count of the clock source. The count continues from the last
+ * reading. If the coarse time has advanced by more than the counter, the
+ * missed wrap-arounds are added. */
+static UA_UInt64
+readClockSource(void) {
+    if(clockSource.lock)
+        clockSource.lock(clockSource.context);
+    UA_UInt64 count = clockSource.read(clockSource.context) & clockSource.mask;
+    if(clockSource.mask != UA_UINT64_MAX) {
+        UA_UInt64 period = clockSource.mask + 1;
+        count |= clockLastCount & ~clockSource.mask;
+        if(count < clockLastCount)
+            count += period;
+        if(clockSource.coarseTime) {
+            UA_DateTime coarse = clockSource.coarseTime(clockSource.context);
+            if(coarse > clockLastCoarse) {
+                UA_UInt64 expected = clockLastCount +
+                    dateTimeToClockCount(coarse - clockLastCoarse);
+                if(expected > count + (period / 2))
+                    count += ((expected - count + (period / 2)) / period) * period;
+            }
+            clockLastCoarse = coarse;
+        }
+    }
+    clockLastCount = count;
+    if(clockSource.unlock)
+        clockSource.unlock(clockSource.context);
+    return count;
+}
+
+void
+UA_DateTime_setClockSource(const UA_ClockSource *source) {
+    /* The mask has to cover the lower bits */
+    if(!source || !source->read || source->frequency == 0 || source->mask == 0 ||
+       (source->mask & (source->mask + 1)) != 0)
+        return;
+    clockSource = *source;
+    clockLastCoarse = 0;
+    clockStartTime = 0;
+    if(clockSource.coarseTime) {
+        clockLastCoarse = clockSource.coarseTime(clockSource.context);
+        clockStartTime = clockLastCoarse;
+    }
+    clockLastCount = clockSource.read(clockSource.context) & clockSource.mask;
+    clockStartCount = clockLastCount;
+    clockSourceSet = true;
+}
+
+UA_Boolean
+UA_DateTime_readClockSource(UA_DateTime *monotonic) {
+    if(!clockSourceSet)
+        return false;
+    *monotonic = clockStartTime + clockCountToDateTime(readClockSource() - clockStartCount);
+    return true;
+}
+
+UA_UInt64
+UA_SimulatedCounter_read(void *counter) {
+    return ((UA_SimulatedCounter*)counter)->count;
+}
+
+UA_DateTime
+UA_SimulatedCounter_coarseTime(void *counter) {
+    return ((UA_SimulatedCounter*)counter)->coarseTime;
+}
+
 /* Guid */
 UA_Boolean
 UA_Guid_equal(const UA_Guid *g1, const UA_Guid *g2) {
@@ -20229,9 +20591,9 @@ void UA_WorkQueue_init(UA_WorkQueue *wq) {
     wq->delayedCallbacks_checkpoint = NULL;
     UA_LOCK_INIT(wq->delayedCallbacks_accessMutex)
 
-    /* Initialize the dispatch queue for worker threads */
-    SIMPLEQ_INIT(&wq->dispatchQueue);
-    UA_LOCK_INIT(wq->dispatchQueue_accessMutex)
+    /* Initialize the condition for sleeping worker threads */
+    wq->nextWorker = 0;
+    wq->sleepingWorkers = 0;
     pthread_cond_init(&wq->dispatchQueue_condition, NULL);
     UA_LOCK_INIT(wq->dispatchQueue_conditionMutex)
 #endif
@@ -20244,22 +20606,8 @@ static void UA_WorkQueue_manuallyProcessDelayed(UA_WorkQueue *wq);
 
 void UA_WorkQueue_cleanup(UA_WorkQueue *wq) {
 #if UA_MULTITHREADING >= 200
-    /* Shut down workers */
+    /* Shut down workers. This executes the remaining work in the rings. */
     UA_WorkQueue_stop(wq);
-
-    /* Execute remaining work in the dispatch queue */
-    while(true) {
-        UA_LOCK(wq->dispatchQueue_accessMutex);
-        UA_DelayedCallback *dc = SIMPLEQ_FIRST(&wq->dispatchQueue);
-        if(!dc) {
-            UA_UNLOCK(wq->dispatchQueue_accessMutex);
-            break;
-        }
-        SIMPLEQ_REMOVE_HEAD(&wq->dispatchQueue, next);
-        UA_UNLOCK(wq->dispatchQueue_accessMutex);
-        dc->callback(dc->application, dc->data);
-        UA_free(dc);
-    }
 #endif
 
     /* All workers are shut down. Execute remaining delayed work here. */
@@ -20267,19 +20615,128 @@ void UA_WorkQueue_cleanup(UA_WorkQueue *wq) {
 
 #if UA_MULTITHREADING >= 200
     wq->delayedCallbacks_checkpoint = NULL;
-    UA_LOCK_DESTROY(wq->dispatchQueue_accessMutex);
     pthread_cond_destroy(&wq->dispatchQueue_condition);
     UA_LOCK_DESTROY(wq->dispatchQueue_conditionMutex);
     UA_LOCK_DESTROY(wq->delayedCallbacks_accessMutex);
 #endif
 }
 
+/*************/
+/* Work Ring */
+/*************/
+
+#if UA_MULTITHREADING >= 200
+
+static void
+UA_WorkRing_init(UA_WorkRing *r) {
+    for(size_t i = 0; i < UA_WORKRING_SIZE; i++)
+        r->slots[i].sequence = i;
+    r->enqueuePos = 0;
+    r->dequeuePos = 0;
+}
+
+/* Returns false if the ring is full */
+static UA_Boolean
+UA_WorkRing_enqueue(UA_WorkRing *r, UA_ApplicationCallback cb,
+                    void *application, void *data) {
+    UA_WorkSlot *slot;
+    size_t pos = r->enqueuePos;
+    while(true) {
+        slot = &r->slots[pos & (UA_WORKRING_SIZE - 1)];
+        size_t seq = slot->sequence;
+        UA_atomic_sync();
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if(diff == 0) {
+            /* The slot is free. Try to claim it. */
+            size_t old = UA_atomic_cmpxchgSize(&r->enqueuePos, pos, pos + 1);
+            if(old == pos)
+                break;
+            pos = old;
+        } else if(diff < 0) {
+            return false; /* The consumers have not freed the slot */
+        } else {
+            pos = r->enqueuePos; /* Another producer was faster */
+        }
+    }
+
+    slot->callback = cb;
+    slot->application = application;
+    slot->data = data;
+    UA_atomic_sync();
+    slot->sequence = pos + 1; /* Publish to the consumers */
+    return true;
+}
+
+/* Returns false if the ring is empty */
+static UA_Boolean
+UA_WorkRing_dequeue(UA_WorkRing *r, UA_WorkSlot *out) {
+    UA_WorkSlot *slot;
+    size_t pos = r->dequeuePos;
+    while(true) {
+        slot = &r->slots[pos & (UA_WORKRING_SIZE - 1)];
+        size_t seq = slot->sequence;
+        UA_atomic_sync();
+        intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+        if(diff == 0) {
+            /* The slot is filled. Try to claim it. */
+            size_t old = UA_atomic_cmpxchgSize(&r->dequeuePos, pos, pos + 1);
+            if(old == pos)
+                break;
+            pos = old;
+        } else if(diff < 0) {
+            return false; /* Nothing has been published yet */
+        } else {
+            pos = r->dequeuePos; /* Another consumer was faster */
+        }
+    }
+
+    out->callback = slot->callback;
+    out->application = slot->application;
+    out->data = slot->data;
+    UA_atomic_sync();
+    slot->sequence = pos + UA_WORKRING_SIZE; /* Free for the next lap */
+    return true;
+}
+
+static UA_Boolean
+UA_WorkRing_isEmpty(UA_WorkRing *r) {
+    size_t pos = r->dequeuePos;
+    UA_atomic_sync();
+    return (r->slots[pos & (UA_WORKRING_SIZE - 1)].sequence != pos + 1);
+}
+
+#endif
+
 /***********/
 /* Workers */
 /***********/
 
 #if UA_MULTITHREADING >= 200
 
+/* Take work from the own ring first. Then try to steal from the other
+ * workers, starting with the next neighbor. */
+static UA_Boolean
+getWork(UA_WorkQueue *wq, UA_Worker *worker, UA_WorkSlot *out) {
+    if(UA_WorkRing_dequeue(&worker->ring, out))
+        return true;
+    size_t self = (size_t)(worker - wq->workers);
+    for(size_t i = 1; i < wq->workersSize; i++) {
+        UA_Worker *victim = &wq->workers[(self + i) % wq->workersSize];
+        if(UA_WorkRing_dequeue(&victim->ring, out))
+            return true;
+    }
+    return false;
+}
+
+static UA_Boolean
+hasWork(UA_WorkQueue *wq) {
+    for(size_t i = 0; i < wq->workersSize; i++) {
+        if(!UA_WorkRing_isEmpty(&wq->workers[i].ring))
+            return true;
+    }
+    return false;
+}
+
 static void *
 workerLoop(UA_Worker *worker) {
     UA_WorkQueue *wq = worker->queue;
@@ -20290,29 +20747,28 @@ workerLoop(UA_Worker *worker) {
      * of the worker. Not for security-critical entropy! */
     UA_random_seed((uintptr_t)worker);
 
+    UA_WorkSlot work;
     while(*running) {
         UA_atomic_addUInt32(counter, 1);
 
-        /* Remove a callback from the queue */
-        UA_LOCK(wq->dispatchQueue_accessMutex);
-        UA_DelayedCallback *dc = SIMPLEQ_FIRST(&wq->dispatchQueue);
-        if(dc)
-            SIMPLEQ_REMOVE_HEAD(&wq->dispatchQueue, next);
-        UA_UNLOCK(wq->dispatchQueue_accessMutex);
-
-        /* Nothing to do. Sleep until a callback is dispatched */
-        if(!dc) {
+        /* Nothing to do. Sleep until a callback is dispatched. The sleeping
+         * counter is increased before the rings are checked again. So either
+         * the producer sees the sleeping worker or the worker sees the
+         * work. */
+        if(!getWork(wq, worker, &work)) {
             UA_LOCK(wq->dispatchQueue_conditionMutex);
-            pthread_cond_wait(&wq->dispatchQueue_condition,
-                              &wq->dispatchQueue_conditionMutex);
+            UA_atomic_addSize(&wq->sleepingWorkers, 1);
+            if(*running && !hasWork(wq))
+                pthread_cond_wait(&wq->dispatchQueue_condition,
+                                  &wq->dispatchQueue_conditionMutex);
+            UA_atomic_subSize(&wq->sleepingWorkers, 1);
             UA_UNLOCK(wq->dispatchQueue_conditionMutex);
             continue;
         }
 
         /* Execute */
-        if(dc->callback)
-            dc->callback(dc->application, dc->data);
-        UA_free(dc);
+        if(work.callback)
+            work.callback(work.application, work.data);
     }
 
     return NULL;
@@ -20328,6 +20784,8 @@ UA_WorkQueue_start(UA_WorkQueue *wq, size_t workersCount) {
     wq->workers = (UA_Worker*)UA_calloc(workersCount, sizeof(UA_Worker));
     if(!wq->workers)
         return UA_STATUSCODE_BADOUTOFMEMORY;
+    for(size_t i = 0; i < workersCount; ++i)
+        UA_WorkRing_init(&wq->workers[i].ring);
     wq->workersSize = workersCount;
 
     /* Spin up the workers */
@@ -20350,12 +20808,24 @@ void UA_WorkQueue_stop(UA_WorkQueue *wq) {
         wq->workers[i].running = false;
 
     /* Wake up all workers */
+    UA_LOCK(wq->dispatchQueue_conditionMutex);
     pthread_cond_broadcast(&wq->dispatchQueue_condition);
+    UA_UNLOCK(wq->dispatchQueue_conditionMutex);
 
-    /* Wait for the workers to finish, then clean up */
+    /* Wait for the workers to finish */
     for(size_t i = 0; i < wq->workersSize; ++i)
         pthread_join(wq->workers[i].thread, NULL);
 
+    /* Execute remaining work in the rings */
+    UA_WorkSlot work;
+    for(size_t i = 0; i < wq->workersSize; ++i) {
+        while(UA_WorkRing_dequeue(&wq->workers[i].ring, &work)) {
+            if(work.callback)
+                work.callback(work.application, work.data);
+        }
+    }
+
+    /* Clean up */
     UA_free(wq->workers);
     wq->workers = NULL;
     wq->workersSize = 0;
@@ -20363,23 +20833,30 @@ void UA_WorkQueue_stop(UA_WorkQueue *wq) {
 
 void UA_WorkQueue_enqueue(UA_WorkQueue *wq, UA_ApplicationCallback cb,
                           void *application, void *data) {
-    UA_DelayedCallback *dc = (UA_DelayedCallback*)UA_malloc(sizeof(UA_DelayedCallback));
-    if(!dc) {
-        cb(application, data); /* Execute immediately if the memory could not be allocated */
-        return;
+    /* Enqueue for the worker threads */
+    UA_Boolean enqueued = false;
+    size_t start = UA_atomic_addSize(&wq->nextWorker, 1);
+    for(size_t i = 0; i < wq->workersSize; i++) {
+        UA_Worker *w = &wq->workers[(start + i) % wq->workersSize];
+        if(UA_WorkRing_enqueue(&w->ring, cb, application, data)) {
+            enqueued = true;
+            break;
+        }
     }
 
-    dc->callback = cb;
-    dc->application = application;
-    dc->data = data;
-
-    /* Enqueue for the worker threads */
-    UA_LOCK(wq->dispatchQueue_accessMutex);
-    SIMPLEQ_INSERT_TAIL(&wq->dispatchQueue, dc, next);
-    UA_UNLOCK(wq->dispatchQueue_accessMutex);
+    /* Execute immediately if no worker can take the callback */
+    if(!enqueued) {
+        cb(application, data);
+        return;
+    }
 
-    /* Wake up sleeping workers */
-    pthread_cond_broadcast(&wq->dispatchQueue_condition);
+    /* Wake up a sleeping worker */
+    UA_atomic_sync();
+    if(wq->sleepingWorkers > 0) {
+        UA_LOCK(wq->dispatchQueue_conditionMutex);
+        pthread_cond_signal(&wq->dispatchQueue_condition);
+        UA_UNLOCK(wq->dispatchQueue_conditionMutex);
+    }
 }
 
 #endif
@@ -20402,25 +20879,37 @@ void UA_WorkQueue_enqueue(UA_WorkQueue *wq, UA_ApplicationCallback cb,
  * callback is processed. */
 #define UA_MAX_DELAYED_SAMPLE 100
 
-/* Call only with a held mutex for the delayed callbacks */
 static void
-dispatchDelayedCallbacks(UA_WorkQueue *wq, UA_DelayedCallback *cb) {
+processDelayedCallback(void *application, void *data) {
+    UA_DelayedCallback *dc = (UA_DelayedCallback*)data;
+    if(dc->callback)
+        dc->callback(dc->application, dc->data);
+    UA_free(dc);
+}
+
+/* Call only with a held mutex for the delayed callbacks. Returns the chain of
+ * delayed callbacks that are ready. They are removed from the queue. */
+static UA_DelayedCallback *
+takeDelayedCallbacks(UA_WorkQueue *wq, UA_DelayedCallback *cb) {
     /* Are callbacks before the last checkpoint ready? */
     for(size_t i = 0; i < wq->workersSize; ++i) {
         if(wq->workers[i].counter == wq->workers[i].checkpointCounter)
-            return;
+            return NULL;
     }
 
-    /* Dispatch all delayed callbacks up to the checkpoint.
-     * TODO: Move over the entire queue up to the checkpoint in one step. */
-    if(wq->delayedCallbacks_checkpoint != NULL) {
-        UA_DelayedCallback *iter, *tmp_iter;
-        SIMPLEQ_FOREACH_SAFE(iter, &wq->delayedCallbacks, next, tmp_iter) {
-            UA_LOCK(wq->dispatchQueue_accessMutex);
-            SIMPLEQ_INSERT_TAIL(&wq->dispatchQueue, iter, next);
-            UA_UNLOCK(wq->dispatchQueue_accessMutex);
-            if(iter == wq->delayedCallbacks_checkpoint)
-                break;
+    /* Take the checkpoint and all delayed callbacks that were added before it.
+     * New callbacks are inserted at the head. So these are the checkpoint and
+     * its successors in the list. */
+    UA_DelayedCallback *dc = wq->delayedCallbacks_checkpoint;
+    if(dc != NULL) {
+        if(SIMPLEQ_FIRST(&wq->delayedCallbacks) == dc) {
+            SIMPLEQ_INIT(&wq->delayedCallbacks);
+        } else {
+            UA_DelayedCallback *prev = SIMPLEQ_FIRST(&wq->delayedCallbacks);
+            while(SIMPLEQ_NEXT(prev, next) != dc)
+                prev = SIMPLEQ_NEXT(prev, next);
+            SIMPLEQ_NEXT(prev, next) = NULL;
+            wq->delayedCallbacks.sqh_last = &SIMPLEQ_NEXT(prev, next);
         }
     }
 
@@ -20428,6 +20917,19 @@ dispatchDelayedCallbacks(UA_WorkQueue *wq, UA_DelayedCallback *cb) {
     for(size_t i = 0; i < wq->workersSize; ++i)
         wq->workers[i].checkpointCounter = wq->workers[i].counter;
     wq->delayedCallbacks_checkpoint = cb;
+    return dc;
+}
+
+/* Call without the mutex for the delayed callbacks. A callback is executed in
+ * the calling thread if no worker can take it. And it may enqueue new delayed
+ * callbacks. */
+static void
+dispatchDelayedCallbacks(UA_WorkQueue *wq, UA_DelayedCallback *dc) {
+    while(dc) {
+        UA_DelayedCallback *nextDc = SIMPLEQ_NEXT(dc, next);
+        UA_WorkQueue_enqueue(wq, processDelayedCallback, NULL, dc);
+        dc = nextDc;
+    }
 }
 
 #endif
@@ -20435,34 +20937,49 @@ dispatchDelayedCallbacks(UA_WorkQueue *wq, UA_DelayedCallback *cb) {
 void
 UA_WorkQueue_enqueueDelayed(UA_WorkQueue *wq, UA_DelayedCallback *cb) {
 #if UA_MULTITHREADING >= 200
-    UA_LOCK(wq->dispatchQueue_accessMutex);
+    UA_LOCK(wq->delayedCallbacks_accessMutex);
 #endif
 
     SIMPLEQ_INSERT_HEAD(&wq->delayedCallbacks, cb, next);
 
 #if UA_MULTITHREADING >= 200
+    UA_DelayedCallback *ready = NULL;
     wq->delayedCallbacks_sinceDispatch++;
     if(wq->delayedCallbacks_sinceDispatch > UA_MAX_DELAYED_SAMPLE) {
-        dispatchDelayedCallbacks(wq, cb);
+        ready = takeDelayedCallbacks(wq, cb);
         wq->delayedCallbacks_sinceDispatch = 0;
     }
 
-    UA_UNLOCK(wq->dispatchQueue_accessMutex);
+    UA_UNLOCK(wq->delayedCallbacks_accessMutex);
+    dispatchDelayedCallbacks(wq, ready);
 #endif
 }
 
-/* Assumes all workers are shut down */
+/* Assumes all workers are shut down. The queue is taken before the callbacks
+ * are executed, as they can enqueue new delayed callbacks. These are processed
+ * in the next round. */
 void UA_WorkQueue_manuallyProcessDelayed(UA_WorkQueue *wq) {
-    UA_DelayedCallback *dc, *dc_tmp;
-    SIMPLEQ_FOREACH_SAFE(dc, &wq->delayedCallbacks, next, dc_tmp) {
-        SIMPLEQ_REMOVE_HEAD(&wq->delayedCallbacks, next);
-        if(dc->callback)
-            dc->callback(dc->application, dc->data);
-        UA_free(dc);
-    }
+    while(true) {
 #if UA_MULTITHREADING >= 200
-    wq->delayedCallbacks_checkpoint = NULL;
+        UA_LOCK(wq->delayedCallbacks_accessMutex);
+#endif
+        UA_DelayedCallback *dc = SIMPLEQ_FIRST(&wq->delayedCallbacks);
+        SIMPLEQ_INIT(&wq->delayedCallbacks);
+#if UA_MULTITHREADING >= 200
+        wq->delayedCallbacks_checkpoint = NULL;
+        UA_UNLOCK(wq->delayedCallbacks_accessMutex);
 #endif
+        if(!dc)
+            return;
+
+        while(dc) {
+            UA_DelayedCallback *nextDc = SIMPLEQ_NEXT(dc, next);
+            if(dc->callback)
+                dc->callback(dc->application, dc->data);
+            UA_free(dc);
+            dc = nextDc;
+        }
+    }
 }
 
 /*********************************** amalgamated original file "C:/open62541/src/ua_timer.c" ***********************************/
@@ -20476,6 +20993,305 @@ void UA_WorkQueue_manuallyProcessDelayed(UA_WorkQueue *wq) {
  */
 
 
+#ifdef UA_ENABLE_TIMER_WHEEL
+
+struct UA_TimerEntry {
+    TAILQ_ENTRY(UA_TimerEntry) pointers;
+    UA_DateTime nextTime;                    /* The next time when the callback
+                                              * is to be executed */
+    UA_UInt64 interval;                      /* Interval in 100ns resolution */
+    UA_Boolean repeated;                     /* Repeated callback? */
+    UA_UInt32 slot;                          /* Index of the current slot.
+                                              * UA_TIMERWHEEL_SLOTS if due. */
+
+    UA_ApplicationCallback callback;
+    void *application;
+    void *data;
+
+    UA_UInt32 index;                         /* Position in the slab */
+    UA_UInt32 generation;                    /* Increased on every reuse */
+    UA_UInt64 id;                            /* Id of the entry. 0 if free. */
+    UA_TimerEntry *nextFree;
+};
+
+static UA_DateTime
+tickOf(UA_DateTime time) {
+    return time / UA_TIMERWHEEL_TICK;
+}
+
+void
+UA_Timer_init(UA_Timer *t) {
+    memset(t, 0, sizeof(UA_Timer));
+    for(size_t i = 0; i < UA_TIMERWHEEL_SLOTS; i++)
+        TAILQ_INIT(&t->slots[i]);
+    TAILQ_INIT(&t->due);
+}
+
+/* Entries that are already due go into the slot of the current tick. Otherwise
+ * they would be picked up only after a full rotation of the wheel. */
+static void
+linkEntry(UA_Timer *t, UA_TimerEntry *te) {
+    UA_DateTime tick = tickOf(te->nextTime);
+    if(tick < t->currentTick)
+        tick = t->currentTick;
+    te->slot = (UA_UInt32)(tick & (UA_TIMERWHEEL_SLOTS - 1));
+    TAILQ_INSERT_TAIL(&t->slots[te->slot], te, pointers);
+    t->occupied[te->slot / 64] |= ((UA_UInt64)1) << (te->slot % 64);
+}
+
+static void
+unlinkEntry(UA_Timer *t, UA_TimerEntry *te) {
+    if(te->slot == UA_TIMERWHEEL_SLOTS) {
+        TAILQ_REMOVE(&t->due, te, pointers);
+        return;
+    }
+    TAILQ_REMOVE(&t->slots[te->slot], te, pointers);
+    if(TAILQ_EMPTY(&t->slots[te->slot]))
+        t->occupied[te->slot / 64] &= ~(((UA_UInt64)1) << (te->slot % 64));
+}
+
+static UA_TimerEntry *
+allocEntry(UA_Timer *t) {
+    if(!t->freeEntries) {
+        /* Add a new chunk to the slab */
+        if(t->chunksSize >= UA_UINT32_MAX / UA_TIMERWHEEL_CHUNKSIZE)
+            return NULL;
+        UA_TimerEntry **chunks = (UA_TimerEntry**)
+            UA_realloc(t->chunks, sizeof(UA_TimerEntry*) * (t->chunksSize + 1));
+        if(!chunks)
+            return NULL;
+        t->chunks = chunks;
+        UA_TimerEntry *chunk = (UA_TimerEntry*)
+            UA_calloc(UA_TIMERWHEEL_CHUNKSIZE, sizeof(UA_TimerEntry));
+        if(!chunk)
+            return NULL;
+        t->chunks[t->chunksSize] = chunk;
+        for(size_t i = UA_TIMERWHEEL_CHUNKSIZE; i > 0; i--) {
+            UA_TimerEntry *te = &chunk[i-1];
+            te->index = (UA_UInt32)((t->chunksSize * UA_TIMERWHEEL_CHUNKSIZE) + i - 1);
+            te->nextFree = t->freeEntries;
+            t->freeEntries = te;
+        }
+        t->chunksSize++;
+    }
+
+    UA_TimerEntry *te = t->freeEntries;
+    t->freeEntries = te->nextFree;
+    te->generation++;
+    if(te->generation == 0)
+        te->generation = 1; /* The id must not be 0 */
+    te->id = (((UA_UInt64)te->generation) << 32) | te->index;
+    return te;
+}
+
+static void
+freeEntry(UA_Timer *t, UA_TimerEntry *te) {
+    te->id = 0;
+    te->nextFree = t->freeEntries;
+    t->freeEntries = te;
+}
+
+static UA_TimerEntry *
+findEntry(UA_Timer *t, UA_UInt64 callbackId) {
+    size_t index = (size_t)(callbackId & UA_UINT32_MAX);
+    if(index >= t->chunksSize * UA_TIMERWHEEL_CHUNKSIZE)
+        return NULL;
+    UA_TimerEntry *te = &t->chunks[index / UA_TIMERWHEEL_CHUNKSIZE]
+        [index % UA_TIMERWHEEL_CHUNKSIZE];
+    if(te->id != callbackId || callbackId == 0)
+        return NULL;
+    return te;
+}
+
+static UA_StatusCode
+addCallback(UA_Timer *t, UA_ApplicationCallback callback, void *application, void *data,
+            UA_DateTime nextTime, UA_UInt64 interval, UA_Boolean repeated,
+            UA_UInt64 *callbackId) {
+    /* A callback method needs to be present */
+    if(!callback)
+        return UA_STATUSCODE_BADINTERNALERROR;
+
+    /* Take the entry from the slab */
+    UA_TimerEntry *te = allocEntry(t);
+    if(!te)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+
+    /* Set the repeated callback */
+    te->interval = (UA_UInt64)interval;
+    te->callback = callback;
+    te->application = application;
+    te->data = data;
+    te->repeated = repeated;
+    te->nextTime = nextTime;
+
+    /* Set the output identifier */
+    if(callbackId)
+        *callbackId = te->id;
+
+    linkEntry(t, te);
+    return UA_STATUSCODE_GOOD;
+}
+
+UA_StatusCode
+UA_Timer_addTimedCallback(UA_Timer *t, UA_ApplicationCallback callback,
+                          void *application, void *data, UA_DateTime date,
+                          UA_UInt64 *callbackId) {
+    return addCallback(t, callback, application, data, date, 0, false, callbackId);
+}
+
+UA_StatusCode
+UA_Timer_addRepeatedCallback(UA_Timer *t, UA_ApplicationCallback callback,
+                             void *application, void *data, UA_Double interval_ms,
+                             UA_UInt64 *callbackId) {
+    /* The interval needs to be positive */
+    if(interval_ms <= 0.0)
+        return UA_STATUSCODE_BADINTERNALERROR;
+
+    UA_UInt64 interval = (UA_UInt64)(interval_ms * UA_DATETIME_MSEC);
+    UA_DateTime nextTime = UA_DateTime_nowMonotonic() + (UA_DateTime)interval;
+    return addCallback(t, callback, application, data, nextTime,
+                       interval, true, callbackId);
+}
+
+UA_StatusCode
+UA_Timer_changeRepeatedCallbackInterval(UA_Timer *t, UA_UInt64 callbackId,
+                                        UA_Double interval_ms) {
+    /* The interval needs to be positive */
+    if(interval_ms <= 0.0)
+        return UA_STATUSCODE_BADINTERNALERROR;
+
+    UA_TimerEntry *te = findEntry(t, callbackId);
+    if(!te)
+        return UA_STATUSCODE_BADNOTFOUND;
+
+    /* Move to the slot of the new execution time */
+    unlinkEntry(t, te);
+    te->interval = (UA_UInt64)(interval_ms * UA_DATETIME_MSEC); /* in 100ns resolution */
+    te->nextTime = UA_DateTime_nowMonotonic() + (UA_DateTime)te->interval;
+    linkEntry(t, te);
+    return UA_STATUSCODE_GOOD;
+}
+
+void
+UA_Timer_removeCallback(UA_Timer *t, UA_UInt64 callbackId) {
+    UA_TimerEntry *te = findEntry(t, callbackId);
+    if(!te)
+        return;
+
+    unlinkEntry(t, te);
+    freeEntry(t, te);
+}
+
+/* The earliest time is exact for the current slot. For the following slots,
+ * the start of the first occupied tick is returned. This is a lower bound, as
+ * the slot may also hold entries for later rotations of the wheel. */
+static UA_DateTime
+nextEventTime(UA_Timer *t) {
+    UA_DateTime earliest = UA_INT64_MAX;
+    UA_UInt32 current = (UA_UInt32)(t->currentTick & (UA_TIMERWHEEL_SLOTS - 1));
+    UA_TimerEntry *te;
+    TAILQ_FOREACH(te, &t->slots[current], pointers) {
+        if(te->nextTime < earliest)
+            earliest = te->nextTime;
+    }
+
+    for(UA_UInt32 i = 1; i < UA_TIMERWHEEL_SLOTS; i++) {
+        UA_UInt32 slot = (current + i) & (UA_TIMERWHEEL_SLOTS - 1);
+        UA_UInt64 word = t->occupied[slot / 64] >> (slot % 64);
+        if(word == 0) {
+            /* Skip to the next word of the bitmap */
+            i += 63 - (slot % 64);
+            continue;
+        }
+        if(!(word & 1))
+            continue;
+        UA_DateTime tickStart = (t->currentTick + i) * UA_TIMERWHEEL_TICK;
+        return (tickStart < earliest) ? tickStart : earliest;
+    }
+    return earliest;
+}
+
+UA_DateTime
+UA_Timer_process(UA_Timer *t, UA_DateTime nowMonotonic,
+                 UA_TimerExecutionCallback executionCallback,
+                 void *executionApplication) {
+    /* Visit every slot between the last processed and the current tick. The
+     * current tick is visited again in the next call, as entries may become
+     * due later during the tick. */
+    UA_DateTime nowTick = tickOf(nowMonotonic);
+    UA_DateTime ticks = nowTick - t->currentTick + 1;
+    if(ticks > UA_TIMERWHEEL_SLOTS || ticks < 1)
+        ticks = UA_TIMERWHEEL_SLOTS;
+
+    /* Entries that the callbacks add for a past tick go into the slot of the
+     * current tick. Not into a slot that was already visited. */
+    t->currentTick = nowTick;
+
+    for(UA_DateTime tick = nowTick - ticks + 1; tick <= nowTick; tick++) {
+        UA_UInt32 slot = (UA_UInt32)(tick & (UA_TIMERWHEEL_SLOTS - 1));
+        if(!(t->occupied[slot / 64] & (((UA_UInt64)1) << (slot % 64))))
+            continue;
+
+        /* Move the entries that are due out of the slot before calling them.
+         * The callbacks can add and remove entries in the timer, also the due
+         * entries. The due entries are sorted by their time. Entries with the
+         * same time keep the order of the slot. */
+        UA_TimerEntry *te, *te_tmp;
+        TAILQ_FOREACH_SAFE(te, &t->slots[slot], pointers, te_tmp) {
+            if(te->nextTime > nowMonotonic)
+                continue;
+            unlinkEntry(t, te);
+            te->slot = UA_TIMERWHEEL_SLOTS;
+            UA_TimerEntry *prev = TAILQ_LAST(&t->due, UA_TimerSlot);
+            while(prev && prev->nextTime > te->nextTime)
+                prev = TAILQ_PREV(prev, UA_TimerSlot, pointers);
+            if(prev)
+                TAILQ_INSERT_AFTER(&t->due, prev, te, pointers);
+            else
+                TAILQ_INSERT_HEAD(&t->due, te, pointers);
+        }
+
+        while((te = TAILQ_FIRST(&t->due))) {
+            unlinkEntry(t, te);
+
+            if(!te->repeated) {
+                /* Release the entry before the callback. Then the callback
+                 * cannot remove it (again) and can reuse it for a new entry. */
+                UA_ApplicationCallback callback = te->callback;
+                void *application = te->application;
+                void *data = te->data;
+                freeEntry(t, te);
+                executionCallback(executionApplication, callback, application, data);
+                continue;
+            }
+
+            /* Set the time for the next execution. Prevent an infinite loop by
+             * forcing the next processing into the next iteration. Reinsert
+             * before the callback, as it may remove the entry. */
+            te->nextTime += (UA_Int64)te->interval;
+            if(te->nextTime < nowMonotonic)
+                te->nextTime = nowMonotonic + 1;
+            linkEntry(t, te);
+            executionCallback(executionApplication, te->callback,
+                              te->application, te->data);
+        }
+    }
+
+    /* Return the timestamp of the earliest next callback */
+    return nextEventTime(t);
+}
+
+void
+UA_Timer_deleteMembers(UA_Timer *t) {
+    /* Free the slab and reset the wheel */
+    for(size_t i = 0; i < t->chunksSize; i++)
+        UA_free(t->chunks[i]);
+    UA_free(t->chunks);
+    UA_Timer_init(t);
+}
+
+#else /* UA_ENABLE_TIMER_WHEEL */
+
 struct UA_TimerEntry {
     ZIP_ENTRY(UA_TimerEntry) zipfields;
     UA_DateTime nextTime;                    /* The next time when the callback
@@ -20662,6 +21478,8 @@ UA_Timer_deleteMembers(UA_Timer *t) {
     ZIP_INIT(&t->root);
 }
 
+#endif /* UA_ENABLE_TIMER_WHEEL */
+
 /*********************************** amalgamated original file "C:/open62541/src/ua_connection.c" ***********************************/
 
 /* This Source Code Form is subject to the terms of the Mozilla Public
@@ -21051,6 +21869,25 @@ encodeHeadersSym(UA_MessageContext *const messageContext, size_t totalLength) {
     return res;
 }
 
+static void
+releasePendingChunks(UA_MessageContext *mc) {
+    UA_Connection *connection = mc->channel->connection;
+    for(size_t i = 0; i < mc->pendingChunksSize; i++)
+        connection->releaseSendBuffer(connection, &mc->pendingChunks[i]);
+    mc->pendingChunksSize = 0;
+}
+
+/* Hand the queued chunks to the network layer in one call. The buffers are
+ * freed in the network layer. */
+static UA_StatusCode
+sendPendingChunks(UA_MessageContext *mc) {
+    UA_Connection *connection = mc->channel->connection;
+    UA_StatusCode res =
+        connection->sendMany(connection, mc->pendingChunks, mc->pendingChunksSize);
+    mc->pendingChunksSize = 0;
+    return res;
+}
+
 static UA_StatusCode
 sendSymmetricChunk(UA_MessageContext *messageContext) {
     UA_SecureChannel *const channel = messageContext->channel;
@@ -21099,10 +21936,23 @@ sendSymmetricChunk(UA_MessageContext *messageContext) {
 #endif
 
     /* Send the chunk, the buffer is freed in the network layer */
-    return connection->send(channel->connection, &messageContext->messageBuffer);
+    if(!connection->sendMany)
+        return connection->send(channel->connection, &messageContext->messageBuffer);
+
+    /* Queue the chunk. The queue is sent with the final chunk or when it is
+     * full, so that several chunks go out with a single write. */
+    messageContext->pendingChunks[messageContext->pendingChunksSize] =
+        messageContext->messageBuffer;
+    messageContext->pendingChunksSize++;
+    messageContext->messageBuffer = UA_BYTESTRING_NULL;
+    if(messageContext->final ||
+       messageContext->pendingChunksSize == UA_MESSAGECONTEXT_PENDINGCHUNKS)
+        return sendPendingChunks(messageContext);
+    return UA_STATUSCODE_GOOD;
 
 error:
     connection->releaseSendBuffer(channel->connection, &messageContext->messageBuffer);
+    releasePendingChunks(messageContext);
     return res;
 }
 
@@ -21153,6 +22003,7 @@ UA_MessageContext_begin(UA_MessageContext *mc, UA_SecureChannel *channel,
     mc->messageSizeSoFar = 0;
     mc->final = false;
     mc->messageBuffer = UA_BYTESTRING_NULL;
+    mc->pendingChunksSize = 0;
     mc->messageType = messageType;
 
     /* Allocate the message buffer */
@@ -21172,11 +22023,39 @@ UA_MessageContext_encode(UA_MessageContext *mc, const void *content,
                          const UA_DataType *contentType) {
     UA_StatusCode retval = UA_encodeBinary(content, contentType, &mc->buf_pos, &mc->buf_end,
                                            sendSymmetricEncodingCallback, mc);
-    if(retval != UA_STATUSCODE_GOOD && mc->messageBuffer.length > 0)
+    if(retval != UA_STATUSCODE_GOOD &&
+       (mc->messageBuffer.length > 0 || mc->pendingChunksSize > 0))
         UA_MessageContext_abort(mc);
     return retval;
 }
 
+UA_StatusCode
+UA_MessageContext_encodeRaw(UA_MessageContext *mc, const UA_ByteString *encoded) {
+    size_t written = 0;
+    while(true) {
+        size_t length = encoded->length - written;
+        size_t space = (uintptr_t)mc->buf_end - (uintptr_t)mc->buf_pos;
+        if(length > space)
+            length = space;
+        if(length > 0)
+            memcpy(mc->buf_pos, &encoded->data[written], length);
+        mc->buf_pos += length;
+        written += length;
+        if(written == encoded->length)
+            return UA_STATUSCODE_GOOD;
+
+        /* The chunk is full */
+        UA_Byte *buf_pos = mc->buf_pos;
+        const UA_Byte *buf_end = mc->buf_end;
+        UA_StatusCode retval = sendSymmetricEncodingCallback(mc, &buf_pos, &buf_end);
+        if(retval != UA_STATUSCODE_GOOD) {
+            if(mc->messageBuffer.length > 0 || mc->pendingChunksSize > 0)
+                UA_MessageContext_abort(mc);
+            return retval;
+        }
+    }
+}
+
 UA_StatusCode
 UA_MessageContext_finish(UA_MessageContext *mc) {
     mc->final = true;
@@ -21187,6 +22066,7 @@ void
 UA_MessageContext_abort(UA_MessageContext *mc) {
     UA_Connection *connection = mc->channel->connection;
     connection->releaseSendBuffer(connection, &mc->messageBuffer);
+    releasePendingChunks(mc);
 }
 
 UA_StatusCode
@@ -22454,12 +23334,85 @@ cmpRefTarget(const void *a, const void *b) {
         return ZIP_CMP_LESS;
     if(aa->targetHash > bb->targetHash)
         return ZIP_CMP_MORE;
-    return (enum ZIP_CMP)UA_ExpandedNodeId_order(&aa->target, &bb->target);
+#ifdef UA_ENABLE_COMPACT_REFERENCES
+    /* Same order as UA_ExpandedNodeId_order for two local numeric targets */
+    if(!aa->targetExt && !bb->targetExt) {
+        if(aa->targetNs != bb->targetNs)
+            return (aa->targetNs < bb->targetNs) ? ZIP_CMP_LESS : ZIP_CMP_MORE;
+        if(aa->targetId != bb->targetId)
+            return (aa->targetId < bb->targetId) ? ZIP_CMP_LESS : ZIP_CMP_MORE;
+        return ZIP_CMP_EQ;
+    }
+#endif
+    UA_ExpandedNodeId tmpA, tmpB;
+    return (enum ZIP_CMP)
+        UA_ExpandedNodeId_order(UA_ReferenceTarget_getTarget(aa, &tmpA),
+                                UA_ReferenceTarget_getTarget(bb, &tmpB));
 }
 
 ZIP_IMPL(UA_ReferenceTargetHead, UA_ReferenceTarget, zipfields,
          UA_ReferenceTarget, zipfields, cmpRefTarget)
 
+/* Set the target of a new entry. The entry is not yet in the tree. */
+static UA_StatusCode
+ReferenceTarget_setTarget(UA_ReferenceTarget *rt, const UA_ExpandedNodeId *target) {
+#ifdef UA_ENABLE_COMPACT_REFERENCES
+    if(target->serverIndex == 0 && target->namespaceUri.data == NULL &&
+       target->nodeId.identifierType == UA_NODEIDTYPE_NUMERIC) {
+        rt->targetNs = target->nodeId.namespaceIndex;
+        rt->targetId = target->nodeId.identifier.numeric;
+        rt->targetExt = NULL;
+        return UA_STATUSCODE_GOOD;
+    }
+    rt->targetNs = 0;
+    rt->targetId = 0;
+    rt->targetExt = UA_ExpandedNodeId_new();
+    if(!rt->targetExt)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    UA_StatusCode retval = UA_ExpandedNodeId_copy(target, rt->targetExt);
+    if(retval != UA_STATUSCODE_GOOD) {
+        UA_ExpandedNodeId_delete(rt->targetExt);
+        rt->targetExt = NULL;
+    }
+    return retval;
+#else
+    return UA_ExpandedNodeId_copy(target, &rt->target);
+#endif
+}
+
+static void
+ReferenceTarget_clearTarget(UA_ReferenceTarget *rt) {
+#ifdef UA_ENABLE_COMPACT_REFERENCES
+    if(rt->targetExt) {
+        UA_ExpandedNodeId_delete(rt->targetExt);
+        rt->targetExt = NULL;
+    }
+#else
+    UA_ExpandedNodeId_clear(&rt->target);
+#endif
+}
+
+/* Prepare an entry to search the tree. The target is not copied and must
+ * outlive the dummy entry. */
+static void
+ReferenceTarget_initDummy(UA_ReferenceTarget *rt, const UA_ExpandedNodeId *target) {
+#ifdef UA_ENABLE_COMPACT_REFERENCES
+    rt->targetNs = 0;
+    rt->targetId = 0;
+    rt->targetExt = NULL;
+    if(target->serverIndex == 0 && target->namespaceUri.data == NULL &&
+       target->nodeId.identifierType == UA_NODEIDTYPE_NUMERIC) {
+        rt->targetNs = target->nodeId.namespaceIndex;
+        rt->targetId = target->nodeId.identifier.numeric;
+    } else {
+        rt->targetExt = (UA_ExpandedNodeId*)(uintptr_t)target;
+    }
+#else
+    rt->target = *target;
+#endif
+    rt->targetHash = UA_ExpandedNodeId_hash(target);
+}
+
 void UA_Node_clear(UA_Node *node) {
     /* Delete standard content */
     UA_NodeId_clear(&node->nodeId);
@@ -22636,7 +23589,9 @@ UA_Node_copy(const UA_Node *src, UA_Node *dst) {
             for(size_t j = 0; j < srefs->refTargetsSize; j++) {
                 UA_ReferenceTarget *srefTarget = &srefs->refTargets[j];
                 UA_ReferenceTarget *drefTarget = &drefs->refTargets[j];
-                retval |= UA_ExpandedNodeId_copy(&srefTarget->target, &drefTarget->target);
+                UA_ExpandedNodeId tmpTarget;
+                retval |= ReferenceTarget_setTarget(drefTarget,
+                              UA_ReferenceTarget_getTarget(srefTarget, &tmpTarget));
                 drefTarget->targetHash = srefTarget->targetHash;
                 ZIP_RIGHT(drefTarget, zipfields) = NULL;
                 if(ZIP_RIGHT(srefTarget, zipfields))
@@ -22958,7 +23913,7 @@ addReferenceTarget(UA_NodeReferenceKind *refs, const UA_ExpandedNodeId *target,
         return retval;
 
     UA_ReferenceTarget *entry = &refs->refTargets[refs->refTargetsSize];
-    retval = UA_ExpandedNodeId_copy(target, &entry->target);
+    retval = ReferenceTarget_setTarget(entry, target);
     if(retval != UA_STATUSCODE_GOOD) {
         if(refs->refTargetsSize== 0) {
             /* We had zero references before (realloc was a malloc) */
@@ -23021,8 +23976,7 @@ UA_Node_addReference(UA_Node *node, const UA_AddReferencesItem *item) {
         return addReferenceKind(node, item);
 
     UA_ReferenceTarget tmpTarget;
-    tmpTarget.target = item->targetNodeId;
-    tmpTarget.targetHash = UA_ExpandedNodeId_hash(&item->targetNodeId);
+    ReferenceTarget_initDummy(&tmpTarget, &item->targetNodeId);
 
     UA_ReferenceTarget *found =
         ZIP_FIND(UA_ReferenceTargetHead, &existingRefs->refTargetsTree, &tmpTarget);
@@ -23040,55 +23994,59 @@ UA_Node_deleteReference(UA_Node *node, const UA_DeleteReferencesItem *item) {
         if(!UA_NodeId_equal(&item->referenceTypeId, &refs->referenceTypeId))
             continue;
 
-        for(size_t j = refs->refTargetsSize; j > 0; --j) {
-            UA_ReferenceTarget *target = &refs->refTargets[j-1];
-            if(!UA_NodeId_equal(&item->targetNodeId.nodeId, &target->target.nodeId))
-                continue;
-
-            /* Ok, delete the reference */
-            ZIP_REMOVE(UA_ReferenceTargetHead, &refs->refTargetsTree, target);
-            UA_ExpandedNodeId_clear(&target->target);
-            refs->refTargetsSize--;
-
-            if(refs->refTargetsSize > 0) {
-                /* At least one target remains in buffer */ 
-                if(j-1 != refs->refTargetsSize) {
-                    /* Move last entry into the entry from where reference was removed */
-                    ZIP_REMOVE(UA_ReferenceTargetHead, &refs->refTargetsTree,
-                               &refs->refTargets[refs->refTargetsSize]);
-                    *target = refs->refTargets[refs->refTargetsSize];
-                    ZIP_INSERT(UA_ReferenceTargetHead, &refs->refTargetsTree,
-                               target, ZIP_RANK(target, zipfields));
-                }
-                /* Shrink down allocated buffer, ignore failure */
-                (void)resizeReferenceTargets(refs, refs->refTargetsSize);
-                return UA_STATUSCODE_GOOD;
+        /* Find the target with the ServerIndex and NamespaceUri. A remote
+         * target with the same NodeId is a different reference. */
+        UA_ReferenceTarget tmpTarget;
+        ReferenceTarget_initDummy(&tmpTarget, &item->targetNodeId);
+        UA_ReferenceTarget *target =
+            ZIP_FIND(UA_ReferenceTargetHead, &refs->refTargetsTree, &tmpTarget);
+        if(!target)
+            continue;
+        size_t pos = (size_t)(target - refs->refTargets);
+
+        /* Ok, delete the reference */
+        ZIP_REMOVE(UA_ReferenceTargetHead, &refs->refTargetsTree, target);
+        ReferenceTarget_clearTarget(target);
+        refs->refTargetsSize--;
+
+        if(refs->refTargetsSize > 0) {
+            /* At least one target remains in buffer */ 
+            if(pos != refs->refTargetsSize) {
+                /* Move last entry into the entry from where reference was removed */
+                ZIP_REMOVE(UA_ReferenceTargetHead, &refs->refTargetsTree,
+                           &refs->refTargets[refs->refTargetsSize]);
+                *target = refs->refTargets[refs->refTargetsSize];
+                ZIP_INSERT(UA_ReferenceTargetHead, &refs->refTargetsTree,
+                           target, ZIP_RANK(target, zipfields));
             }
+            /* Shrink down allocated buffer, ignore failure */
+            (void)resizeReferenceTargets(refs, refs->refTargetsSize);
+            return UA_STATUSCODE_GOOD;
+        }
 
-            /* No target for the ReferenceType remaining. Remove entry. */
-            UA_free(refs->refTargets);
-            UA_NodeId_clear(&refs->referenceTypeId);
-            node->referencesSize--;
-            if(node->referencesSize > 0) {
-                if(i-1 != node->referencesSize) {
-                    /* Move last array node into array node from where reference kind was removed */
-                    node->references[i-1] = node->references[node->referencesSize];
-                }
-                /* And shrink down allocated buffer for one entry */
-                UA_NodeReferenceKind *newRefs = (UA_NodeReferenceKind*)
-                    UA_realloc(node->references, sizeof(UA_NodeReferenceKind) * node->referencesSize);
-                /* Ignore errors in case memory buffer could not be shrinked down */
-                if(newRefs) {
-                    node->references = newRefs;
-                }
-                return UA_STATUSCODE_GOOD;
+        /* No target for the ReferenceType remaining. Remove entry. */
+        UA_free(refs->refTargets);
+        UA_NodeId_clear(&refs->referenceTypeId);
+        node->referencesSize--;
+        if(node->referencesSize > 0) {
+            if(i-1 != node->referencesSize) {
+                /* Move last array node into array node from where reference kind was removed */
+                node->references[i-1] = node->references[node->referencesSize];
+            }
+            /* And shrink down allocated buffer for one entry */
+            UA_NodeReferenceKind *newRefs = (UA_NodeReferenceKind*)
+                UA_realloc(node->references, sizeof(UA_NodeReferenceKind) * node->referencesSize);
+            /* Ignore errors in case memory buffer could not be shrinked down */
+            if(newRefs) {
+                node->references = newRefs;
             }
-
-            /* No remaining references of any ReferenceType */
-            UA_free(node->references);
-            node->references = NULL;
             return UA_STATUSCODE_GOOD;
         }
+
+        /* No remaining references of any ReferenceType */
+        UA_free(node->references);
+        node->references = NULL;
+        return UA_STATUSCODE_GOOD;
     }
     return UA_STATUSCODE_UNCERTAINREFERENCENOTDELETED;
 }
@@ -23116,7 +24074,7 @@ UA_Node_deleteReferencesSubset(UA_Node *node, size_t referencesSkipSize,
 
         /* Remove references */
         for(size_t j = 0; j < refs->refTargetsSize; j++)
-            UA_ExpandedNodeId_clear(&refs->refTargets[j].target);
+            ReferenceTarget_clearTarget(&refs->refTargets[j]);
         UA_free(refs->refTargets);
         UA_NodeId_clear(&refs->referenceTypeId);
         node->referencesSize--;
@@ -23290,8 +24248,11 @@ UA_Server_forEachChildNodeCall(UA_Server *server, UA_NodeId parentNodeId,
     for(size_t i = parentCopy->referencesSize; i > 0; --i) {
         UA_NodeReferenceKind *ref = &parentCopy->references[i - 1];
         for(size_t j = 0; j<ref->refTargetsSize; j++) {
+            UA_NodeId tmpTarget;
+            const UA_NodeId *targetId =
+                UA_ReferenceTarget_getNodeId(&ref->refTargets[j], &tmpTarget);
             UA_UNLOCK(server->serviceMutex);
-            retval = callback(ref->refTargets[j].target.nodeId, ref->isInverse,
+            retval = callback(*targetId, ref->isInverse,
                               ref->referenceTypeId, handle);
             UA_LOCK(server->serviceMutex);
             if(retval != UA_STATUSCODE_GOOD)
@@ -23359,9 +24320,17 @@ void UA_Server_delete(UA_Server *server) {
     /* Clean up the work queue */
     UA_WorkQueue_cleanup(&server->workQueue);
 
+#ifdef UA_ENABLE_SUBSCRIPTIONS
+    /* All notifications have been returned to the pool */
+    UA_NotificationPool_clear(&server->notificationPool);
+#endif
+
     /* Delete the timed work */
     UA_Timer_deleteMembers(&server->timer);
 
+    UA_ReferenceTypeIndex_clear(&server->refTypeIndex);
+    UA_Array_delete(server->bulkNodes, server->bulkNodesSize, &UA_TYPES[UA_TYPES_NODEID]);
+
     /* Clean up the config */
     UA_ServerConfig_clean(&server->config);
 
@@ -24651,12 +25620,9 @@ addModellingRules(UA_Server *server) {
 
 #endif
 
-/* Initialize the nodeset 0 by using the generated code of the nodeset compiler.
- * This also initialized the data sources for various variables, such as for
- * example server time. */
-UA_StatusCode
-UA_Server_initNS0(UA_Server *server) {
-
+/* Create the nodes of namespace 0 from the generated code */
+static UA_StatusCode
+createNS0Nodes(UA_Server *server) {
     /* Initialize base nodes which are always required an cannot be created
      * through the NS compiler */
     server->bootstrapNS0 = true;
@@ -24667,7 +25633,13 @@ UA_Server_initNS0(UA_Server *server) {
 
 #ifdef UA_GENERATED_NAMESPACE_ZERO
     /* Load nodes and references generated from the XML ns0 definition */
-    retVal = namespace0_generated(server);
+    retVal = UA_Server_bulkLoad_begin(server);
+    if(retVal == UA_STATUSCODE_GOOD) {
+        retVal = namespace0_generated(server);
+        UA_StatusCode endRetVal = UA_Server_bulkLoad_end(server);
+        if(retVal == UA_STATUSCODE_GOOD)
+            retVal = endRetVal;
+    }
 #else
     /* Create a minimal server object */
     retVal = UA_Server_minimalServerObject(server);
@@ -24680,6 +25652,534 @@ UA_Server_initNS0(UA_Server *server) {
                      UA_StatusCode_name(retVal));
         return UA_STATUSCODE_BADINTERNALERROR;
     }
+    return UA_STATUSCODE_GOOD;
+}
+
+/*********************/
+/* Namespace 0 Image */
+/*********************/
+
+/* The image starts with a header of seven UInt32: magic, format version,
+ * library version, build fingerprint, number of nodes, payload length and a
+ * FNV hash of the payload. Every node is a record with its length, the
+ * NodeClass, the attributes and the references in the binary encoding.
+ * Function pointers and node contexts are not part of the image. */
+#define NS0_SNAPSHOT_MAGIC 0x30534E55 /* "UNS0" */
+#define NS0_SNAPSHOT_VERSION 2
+#define NS0_SNAPSHOT_LIBVERSION                                         \
+    ((UA_OPEN62541_VER_MAJOR << 16) | (UA_OPEN62541_VER_MINOR << 8) |  \
+     UA_OPEN62541_VER_PATCH)
+#define NS0_SNAPSHOT_HEADERFIELDS 7
+#define NS0_SNAPSHOT_HEADERSIZE (NS0_SNAPSHOT_HEADERFIELDS * 4)
+
+/* The build options that change the generated namespace 0 or the node
+ * structures. An image from a differently configured build is rejected even
+ * if the library version matches. */
+static UA_UInt32
+ns0SnapshotFingerprint(void) {
+    UA_UInt32 features = 0;
+#ifdef UA_GENERATED_NAMESPACE_ZERO
+    features |= 1u << 0;
+#endif
+#ifdef UA_GENERATED_NAMESPACE_ZERO_FULL
+    features |= 1u << 1;
+#endif
+#ifdef UA_ENABLE_METHODCALLS
+    features |= 1u << 2;
+#endif
+#ifdef UA_ENABLE_SUBSCRIPTIONS
+    features |= 1u << 3;
+#endif
+#ifdef UA_ENABLE_SUBSCRIPTIONS_EVENTS
+    features |= 1u << 4;
+#endif
+#ifdef UA_ENABLE_SUBSCRIPTIONS_ALARMS_CONDITIONS
+    features |= 1u << 5;
+#endif
+#ifdef UA_ENABLE_PUBSUB_INFORMATIONMODEL
+    features |= 1u << 6;
+#endif
+#ifdef UA_ENABLE_PUBSUB_INFORMATIONMODEL_METHODS
+    features |= 1u << 7;
+#endif
+#ifdef UA_ENABLE_DISCOVERY
+    features |= 1u << 8;
+#endif
+#ifdef UA_ENABLE_HISTORIZING
+    features |= 1u << 9;
+#endif
+#ifdef UA_ENABLE_DA
+    features |= 1u << 10;
+#endif
+#ifdef UA_ENABLE_NODESET_COMPILER_DESCRIPTIONS
+    features |= 1u << 11;
+#endif
+#ifdef UA_ENABLE_MICRO_EMB_DEV_PROFILE
+    features |= 1u << 12;
+#endif
+#ifdef UA_ENABLE_COMPACT_REFERENCES
+    features |= 1u << 13;
+#endif
+#ifdef UA_ENABLE_IMMUTABLE_NODES
+    features |= 1u << 14;
+#endif
+    const UA_UInt32 build[] = {
+        features, UA_TYPES_COUNT,
+        (UA_UInt32)sizeof(UA_Node), (UA_UInt32)sizeof(UA_NodeReferenceKind),
+        (UA_UInt32)sizeof(UA_VariableNode), (UA_UInt32)sizeof(UA_VariableTypeNode),
+        (UA_UInt32)sizeof(UA_MethodNode), (UA_UInt32)sizeof(UA_ObjectNode),
+        (UA_UInt32)sizeof(UA_ObjectTypeNode), (UA_UInt32)sizeof(UA_ReferenceTypeNode),
+        (UA_UInt32)sizeof(UA_DataTypeNode), (UA_UInt32)sizeof(UA_ViewNode)
+    };
+    return UA_ByteString_hash(0, (const UA_Byte*)build, sizeof(build));
+}
+
+typedef struct {
+    UA_ByteString buf;
+    size_t pos;
+    UA_UInt32 nodesSize;
+    UA_StatusCode retval;
+} SnapshotWriter;
+
+static void
+snapshotWrite(SnapshotWriter *w, const void *src, const UA_DataType *type) {
+    if(w->retval != UA_STATUSCODE_GOOD)
+        return;
+    size_t size = UA_calcSizeBinary(src, type);
+    if(w->pos + size > w->buf.length) {
+        size_t newLength = (w->buf.length > 0) ? w->buf.length * 2 : 4096;
+        if(newLength < w->pos + size)
+            newLength = w->pos + size;
+        UA_Byte *newData = (UA_Byte*)UA_realloc(w->buf.data, newLength);
+        if(!newData) {
+            w->retval = UA_STATUSCODE_BADOUTOFMEMORY;
+            return;
+        }
+        w->buf.data = newData;
+        w->buf.length = newLength;
+    }
+    UA_Byte *pos = &w->buf.data[w->pos];
+    const UA_Byte *end = &w->buf.data[w->buf.length];
+    w->retval = UA_encodeBinary(src, type, &pos, &end, NULL, NULL);
+    w->pos = (size_t)(pos - w->buf.data);
+}
+
+/* Overwrite a UInt32 at an earlier position */
+static void
+snapshotPatchUInt32(SnapshotWriter *w, size_t at, UA_UInt32 value) {
+    if(w->retval != UA_STATUSCODE_GOOD)
+        return;
+    UA_Byte *pos = &w->buf.data[at];
+    const UA_Byte *end = &w->buf.data[at + 4];
+    w->retval = UA_encodeBinary(&value, &UA_TYPES[UA_TYPES_UINT32], &pos, &end, NULL, NULL);
+}
+
+/* The members are the same for VariableNodes and VariableTypeNodes */
+static void
+snapshotWriteVariableAttributes(SnapshotWriter *w, const UA_VariableNode *vn) {
+    snapshotWrite(w, &vn->dataType, &UA_TYPES[UA_TYPES_NODEID]);
+    snapshotWrite(w, &vn->valueRank, &UA_TYPES[UA_TYPES_INT32]);
+    UA_UInt32 dimsSize = (UA_UInt32)vn->arrayDimensionsSize;
+    snapshotWrite(w, &dimsSize, &UA_TYPES[UA_TYPES_UINT32]);
+    for(size_t i = 0; i < vn->arrayDimensionsSize; i++)
+        snapshotWrite(w, &vn->arrayDimensions[i], &UA_TYPES[UA_TYPES_UINT32]);
+
+    /* A DataSource is set up again after loading */
+    UA_DataValue empty;
+    UA_DataValue_init(&empty);
+    const UA_DataValue *value = &empty;
+    if(vn->valueSource == UA_VALUESOURCE_DATA)
+        value = &vn->value.data.value;
+    snapshotWrite(w, value, &UA_TYPES[UA_TYPES_DATAVALUE]);
+}
+
+static void
+snapshotWriteNode(void *visitorCtx, const UA_Node *node) {
+    SnapshotWriter *w = (SnapshotWriter*)visitorCtx;
+    size_t lengthPos = w->pos;
+    UA_UInt32 length = 0;
+    snapshotWrite(w, &length, &UA_TYPES[UA_TYPES_UINT32]);
+
+    UA_UInt32 nodeClass = (UA_UInt32)node->nodeClass;
+    snapshotWrite(w, &nodeClass, &UA_TYPES[UA_TYPES_UINT32]);
+    snapshotWrite(w, &node->nodeId, &UA_TYPES[UA_TYPES_NODEID]);
+    snapshotWrite(w, &node->browseName, &UA_TYPES[UA_TYPES_QUALIFIEDNAME]);
+    snapshotWrite(w, &node->displayName, &UA_TYPES[UA_TYPES_LOCALIZEDTEXT]);
+    snapshotWrite(w, &node->description, &UA_TYPES[UA_TYPES_LOCALIZEDTEXT]);
+    snapshotWrite(w, &node->writeMask, &UA_TYPES[UA_TYPES_UINT32]);
+    snapshotWrite(w, &node->constructed, &UA_TYPES[UA_TYPES_BOOLEAN]);
+
+    switch(node->nodeClass) {
+    case UA_NODECLASS_VARIABLE: {
+        const UA_VariableNode *vn = (const UA_VariableNode*)node;
+        snapshotWriteVariableAttributes(w, vn);
+        snapshotWrite(w, &vn->accessLevel, &UA_TYPES[UA_TYPES_BYTE]);
+        snapshotWrite(w, &vn->minimumSamplingInterval, &UA_TYPES[UA_TYPES_DOUBLE]);
+        snapshotWrite(w, &vn->historizing, &UA_TYPES[UA_TYPES_BOOLEAN]);
+        break;
+    }
+    case UA_NODECLASS_VARIABLETYPE: {
+        const UA_VariableTypeNode *vtn = (const UA_VariableTypeNode*)node;
+        snapshotWriteVariableAttributes(w, (const UA_VariableNode*)node);
+        snapshotWrite(w, &vtn->isAbstract, &UA_TYPES[UA_TYPES_BOOLEAN]);
+        break;
+    }
+    case UA_NODECLASS_METHOD:
+        snapshotWrite(w, &((const UA_MethodNode*)node)->executable,
+                      &UA_TYPES[UA_TYPES_BOOLEAN]);
+        break;
+    case UA_NODECLASS_OBJECT:
+        snapshotWrite(w, &((const UA_ObjectNode*)node)->eventNotifier,
+                      &UA_TYPES[UA_TYPES_BYTE]);
+        break;
+    case UA_NODECLASS_OBJECTTYPE:
+        snapshotWrite(w, &((const UA_ObjectTypeNode*)node)->isAbstract,
+                      &UA_TYPES[UA_TYPES_BOOLEAN]);
+        break;
+    case UA_NODECLASS_REFERENCETYPE: {
+        const UA_ReferenceTypeNode *rtn = (const UA_ReferenceTypeNode*)node;
+        snapshotWrite(w, &rtn->isAbstract, &UA_TYPES[UA_TYPES_BOOLEAN]);
+        snapshotWrite(w, &rtn->symmetric, &UA_TYPES[UA_TYPES_BOOLEAN]);
+        snapshotWrite(w, &rtn->inverseName, &UA_TYPES[UA_TYPES_LOCALIZEDTEXT]);
+        break;
+    }
+    case UA_NODECLASS_DATATYPE:
+        snapshotWrite(w, &((const UA_DataTypeNode*)node)->isAbstract,
+                      &UA_TYPES[UA_TYPES_BOOLEAN]);
+        break;
+    case UA_NODECLASS_VIEW: {
+        const UA_ViewNode *vwn = (const UA_ViewNode*)node;
+        snapshotWrite(w, &vwn->eventNotifier, &UA_TYPES[UA_TYPES_BYTE]);
+        snapshotWrite(w, &vwn->containsNoLoops, &UA_TYPES[UA_TYPES_BOOLEAN]);
+        break;
+    }
+    default:
+        w->retval = UA_STATUSCODE_BADNODECLASSINVALID;
+        return;
+    }
+
+    /* References in their original order */
+    UA_UInt32 refsSize = (UA_UInt32)node->referencesSize;
+    snapshotWrite(w, &refsSize, &UA_TYPES[UA_TYPES_UINT32]);
+    for(size_t i = 0; i < node->referencesSize; i++) {
+        const UA_NodeReferenceKind *rk = &node->references[i];
+        snapshotWrite(w, &rk->referenceTypeId, &UA_TYPES[UA_TYPES_NODEID]);
+        snapshotWrite(w, &rk->isInverse, &UA_TYPES[UA_TYPES_BOOLEAN]);
+        UA_UInt32 targetsSize = (UA_UInt32)rk->refTargetsSize;
+        snapshotWrite(w, &targetsSize, &UA_TYPES[UA_TYPES_UINT32]);
+        for(size_t j = 0; j < rk->refTargetsSize; j++) {
+            UA_ExpandedNodeId tmpTarget;
+            snapshotWrite(w, UA_ReferenceTarget_getTarget(&rk->refTargets[j], &tmpTarget),
+                          &UA_TYPES[UA_TYPES_EXPANDEDNODEID]);
+        }
+    }
+
+    snapshotPatchUInt32(w, lengthPos, (UA_UInt32)(w->pos - lengthPos - 4));
+    w->nodesSize++;
+}
+
+static UA_StatusCode
+writeNS0Snapshot(UA_Server *server, UA_ByteString *image) {
+    SnapshotWriter w;
+    memset(&w, 0, sizeof(SnapshotWriter));
+
+    /* Reserve the header */
+    UA_UInt32 header[NS0_SNAPSHOT_HEADERFIELDS];
+    memset(header, 0, sizeof(header));
+    for(size_t i = 0; i < NS0_SNAPSHOT_HEADERFIELDS; i++)
+        snapshotWrite(&w, &header[i], &UA_TYPES[UA_TYPES_UINT32]);
+
+    server->config.nodestore.iterate(server->config.nodestore.context,
+                                     snapshotWriteNode, &w);
+
+    /* Fill the header */
+    size_t payloadLength = w.pos - NS0_SNAPSHOT_HEADERSIZE;
+    header[0] = NS0_SNAPSHOT_MAGIC;
+    header[1] = NS0_SNAPSHOT_VERSION;
+    header[2] = NS0_SNAPSHOT_LIBVERSION;
+    header[3] = ns0SnapshotFingerprint();
+    header[4] = w.nodesSize;
+    header[5] = (UA_UInt32)payloadLength;
+    if(w.retval == UA_STATUSCODE_GOOD)
+        header[6] = UA_ByteString_hash(0, &w.buf.data[NS0_SNAPSHOT_HEADERSIZE],
+                                       payloadLength);
+    for(size_t i = 0; i < NS0_SNAPSHOT_HEADERFIELDS; i++)
+        snapshotPatchUInt32(&w, i * 4, header[i]);
+
+    if(w.retval != UA_STATUSCODE_GOOD) {
+        UA_free(w.buf.data);
+        return w.retval;
+    }
+    image->data = w.buf.data;
+    image->length = w.pos;
+    return UA_STATUSCODE_GOOD;
+}
+
+UA_StatusCode
+UA_Server_createNS0Snapshot(UA_Server *server, UA_ByteString *image) {
+    UA_ByteString_init(image);
+
+    /* The nodestore is swapped without the service lock. That is only safe
+     * before the server is started. */
+    if(server->startTime != 0) {
+        UA_LOG_ERROR(&server->config.logger, UA_LOGCATEGORY_SERVER,
+                     "The image of Namespace 0 can only be created before "
+                     "the server is started");
+        return UA_STATUSCODE_BADINVALIDSTATE;
+    }
+
+    /* Create the nodes in a temporary nodestore. The nodestore of the server
+     * is not touched. */
+    UA_Nodestore ns;
+    UA_StatusCode retval = UA_Nodestore_HashMap(&ns);
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
+    UA_Nodestore serverNs = server->config.nodestore;
+    server->config.nodestore = ns;
+    invalidateReferenceTypeIndex(server);
+
+    retval = createNS0Nodes(server);
+    if(retval == UA_STATUSCODE_GOOD)
+        retval = writeNS0Snapshot(server, image);
+
+    server->config.nodestore = serverNs;
+    ns.clear(ns.context);
+    invalidateReferenceTypeIndex(server);
+    return retval;
+}
+
+static void
+snapshotRead(UA_Server *server, const UA_ByteString *image, size_t *offset,
+             void *dst, const UA_DataType *type, UA_StatusCode *retval) {
+    if(*retval != UA_STATUSCODE_GOOD)
+        return;
+    *retval = UA_decodeBinary(image, offset, dst, type, server->config.customDataTypes);
+}
+
+static void
+snapshotReadVariableAttributes(UA_Server *server, const UA_ByteString *image,
+                               size_t *offset, UA_VariableNode *vn,
+                               UA_StatusCode *retval) {
+    snapshotRead(server, image, offset, &vn->dataType, &UA_TYPES[UA_TYPES_NODEID], retval);
+    snapshotRead(server, image, offset, &vn->valueRank, &UA_TYPES[UA_TYPES_INT32], retval);
+    UA_UInt32 dimsSize = 0;
+    snapshotRead(server, image, offset, &dimsSize, &UA_TYPES[UA_TYPES_UINT32], retval);
+    if(*retval == UA_STATUSCODE_GOOD && dimsSize > 0) {
+        if(dimsSize > image->length - *offset) {
+            *retval = UA_STATUSCODE_BADDECODINGERROR;
+            return;
+        }
+        vn->arrayDimensions = (UA_UInt32*)UA_Array_new(dimsSize, &UA_TYPES[UA_TYPES_UINT32]);
+        if(!vn->arrayDimensions) {
+            *retval = UA_STATUSCODE_BADOUTOFMEMORY;
+            return;
+        }
+        vn->arrayDimensionsSize = dimsSize;
+        for(size_t i = 0; i < dimsSize; i++)
+            snapshotRead(server, image, offset, &vn->arrayDimensions[i],
+                         &UA_TYPES[UA_TYPES_UINT32], retval);
+    }
+    vn->valueSource = UA_VALUESOURCE_DATA;
+    snapshotRead(server, image, offset, &vn->value.data.value,
+                 &UA_TYPES[UA_TYPES_DATAVALUE], retval);
+}
+
+static UA_StatusCode
+loadSnapshotNode(UA_Server *server, const UA_ByteString *image, size_t *offset) {
+    UA_StatusCode retval = UA_STATUSCODE_GOOD;
+    UA_UInt32 length = 0;
+    snapshotRead(server, image, offset, &length, &UA_TYPES[UA_TYPES_UINT32], &retval);
+    if(retval != UA_STATUSCODE_GOOD || length > image->length - *offset)
+        return UA_STATUSCODE_BADDECODINGERROR;
+    size_t end = *offset + length;
+
+    UA_UInt32 nodeClass = 0;
+    snapshotRead(server, image, offset, &nodeClass, &UA_TYPES[UA_TYPES_UINT32], &retval);
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
+    UA_Node *node = UA_NODESTORE_NEW(server, (UA_NodeClass)nodeClass);
+    if(!node)
+        return UA_STATUSCODE_BADDECODINGERROR;
+
+    snapshotRead(server, image, offset, &node->nodeId,
+                 &UA_TYPES[UA_TYPES_NODEID], &retval);
+    snapshotRead(server, image, offset, &node->browseName,
+                 &UA_TYPES[UA_TYPES_QUALIFIEDNAME], &retval);
+    snapshotRead(server, image, offset, &node->displayName,
+                 &UA_TYPES[UA_TYPES_LOCALIZEDTEXT], &retval);
+    snapshotRead(server, image, offset, &node->description,
+                 &UA_TYPES[UA_TYPES_LOCALIZEDTEXT], &retval);
+    snapshotRead(server, image, offset, &node->writeMask,
+                 &UA_TYPES[UA_TYPES_UINT32], &retval);
+    snapshotRead(server, image, offset, &node->constructed,
+                 &UA_TYPES[UA_TYPES_BOOLEAN], &retval);
+
+    switch(node->nodeClass) {
+    case UA_NODECLASS_VARIABLE: {
+        UA_VariableNode *vn = (UA_VariableNode*)node;
+        snapshotReadVariableAttributes(server, image, offset, vn, &retval);
+        snapshotRead(server, image, offset, &vn->accessLevel,
+                     &UA_TYPES[UA_TYPES_BYTE], &retval);
+        snapshotRead(server, image, offset, &vn->minimumSamplingInterval,
+                     &UA_TYPES[UA_TYPES_DOUBLE], &retval);
+        snapshotRead(server, image, offset, &vn->historizing,
+                     &UA_TYPES[UA_TYPES_BOOLEAN], &retval);
+        break;
+    }
+    case UA_NODECLASS_VARIABLETYPE:
+        snapshotReadVariableAttributes(server, image, offset,
+                                       (UA_VariableNode*)node, &retval);
+        snapshotRead(server, image, offset, &((UA_VariableTypeNode*)node)->isAbstract,
+                     &UA_TYPES[UA_TYPES_BOOLEAN], &retval);
+        break;
+    case UA_NODECLASS_METHOD:
+        snapshotRead(server, image, offset, &((UA_MethodNode*)node)->executable,
+                     &UA_TYPES[UA_TYPES_BOOLEAN], &retval);
+        break;
+    case UA_NODECLASS_OBJECT:
+        snapshotRead(server, image, offset, &((UA_ObjectNode*)node)->eventNotifier,
+                     &UA_TYPES[UA_TYPES_BYTE], &retval);
+        break;
+    case UA_NODECLASS_OBJECTTYPE:
+        snapshotRead(server, image, offset, &((UA_ObjectTypeNode*)node)->isAbstract,
+                     &UA_TYPES[UA_TYPES_BOOLEAN], &retval);
+        break;
+    case UA_NODECLASS_REFERENCETYPE: {
+        UA_ReferenceTypeNode *rtn = (UA_ReferenceTypeNode*)node;
+        snapshotRead(server, image, offset, &rtn->isAbstract,
+                     &UA_TYPES[UA_TYPES_BOOLEAN], &retval);
+        snapshotRead(server, image, offset, &rtn->symmetric,
+                     &UA_TYPES[UA_TYPES_BOOLEAN], &retval);
+        snapshotRead(server, image, offset, &rtn->inverseName,
+                     &UA_TYPES[UA_TYPES_LOCALIZEDTEXT], &retval);
+        break;
+    }
+    case UA_NODECLASS_DATATYPE:
+        snapshotRead(server, image, offset, &((UA_DataTypeNode*)node)->isAbstract,
+                     &UA_TYPES[UA_TYPES_BOOLEAN], &retval);
+        break;
+    case UA_NODECLASS_VIEW: {
+        UA_ViewNode *vwn = (UA_ViewNode*)node;
+        snapshotRead(server, image, offset, &vwn->eventNotifier,
+                     &UA_TYPES[UA_TYPES_BYTE], &retval);
+        snapshotRead(server, image, offset, &vwn->containsNoLoops,
+                     &UA_TYPES[UA_TYPES_BOOLEAN], &retval);
+        break;
+    }
+    default:
+        retval = UA_STATUSCODE_BADDECODINGERROR;
+        break;
+    }
+
+    /* Add the references. This rebuilds the tree of the targets. */
+    UA_UInt32 refsSize = 0;
+    snapshotRead(server, image, offset, &refsSize, &UA_TYPES[UA_TYPES_UINT32], &retval);
+    for(size_t i = 0; i < refsSize && retval == UA_STATUSCODE_GOOD; i++) {
+        UA_AddReferencesItem item;
+        UA_AddReferencesItem_init(&item);
+        UA_Boolean isInverse = false;
+        UA_UInt32 targetsSize = 0;
+        snapshotRead(server, image, offset, &item.referenceTypeId,
+                     &UA_TYPES[UA_TYPES_NODEID], &retval);
+        snapshotRead(server, image, offset, &isInverse, &UA_TYPES[UA_TYPES_BOOLEAN], &retval);
+        snapshotRead(server, image, offset, &targetsSize, &UA_TYPES[UA_TYPES_UINT32], &retval);
+        item.isForward = !isInverse;
+        for(size_t j = 0; j < targetsSize && retval == UA_STATUSCODE_GOOD; j++) {
+            snapshotRead(server, image, offset, &item.targetNodeId,
+                         &UA_TYPES[UA_TYPES_EXPANDEDNODEID], &retval);
+            if(retval == UA_STATUSCODE_GOOD)
+                retval = UA_Node_addReference(node, &item);
+            UA_ExpandedNodeId_clear(&item.targetNodeId);
+        }
+        UA_NodeId_clear(&item.referenceTypeId);
+    }
+
+    if(retval == UA_STATUSCODE_GOOD && *offset != end)
+        retval = UA_STATUSCODE_BADDECODINGERROR;
+    if(retval != UA_STATUSCODE_GOOD) {
+        UA_NODESTORE_DELETE(server, node);
+        return retval;
+    }
+    return UA_NODESTORE_INSERT(server, node, NULL);
+}
+
+/* Remove the first nodesSize nodes of the image from the nodestore */
+static void
+unloadSnapshotNodes(UA_Server *server, const UA_ByteString *image, size_t nodesSize) {
+    size_t offset = NS0_SNAPSHOT_HEADERSIZE;
+    for(size_t i = 0; i < nodesSize; i++) {
+        UA_StatusCode retval = UA_STATUSCODE_GOOD;
+        UA_UInt32 length = 0;
+        UA_UInt32 nodeClass = 0;
+        UA_NodeId nodeId;
+        UA_NodeId_init(&nodeId);
+        snapshotRead(server, image, &offset, &length, &UA_TYPES[UA_TYPES_UINT32], &retval);
+        size_t end = offset + length;
+        snapshotRead(server, image, &offset, &nodeClass, &UA_TYPES[UA_TYPES_UINT32], &retval);
+        snapshotRead(server, image, &offset, &nodeId, &UA_TYPES[UA_TYPES_NODEID], &retval);
+        if(retval != UA_STATUSCODE_GOOD)
+            return;
+        UA_NODESTORE_REMOVE(server, &nodeId);
+        UA_NodeId_clear(&nodeId);
+        offset = end;
+    }
+}
+
+static UA_StatusCode
+loadNS0Snapshot(UA_Server *server, const UA_ByteString *image) {
+    /* Check the header before anything is added to the nodestore */
+    if(image->length < NS0_SNAPSHOT_HEADERSIZE)
+        return UA_STATUSCODE_BADDECODINGERROR;
+    UA_StatusCode retval = UA_STATUSCODE_GOOD;
+    UA_UInt32 header[NS0_SNAPSHOT_HEADERFIELDS];
+    size_t offset = 0;
+    for(size_t i = 0; i < NS0_SNAPSHOT_HEADERFIELDS; i++)
+        snapshotRead(server, image, &offset, &header[i], &UA_TYPES[UA_TYPES_UINT32], &retval);
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
+    if(header[0] != NS0_SNAPSHOT_MAGIC || header[1] != NS0_SNAPSHOT_VERSION ||
+       header[2] != NS0_SNAPSHOT_LIBVERSION || header[3] != ns0SnapshotFingerprint())
+        return UA_STATUSCODE_BADDATAENCODINGUNSUPPORTED;
+    if(header[5] != image->length - NS0_SNAPSHOT_HEADERSIZE ||
+       header[6] != UA_ByteString_hash(0, &image->data[NS0_SNAPSHOT_HEADERSIZE],
+                                       header[5]))
+        return UA_STATUSCODE_BADDECODINGERROR;
+
+    /* Load the nodes in a single pass. Remove the loaded nodes if the image
+     * cannot be loaded completely. */
+    size_t i = 0;
+    for(; i < header[4]; i++) {
+        retval = loadSnapshotNode(server, image, &offset);
+        if(retval != UA_STATUSCODE_GOOD)
+            break;
+    }
+    if(retval != UA_STATUSCODE_GOOD)
+        unloadSnapshotNodes(server, image, i);
+    invalidateReferenceTypeIndex(server);
+    return retval;
+}
+
+/* Initialize the nodeset 0 by using the generated code of the nodeset compiler.
+ * This also initialized the data sources for various variables, such as for
+ * example server time. */
+UA_StatusCode
+UA_Server_initNS0(UA_Server *server) {
+    /* Load the nodes from the image if one is configured. Fall back to the
+     * generated code if the image does not match. */
+    UA_StatusCode retVal = UA_STATUSCODE_BADNOTFOUND;
+    if(server->config.ns0Snapshot.length > 0) {
+        retVal = loadNS0Snapshot(server, &server->config.ns0Snapshot);
+        if(retVal != UA_STATUSCODE_GOOD)
+            UA_LOG_WARNING(&server->config.logger, UA_LOGCATEGORY_SERVER,
+                           "Loading the image of Namespace 0 failed with %s. "
+                           "Creating the nodes from the generated code instead.",
+                           UA_StatusCode_name(retVal));
+    }
+    if(retVal != UA_STATUSCODE_GOOD) {
+        retVal = createNS0Nodes(server);
+        if(retVal != UA_STATUSCODE_GOOD)
+            return retVal;
+    }
 
     /* NamespaceArray */
     UA_DataSource namespaceDataSource = {readNamespaces, writeNamespaces};
@@ -25999,6 +27499,10 @@ isNodeInTreeNoCircular(UA_Server *server, const UA_NodeId *leafNode, const UA_No
 
         /* Match the targets or recurse */
         for(size_t j = 0; j < refs->refTargetsSize; ++j) {
+            UA_NodeId tmpTarget;
+            const UA_NodeId *targetId =
+                UA_ReferenceTarget_getNodeId(&refs->refTargets[j], &tmpTarget);
+
             /* Check if we already have seen the referenced node and skip to
              * avoid endless recursion. Do this only at every 5th depth to save
              * effort. Circular dependencies are rare and forbidden for most
@@ -26007,7 +27511,7 @@ isNodeInTreeNoCircular(UA_Server *server, const UA_NodeId *leafNode, const UA_No
                 struct ref_history *last = visitedRefs;
                 UA_Boolean skip = false;
                 while(!skip && last) {
-                    if(UA_NodeId_equal(last->id, &refs->refTargets[j].target.nodeId))
+                    if(UA_NodeId_equal(last->id, targetId))
                         skip = true;
                     last = last->parent;
                 }
@@ -26016,12 +27520,12 @@ isNodeInTreeNoCircular(UA_Server *server, const UA_NodeId *leafNode, const UA_No
             }
 
             /* Stack-allocate the visitedRefs structure for the next depth */
-            struct ref_history nextVisitedRefs = {visitedRefs, &refs->refTargets[j].target.nodeId,
+            struct ref_history nextVisitedRefs = {visitedRefs, targetId,
                                                   (UA_UInt16)(visitedRefs->depth+1)};
 
             /* Recurse */
             UA_Boolean foundRecursive =
-                isNodeInTreeNoCircular(server, &refs->refTargets[j].target.nodeId, nodeToFind,
+                isNodeInTreeNoCircular(server, targetId, nodeToFind,
                                        &nextVisitedRefs, referenceTypeIds, referenceTypeIdsSize);
             if(foundRecursive) {
                 UA_NODESTORE_RELEASE(server, node);
@@ -26078,7 +27582,9 @@ getNodeType(UA_Server *server, const UA_Node *node) {
         if(!UA_NodeId_equal(&node->references[i].referenceTypeId, &parentRef))
             continue;
         UA_assert(node->references[i].refTargetsSize> 0);
-        const UA_NodeId *targetId = &node->references[i].refTargets[0].target.nodeId;
+        UA_NodeId tmpTarget;
+        const UA_NodeId *targetId =
+            UA_ReferenceTarget_getNodeId(&node->references[i].refTargets[0], &tmpTarget);
         const UA_Node *type = UA_NODESTORE_GET(server, targetId);
         if(!type)
             continue;
@@ -26205,6 +27711,39 @@ UA_Server_editNode(UA_Server *server, UA_Session *session,
 #endif
 }
 
+UA_StatusCode
+UA_Server_editNodeValue(UA_Server *server, UA_Session *session,
+                        const UA_NodeId *nodeId, UA_EditNodeCallback callback,
+                        void *data) {
+#ifdef UA_ENABLE_IMMUTABLE_NODES
+    if(server->config.nodestore.getNodeValueCopy) {
+        UA_StatusCode retval;
+        do {
+            /* Get a copy of the node where only the value is editable */
+            UA_Node *node;
+            retval = UA_NODESTORE_GETVALUECOPY(server, nodeId, &node);
+            if(retval == UA_STATUSCODE_BADNODECLASSINVALID)
+                break; /* Use the generic path */
+            if(retval != UA_STATUSCODE_GOOD)
+                return retval;
+
+            /* Run the operation on the copy */
+            retval = callback(server, session, node, data);
+            if(retval != UA_STATUSCODE_GOOD) {
+                UA_NODESTORE_DELETE(server, node);
+                return retval;
+            }
+
+            /* Replace the node */
+            retval = UA_NODESTORE_REPLACE(server, node);
+        } while(retval != UA_STATUSCODE_GOOD);
+        if(retval == UA_STATUSCODE_GOOD)
+            return retval;
+    }
+#endif
+    return UA_Server_editNode(server, session, nodeId, callback, data);
+}
+
 UA_StatusCode
 UA_Server_processServiceOperations(UA_Server *server, UA_Session *session,
                                    UA_ServiceOperation operationCallback,
@@ -27249,10 +28788,51 @@ static UA_Boolean UA_NetworkMessage_ExtendedFlags1Enabled(const UA_NetworkMessag
 static UA_Boolean UA_NetworkMessage_ExtendedFlags2Enabled(const UA_NetworkMessage* src);
 static UA_Boolean UA_DataSetMessageHeader_DataSetFlags2Enabled(const UA_DataSetMessageHeader* src);
 
+void
+UA_NetworkMessage_compileBufferedMessage(UA_NetworkMessageOffsetBuffer *buffer) {
+    for(size_t i = 0; i < buffer->offsetsSize; ++i) {
+        UA_NetworkMessageOffset *o = &buffer->offsets[i];
+        o->directSource = NULL;
+        o->directOffset = 0;
+        o->directSize = 0;
+        const UA_Variant *v = NULL;
+        switch(o->contentType) {
+            case UA_PUBSUB_OFFSETTYPE_DATASETMESSAGE_SEQUENCENUMBER:
+            case UA_PUBSUB_OFFSETTYPE_NETWORKMESSAGE_SEQUENCENUMBER:
+                if(!UA_BINARY_OVERLAYABLE_INTEGER)
+                    continue;
+                v = &o->offsetData.value.value->value;
+                o->directOffset = o->offset;
+                break;
+            case UA_PUBSUB_OFFSETTYPE_PAYLOAD_VARIANT:
+                /* Only scalars whose binary encoding is the encoding byte
+                 * followed by the memory layout of the value */
+                v = &o->offsetData.value.value->value;
+                if(!v->type || !v->type->overlayable || !UA_Variant_isScalar(v) ||
+                   UA_calcSizeBinary(v, &UA_TYPES[UA_TYPES_VARIANT]) != 1u + v->type->memSize)
+                    continue;
+                o->directOffset = o->offset + 1; /* Skip the encoding byte */
+                break;
+            default:
+                continue;
+        }
+        if(!v->data || o->directOffset + v->type->memSize > buffer->buffer.length)
+            continue;
+        o->directSource = v->data;
+        o->directSize = v->type->memSize;
+    }
+}
+
 UA_StatusCode
 UA_NetworkMessage_updateBufferedMessage(UA_NetworkMessageOffsetBuffer *buffer){
     UA_StatusCode rv = UA_STATUSCODE_GOOD;
     for (size_t i = 0; i < buffer->offsetsSize; ++i) {
+        /* Fast path. Copy the value as-is into the pre-encoded message. */
+        if(buffer->offsets[i].directSize > 0) {
+            memcpy(&buffer->buffer.data[buffer->offsets[i].directOffset],
+                   buffer->offsets[i].directSource, buffer->offsets[i].directSize);
+            continue;
+        }
         const UA_Byte *bufEnd = &buffer->buffer.data[buffer->buffer.length];
         UA_Byte *bufPos = &buffer->buffer.data[buffer->offsets[i].offset];
         switch (buffer->offsets[i].contentType) {
@@ -27888,6 +29468,7 @@ increaseOffsetArray(UA_NetworkMessageOffsetBuffer *offsetBuffer) {
     if(!tmpOffsets)
         return false;
     offsetBuffer->offsets = tmpOffsets;
+    memset(&offsetBuffer->offsets[offsetBuffer->offsetsSize], 0, sizeof(UA_NetworkMessageOffset));
     offsetBuffer->offsetsSize++;
     return true;
 }
@@ -28724,17 +30305,38 @@ UA_PubSubConnectionConfig_clear(UA_PubSubConnectionConfig *connectionConfig) {
 
 void
 UA_PubSubConnection_clear(UA_Server *server, UA_PubSubConnection *connection) {
+    /* Stop and unfreeze the groups. Frozen groups cannot be removed and the
+     * connection stays frozen as long as one of its groups is frozen. */
+    UA_ReaderGroup *readerGroups, *tmpReaderGroup;
+    LIST_FOREACH(readerGroups, &connection->readerGroups, listEntry) {
+        UA_ReaderGroup_removeSubscribeCallback(server, readerGroups);
+        UA_Server_unfreezeReaderGroupConfiguration(server, readerGroups->identifier);
+    }
+    UA_WriterGroup *writerGroup, *tmpWriterGroup;
+    LIST_FOREACH(writerGroup, &connection->writerGroups, listEntry) {
+        UA_WriterGroup_setPubSubState(server, UA_PUBSUBSTATE_DISABLED, writerGroup);
+        if(writerGroup->config.configurationFrozen)
+            UA_Server_unfreezeWriterGroupConfiguration(server, writerGroup->identifier);
+    }
+
     //delete connection config
     UA_PubSubConnectionConfig_clear(connection->config);
     //remove contained WriterGroups
-    UA_WriterGroup *writerGroup, *tmpWriterGroup;
+    UA_StatusCode res;
     LIST_FOREACH_SAFE(writerGroup, &connection->writerGroups, listEntry, tmpWriterGroup){
-        UA_Server_removeWriterGroup(server, writerGroup->identifier);
+        res = UA_Server_removeWriterGroup(server, writerGroup->identifier);
+        if(res != UA_STATUSCODE_GOOD)
+            UA_LOG_ERROR(&server->config.logger, UA_LOGCATEGORY_SERVER,
+                         "Removing the WriterGroup failed with %s",
+                         UA_StatusCode_name(res));
     }
     /* remove contained ReaderGroups */
-    UA_ReaderGroup *readerGroups, *tmpReaderGroup;
     LIST_FOREACH_SAFE(readerGroups, &connection->readerGroups, listEntry, tmpReaderGroup){
-      UA_Server_removeReaderGroup(server, readerGroups->identifier);
+        res = UA_Server_removeReaderGroup(server, readerGroups->identifier);
+        if(res != UA_STATUSCODE_GOOD)
+            UA_LOG_ERROR(&server->config.logger, UA_LOGCATEGORY_SERVER,
+                         "Removing the ReaderGroup failed with %s",
+                         UA_StatusCode_name(res));
     }
 
     UA_NodeId_clear(&connection->identifier);
@@ -28831,7 +30433,7 @@ UA_Server_removeWriterGroup(UA_Server *server, const UA_NodeId writerGroup){
     }
     if(wg->state == UA_PUBSUBSTATE_OPERATIONAL){
         //unregister the publish callback
-        UA_PubSubManager_removeRepeatedPubSubCallback(server, wg->publishCallbackId);
+        UA_WriterGroup_removePublishCallback(server, wg);
     }
 #ifdef UA_ENABLE_PUBSUB_INFORMATIONMODEL
     removeGroupRepresentation(server, wg);
@@ -28880,6 +30482,7 @@ UA_Server_freezeWriterGroupConfiguration(UA_Server *server, const UA_NodeId writ
         /* Generate data set messages  */
         UA_STACKARRAY(UA_UInt16, dsWriterIds, wg->writersCount);
         UA_STACKARRAY(UA_DataSetMessage, dsmStore, wg->writersCount);
+        UA_STACKARRAY(UA_DataSetWriter *, dswStore, wg->writersCount);
         UA_DataSetWriter *dsw;
         LIST_FOREACH(dsw, &wg->writers, listEntry) {
             /* Find the dataset */
@@ -28923,6 +30526,7 @@ UA_Server_freezeWriterGroupConfiguration(UA_Server *server, const UA_NodeId writ
                 continue;
             }
             dsWriterIds[dsmCount] = dsw->config.dataSetWriterId;
+            dswStore[dsmCount] = dsw;
             dsmCount++;
         }
         UA_NetworkMessage networkMessage;
@@ -28942,6 +30546,28 @@ UA_Server_freezeWriterGroupConfiguration(UA_Server *server, const UA_NodeId writ
         const UA_Byte *bufEnd = &wg->bufferedMessage.buffer.data[wg->bufferedMessage.buffer.length];
         UA_Byte *bufPos = wg->bufferedMessage.buffer.data;
         UA_NetworkMessage_encodeBinary(&networkMessage, &bufPos, bufEnd);
+        /* The sequence numbers were taken from the stack-allocated messages.
+         * Point them to the counters that are incremented on every publish.
+         * Not every DataSetMessage needs to carry a sequence number. So the
+         * DataSetMessage is identified by the header the offset points to. */
+        for(size_t i = 0; i < wg->bufferedMessage.offsetsSize; i++) {
+            UA_NetworkMessageOffset *o = &wg->bufferedMessage.offsets[i];
+            if(o->contentType == UA_PUBSUB_OFFSETTYPE_NETWORKMESSAGE_SEQUENCENUMBER) {
+                o->offsetData.value.value->value.data = &wg->sequenceNumber;
+                continue;
+            }
+            if(o->contentType != UA_PUBSUB_OFFSETTYPE_DATASETMESSAGE_SEQUENCENUMBER)
+                continue;
+            for(size_t j = 0; j < dsmCount; j++) {
+                if(o->offsetData.value.value->value.data !=
+                   &dsmStore[j].header.dataSetMessageSequenceNr)
+                    continue;
+                o->offsetData.value.value->value.data =
+                    &dswStore[j]->actualDataSetMessageSequenceCount;
+                break;
+            }
+        }
+        UA_NetworkMessage_compileBufferedMessage(&wg->bufferedMessage);
         /* Clean up DSM */
         for(size_t i = 0; i < dsmCount; i++){
             UA_free(dsmStore[i].data.keyFrameData.dataSetFields);
@@ -29589,7 +31215,7 @@ UA_Server_updateWriterGroupConfig(UA_Server *server, UA_NodeId writerGroupIdenti
     }
     if(currentWriterGroup->config.publishingInterval != config->publishingInterval) {
         if(currentWriterGroup->config.rtLevel == UA_PUBSUB_RT_NONE && currentWriterGroup->state == UA_PUBSUBSTATE_OPERATIONAL){
-            UA_PubSubManager_removeRepeatedPubSubCallback(server, currentWriterGroup->publishCallbackId);
+            UA_WriterGroup_removePublishCallback(server, currentWriterGroup);
             currentWriterGroup->config.publishingInterval = config->publishingInterval;
             UA_WriterGroup_addPublishCallback(server, currentWriterGroup);
         } else {
@@ -29642,6 +31268,10 @@ UA_WriterGroup_clear(UA_Server *server, UA_WriterGroup *writerGroup) {
         for (size_t i = 0; i < writerGroup->bufferedMessage.offsetsSize; i++) {
             if(writerGroup->bufferedMessage.offsets[i].contentType == UA_PUBSUB_OFFSETTYPE_PAYLOAD_VARIANT){
                 UA_DataValue_delete(writerGroup->bufferedMessage.offsets[i].offsetData.value.value);
+            } else if(writerGroup->bufferedMessage.offsets[i].contentType == UA_PUBSUB_OFFSETTYPE_NETWORKMESSAGE_SEQUENCENUMBER ||
+                      writerGroup->bufferedMessage.offsets[i].contentType == UA_PUBSUB_OFFSETTYPE_DATASETMESSAGE_SEQUENCENUMBER){
+                /* The sequence number is not owned by the DataValue */
+                UA_free(writerGroup->bufferedMessage.offsets[i].offsetData.value.value);
             }
         }
         UA_ByteString_deleteMembers(&writerGroup->bufferedMessage.buffer);
@@ -29661,7 +31291,7 @@ UA_WriterGroup_setPubSubState(UA_Server *server, UA_PubSubState state, UA_Writer
                 case UA_PUBSUBSTATE_PAUSED:
                     break;
                 case UA_PUBSUBSTATE_OPERATIONAL:
-                    UA_PubSubManager_removeRepeatedPubSubCallback(server, writerGroup->publishCallbackId);
+                    UA_WriterGroup_removePublishCallback(server, writerGroup);
                     LIST_FOREACH(dataSetWriter, &writerGroup->writers, listEntry){
                         UA_DataSetWriter_setPubSubState(server, UA_PUBSUBSTATE_DISABLED, dataSetWriter);
                     }
@@ -29691,14 +31321,24 @@ UA_WriterGroup_setPubSubState(UA_Server *server, UA_PubSubState state, UA_Writer
             break;
         case UA_PUBSUBSTATE_OPERATIONAL:
             switch (writerGroup->state){
-                case UA_PUBSUBSTATE_DISABLED:
+                case UA_PUBSUBSTATE_DISABLED: {
                     writerGroup->state = UA_PUBSUBSTATE_OPERATIONAL;
-                    UA_PubSubManager_removeRepeatedPubSubCallback(server, writerGroup->publishCallbackId);
+                    UA_WriterGroup_removePublishCallback(server, writerGroup);
                     LIST_FOREACH(dataSetWriter, &writerGroup->writers, listEntry){
                         UA_DataSetWriter_setPubSubState(server, UA_PUBSUBSTATE_OPERATIONAL, dataSetWriter);
                     }
-                    UA_WriterGroup_addPublishCallback(server, writerGroup);
+                    UA_StatusCode retval = UA_WriterGroup_addPublishCallback(server, writerGroup);
+                    if(retval != UA_STATUSCODE_GOOD) {
+                        /* The WriterGroup would never publish. Roll back. */
+                        UA_WriterGroup_removePublishCallback(server, writerGroup);
+                        LIST_FOREACH(dataSetWriter, &writerGroup->writers, listEntry){
+                            UA_DataSetWriter_setPubSubState(server, UA_PUBSUBSTATE_DISABLED, dataSetWriter);
+                        }
+                        writerGroup->state = UA_PUBSUBSTATE_DISABLED;
+                        return retval;
+                    }
                     break;
+                }
                 case UA_PUBSUBSTATE_PAUSED:
                     break;
                 case UA_PUBSUBSTATE_OPERATIONAL:
@@ -30458,6 +32098,30 @@ sendBufferedNetworkMessage(UA_Server *server, UA_PubSubConnection *connection,
                                      transportSettings, &buffer->buffer);
 }
 
+/* Encode the NetworkMessage into a newly allocated buffer. Used to send
+ * several NetworkMessages at once over the channel. */
+static UA_StatusCode
+encodeNetworkMessage(UA_PubSubConnection *connection, UA_WriterGroup *wg,
+                     UA_DataSetMessage *dsm, UA_UInt16 *writerIds, UA_Byte dsmCount,
+                     UA_ExtensionObject *messageSettings,
+                     UA_ExtensionObject *transportSettings, UA_ByteString *buf) {
+    UA_NetworkMessage nm;
+    memset(&nm, 0, sizeof(UA_NetworkMessage));
+    generateNetworkMessage(connection, wg, dsm, writerIds, dsmCount, messageSettings, transportSettings, &nm);
+
+    size_t msgSize = UA_NetworkMessage_calcSizeBinary(&nm, NULL);
+    UA_StatusCode retval = UA_ByteString_allocBuffer(buf, msgSize);
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
+
+    UA_Byte *bufPos = buf->data;
+    memset(bufPos, 0, msgSize);
+    retval = UA_NetworkMessage_encodeBinary(&nm, &bufPos, &buf->data[buf->length]);
+    if(retval != UA_STATUSCODE_GOOD)
+        UA_ByteString_clear(buf);
+    return retval;
+}
+
 static UA_StatusCode
 sendNetworkMessage(UA_PubSubConnection *connection, UA_WriterGroup *wg,
                    UA_DataSetMessage *dsm, UA_UInt16 *writerIds, UA_Byte dsmCount,
@@ -30538,8 +32202,12 @@ UA_WriterGroup_publishCallback(UA_Server *server, UA_WriterGroup *writerGroup) {
         UA_StatusCode res =
             sendBufferedNetworkMessage(server, connection, &writerGroup->bufferedMessage,
                                        &writerGroup->config.transportSettings);
-        if(res == UA_STATUSCODE_GOOD)
+        if(res == UA_STATUSCODE_GOOD) {
             writerGroup->sequenceNumber++;
+            UA_DataSetWriter *dsw;
+            LIST_FOREACH(dsw, &writerGroup->writers, listEntry)
+                dsw->actualDataSetMessageSequenceCount++;
+        }
         return;
     }
 
@@ -30558,6 +32226,9 @@ UA_WriterGroup_publishCallback(UA_Server *server, UA_WriterGroup *writerGroup) {
     UA_DataSetWriter *dsw;
     UA_STACKARRAY(UA_UInt16, dsWriterIds, writerGroup->writersCount);
     UA_STACKARRAY(UA_DataSetMessage, dsmStore, writerGroup->writersCount);
+    /* NetworkMessages with a single DSM are sent at once if supported */
+    size_t nmBuffersSize = 0;
+    UA_STACKARRAY(UA_ByteString, nmBuffers, writerGroup->writersCount);
     LIST_FOREACH(dsw, &writerGroup->writers, listEntry) {
         /* Find the dataset */
         UA_PublishedDataSet *pds =
@@ -30581,7 +32252,16 @@ UA_WriterGroup_publishCallback(UA_Server *server, UA_WriterGroup *writerGroup) {
          * are contained in the PublishedDataSet, then this DSM must go into a
          * dedicated NM as well. */
         if(pds->promotedFieldsCount > 0 || maxDSM == 1) {
-            if(writerGroup->config.encodingMimeType == UA_PUBSUB_ENCODING_UADP){
+            if(writerGroup->config.encodingMimeType == UA_PUBSUB_ENCODING_UADP &&
+               connection->channel->sendMany) {
+                res = encodeNetworkMessage(connection, writerGroup, &dsmStore[dsmCount],
+                                           &dsw->config.dataSetWriterId, 1,
+                                           &writerGroup->config.messageSettings,
+                                           &writerGroup->config.transportSettings,
+                                           &nmBuffers[nmBuffersSize]);
+                if(res == UA_STATUSCODE_GOOD)
+                    nmBuffersSize++;
+            } else if(writerGroup->config.encodingMimeType == UA_PUBSUB_ENCODING_UADP){
                 res = sendNetworkMessage(connection, writerGroup, &dsmStore[dsmCount],
                                          &dsw->config.dataSetWriterId, 1,
                                          &writerGroup->config.messageSettings,
@@ -30612,6 +32292,19 @@ UA_WriterGroup_publishCallback(UA_Server *server, UA_WriterGroup *writerGroup) {
         dsmCount++;
     }
 
+    /* Send the NetworkMessages with a single DSM in one go */
+    if(nmBuffersSize > 0) {
+        UA_StatusCode res2 =
+            connection->channel->sendMany(connection->channel,
+                                          &writerGroup->config.transportSettings,
+                                          nmBuffers, nmBuffersSize);
+        if(res2 != UA_STATUSCODE_GOOD)
+            UA_LOG_WARNING(&server->config.logger, UA_LOGCATEGORY_SERVER,
+                           "PubSub Publish: Could not send the NetworkMessages");
+        for(size_t i = 0; i < nmBuffersSize; i++)
+            UA_ByteString_clear(&nmBuffers[i]);
+    }
+
     /* Send the NetworkMessages with batched DataSetMessages */
     size_t nmCount = (dsmCount / maxDSM) + ((dsmCount % maxDSM) == 0 ? 0 : 1);
     for(UA_UInt32 i = 0; i < nmCount; i++) {
@@ -30648,6 +32341,28 @@ UA_WriterGroup_publishCallback(UA_Server *server, UA_WriterGroup *writerGroup) {
  * creation. */
 UA_StatusCode
 UA_WriterGroup_addPublishCallback(UA_Server *server, UA_WriterGroup *writerGroup) {
+    /* Fixed-size WriterGroups are published from the PubSubScheduler if
+     * configured. The first publish happens with the next cycle. */
+    UA_PubSubScheduler *scheduler = server->config.pubsubScheduler;
+    if(scheduler && writerGroup->config.rtLevel == UA_PUBSUB_RT_FIXED_SIZE) {
+        UA_StatusCode retval =
+            UA_PubSubScheduler_addCallback(scheduler, server,
+                                           (UA_ServerCallback) UA_WriterGroup_publishCallback,
+                                           writerGroup, writerGroup->config.publishingInterval,
+                                           &writerGroup->publishCallbackId);
+        if(retval == UA_STATUSCODE_GOOD) {
+            writerGroup->publishCallbackIsRegistered = true;
+            writerGroup->publishCallbackIsScheduled = true;
+            return UA_STATUSCODE_GOOD;
+        }
+        /* E.g. the interval is no multiple of the cycle time. Publish from
+         * the server timer instead. */
+        UA_LOG_WARNING(&server->config.logger, UA_LOGCATEGORY_SERVER,
+                       "WriterGroup cannot be added to the PubSubScheduler (%s). "
+                       "Publishing from the server timer instead.",
+                       UA_StatusCode_name(retval));
+    }
+
     UA_StatusCode retval =
             UA_PubSubManager_addRepeatedCallback(server,
                                                  (UA_ServerCallback) UA_WriterGroup_publishCallback,
@@ -30661,6 +32376,19 @@ UA_WriterGroup_addPublishCallback(UA_Server *server, UA_WriterGroup *writerGroup
     return retval;
 }
 
+void
+UA_WriterGroup_removePublishCallback(UA_Server *server, UA_WriterGroup *writerGroup) {
+    if(!writerGroup->publishCallbackIsRegistered)
+        return;
+    if(writerGroup->publishCallbackIsScheduled)
+        UA_PubSubScheduler_removeCallback(server->config.pubsubScheduler,
+                                          writerGroup->publishCallbackId);
+    else
+        UA_PubSubManager_removeRepeatedPubSubCallback(server, writerGroup->publishCallbackId);
+    writerGroup->publishCallbackIsRegistered = false;
+    writerGroup->publishCallbackIsScheduled = false;
+}
+
 #endif /* UA_ENABLE_PUBSUB */
 
 /*********************************** amalgamated original file "C:/open62541/src/pubsub/ua_pubsub_reader.c" ***********************************/
@@ -30743,6 +32471,12 @@ UA_Server_removeReaderGroup(UA_Server *server, UA_NodeId groupIdentifier) {
         return UA_STATUSCODE_BADNOTFOUND;
     }
 
+    if(readerGroup->config.configurationFrozen) {
+        UA_LOG_WARNING(&server->config.logger, UA_LOGCATEGORY_SERVER,
+                       "Delete ReaderGroup failed. ReaderGroup is frozen.");
+        return UA_STATUSCODE_BADCONFIGURATIONERROR;
+    }
+
     /* Search the connection to which the given readergroup is connected to */
     UA_PubSubConnection *connection =
         UA_PubSubConnection_findConnectionbyId(server, readerGroup->linkedConnection);
@@ -30751,7 +32485,7 @@ UA_Server_removeReaderGroup(UA_Server *server, UA_NodeId groupIdentifier) {
     }
 
     /* Unregister subscribe callback */
-    UA_PubSubManager_removeRepeatedPubSubCallback(server, readerGroup->subscribeCallbackId);
+    UA_ReaderGroup_removeSubscribeCallback(server, readerGroup);
 #ifdef UA_ENABLE_PUBSUB_INFORMATIONMODEL
     /* To Do:RemoveGroupRepresentation(server, &readerGroup->identifier) */
 #endif
@@ -30807,6 +32541,7 @@ UA_Server_ReaderGroup_delete(UA_Server* server, UA_ReaderGroup *readerGroup) {
 
     /* Delete ReaderGroup and its members */
     UA_String_deleteMembers(&readerGroup->config.name);
+    UA_ByteString_deleteMembers(&readerGroup->bufferedMessage);
     UA_NodeId_deleteMembers(&readerGroup->linkedConnection);
     UA_NodeId_deleteMembers(&readerGroup->identifier);
 }
@@ -30817,6 +32552,8 @@ UA_ReaderGroupConfig_copy(const UA_ReaderGroupConfig *src,
     /* Currently simple memcpy only */
     memcpy(&dst->securityParameters, &src->securityParameters, sizeof(UA_PubSubSecurityParameters));
     UA_String_copy(&src->name, &dst->name);
+    dst->configurationFrozen = src->configurationFrozen;
+    dst->rtLevel = src->rtLevel;
     return UA_STATUSCODE_GOOD;
 }
 
@@ -30939,24 +32676,391 @@ UA_DataSetReader *UA_ReaderGroup_findDSRbyId(UA_Server *server, UA_NodeId identi
     return NULL;
 }
 
+/* Receive buffer size per NetworkMessage and maximum number of messages
+ * taken from the channel in one subscribe callback */
+#define UA_PUBSUB_RECEIVEBUFFERSIZE 512
+#define UA_PUBSUB_RECEIVEBATCH 8
+
+/***************************************/
+/* ReaderGroup RT (fixed size) receive */
+/***************************************/
+
+static void
+UA_DataSetReaderBufferedMessage_clear(UA_DataSetReaderBufferedMessage *bm) {
+    UA_ByteString_deleteMembers(&bm->message);
+    UA_free(bm->staticRanges);
+    UA_free(bm->fieldRanges);
+    memset(bm, 0, sizeof(UA_DataSetReaderBufferedMessage));
+}
+
+/* Collect the ranges of the template that are equal in both encodings and do
+ * not belong to a field value. Returns the number of ranges. */
+static size_t
+collectStaticRanges(const UA_ByteString *a, const UA_ByteString *b,
+                    const UA_PubSubBufferRange *fields, size_t fieldsSize,
+                    UA_PubSubBufferRange *ranges) {
+    size_t rangesSize = 0;
+    size_t field = 0;
+    size_t start = 0;
+    UA_Boolean inRange = false;
+    for(size_t i = 0; i <= a->length; i++) {
+        UA_Boolean isStatic = (i < a->length && a->data[i] == b->data[i]);
+        if(field < fieldsSize && i >= fields[field].offset) {
+            isStatic = false;
+            if(i + 1 == fields[field].offset + fields[field].length)
+                field++;
+        }
+        if(isStatic && !inRange) {
+            start = i;
+            inRange = true;
+        } else if(!isStatic && inRange) {
+            if(ranges) {
+                ranges[rangesSize].offset = start;
+                ranges[rangesSize].length = i - start;
+            }
+            rangesSize++;
+            inRange = false;
+        }
+    }
+    return rangesSize;
+}
+
+/* Generate the NetworkMessage that the publisher is expected to send for the
+ * DataSetReader. The header fields that change with every message are set to
+ * the given value. */
+static UA_StatusCode
+generateExpectedMessage(UA_DataSetReader *dsr, UA_DataValue *fields,
+                        UA_DataSetMessage *dsm, UA_UInt16 *dsmLength,
+                        UA_NetworkMessage *nm, UA_Boolean dynamicBitsSet) {
+    UA_UadpDataSetReaderMessageDataType *ms = &dsr->config.messageSettings;
+    UA_UInt16 dynamicUInt16 = dynamicBitsSet ? UA_UINT16_MAX : 0;
+    UA_DateTime dynamicDateTime = dynamicBitsSet ? (UA_DateTime)-1 : 0;
+
+    /* DataSetMessage, as generated by UA_DataSetWriter_generateDataSetMessage */
+    memset(dsm, 0, sizeof(UA_DataSetMessage));
+    dsm->header.dataSetMessageValid = true;
+    dsm->header.dataSetMessageType = UA_DATASETMESSAGE_DATAKEYFRAME;
+    dsm->header.fieldEncoding = UA_FIELDENCODING_VARIANT;
+    if((u64)ms->dataSetMessageContentMask & (u64)UA_UADPDATASETMESSAGECONTENTMASK_MAJORVERSION) {
+        dsm->header.configVersionMajorVersionEnabled = true;
+        dsm->header.configVersionMajorVersion =
+            dsr->config.dataSetMetaData.configurationVersion.majorVersion;
+    }
+    if((u64)ms->dataSetMessageContentMask & (u64)UA_UADPDATASETMESSAGECONTENTMASK_MINORVERSION) {
+        dsm->header.configVersionMinorVersionEnabled = true;
+        dsm->header.configVersionMinorVersion =
+            dsr->config.dataSetMetaData.configurationVersion.minorVersion;
+    }
+    if((u64)ms->dataSetMessageContentMask & (u64)UA_UADPDATASETMESSAGECONTENTMASK_SEQUENCENUMBER) {
+        dsm->header.dataSetMessageSequenceNrEnabled = true;
+        dsm->header.dataSetMessageSequenceNr = dynamicUInt16;
+    }
+    if((u64)ms->dataSetMessageContentMask & (u64)UA_UADPDATASETMESSAGECONTENTMASK_TIMESTAMP) {
+        dsm->header.timestampEnabled = true;
+        dsm->header.timestamp = dynamicDateTime;
+    }
+    dsm->data.keyFrameData.fieldCount = (UA_UInt16)dsr->config.dataSetMetaData.fieldsSize;
+    dsm->data.keyFrameData.dataSetFields = fields;
+    *dsmLength = (UA_UInt16)UA_DataSetMessage_calcSizeBinary(dsm, NULL, 0);
+
+    /* NetworkMessage, as generated by generateNetworkMessage */
+    memset(nm, 0, sizeof(UA_NetworkMessage));
+    u64 nmMask = (u64)ms->networkMessageContentMask;
+    if(nmMask & (u64)UA_UADPNETWORKMESSAGECONTENTMASK_PROMOTEDFIELDS)
+        return UA_STATUSCODE_BADNOTSUPPORTED;
+    nm->publisherIdEnabled = (nmMask & (u64)UA_UADPNETWORKMESSAGECONTENTMASK_PUBLISHERID) != 0;
+    nm->groupHeaderEnabled = (nmMask & (u64)UA_UADPNETWORKMESSAGECONTENTMASK_GROUPHEADER) != 0;
+    nm->groupHeader.writerGroupIdEnabled = (nmMask & (u64)UA_UADPNETWORKMESSAGECONTENTMASK_WRITERGROUPID) != 0;
+    nm->groupHeader.groupVersionEnabled = (nmMask & (u64)UA_UADPNETWORKMESSAGECONTENTMASK_GROUPVERSION) != 0;
+    nm->groupHeader.networkMessageNumberEnabled =
+        (nmMask & (u64)UA_UADPNETWORKMESSAGECONTENTMASK_NETWORKMESSAGENUMBER) != 0;
+    nm->groupHeader.sequenceNumberEnabled = (nmMask & (u64)UA_UADPNETWORKMESSAGECONTENTMASK_SEQUENCENUMBER) != 0;
+    nm->payloadHeaderEnabled = (nmMask & (u64)UA_UADPNETWORKMESSAGECONTENTMASK_PAYLOADHEADER) != 0;
+    nm->timestampEnabled = (nmMask & (u64)UA_UADPNETWORKMESSAGECONTENTMASK_TIMESTAMP) != 0;
+    nm->picosecondsEnabled = (nmMask & (u64)UA_UADPNETWORKMESSAGECONTENTMASK_PICOSECONDS) != 0;
+    nm->dataSetClassIdEnabled = (nmMask & (u64)UA_UADPNETWORKMESSAGECONTENTMASK_DATASETCLASSID) != 0;
+    nm->version = 1;
+    nm->networkMessageType = UA_NETWORKMESSAGE_DATASET;
+    if(nm->publisherIdEnabled) {
+        const UA_DataType *idType = dsr->config.publisherId.type;
+        if(!idType || !UA_Variant_isScalar(&dsr->config.publisherId))
+            return UA_STATUSCODE_BADNOTSUPPORTED;
+        if(idType == &UA_TYPES[UA_TYPES_BYTE]) {
+            nm->publisherIdType = UA_PUBLISHERDATATYPE_BYTE;
+            nm->publisherId.publisherIdByte = *(UA_Byte*)dsr->config.publisherId.data;
+        } else if(idType == &UA_TYPES[UA_TYPES_UINT16]) {
+            nm->publisherIdType = UA_PUBLISHERDATATYPE_UINT16;
+            nm->publisherId.publisherIdUInt16 = *(UA_UInt16*)dsr->config.publisherId.data;
+        } else if(idType == &UA_TYPES[UA_TYPES_UINT32]) {
+            nm->publisherIdType = UA_PUBLISHERDATATYPE_UINT32;
+            nm->publisherId.publisherIdUInt32 = *(UA_UInt32*)dsr->config.publisherId.data;
+        } else if(idType == &UA_TYPES[UA_TYPES_UINT64]) {
+            nm->publisherIdType = UA_PUBLISHERDATATYPE_UINT64;
+            nm->publisherId.publisherIdUInt64 = *(UA_UInt64*)dsr->config.publisherId.data;
+        } else if(idType == &UA_TYPES[UA_TYPES_STRING]) {
+            nm->publisherIdType = UA_PUBLISHERDATATYPE_STRING;
+            nm->publisherId.publisherIdString = *(UA_String*)dsr->config.publisherId.data;
+        } else {
+            return UA_STATUSCODE_BADNOTSUPPORTED;
+        }
+    }
+    nm->dataSetClassId = ms->dataSetClassId;
+    nm->groupHeader.writerGroupId = dsr->config.writerGroupId;
+    nm->groupHeader.groupVersion = ms->groupVersion;
+    nm->groupHeader.networkMessageNumber = 1;
+    nm->groupHeader.sequenceNumber = dynamicUInt16;
+    nm->timestamp = dynamicDateTime;
+    nm->picoseconds = dynamicUInt16;
+    nm->payloadHeader.dataSetPayloadHeader.count = 1;
+    nm->payloadHeader.dataSetPayloadHeader.dataSetWriterIds = &dsr->config.dataSetWriterId;
+    nm->payload.dataSetPayload.sizes = dsmLength;
+    nm->payload.dataSetPayload.dataSetMessages = dsm;
+    return UA_STATUSCODE_GOOD;
+}
+
+/* Encode the expected message twice, once with all bits of the changing header
+ * fields cleared and once with all bits set. The bytes that are equal in both
+ * encodings (and are not field values) are checked on reception. */
+static UA_StatusCode
+UA_DataSetReader_generateBufferedMessage(UA_Server *server, UA_DataSetReader *dsr) {
+    UA_DataSetMetaDataType *metaData = &dsr->config.dataSetMetaData;
+    if(metaData->fieldsSize == 0 || metaData->fieldsSize > UA_UINT16_MAX ||
+       !dsr->externalDataValues) {
+        UA_LOG_WARNING(&server->config.logger, UA_LOGCATEGORY_SERVER,
+                       "PubSub-RT configuration fail: DataSetReader without external data values.");
+        return UA_STATUSCODE_BADCONFIGURATIONERROR;
+    }
+    if((u64)dsr->config.dataSetFieldContentMask &
+       ((u64)UA_DATASETFIELDCONTENTMASK_RAWDATA | (u64)UA_DATASETFIELDCONTENTMASK_SOURCETIMESTAMP |
+        (u64)UA_DATASETFIELDCONTENTMASK_SERVERPICOSECONDS | (u64)UA_DATASETFIELDCONTENTMASK_SOURCEPICOSECONDS |
+        (u64)UA_DATASETFIELDCONTENTMASK_STATUSCODE)) {
+        UA_LOG_WARNING(&server->config.logger, UA_LOGCATEGORY_SERVER,
+                       "PubSub-RT configuration fail: Only the variant field encoding is supported.");
+        return UA_STATUSCODE_BADNOTSUPPORTED;
+    }
+
+    /* The fields are encoded as variant scalars at the end of the message */
+    UA_STACKARRAY(UA_DataValue, fields, metaData->fieldsSize);
+    UA_STACKARRAY(UA_PubSubBufferRange, fieldRanges, metaData->fieldsSize);
+    size_t fieldsLength = 0;
+    for(size_t i = 0; i < metaData->fieldsSize; i++) {
+        const UA_DataValue *ext = dsr->externalDataValues[i];
+        const UA_DataType *type = UA_findDataType(&metaData->fields[i].dataType);
+        UA_DataValue_init(&fields[i]);
+        if(ext) {
+            fields[i].hasValue = true;
+            fields[i].value = ext->value;
+        }
+        if(!ext || !type || !type->overlayable || ext->value.type != type ||
+           !ext->value.data || !UA_Variant_isScalar(&ext->value) ||
+           UA_calcSizeBinary(&ext->value, &UA_TYPES[UA_TYPES_VARIANT]) != 1u + type->memSize) {
+            UA_LOG_WARNING(&server->config.logger, UA_LOGCATEGORY_SERVER,
+                           "PubSub-RT configuration fail: Field %u is not a fixed-size "
+                           "scalar with an external data value.", (unsigned)i);
+            return UA_STATUSCODE_BADNOTSUPPORTED;
+        }
+        fieldRanges[i].length = type->memSize;
+        fieldsLength += 1u + type->memSize;
+    }
+
+    UA_DataSetMessage dsm;
+    UA_UInt16 dsmLength;
+    UA_NetworkMessage nm;
+    UA_StatusCode res = generateExpectedMessage(dsr, fields, &dsm, &dsmLength, &nm, false);
+    if(res != UA_STATUSCODE_GOOD) {
+        UA_LOG_WARNING(&server->config.logger, UA_LOGCATEGORY_SERVER,
+                       "PubSub-RT configuration fail: Unsupported NetworkMessage content.");
+        return res;
+    }
+    UA_ByteString cleared, set;
+    size_t msgSize = UA_NetworkMessage_calcSizeBinary(&nm, NULL);
+    if(msgSize < fieldsLength)
+        return UA_STATUSCODE_BADINTERNALERROR;
+    res = UA_ByteString_allocBuffer(&cleared, msgSize);
+    if(res != UA_STATUSCODE_GOOD)
+        return res;
+    res = UA_ByteString_allocBuffer(&set, msgSize);
+    if(res != UA_STATUSCODE_GOOD) {
+        UA_ByteString_deleteMembers(&cleared);
+        return res;
+    }
+    UA_Byte *bufPos = cleared.data;
+    res = UA_NetworkMessage_encodeBinary(&nm, &bufPos, &cleared.data[cleared.length]);
+    generateExpectedMessage(dsr, fields, &dsm, &dsmLength, &nm, true);
+    bufPos = set.data;
+    res |= UA_NetworkMessage_encodeBinary(&nm, &bufPos, &set.data[set.length]);
+    if(res != UA_STATUSCODE_GOOD)
+        goto cleanup;
+
+    /* Skip the variant encoding byte of each field */
+    size_t pos = msgSize - fieldsLength;
+    for(size_t i = 0; i < metaData->fieldsSize; i++) {
+        fieldRanges[i].offset = pos + 1;
+        pos += 1 + fieldRanges[i].length;
+    }
+
+    UA_DataSetReaderBufferedMessage *bm = &dsr->bufferedMessage;
+    UA_DataSetReaderBufferedMessage_clear(bm);
+    bm->staticRangesSize = collectStaticRanges(&cleared, &set, fieldRanges,
+                                               metaData->fieldsSize, NULL);
+    bm->staticRanges = (UA_PubSubBufferRange*)
+        UA_calloc(bm->staticRangesSize, sizeof(UA_PubSubBufferRange));
+    bm->fieldRanges = (UA_PubSubBufferRange*)
+        UA_calloc(metaData->fieldsSize, sizeof(UA_PubSubBufferRange));
+    if(!bm->staticRanges || !bm->fieldRanges) {
+        UA_DataSetReaderBufferedMessage_clear(bm);
+        res = UA_STATUSCODE_BADOUTOFMEMORY;
+        goto cleanup;
+    }
+    collectStaticRanges(&cleared, &set, fieldRanges, metaData->fieldsSize, bm->staticRanges);
+    memcpy(bm->fieldRanges, fieldRanges, metaData->fieldsSize * sizeof(UA_PubSubBufferRange));
+    bm->fieldRangesSize = metaData->fieldsSize;
+    bm->message = cleared;
+    UA_ByteString_init(&cleared);
+
+ cleanup:
+    UA_ByteString_deleteMembers(&cleared);
+    UA_ByteString_deleteMembers(&set);
+    return res;
+}
+
+/* Match the received message against the precomputed layout and copy the
+ * field values into the external data values */
+static UA_Boolean
+UA_DataSetReader_processBufferedMessage(UA_DataSetReader *dsr, const UA_ByteString *msg) {
+    const UA_DataSetReaderBufferedMessage *bm = &dsr->bufferedMessage;
+    if(msg->length != bm->message.length)
+        return false;
+    for(size_t i = 0; i < bm->staticRangesSize; i++) {
+        const UA_PubSubBufferRange *r = &bm->staticRanges[i];
+        if(memcmp(&msg->data[r->offset], &bm->message.data[r->offset], r->length) != 0)
+            return false;
+    }
+    for(size_t i = 0; i < bm->fieldRangesSize; i++)
+        memcpy(dsr->externalDataValues[i]->value.data,
+               &msg->data[bm->fieldRanges[i].offset], bm->fieldRanges[i].length);
+    return true;
+}
+
+UA_StatusCode
+UA_Server_freezeReaderGroupConfiguration(UA_Server *server, const UA_NodeId readerGroup) {
+    UA_ReaderGroup *rg = UA_ReaderGroup_findRGbyId(server, readerGroup);
+    if(!rg)
+        return UA_STATUSCODE_BADNOTFOUND;
+    if(rg->config.configurationFrozen)
+        return UA_STATUSCODE_GOOD;
+    UA_PubSubConnection *pubSubConnection =
+        UA_PubSubConnection_findConnectionbyId(server, rg->linkedConnection);
+    if(!pubSubConnection)
+        return UA_STATUSCODE_BADNOTFOUND;
+
+    if(rg->config.rtLevel == UA_PUBSUB_RT_FIXED_SIZE) {
+        /* Keep the receive buffer at least at the size used by the non-RT path */
+        size_t bufferSize = UA_PUBSUB_RECEIVEBUFFERSIZE;
+        UA_StatusCode res = UA_STATUSCODE_GOOD;
+        UA_DataSetReader *dsr;
+        LIST_FOREACH(dsr, &rg->readers, listEntry) {
+            res = UA_DataSetReader_generateBufferedMessage(server, dsr);
+            if(res != UA_STATUSCODE_GOOD)
+                break;
+            if(dsr->bufferedMessage.message.length > bufferSize)
+                bufferSize = dsr->bufferedMessage.message.length;
+        }
+        if(res == UA_STATUSCODE_GOOD)
+            res = UA_ByteString_allocBuffer(&rg->bufferedMessage, bufferSize);
+        if(res != UA_STATUSCODE_GOOD) {
+            LIST_FOREACH(dsr, &rg->readers, listEntry)
+                UA_DataSetReaderBufferedMessage_clear(&dsr->bufferedMessage);
+            return res;
+        }
+    }
+
+    //PubSubConnection freezeCounter++
+    pubSubConnection->configurationFreezeCounter++;
+    pubSubConnection->config->configurationFrozen = UA_TRUE;
+    rg->config.configurationFrozen = UA_TRUE;
+    return UA_STATUSCODE_GOOD;
+}
+
+UA_StatusCode
+UA_Server_unfreezeReaderGroupConfiguration(UA_Server *server, const UA_NodeId readerGroup) {
+    UA_ReaderGroup *rg = UA_ReaderGroup_findRGbyId(server, readerGroup);
+    if(!rg)
+        return UA_STATUSCODE_BADNOTFOUND;
+    if(!rg->config.configurationFrozen)
+        return UA_STATUSCODE_GOOD;
+    //PubSubConnection freezeCounter--
+    UA_PubSubConnection *pubSubConnection =
+        UA_PubSubConnection_findConnectionbyId(server, rg->linkedConnection);
+    if(pubSubConnection) {
+        pubSubConnection->configurationFreezeCounter--;
+        if(pubSubConnection->configurationFreezeCounter == 0)
+            pubSubConnection->config->configurationFrozen = UA_FALSE;
+    }
+    UA_DataSetReader *dsr;
+    LIST_FOREACH(dsr, &rg->readers, listEntry)
+        UA_DataSetReaderBufferedMessage_clear(&dsr->bufferedMessage);
+    UA_ByteString_deleteMembers(&rg->bufferedMessage);
+    rg->config.configurationFrozen = UA_FALSE;
+    return UA_STATUSCODE_GOOD;
+}
+
 /* This callback triggers the collection and reception of NetworkMessages and the
  * contained DataSetMessages. */
 void UA_ReaderGroup_subscribeCallback(UA_Server *server, UA_ReaderGroup *readerGroup) {
     UA_PubSubConnection *connection =
         UA_PubSubConnection_findConnectionbyId(server, readerGroup->linkedConnection);
+    if(!connection || !connection->channel)
+        return;
+    if(readerGroup->config.configurationFrozen &&
+       readerGroup->config.rtLevel == UA_PUBSUB_RT_FIXED_SIZE) {
+        /* The receive buffer is reused. Its length is reset to the capacity. */
+        UA_ByteString rtBuffer = readerGroup->bufferedMessage;
+        connection->channel->receive(connection->channel, &rtBuffer, NULL, 1000);
+        if(rtBuffer.length == 0)
+            return;
+        UA_DataSetReader *dsr;
+        LIST_FOREACH(dsr, &readerGroup->readers, listEntry) {
+            if(UA_DataSetReader_processBufferedMessage(dsr, &rtBuffer))
+                return;
+        }
+        UA_LOG_DEBUG(&server->config.logger, UA_LOGCATEGORY_SERVER,
+                     "PubSub-RT: Received message does not match a DataSetReader");
+        return;
+    }
+
+    /* Drain up to UA_PUBSUB_RECEIVEBATCH messages per callback if the channel
+     * supports it */
+    size_t batchSize = connection->channel->receiveMany ? UA_PUBSUB_RECEIVEBATCH : 1;
     UA_ByteString buffer;
-    if(UA_ByteString_allocBuffer(&buffer, 512) != UA_STATUSCODE_GOOD) {
+    if(UA_ByteString_allocBuffer(&buffer, UA_PUBSUB_RECEIVEBUFFERSIZE * batchSize) != UA_STATUSCODE_GOOD) {
         UA_LOG_INFO(&server->config.logger, UA_LOGCATEGORY_SERVER, "Message buffer alloc failed!");
         return;
     }
 
-    connection->channel->receive(connection->channel, &buffer, NULL, 1000);
-    if(buffer.length > 0) {
+    UA_ByteString messages[UA_PUBSUB_RECEIVEBATCH];
+    size_t messagesSize = 0;
+    if(connection->channel->receiveMany) {
+        for(size_t i = 0; i < batchSize; i++) {
+            messages[i].data = &buffer.data[i * UA_PUBSUB_RECEIVEBUFFERSIZE];
+            messages[i].length = UA_PUBSUB_RECEIVEBUFFERSIZE;
+        }
+        connection->channel->receiveMany(connection->channel, messages, batchSize,
+                                         &messagesSize, NULL, 1000);
+    } else {
+        connection->channel->receive(connection->channel, &buffer, NULL, 1000);
+        messages[0] = buffer;
+        messagesSize = 1;
+    }
+
+    for(size_t i = 0; i < messagesSize; i++) {
+        if(messages[i].length == 0)
+            continue;
         UA_LOG_INFO(&server->config.logger, UA_LOGCATEGORY_USERLAND, "Message received:");
         UA_NetworkMessage currentNetworkMessage;
         memset(&currentNetworkMessage, 0, sizeof(UA_NetworkMessage));
         size_t currentPosition = 0;
-        UA_NetworkMessage_decodeBinary(&buffer, &currentPosition, &currentNetworkMessage);
+        UA_NetworkMessage_decodeBinary(&messages[i], &currentPosition, &currentNetworkMessage);
         UA_Server_processNetworkMessage(server, &currentNetworkMessage, connection);
         UA_NetworkMessage_deleteMembers(&currentNetworkMessage);
     }
@@ -30982,6 +33086,14 @@ UA_ReaderGroup_addSubscribeCallback(UA_Server *server, UA_ReaderGroup *readerGro
     return retval;
 }
 
+void
+UA_ReaderGroup_removeSubscribeCallback(UA_Server *server, UA_ReaderGroup *readerGroup) {
+    if(!readerGroup->subscribeCallbackIsRegistered)
+        return;
+    UA_PubSubManager_removeRepeatedPubSubCallback(server, readerGroup->subscribeCallbackId);
+    readerGroup->subscribeCallbackIsRegistered = false;
+}
+
 /**********/
 /* Reader */
 /**********/
@@ -31001,6 +33113,12 @@ UA_Server_addDataSetReader(UA_Server *server, UA_NodeId readerGroupIdentifier,
         return UA_STATUSCODE_BADNOTFOUND;
     }
 
+    if(readerGroup->config.configurationFrozen) {
+        UA_LOG_WARNING(&server->config.logger, UA_LOGCATEGORY_SERVER,
+                       "Add DataSetReader failed. ReaderGroup is frozen.");
+        return UA_STATUSCODE_BADCONFIGURATIONERROR;
+    }
+
     /* Allocate memory for new DataSetReader */
     UA_DataSetReader *newDataSetReader = (UA_DataSetReader *)UA_calloc(1, sizeof(UA_DataSetReader));
     /* Copy the config into the new dataSetReader */
@@ -31030,6 +33148,13 @@ UA_Server_removeDataSetReader(UA_Server *server, UA_NodeId readerIdentifier) {
         return UA_STATUSCODE_BADNOTFOUND;
     }
 
+    UA_ReaderGroup *readerGroup = UA_ReaderGroup_findRGbyId(server, dataSetReader->linkedReaderGroup);
+    if(readerGroup && readerGroup->config.configurationFrozen) {
+        UA_LOG_WARNING(&server->config.logger, UA_LOGCATEGORY_SERVER,
+                       "Remove DataSetReader failed. ReaderGroup is frozen.");
+        return UA_STATUSCODE_BADCONFIGURATIONERROR;
+    }
+
 #ifdef UA_ENABLE_PUBSUB_INFORMATIONMODEL
     removeDataSetReaderRepresentation(server, dataSetReader);
 #endif
@@ -31054,6 +33179,12 @@ UA_Server_DataSetReader_updateConfig(UA_Server *server, UA_NodeId dataSetReaderI
        return UA_STATUSCODE_BADNOTFOUND;
     }
 
+    if(currentReaderGroup && currentReaderGroup->config.configurationFrozen) {
+        UA_LOG_WARNING(&server->config.logger, UA_LOGCATEGORY_SERVER,
+                       "Update DataSetReader failed. ReaderGroup is frozen.");
+        return UA_STATUSCODE_BADCONFIGURATIONERROR;
+    }
+
     /* The update functionality will be extended during the next PubSub batches.
      * Currently is only a change of the publishing interval possible. */
     if(currentDataSetReader->config.writerGroupId != config->writerGroupId) {
@@ -31148,6 +33279,31 @@ UA_Server_DataSetReader_createTargetVariables(UA_Server *server,
     return retval;
 }
 
+UA_StatusCode
+UA_Server_DataSetReader_setExternalDataValue(UA_Server *server, UA_NodeId dataSetReaderIdentifier,
+                                             size_t fieldIndex, UA_DataValue *externalDataValue) {
+    UA_DataSetReader *pDS = UA_ReaderGroup_findDSRbyId(server, dataSetReaderIdentifier);
+    if(pDS == NULL || fieldIndex >= pDS->config.dataSetMetaData.fieldsSize) {
+        return UA_STATUSCODE_BADINVALIDARGUMENT;
+    }
+
+    UA_ReaderGroup *pGroup = UA_ReaderGroup_findRGbyId(server, pDS->linkedReaderGroup);
+    if(pGroup && pGroup->config.configurationFrozen) {
+        return UA_STATUSCODE_BADCONFIGURATIONERROR;
+    }
+
+    if(!pDS->externalDataValues) {
+        pDS->externalDataValues = (UA_DataValue**)
+            UA_calloc(pDS->config.dataSetMetaData.fieldsSize, sizeof(UA_DataValue*));
+        if(!pDS->externalDataValues) {
+            return UA_STATUSCODE_BADOUTOFMEMORY;
+        }
+    }
+
+    pDS->externalDataValues[fieldIndex] = externalDataValue;
+    return UA_STATUSCODE_GOOD;
+}
+
 /* Adds Subscribed Variables from the DataSetMetaData for the given DataSet into
  * the given parent node and creates the corresponding data in the
  * targetVariables of the DataSetReader */
@@ -31318,6 +33474,8 @@ void UA_DataSetReader_delete(UA_Server *server, UA_DataSetReader *dataSetReader)
     UA_DataSetMetaDataType_deleteMembers(&dataSetReader->config.dataSetMetaData);
     UA_UadpDataSetReaderMessageDataType_deleteMembers(&dataSetReader->config.messageSettings);
     UA_TargetVariablesDataType_deleteMembers(&dataSetReader->subscribedDataSetTarget);
+    UA_free(dataSetReader->externalDataValues);
+    UA_DataSetReaderBufferedMessage_clear(&dataSetReader->bufferedMessage);
 
     /* Delete DataSetReader */
     UA_ReaderGroup* pGroup = UA_ReaderGroup_findRGbyId(server, dataSetReader->linkedReaderGroup);
@@ -31658,6 +33816,15 @@ UA_PubSubManager_delete(UA_Server *server, UA_PubSubManager *pubSubManager) {
         }
     }
 
+    /* Stop and unfreeze all ReaderGroups */
+    TAILQ_FOREACH(tmpConnection, &server->pubSubManager.connections, listEntry) {
+        UA_ReaderGroup *readerGroup;
+        LIST_FOREACH(readerGroup, &tmpConnection->readerGroups, listEntry) {
+            UA_ReaderGroup_removeSubscribeCallback(server, readerGroup);
+            UA_Server_unfreezeReaderGroupConfiguration(server, readerGroup->identifier);
+        }
+    }
+
     //free the currently configured transport layers
     UA_free(server->config.pubsubTransportLayers);
     server->config.pubsubTransportLayersSize = 0;
@@ -31704,6 +33871,224 @@ UA_PubSubManager_removeRepeatedPubSubCallback(UA_Server *server, UA_UInt64 callb
 
 #endif /* UA_ENABLE_PUBSUB */
 
+/*********************************** amalgamated original file "C:/open62541/src/pubsub/ua_pubsub_scheduler.c" ***********************************/
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+
+#ifdef UA_ENABLE_PUBSUB /* conditional compilation */
+
+/* The driving task runs concurrently to the server also without
+ * UA_MULTITHREADING. Then UA_atomic_sync is empty. So use a full barrier
+ * here. */
+#ifdef _MSC_VER
+# define UA_PubSubScheduler_barrier() MemoryBarrier()
+#else
+# define UA_PubSubScheduler_barrier() __sync_synchronize()
+#endif
+
+void
+UA_PubSubScheduler_init(UA_PubSubScheduler *scheduler, UA_DateTime cycleTime,
+                        UA_DateTime phaseOffset, UA_DateTime bucketWidth) {
+    memset(scheduler, 0, sizeof(UA_PubSubScheduler));
+    scheduler->cycleTime = cycleTime;
+    scheduler->phaseOffset = phaseOffset;
+    scheduler->bucketWidth = bucketWidth;
+    if(scheduler->bucketWidth <= 0)
+        scheduler->bucketWidth = cycleTime / UA_PUBSUB_SCHEDULER_HISTOGRAMSIZE;
+    if(scheduler->bucketWidth <= 0)
+        scheduler->bucketWidth = 1;
+}
+
+UA_StatusCode
+UA_PubSubScheduler_addCallback(UA_PubSubScheduler *scheduler, UA_Server *server,
+                               UA_ServerCallback callback, void *data,
+                               UA_Double interval_ms, UA_UInt64 *callbackId) {
+    if(scheduler->cycleTime <= 0)
+        return UA_STATUSCODE_BADINTERNALERROR;
+
+    /* The interval must be a multiple of the cycle time */
+    UA_Double cycles = (interval_ms * (UA_Double)UA_DATETIME_MSEC) /
+        (UA_Double)scheduler->cycleTime;
+    UA_UInt64 roundedCycles = (UA_UInt64)(cycles + 0.5);
+    if(roundedCycles == 0 ||
+       (UA_Double)roundedCycles - cycles > 0.001 || cycles - (UA_Double)roundedCycles > 0.001)
+        return UA_STATUSCODE_BADINVALIDARGUMENT;
+
+    for(size_t i = 0; i < UA_PUBSUB_SCHEDULER_MAXCALLBACKS; i++) {
+        UA_PubSubSchedulerEntry *entry = &scheduler->entries[i];
+        if(entry->callback)
+            continue;
+        entry->server = server;
+        entry->data = data;
+        entry->cycles = roundedCycles;
+        entry->callbackId = ++scheduler->lastCallbackId;
+        UA_PubSubScheduler_barrier();
+        entry->callback = callback;
+        if(callbackId)
+            *callbackId = entry->callbackId;
+        return UA_STATUSCODE_GOOD;
+    }
+    return UA_STATUSCODE_BADRESOURCEUNAVAILABLE;
+}
+
+/* Wait until a cycle that runs concurrently has finished. Afterwards, the
+ * callbacks removed before are no longer executed. */
+static void
+waitForCycle(UA_PubSubScheduler *scheduler) {
+    UA_PubSubScheduler_barrier();
+    UA_UInt32 sequence = scheduler->cycleSequence;
+    if(!(sequence & 1))
+        return;
+    while(scheduler->cycleSequence == sequence) {
+#ifdef UA_ARCHITECTURE_FREERTOSLWIP
+        /* UA_sleep_ms(1) is zero ticks below 1 kHz and would spin */
+        vTaskDelay(1);
+#else
+        UA_sleep_ms(1);
+#endif
+    }
+    UA_PubSubScheduler_barrier();
+}
+
+void
+UA_PubSubScheduler_removeCallback(UA_PubSubScheduler *scheduler, UA_UInt64 callbackId) {
+    for(size_t i = 0; i < UA_PUBSUB_SCHEDULER_MAXCALLBACKS; i++) {
+        if(scheduler->entries[i].callback &&
+           scheduler->entries[i].callbackId == callbackId) {
+            scheduler->entries[i].callback = NULL;
+            waitForCycle(scheduler);
+            return;
+        }
+    }
+}
+
+void
+UA_PubSubScheduler_start(UA_PubSubScheduler *scheduler, UA_DateTime now) {
+    UA_DateTime cycleTime = scheduler->cycleTime;
+    UA_DateTime phase = scheduler->phaseOffset % cycleTime;
+    if(phase < 0)
+        phase += cycleTime;
+    UA_DateTime next = ((now - phase) / cycleTime + 1) * cycleTime + phase;
+    if(next <= now)
+        next += cycleTime;
+    scheduler->nextCycle = next;
+    scheduler->cycleCount = 0;
+    memset(scheduler->histogram, 0, sizeof(scheduler->histogram));
+    scheduler->maxLateness = 0;
+    scheduler->missedCycles = 0;
+    scheduler->running = true;
+}
+
+void
+UA_PubSubScheduler_stop(UA_PubSubScheduler *scheduler) {
+    scheduler->running = false;
+    waitForCycle(scheduler);
+}
+
+void
+UA_PubSubScheduler_cycle(UA_PubSubScheduler *scheduler, UA_DateTime now) {
+    if(now < scheduler->nextCycle)
+        return;
+
+    /* Record the lateness */
+    UA_DateTime lateness = now - scheduler->nextCycle;
+    UA_DateTime bucket = lateness / scheduler->bucketWidth;
+    if(bucket >= UA_PUBSUB_SCHEDULER_HISTOGRAMSIZE)
+        bucket = UA_PUBSUB_SCHEDULER_HISTOGRAMSIZE - 1;
+    scheduler->histogram[bucket]++;
+    if(lateness > scheduler->maxLateness)
+        scheduler->maxLateness = lateness;
+
+    /* Run the callbacks due in this cycle. The sequence is odd while the
+     * callbacks run. */
+    scheduler->cycleSequence++;
+    UA_PubSubScheduler_barrier();
+    for(size_t i = 0; i < UA_PUBSUB_SCHEDULER_MAXCALLBACKS; i++) {
+        UA_PubSubSchedulerEntry *entry = &scheduler->entries[i];
+        UA_ServerCallback callback = entry->callback;
+        if(callback && scheduler->cycleCount % entry->cycles == 0)
+            callback(entry->server, entry->data);
+    }
+    UA_PubSubScheduler_barrier();
+    scheduler->cycleSequence++;
+
+    /* Skip the cycles that have passed. Otherwise the callbacks would be
+     * executed in a burst. */
+    scheduler->cycleCount++;
+    scheduler->nextCycle += scheduler->cycleTime;
+    if(scheduler->nextCycle <= now) {
+        UA_UInt64 missed = (UA_UInt64)
+            ((now - scheduler->nextCycle) / scheduler->cycleTime) + 1;
+        scheduler->missedCycles += missed;
+        scheduler->cycleCount += missed;
+        scheduler->nextCycle += (UA_DateTime)missed * scheduler->cycleTime;
+    }
+}
+
+#ifdef UA_ARCHITECTURE_POSIX
+
+#include <time.h>
+
+void
+UA_PubSubScheduler_runPosix(UA_PubSubScheduler *scheduler) {
+    UA_PubSubScheduler_start(scheduler, UA_DateTime_nowMonotonic());
+    while(scheduler->running) {
+        /* Sleep until the next cycle. UA_DateTime_nowMonotonic may use
+         * another clock than CLOCK_MONOTONIC. So the remaining time is added to
+         * the current CLOCK_MONOTONIC time. */
+        UA_DateTime wait = scheduler->nextCycle - UA_DateTime_nowMonotonic();
+        if(wait > 0) {
+            struct timespec deadline;
+            clock_gettime(CLOCK_MONOTONIC, &deadline);
+            long nsec = deadline.tv_nsec + (long)((wait % UA_DATETIME_SEC) * 100);
+            deadline.tv_sec += (time_t)(wait / UA_DATETIME_SEC) + nsec / 1000000000L;
+            deadline.tv_nsec = nsec % 1000000000L;
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL);
+        }
+        UA_PubSubScheduler_cycle(scheduler, UA_DateTime_nowMonotonic());
+    }
+}
+
+#endif /* UA_ARCHITECTURE_POSIX */
+
+#ifdef UA_ARCHITECTURE_FREERTOSLWIP
+
+void
+UA_PubSubScheduler_task(void *data) {
+    UA_PubSubScheduler *scheduler = (UA_PubSubScheduler*)data;
+    scheduler->task = xTaskGetCurrentTaskHandle();
+    const UA_DateTime tickTime = UA_DATETIME_SEC / configTICK_RATE_HZ;
+    UA_PubSubScheduler_start(scheduler, UA_DateTime_nowMonotonic());
+    while(scheduler->running) {
+        UA_DateTime now = UA_DateTime_nowMonotonic();
+        UA_DateTime wait = scheduler->nextCycle - now;
+        if(wait > 0) {
+            ulTaskNotifyTake(pdTRUE, (TickType_t)((wait + tickTime - 1) / tickTime));
+            continue;
+        }
+        UA_PubSubScheduler_cycle(scheduler, now);
+    }
+    scheduler->task = NULL;
+    vTaskDelete(NULL);
+}
+
+void
+UA_PubSubScheduler_notifyFromISR(UA_PubSubScheduler *scheduler) {
+    if(!scheduler->task)
+        return;
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR((TaskHandle_t)scheduler->task, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+#endif /* UA_ARCHITECTURE_FREERTOSLWIP */
+
+#endif /* UA_ENABLE_PUBSUB */
+
 /*********************************** amalgamated original file "C:/open62541/src/pubsub/ua_pubsub_ns0.c" ***********************************/
 
 /* This Source Code Form is subject to the terms of the Mozilla Public
@@ -33010,9 +35395,15 @@ RefTree_add(RefTree *rt, const UA_ExpandedNodeId *target) {
     return UA_STATUSCODE_GOOD;
 }
 
+/* The relevant references are given either as a bitset over the ReferenceType
+ * index or as a list of NodeIds. If both are NULL, all references are
+ * relevant. */
 static UA_Boolean
-relevantReference(const UA_NodeId *refType, size_t relevantRefsSize,
+relevantReference(const UA_Server *server, const UA_UInt32 *set,
+                  const UA_NodeId *refType, size_t relevantRefsSize,
                   const UA_NodeId *relevantRefs) {
+    if(set)
+        return isInReferenceTypeSet(server, set, refType);
     if(!relevantRefs)
         return true;
     for(size_t i = 0; i < relevantRefsSize; i++) {
@@ -33024,8 +35415,8 @@ relevantReference(const UA_NodeId *refType, size_t relevantRefsSize,
 
 static UA_StatusCode
 addRelevantReferences(UA_Server *server, RefTree *rt, const UA_NodeId *nodeId,
-                      size_t refTypesSize, const UA_NodeId *refTypes,
-                      UA_BrowseDirection browseDirection) {
+                      const UA_UInt32 *set, size_t refTypesSize,
+                      const UA_NodeId *refTypes, UA_BrowseDirection browseDirection) {
     const UA_Node *node = UA_NODESTORE_GET(server, nodeId);
     if(!node)
         return UA_STATUSCODE_BADNODEIDUNKNOWN;
@@ -33041,11 +35432,14 @@ addRelevantReferences(UA_Server *server, RefTree *rt, const UA_NodeId *nodeId,
             continue;
 
         /* Is the reference part of the hierarchy of references we look for? */
-        if(!relevantReference(&rk->referenceTypeId, refTypesSize, refTypes))
+        if(!relevantReference(server, set, &rk->referenceTypeId,
+                              refTypesSize, refTypes))
             continue;
 
         for(size_t k = 0; k < rk->refTargetsSize; k++) {
-            retval = RefTree_add(rt, &rk->refTargets[k].target);
+            UA_ExpandedNodeId tmpTarget;
+            retval = RefTree_add(rt, UA_ReferenceTarget_getTarget(&rk->refTargets[k],
+                                                                  &tmpTarget));
             if(retval != UA_STATUSCODE_GOOD)
                 goto cleanup;
         }
@@ -33056,12 +35450,13 @@ addRelevantReferences(UA_Server *server, RefTree *rt, const UA_NodeId *nodeId,
     return retval;
 }
 
-UA_StatusCode
-browseRecursive(UA_Server *server,
-                size_t startNodesSize, const UA_NodeId *startNodes,
-                size_t refTypesSize, const UA_NodeId *refTypes,
-                UA_BrowseDirection browseDirection, UA_Boolean includeStartNodes,
-                size_t *resultsSize, UA_ExpandedNodeId **results) {
+static UA_StatusCode
+browseRecursiveWithSet(UA_Server *server,
+                       size_t startNodesSize, const UA_NodeId *startNodes,
+                       const UA_UInt32 *set, size_t refTypesSize,
+                       const UA_NodeId *refTypes, UA_BrowseDirection browseDirection,
+                       UA_Boolean includeStartNodes,
+                       size_t *resultsSize, UA_ExpandedNodeId **results) {
     RefTree rt;
     UA_StatusCode retval = RefTree_init(&rt);
     if(retval != UA_STATUSCODE_GOOD)
@@ -33074,7 +35469,7 @@ browseRecursive(UA_Server *server,
             en.nodeId = startNodes[i];
             retval = RefTree_add(&rt, &en);
         } else {
-            retval = addRelevantReferences(server, &rt, &startNodes[i],
+            retval = addRelevantReferences(server, &rt, &startNodes[i], set,
                                            refTypesSize, refTypes, browseDirection);
         }
     }
@@ -33092,7 +35487,7 @@ browseRecursive(UA_Server *server,
         if(rt.targets[i].namespaceUri.data != NULL)
             continue;
 
-        retval = addRelevantReferences(server, &rt, &rt.targets[i].nodeId,
+        retval = addRelevantReferences(server, &rt, &rt.targets[i].nodeId, set,
                                        refTypesSize, refTypes, browseDirection);
         if(retval != UA_STATUSCODE_GOOD) {
             RefTree_clear(&rt);
@@ -33110,6 +35505,39 @@ browseRecursive(UA_Server *server,
     return UA_STATUSCODE_GOOD;
 }
 
+UA_StatusCode
+browseRecursive(UA_Server *server,
+                size_t startNodesSize, const UA_NodeId *startNodes,
+                size_t refTypesSize, const UA_NodeId *refTypes,
+                UA_BrowseDirection browseDirection, UA_Boolean includeStartNodes,
+                size_t *resultsSize, UA_ExpandedNodeId **results) {
+    /* Merge the reference types into one bitset. Fall back to comparing the
+     * NodeIds if one of them is not a ReferenceType. The first pass adds
+     * missing types to the index, so it is not rebuilt during the second. */
+    UA_UInt32 *set = NULL;
+    const UA_UInt32 *typeSet;
+    size_t i = 0;
+    for(; i < refTypesSize && refTypes; i++) {
+        if(getReferenceTypeSet(server, &refTypes[i], false,
+                               &typeSet) != UA_STATUSCODE_GOOD)
+            break;
+    }
+    if(refTypes && i == refTypesSize)
+        set = (UA_UInt32*)UA_calloc(server->refTypeIndex.words, sizeof(UA_UInt32));
+    for(i = 0; set && i < refTypesSize; i++) {
+        getReferenceTypeSet(server, &refTypes[i], false, &typeSet);
+        for(size_t w = 0; w < server->refTypeIndex.words; w++)
+            set[w] |= typeSet[w];
+    }
+
+    UA_StatusCode retval =
+        browseRecursiveWithSet(server, startNodesSize, startNodes, set,
+                               refTypesSize, refTypes, browseDirection,
+                               includeStartNodes, resultsSize, results);
+    UA_free(set);
+    return retval;
+}
+
 /* Only if IncludeSubtypes is selected */
 UA_StatusCode
 referenceSubtypes(UA_Server *server, const UA_NodeId *refType,
@@ -33118,6 +35546,30 @@ referenceSubtypes(UA_Server *server, const UA_NodeId *refType,
     if(UA_NodeId_isNull(refType))
         return UA_STATUSCODE_GOOD;
 
+    /* Take the subtypes from the ReferenceType index */
+    const UA_UInt32 *set;
+    if(getReferenceTypeSet(server, refType, true, &set) == UA_STATUSCODE_GOOD) {
+        const UA_ReferenceTypeIndex *ri = &server->refTypeIndex;
+        size_t setSize = 0;
+        for(size_t i = 0; i < ri->typesSize; i++) {
+            if(set[i >> 5] & ((UA_UInt32)1 << (i & 31)))
+                setSize++;
+        }
+        UA_NodeId *newRt = (UA_NodeId*)
+            UA_realloc(*refTypes, (*refTypesSize + setSize) * sizeof(UA_NodeId));
+        if(!newRt)
+            return UA_STATUSCODE_BADOUTOFMEMORY;
+        *refTypes = newRt;
+        UA_StatusCode retval = UA_STATUSCODE_GOOD;
+        for(size_t i = 0; i < ri->typesSize; i++) {
+            if(!(set[i >> 5] & ((UA_UInt32)1 << (i & 31))))
+                continue;
+            retval |= UA_NodeId_copy(&ri->types[i], &newRt[*refTypesSize]);
+            (*refTypesSize)++;
+        }
+        return retval;
+    }
+
     /* Browse recursive for the hierarchy of sub-references */
     UA_ExpandedNodeId *rt = NULL;
     size_t rtSize = 0;
@@ -33153,35 +35605,271 @@ referenceSubtypes(UA_Server *server, const UA_NodeId *refType,
     return UA_STATUSCODE_GOOD;
 }
 
+/***********************/
+/* ReferenceType Index */
+/***********************/
+
+static void
+UA_ReferenceTypeIndex_reset(UA_ReferenceTypeIndex *ri) {
+    UA_Array_delete(ri->types, ri->typesSize, &UA_TYPES[UA_TYPES_NODEID]);
+    UA_free(ri->sets);
+    UA_free(ri->table);
+    ri->valid = false;
+    ri->typesSize = 0;
+    ri->types = NULL;
+    ri->words = 0;
+    ri->sets = NULL;
+    ri->tableSize = 0;
+    ri->table = NULL;
+}
+
+void
+UA_ReferenceTypeIndex_clear(UA_ReferenceTypeIndex *ri) {
+    UA_ReferenceTypeIndex_reset(ri);
+    UA_Array_delete(ri->roots, ri->rootsSize, &UA_TYPES[UA_TYPES_NODEID]);
+    ri->rootsSize = 0;
+    ri->roots = NULL;
+}
+
+static UA_Boolean
+UA_ReferenceTypeIndex_find(const UA_ReferenceTypeIndex *ri, const UA_NodeId *refType,
+                           size_t *pos) {
+    if(ri->tableSize == 0)
+        return false;
+    size_t mask = ri->tableSize - 1;
+    for(size_t i = UA_NodeId_hash(refType) & mask; ri->table[i] != 0; i = (i + 1) & mask) {
+        if(UA_NodeId_equal(&ri->types[ri->table[i] - 1], refType)) {
+            *pos = ri->table[i] - 1;
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Returns the position of the type. Appends the type if it is new. */
+static UA_StatusCode
+UA_ReferenceTypeIndex_append(UA_ReferenceTypeIndex *ri, size_t *typesCapacity,
+                             const UA_NodeId *refType, size_t *pos) {
+    for(*pos = 0; *pos < ri->typesSize; (*pos)++) {
+        if(UA_NodeId_equal(&ri->types[*pos], refType))
+            return UA_STATUSCODE_GOOD;
+    }
+    if(ri->typesSize == *typesCapacity) {
+        size_t newCapacity = (*typesCapacity == 0) ? 32 : *typesCapacity * 2;
+        UA_NodeId *newTypes = (UA_NodeId*)
+            UA_realloc(ri->types, newCapacity * sizeof(UA_NodeId));
+        if(!newTypes)
+            return UA_STATUSCODE_BADOUTOFMEMORY;
+        ri->types = newTypes;
+        *typesCapacity = newCapacity;
+    }
+    UA_StatusCode retval = UA_NodeId_copy(refType, &ri->types[*pos]);
+    if(retval == UA_STATUSCODE_GOOD)
+        ri->typesSize++;
+    return retval;
+}
+
+static UA_StatusCode
+UA_ReferenceTypeIndex_build(UA_Server *server, UA_ReferenceTypeIndex *ri) {
+    UA_ReferenceTypeIndex_reset(ri);
+    ri->generation++;
+
+    /* Start at References and the additional roots that are still
+     * ReferenceTypes */
+    size_t typesCapacity = 0, pos;
+    const UA_NodeId references = UA_NODEID_NUMERIC(0, UA_NS0ID_REFERENCES);
+    UA_StatusCode retval = UA_ReferenceTypeIndex_append(ri, &typesCapacity,
+                                                        &references, &pos);
+    for(size_t i = 0; i < ri->rootsSize && retval == UA_STATUSCODE_GOOD;) {
+        const UA_Node *node = UA_NODESTORE_GET(server, &ri->roots[i]);
+        UA_Boolean isRefType = (node && node->nodeClass == UA_NODECLASS_REFERENCETYPE);
+        if(node)
+            UA_NODESTORE_RELEASE(server, node);
+        if(!isRefType) {
+            UA_NodeId_clear(&ri->roots[i]);
+            ri->roots[i] = ri->roots[--ri->rootsSize];
+            continue;
+        }
+        retval = UA_ReferenceTypeIndex_append(ri, &typesCapacity, &ri->roots[i], &pos);
+        i++;
+    }
+
+    /* Collect the subtypes in breadth-first order. Remember the HasSubtype
+     * edges as pairs of positions. */
+    size_t edgesSize = 0, edgesCapacity = 32;
+    UA_UInt32 *edges = (UA_UInt32*)UA_malloc(edgesCapacity * 2 * sizeof(UA_UInt32));
+    if(!edges)
+        retval = UA_STATUSCODE_BADOUTOFMEMORY;
+    for(size_t i = 0; i < ri->typesSize && retval == UA_STATUSCODE_GOOD; i++) {
+        const UA_Node *node = UA_NODESTORE_GET(server, &ri->types[i]);
+        if(!node)
+            continue;
+        for(size_t j = 0; j < node->referencesSize && retval == UA_STATUSCODE_GOOD; j++) {
+            const UA_NodeReferenceKind *rk = &node->references[j];
+            if(rk->isInverse || !UA_NodeId_equal(&rk->referenceTypeId, &subtypeId))
+                continue;
+            for(size_t k = 0; k < rk->refTargetsSize; k++) {
+                if(!UA_ReferenceTarget_isLocal(&rk->refTargets[k]))
+                    continue;
+                UA_NodeId tmpTarget;
+                retval = UA_ReferenceTypeIndex_append(ri, &typesCapacity,
+                             UA_ReferenceTarget_getNodeId(&rk->refTargets[k], &tmpTarget),
+                             &pos);
+                if(retval != UA_STATUSCODE_GOOD)
+                    break;
+                if(edgesSize == edgesCapacity) {
+                    UA_UInt32 *newEdges = (UA_UInt32*)
+                        UA_realloc(edges, edgesCapacity * 4 * sizeof(UA_UInt32));
+                    if(!newEdges) {
+                        retval = UA_STATUSCODE_BADOUTOFMEMORY;
+                        break;
+                    }
+                    edges = newEdges;
+                    edgesCapacity *= 2;
+                }
+                edges[edgesSize * 2] = (UA_UInt32)i;
+                edges[edgesSize * 2 + 1] = (UA_UInt32)pos;
+                edgesSize++;
+            }
+        }
+        UA_NODESTORE_RELEASE(server, node);
+    }
+
+    /* Allocate the bitsets and the hash table */
+    size_t tableSize = 4;
+    while(tableSize < ri->typesSize * 2)
+        tableSize *= 2;
+    ri->words = (ri->typesSize + 31) / 32;
+    if(retval == UA_STATUSCODE_GOOD) {
+        ri->sets = (UA_UInt32*)UA_calloc(ri->typesSize * 2 * ri->words, sizeof(UA_UInt32));
+        ri->table = (UA_UInt32*)UA_calloc(tableSize, sizeof(UA_UInt32));
+        if(!ri->sets || !ri->table)
+            retval = UA_STATUSCODE_BADOUTOFMEMORY;
+    }
+    if(retval != UA_STATUSCODE_GOOD) {
+        UA_free(edges);
+        UA_ReferenceTypeIndex_reset(ri);
+        return retval;
+    }
+    ri->tableSize = tableSize;
+
+    for(size_t i = 0; i < ri->typesSize; i++) {
+        UA_UInt32 bit = (UA_UInt32)1 << (i & 31);
+        ri->sets[(2 * i) * ri->words + (i >> 5)] = bit;
+        ri->sets[(2 * i + 1) * ri->words + (i >> 5)] = bit;
+        size_t h = UA_NodeId_hash(&ri->types[i]) & (tableSize - 1);
+        while(ri->table[h] != 0)
+            h = (h + 1) & (tableSize - 1);
+        ri->table[h] = (UA_UInt32)i + 1;
+    }
+
+    /* Merge the subtype closures upwards. Walking the edges backwards handles
+     * the breadth-first tree in one pass. Repeat in case of multiple
+     * inheritance. */
+    UA_Boolean changed = true;
+    while(changed) {
+        changed = false;
+        for(size_t e = edgesSize; e > 0; e--) {
+            UA_UInt32 *super = &ri->sets[(2 * edges[(e - 1) * 2] + 1) * ri->words];
+            const UA_UInt32 *sub = &ri->sets[(2 * edges[(e - 1) * 2 + 1] + 1) * ri->words];
+            for(size_t w = 0; w < ri->words; w++) {
+                if((super[w] | sub[w]) != super[w]) {
+                    super[w] |= sub[w];
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    UA_free(edges);
+    ri->valid = true;
+    return UA_STATUSCODE_GOOD;
+}
+
+void
+invalidateReferenceTypeIndex(UA_Server *server) {
+    server->refTypeIndex.valid = false;
+}
+
+UA_StatusCode
+getReferenceTypeSet(UA_Server *server, const UA_NodeId *refType,
+                    UA_Boolean includeSubtypes, const UA_UInt32 **set) {
+    UA_ReferenceTypeIndex *ri = &server->refTypeIndex;
+    if(!ri->valid) {
+        UA_StatusCode retval = UA_ReferenceTypeIndex_build(server, ri);
+        if(retval != UA_STATUSCODE_GOOD)
+            return retval;
+    }
+    size_t pos;
+    if(!UA_ReferenceTypeIndex_find(ri, refType, &pos)) {
+        /* A ReferenceType that is not (yet) connected to References. For
+         * example during bootstrapping, before the HasSubtype references are
+         * added. Index it as an additional root. */
+        const UA_Node *node = UA_NODESTORE_GET(server, refType);
+        if(!node)
+            return UA_STATUSCODE_BADREFERENCETYPEIDINVALID;
+        UA_Boolean isRefType = (node->nodeClass == UA_NODECLASS_REFERENCETYPE);
+        UA_NODESTORE_RELEASE(server, node);
+        if(!isRefType)
+            return UA_STATUSCODE_BADREFERENCETYPEIDINVALID;
+        UA_NodeId *newRoots = (UA_NodeId*)
+            UA_realloc(ri->roots, (ri->rootsSize + 1) * sizeof(UA_NodeId));
+        if(!newRoots)
+            return UA_STATUSCODE_BADOUTOFMEMORY;
+        ri->roots = newRoots;
+        UA_StatusCode retval = UA_NodeId_copy(refType, &ri->roots[ri->rootsSize]);
+        if(retval != UA_STATUSCODE_GOOD)
+            return retval;
+        ri->rootsSize++;
+        retval = UA_ReferenceTypeIndex_build(server, ri);
+        if(retval != UA_STATUSCODE_GOOD)
+            return retval;
+        if(!UA_ReferenceTypeIndex_find(ri, refType, &pos))
+            return UA_STATUSCODE_BADREFERENCETYPEIDINVALID;
+    }
+    *set = &ri->sets[(2 * pos + (includeSubtypes ? 1 : 0)) * ri->words];
+    return UA_STATUSCODE_GOOD;
+}
+
+UA_Boolean
+isInReferenceTypeSet(const UA_Server *server, const UA_UInt32 *set,
+                     const UA_NodeId *refType) {
+    if(!set)
+        return true;
+    size_t pos;
+    if(!UA_ReferenceTypeIndex_find(&server->refTypeIndex, refType, &pos))
+        return false;
+    return (set[pos >> 5] & ((UA_UInt32)1 << (pos & 31))) != 0;
+}
+
+UA_Boolean
+isReferenceSubtype(UA_Server *server, const UA_NodeId *refType,
+                   const UA_NodeId *superType) {
+    const UA_UInt32 *set;
+    if(getReferenceTypeSet(server, superType, true, &set) == UA_STATUSCODE_GOOD)
+        return isInReferenceTypeSet(server, set, refType);
+    return isNodeInTree(server, refType, superType, &subtypeId, 1);
+}
+
 UA_StatusCode
 UA_Server_browseRecursive(UA_Server *server, const UA_BrowseDescription *bd,
                           size_t *resultsSize, UA_ExpandedNodeId **results) {
-    /* Set the list of relevant reference types */
+    /* Set the relevant reference types */
     UA_LOCK(server->serviceMutex);
-    UA_NodeId *refTypes = NULL;
-    size_t refTypesSize = 0;
+    const UA_UInt32 *set = NULL;
     UA_StatusCode retval = UA_STATUSCODE_GOOD;
     if(!UA_NodeId_isNull(&bd->referenceTypeId)) {
-        if(!bd->includeSubtypes) {
-            refTypes = (UA_NodeId*)(uintptr_t)&bd->referenceTypeId;
-            refTypesSize = 1;
-        } else {
-            retval = referenceSubtypes(server, &bd->referenceTypeId,
-                                       &refTypesSize, &refTypes);
-            if(retval != UA_STATUSCODE_GOOD) {
-                UA_UNLOCK(server->serviceMutex);
-                return retval;
-            }
+        retval = getReferenceTypeSet(server, &bd->referenceTypeId,
+                                     bd->includeSubtypes, &set);
+        if(retval != UA_STATUSCODE_GOOD) {
+            UA_UNLOCK(server->serviceMutex);
+            return retval;
         }
     }
 
     /* Browse */
-    retval = browseRecursive(server, 1, &bd->nodeId, refTypesSize, refTypes,
-                             bd->browseDirection, false, resultsSize, results);
-
-    /* Clean up */
-    if(refTypes && bd->includeSubtypes)
-        UA_Array_delete(refTypes, refTypesSize, &UA_TYPES[UA_TYPES_NODEID]);
+    retval = browseRecursiveWithSet(server, 1, &bd->nodeId, set, 0, NULL,
+                                    bd->browseDirection, false, resultsSize, results);
 
     UA_UNLOCK(server->serviceMutex);
     return retval;
@@ -33236,8 +35924,11 @@ struct ContinuationPoint {
     UA_BrowseDescription browseDescription;
     UA_UInt32 maxReferences;
 
-    size_t relevantReferencesSize;
-    UA_NodeId *relevantReferences;
+    /* Bitset over the ReferenceType index. NULL for all references. Persisted
+     * continuation points own a copy of the bitset. The bitset is computed
+     * again if the index was rebuilt in the meantime. */
+    UA_UInt32 *relevantReferences;
+    UA_UInt32 relevantReferencesGeneration;
 
     /* The last point in the node references? */
     size_t referenceKindIndex;
@@ -33248,15 +35939,70 @@ ContinuationPoint *
 ContinuationPoint_clear(ContinuationPoint *cp) {
     UA_ByteString_clear(&cp->identifier);
     UA_BrowseDescription_clear(&cp->browseDescription);
-    UA_Array_delete(cp->relevantReferences, cp->relevantReferencesSize,
-                    &UA_TYPES[UA_TYPES_NODEID]);
+    UA_free(cp->relevantReferences);
     return cp->next;
 }
 
-/* Target node on top of the stack */
+static UA_StatusCode
+ContinuationPoint_copyRelevantReferences(UA_Server *server, ContinuationPoint *cp,
+                                         const UA_UInt32 *set) {
+    UA_free(cp->relevantReferences);
+    cp->relevantReferences = NULL;
+    if(!set)
+        return UA_STATUSCODE_GOOD;
+    size_t words = server->refTypeIndex.words;
+    cp->relevantReferences = (UA_UInt32*)UA_malloc(words * sizeof(UA_UInt32));
+    if(!cp->relevantReferences)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    memcpy(cp->relevantReferences, set, words * sizeof(UA_UInt32));
+    cp->relevantReferencesGeneration = server->refTypeIndex.generation;
+    return UA_STATUSCODE_GOOD;
+}
+
+/* Remembers the last TypeDefinition that was verified during a Browse. Sibling
+ * nodes mostly share their type. Then the type node is not looked up again. */
+typedef struct {
+    UA_NodeClass nodeClass; /* NodeClass of the instance */
+    UA_NodeId typeId;
+} TypeDefinitionCache;
+
+static UA_StatusCode
+getTypeDefinitionId(UA_Server *server, const UA_Node *node,
+                    TypeDefinitionCache *cache, UA_NodeId *typeId) {
+    /* Same candidate as in getNodeType. There is at most one ReferenceKind for
+     * the forward HasTypeDefinition references. */
+    const UA_NodeId hasTypeDefinition = UA_NODEID_NUMERIC(0, UA_NS0ID_HASTYPEDEFINITION);
+    for(size_t i = 0; i < node->referencesSize; ++i) {
+        const UA_NodeReferenceKind *rk = &node->references[i];
+        if(rk->isInverse || !UA_NodeId_equal(&rk->referenceTypeId, &hasTypeDefinition))
+            continue;
+        if(cache->nodeClass == node->nodeClass &&
+           UA_ReferenceTarget_equalNodeId(&rk->refTargets[0], &cache->typeId))
+            return UA_NodeId_copy(&cache->typeId, typeId);
+        break;
+    }
+
+    /* Look up and verify the type node */
+    const UA_Node *type = getNodeType(server, node);
+    if(!type)
+        return UA_STATUSCODE_GOOD;
+    UA_StatusCode retval = UA_NodeId_copy(&type->nodeId, typeId);
+    UA_NodeId_clear(&cache->typeId);
+    cache->nodeClass = UA_NODECLASS_UNSPECIFIED;
+    if(UA_NodeId_copy(&type->nodeId, &cache->typeId) == UA_STATUSCODE_GOOD)
+        cache->nodeClass = node->nodeClass;
+    UA_NODESTORE_RELEASE(server, type);
+    return retval;
+}
+
+/* Target node on top of the stack. The target is NULL if the target
+ * attributes were not requested or the target cannot be resolved (remote
+ * server or missing node). Then only the fields without access to the node
+ * are set. */
 static UA_StatusCode UA_FUNC_ATTR_WARN_UNUSED_RESULT
 addReferenceDescription(UA_Server *server, RefResult *rr, const UA_NodeReferenceKind *ref,
-                        UA_UInt32 mask, const UA_ExpandedNodeId *nodeId, const UA_Node *curr) {
+                        UA_UInt32 mask, const UA_ExpandedNodeId *nodeId, const UA_Node *curr,
+                        TypeDefinitionCache *typeCache) {
     /* Ensure capacity is left */
     UA_StatusCode retval = UA_STATUSCODE_GOOD;
     if(rr->size >= rr->capacity) {
@@ -33274,27 +36020,19 @@ addReferenceDescription(UA_Server *server, RefResult *rr, const UA_NodeReference
     if(mask & UA_BROWSERESULTMASK_ISFORWARD)
         descr->isForward = !ref->isInverse;
 
-    /* Remote references (ExpandedNodeId) are not further looked up here */
-    if(!curr) {
-        UA_ReferenceDescription_clear(descr);
-        return retval;
-    }
-    
     /* Fields that require the actual node */
-    if(mask & UA_BROWSERESULTMASK_NODECLASS)
-        retval |= UA_NodeClass_copy(&curr->nodeClass, &descr->nodeClass);
-    if(mask & UA_BROWSERESULTMASK_BROWSENAME)
-        retval |= UA_QualifiedName_copy(&curr->browseName, &descr->browseName);
-    if(mask & UA_BROWSERESULTMASK_DISPLAYNAME)
-        retval |= UA_LocalizedText_copy(&curr->displayName, &descr->displayName);
-    if(mask & UA_BROWSERESULTMASK_TYPEDEFINITION) {
-        if(curr->nodeClass == UA_NODECLASS_OBJECT ||
-           curr->nodeClass == UA_NODECLASS_VARIABLE) {
-            const UA_Node *type = getNodeType(server, curr);
-            if(type) {
-                retval |= UA_NodeId_copy(&type->nodeId, &descr->typeDefinition.nodeId);
-                UA_NODESTORE_RELEASE(server, type);
-            }
+    if(curr) {
+        if(mask & UA_BROWSERESULTMASK_NODECLASS)
+            retval |= UA_NodeClass_copy(&curr->nodeClass, &descr->nodeClass);
+        if(mask & UA_BROWSERESULTMASK_BROWSENAME)
+            retval |= UA_QualifiedName_copy(&curr->browseName, &descr->browseName);
+        if(mask & UA_BROWSERESULTMASK_DISPLAYNAME)
+            retval |= UA_LocalizedText_copy(&curr->displayName, &descr->displayName);
+        if(mask & UA_BROWSERESULTMASK_TYPEDEFINITION) {
+            if(curr->nodeClass == UA_NODECLASS_OBJECT ||
+               curr->nodeClass == UA_NODECLASS_VARIABLE)
+                retval |= getTypeDefinitionId(server, curr, typeCache,
+                                              &descr->typeDefinition.nodeId);
         }
     }
 
@@ -33323,6 +36061,14 @@ browseReferences(UA_Server *server, const UA_Node *node,
     size_t referenceKindIndex = cp->referenceKindIndex;
     size_t targetIndex = cp->targetIndex;
 
+    /* The target nodes are only looked up if the NodeClass is filtered or
+     * attributes of the target are requested */
+    UA_Boolean resolveTargets = (bd->nodeClassMask != UA_NODECLASS_UNSPECIFIED ||
+                                 (bd->resultMask & UA_BROWSERESULTMASK_TARGETINFO) != 0);
+    TypeDefinitionCache typeCache;
+    typeCache.nodeClass = UA_NODECLASS_UNSPECIFIED;
+    UA_NodeId_init(&typeCache.typeId);
+
     /* Loop over the node's references */
     const UA_Node *target = NULL;
     UA_StatusCode retval = UA_STATUSCODE_GOOD;
@@ -33336,24 +36082,27 @@ browseReferences(UA_Server *server, const UA_Node *node,
             continue;
 
         /* Is the reference part of the hierarchy of references we look for? */
-        if(!relevantReference(&rk->referenceTypeId, cp->relevantReferencesSize,
-                              cp->relevantReferences))
+        if(!isInReferenceTypeSet(server, cp->relevantReferences, &rk->referenceTypeId))
             continue;
 
         /* Loop over the targets */
         for(; targetIndex < rk->refTargetsSize; ++targetIndex) {
             target = NULL;
-
-            /* Get the node if it is not a remote reference */
-            if(rk->refTargets[targetIndex].target.serverIndex == 0 &&
-               rk->refTargets[targetIndex].target.namespaceUri.data == NULL) {
-                target = UA_NODESTORE_GET(server,
-                                          &rk->refTargets[targetIndex].target.nodeId);
+            UA_ExpandedNodeId tmpTarget;
+            const UA_ExpandedNodeId *targetId =
+                UA_ReferenceTarget_getTarget(&rk->refTargets[targetIndex], &tmpTarget);
+
+            /* Get the node if it is not a remote reference. Remote
+             * references and references to missing nodes cannot be resolved.
+             * They are returned independent of the masks, with only the
+             * fields that need no access to the target node. */
+            if(resolveTargets && targetId->serverIndex == 0 &&
+               targetId->namespaceUri.data == NULL) {
+                target = UA_NODESTORE_GET(server, &targetId->nodeId);
 
                 /* Test if the node class matches */
                 if(target && !matchClassMask(target, bd->nodeClassMask)) {
-                    if(target)
-                        UA_NODESTORE_RELEASE(server, target);
+                    UA_NODESTORE_RELEASE(server, target);
                     continue;
                 }
             }
@@ -33364,21 +36113,26 @@ browseReferences(UA_Server *server, const UA_Node *node,
                 cp->targetIndex = targetIndex;
                 if(target)
                     UA_NODESTORE_RELEASE(server, target);
+                UA_NodeId_clear(&typeCache.typeId);
                 return UA_STATUSCODE_GOOD;
             }
 
             /* Copy the node description. Target is on top of the stack */
             retval = addReferenceDescription(server, rr, rk, bd->resultMask,
-                                             &rk->refTargets[targetIndex].target, target);
-            UA_NODESTORE_RELEASE(server, target);
-            if(retval != UA_STATUSCODE_GOOD)
+                                             targetId, target, &typeCache);
+            if(target)
+                UA_NODESTORE_RELEASE(server, target);
+            if(retval != UA_STATUSCODE_GOOD) {
+                UA_NodeId_clear(&typeCache.typeId);
                 return retval;
+            }
         }
 
         targetIndex = 0; /* Start at index 0 for the next reference kind */
     }
 
     /* The node is done */
+    UA_NodeId_clear(&typeCache.typeId);
     *done = true;
     return UA_STATUSCODE_GOOD;
 }
@@ -33476,29 +36230,22 @@ Operation_Browse(UA_Server *server, UA_Session *session, const UA_UInt32 *maxref
         }
     }
 
-    /* Get the list of relevant reference types */
+    /* Get the relevant reference types. The temporary cp points into the
+     * ReferenceType index. */
     if(!UA_NodeId_isNull(&descr->referenceTypeId)) {
-        if(!descr->includeSubtypes) {
-            cp->relevantReferences = (UA_NodeId*)(uintptr_t)&descr->referenceTypeId;
-            cp->relevantReferencesSize = 1;
-        } else {
-            result->statusCode =
-                referenceSubtypes(server, &descr->referenceTypeId,
-                                  &cp->relevantReferencesSize, &cp->relevantReferences);
-            if(result->statusCode != UA_STATUSCODE_GOOD)
-                return;
-        }
+        const UA_UInt32 *set = NULL;
+        result->statusCode = getReferenceTypeSet(server, &descr->referenceTypeId,
+                                                 descr->includeSubtypes, &set);
+        if(result->statusCode != UA_STATUSCODE_GOOD)
+            return;
+        cp->relevantReferences = (UA_UInt32*)(uintptr_t)set;
     }
 
     UA_Boolean done = browseWithContinuation(server, session, cp, result);
 
     /* Exit early if done or an error occurred */
-    if(done || result->statusCode != UA_STATUSCODE_GOOD) {
-        if(descr->includeSubtypes)
-            UA_Array_delete(cp->relevantReferences, cp->relevantReferencesSize,
-                            &UA_TYPES[UA_TYPES_NODEID]);
+    if(done || result->statusCode != UA_STATUSCODE_GOOD)
         return;
-    }
 
     /* Persist the new continuation point */
 
@@ -33523,16 +36270,9 @@ Operation_Browse(UA_Server *server, UA_Session *session, const UA_UInt32 *maxref
     cp2->targetIndex = cp->targetIndex;
     cp2->maxReferences = cp->maxReferences;
 
-    if(descr->includeSubtypes) {
-        cp2->relevantReferences = cp->relevantReferences;
-        cp2->relevantReferencesSize = cp->relevantReferencesSize;
-    } else {
-        retval = UA_Array_copy(cp->relevantReferences, cp->relevantReferencesSize,
-                               (void**)&cp2->relevantReferences, &UA_TYPES[UA_TYPES_NODEID]);
-        if(retval != UA_STATUSCODE_GOOD)
-            goto cleanup;
-        cp2->relevantReferencesSize = cp->relevantReferencesSize;
-    }
+    retval = ContinuationPoint_copyRelevantReferences(server, cp2, cp->relevantReferences);
+    if(retval != UA_STATUSCODE_GOOD)
+        goto cleanup;
 
     /* Copy the description */
     retval = UA_BrowseDescription_copy(descr, &cp2->browseDescription);
@@ -33629,6 +36369,20 @@ Operation_BrowseNext(UA_Server *server, UA_Session *session,
         return;
     }
 
+    /* The ReferenceType index was rebuilt since the last call */
+    if(cp->relevantReferences &&
+       (!server->refTypeIndex.valid ||
+        cp->relevantReferencesGeneration != server->refTypeIndex.generation)) {
+        const UA_UInt32 *set = NULL;
+        result->statusCode =
+            getReferenceTypeSet(server, &cp->browseDescription.referenceTypeId,
+                                cp->browseDescription.includeSubtypes, &set);
+        if(result->statusCode == UA_STATUSCODE_GOOD)
+            result->statusCode = ContinuationPoint_copyRelevantReferences(server, cp, set);
+        if(result->statusCode != UA_STATUSCODE_GOOD)
+            return;
+    }
+
     /* Continue browsing */
     UA_Boolean done = browseWithContinuation(server, session, cp, result);
 
@@ -33685,7 +36439,9 @@ walkBrowsePathElementReferenceTargets(UA_BrowsePathResult *result, size_t *targe
                                       UA_UInt32 elemDepth, const UA_NodeReferenceKind *rk) {
     /* Loop over the targets */
     for(size_t i = 0; i < rk->refTargetsSize; i++) {
-        UA_ExpandedNodeId *targetId = &rk->refTargets[i].target;
+        UA_ExpandedNodeId tmpTarget;
+        const UA_ExpandedNodeId *targetId =
+            UA_ReferenceTarget_getTarget(&rk->refTargets[i], &tmpTarget);
 
         /* Does the reference point to an external server? Then add to the
          * targets with the right path depth. */
@@ -33734,16 +36490,11 @@ walkBrowsePathElement(UA_Server *server, UA_Session *session, UA_UInt32 nodeClas
                       const UA_NodeId *current, const size_t currentCount,
                       UA_NodeId **next, size_t *nextSize, size_t *nextCount) {
     /* Return all references? */
-    UA_Boolean all_refs = UA_NodeId_isNull(&elem->referenceTypeId);
-    if(!all_refs) {
-        const UA_Node *rootRef = UA_NODESTORE_GET(server, &elem->referenceTypeId);
-        if(!rootRef)
-            return;
-        UA_Boolean match = (rootRef->nodeClass == UA_NODECLASS_REFERENCETYPE);
-        UA_NODESTORE_RELEASE(server, rootRef);
-        if(!match)
-            return;
-    }
+    const UA_UInt32 *set = NULL;
+    if(!UA_NodeId_isNull(&elem->referenceTypeId) &&
+       getReferenceTypeSet(server, &elem->referenceTypeId, elem->includeSubtypes,
+                           &set) != UA_STATUSCODE_GOOD)
+        return;
 
     /* Iterate over all nodes at the current depth-level */
     for(size_t i = 0; i < currentCount; ++i) {
@@ -33780,12 +36531,8 @@ walkBrowsePathElement(UA_Server *server, UA_Session *session, UA_UInt32 nodeClas
                 continue;
 
             /* Is the node relevant? */
-            if(!all_refs) {
-                if(!elem->includeSubtypes && !UA_NodeId_equal(&rk->referenceTypeId, &elem->referenceTypeId))
-                    continue;
-                if(!isNodeInTree(server, &rk->referenceTypeId, &elem->referenceTypeId, &subtypeId, 1))
-                    continue;
-            }
+            if(!isInReferenceTypeSet(server, set, &rk->referenceTypeId))
+                continue;
 
             /* Walk over the reference targets */
             walkBrowsePathElementReferenceTargets(result, targetsSize, next, nextSize,
@@ -34150,8 +36897,10 @@ getArgumentsVariableNode(UA_Server *server, const UA_MethodNode *ofMethod,
             continue;
 
         for(size_t j = 0; j < rk->refTargetsSize; ++j) {
+            UA_NodeId tmpTarget;
             const UA_Node *refTarget =
-                UA_NODESTORE_GET(server, &rk->refTargets[j].target.nodeId);
+                UA_NODESTORE_GET(server, UA_ReferenceTarget_getNodeId(&rk->refTargets[j],
+                                                                      &tmpTarget));
             if(!refTarget)
                 continue;
             if(refTarget->nodeClass == UA_NODECLASS_VARIABLE &&
@@ -34229,7 +36978,6 @@ validMethodArguments(UA_Server *server, UA_Session *session, const UA_MethodNode
 }
 
 static const UA_NodeId hasComponentNodeId = {0, UA_NODEIDTYPE_NUMERIC, {UA_NS0ID_HASCOMPONENT}};
-static const UA_NodeId hasSubTypeNodeId = {0, UA_NODEIDTYPE_NUMERIC, {UA_NS0ID_HASSUBTYPE}};
 
 static void
 callWithMethodAndObject(UA_Server *server, UA_Session *session,
@@ -34263,11 +37011,10 @@ callWithMethodAndObject(UA_Server *server, UA_Session *session,
         UA_NodeReferenceKind *rk = &object->references[i];
         if(rk->isInverse)
             continue;
-        if(!isNodeInTree(server, &rk->referenceTypeId,
-                         &hasComponentNodeId, &hasSubTypeNodeId, 1))
+        if(!isReferenceSubtype(server, &rk->referenceTypeId, &hasComponentNodeId))
             continue;
         for(size_t j = 0; j < rk->refTargetsSize; ++j) {
-            if(UA_NodeId_equal(&rk->refTargets[j].target.nodeId, &request->methodId)) {
+            if(UA_ReferenceTarget_equalNodeId(&rk->refTargets[j], &request->methodId)) {
                 found = true;
                 break;
             }
@@ -36635,11 +39382,24 @@ copyAttributeIntoNode(UA_Server *server, UA_Session *session,
     return retval;
 }
 
+/* Writing the value attribute edits only the value of the node */
+static UA_StatusCode
+editNodeWithWriteValue(UA_Server *server, UA_Session *session,
+                       const UA_WriteValue *wv) {
+    /* casting away const qualifier because callback uses const anyway */
+    if(wv->attributeId == UA_ATTRIBUTEID_VALUE)
+        return UA_Server_editNodeValue(server, session, &wv->nodeId,
+                                       (UA_EditNodeCallback)copyAttributeIntoNode,
+                                       (UA_WriteValue *)(uintptr_t)wv);
+    return UA_Server_editNode(server, session, &wv->nodeId,
+                              (UA_EditNodeCallback)copyAttributeIntoNode,
+                              (UA_WriteValue *)(uintptr_t)wv);
+}
+
 static void
 Operation_Write(UA_Server *server, UA_Session *session, void *context,
                 UA_WriteValue *wv, UA_StatusCode *result) {
-    *result = UA_Server_editNode(server, session, &wv->nodeId,
-                        (UA_EditNodeCallback)copyAttributeIntoNode, wv);
+    *result = editNodeWithWriteValue(server, session, wv);
 }
 
 void
@@ -36667,19 +39427,13 @@ Service_Write(UA_Server *server, UA_Session *session,
 UA_StatusCode
 writeWithSession(UA_Server *server, UA_Session *session,
                            const UA_WriteValue *value) {
-    return UA_Server_editNode(server, session, &value->nodeId,
-                              (UA_EditNodeCallback)copyAttributeIntoNode,
-                              /* casting away const qualifier because callback uses const anyway */
-                              (UA_WriteValue *)(uintptr_t)value);
+    return editNodeWithWriteValue(server, session, value);
 }
 
 UA_StatusCode
 writeAttribute(UA_Server *server, const UA_WriteValue *value) {
     UA_LOCK_ASSERT(server->serviceMutex, 1);
-    return UA_Server_editNode(server, &server->adminSession, &value->nodeId,
-                              (UA_EditNodeCallback)copyAttributeIntoNode,
-                               /* casting away const qualifier because callback uses const anyway */
-                              (UA_WriteValue *)(uintptr_t)value);
+    return editNodeWithWriteValue(server, &server->adminSession, value);
 }
 
 UA_StatusCode
@@ -38063,7 +40817,7 @@ Service_Republish(UA_Server *server, UA_Session *session,
     /* Find the notification in the retransmission queue  */
     UA_NotificationMessageEntry *entry;
     TAILQ_FOREACH(entry, &sub->retransmissionQueue, listEntry) {
-        if(entry->message.sequenceNumber == request->retransmitSequenceNumber)
+        if(entry->sequenceNumber == request->retransmitSequenceNumber)
             break;
     }
     if(!entry) {
@@ -38071,8 +40825,10 @@ Service_Republish(UA_Server *server, UA_Session *session,
         return;
     }
 
+    size_t offset = 0;
     response->responseHeader.serviceResult =
-        UA_NotificationMessage_copy(&entry->message, &response->notificationMessage);
+        UA_decodeBinary(&entry->encoded, &offset, &response->notificationMessage,
+                        &UA_TYPES[UA_TYPES_NOTIFICATIONMESSAGE], NULL);
 }
 
 #endif /* UA_ENABLE_SUBSCRIPTIONS */
@@ -38220,6 +40976,7 @@ setMonitoredItemSettings(UA_Server *server, UA_Session *session, UA_MonitoredIte
 
     /* Remove the old samples */
     UA_ByteString_clear(&mon->lastSampledValue);
+    mon->lastSampledHeader.valid = false;
     UA_Variant_clear(&mon->lastValue);
 
     /* ClientHandle */
@@ -38615,11 +41372,12 @@ Operation_SetMonitoringMode(UA_Server *server, UA_Session *session,
         UA_Notification *notification, *notification_tmp;
         TAILQ_FOREACH_SAFE(notification, &mon->queue, listEntry, notification_tmp) {
             UA_Notification_dequeue(server, notification);
-            UA_Notification_delete(notification);
+            UA_Notification_delete(server, notification);
         }
 
         /* Initialize lastSampledValue */
         UA_ByteString_clear(&mon->lastSampledValue);
+        mon->lastSampledHeader.valid = false;
         UA_Variant_clear(&mon->lastValue);
     }
 }
@@ -39180,7 +41938,7 @@ isMandatoryChild(UA_Server *server, UA_Session *session,
         if(refs->isInverse)
             continue;
         for(size_t j = 0; j < refs->refTargetsSize; ++j) {
-            if(UA_NodeId_equal(&mandatoryId, &refs->refTargets[j].target.nodeId)) {
+            if(UA_ReferenceTarget_equalNodeId(&refs->refTargets[j], &mandatoryId)) {
                 UA_NODESTORE_RELEASE(server, child);
                 return true;
             }
@@ -39308,6 +42066,7 @@ copyChild(UA_Server *server, UA_Session *session, const UA_NodeId *destinationNo
             UA_NODESTORE_REMOVE(server, &newNodeId);
             return retval;
         }
+        server->bulkChildrenAdded = true;
 
         /* For the new child, recursively copy the members of the original. No
          * typechecking is performed here. Assuming that the original is
@@ -39397,6 +42156,13 @@ addRef(UA_Server *server, UA_Session *session, const UA_NodeId *nodeId,
 
 static const UA_NodeId hasSubtype = {0, UA_NODEIDTYPE_NUMERIC, {UA_NS0ID_HASSUBTYPE}};
 
+/* Nodes added by the server during a bulk load come from a validated nodeset
+ * and are not checked again. Nodes added by clients are always checked. */
+static UA_Boolean
+isBulkLoaded(UA_Server *server, UA_Session *session) {
+    return server->bulkLoading && session == &server->adminSession;
+}
+
 UA_StatusCode
 AddNode_addRefs(UA_Server *server, UA_Session *session, const UA_NodeId *nodeId,
                 const UA_NodeId *parentNodeId, const UA_NodeId *referenceTypeId,
@@ -39422,7 +42188,7 @@ AddNode_addRefs(UA_Server *server, UA_Session *session, const UA_NodeId *nodeId,
         }
     }
 
-    UA_StatusCode retval;
+    UA_StatusCode retval = UA_STATUSCODE_GOOD;
     /* Make sure newly created node does not have itself as parent */
     if (UA_NodeId_equal(nodeId, parentNodeId)) {
         UA_LOG_NODEID_WRAP(nodeId, UA_LOG_INFO_SESSION(&server->config.logger, session,
@@ -39435,8 +42201,9 @@ AddNode_addRefs(UA_Server *server, UA_Session *session, const UA_NodeId *nodeId,
 
 
     /* Check parent reference. Objects may have no parent. */
-    retval = checkParentReference(server, session, node->nodeClass,
-                                                parentNodeId, referenceTypeId);
+    if(!isBulkLoaded(server, session))
+        retval = checkParentReference(server, session, node->nodeClass,
+                                      parentNodeId, referenceTypeId);
     if(retval != UA_STATUSCODE_GOOD) {
         UA_LOG_NODEID_WRAP(nodeId, UA_LOG_INFO_SESSION(&server->config.logger, session,
                             "AddNodes: The parent reference for %.*s is invalid "
@@ -39512,7 +42279,7 @@ AddNode_addRefs(UA_Server *server, UA_Session *session, const UA_NodeId *nodeId,
 
         /* See if the type has the correct node class. For type-nodes, we know
          * that type has the same nodeClass from checkParentReference. */
-        if(node->nodeClass == UA_NODECLASS_VARIABLE) {
+        if(node->nodeClass == UA_NODECLASS_VARIABLE && !isBulkLoaded(server, session)) {
             if(((const UA_VariableTypeNode*)type)->isAbstract) {
                 /* Get subtypes of the parent reference types */
                 UA_NodeId *parentTypeHierarchy = NULL;
@@ -39549,7 +42316,7 @@ AddNode_addRefs(UA_Server *server, UA_Session *session, const UA_NodeId *nodeId,
             }
         }
 
-        if(node->nodeClass == UA_NODECLASS_OBJECT) {
+        if(node->nodeClass == UA_NODECLASS_OBJECT && !isBulkLoaded(server, session)) {
             if(((const UA_ObjectTypeNode*)type)->isAbstract) {
                 /* Get subtypes of the parent reference types */
                 UA_NodeId *parentTypeHierarchy = NULL;
@@ -39861,6 +42628,10 @@ checkValidBrowseName(UA_Server *server, UA_Session *session,
     return retval;
 }
 
+static UA_StatusCode
+callConstructors(UA_Server *server, UA_Session *session,
+                 const UA_Node *node, const UA_Node *type);
+
 /* Construct children first */
 static UA_StatusCode
 recursiveCallConstructors(UA_Server *server, UA_Session *session,
@@ -39919,7 +42690,15 @@ recursiveCallConstructors(UA_Server *server, UA_Session *session,
     if(retval != UA_STATUSCODE_GOOD)
         return retval;
 
+    return callConstructors(server, session, node, type);
+}
+
+/* Call the constructors of the node only. The children are not visited. */
+static UA_StatusCode
+callConstructors(UA_Server *server, UA_Session *session,
+                 const UA_Node *node, const UA_Node *type) {
     /* Get the node type constructor */
+    UA_StatusCode retval = UA_STATUSCODE_GOOD;
     const UA_NodeTypeLifecycle *lifecycle = NULL;
     if(type && node->nodeClass == UA_NODECLASS_OBJECT) {
         const UA_ObjectTypeNode *ot = (const UA_ObjectTypeNode*)type;
@@ -39996,9 +42775,15 @@ recursiveDeleteNode(UA_Server *server, UA_Session *session,
                     const UA_Node *node, UA_Boolean removeTargetRefs);
 
 /* Children, references, type-checking, constructors. */
-UA_StatusCode
-AddNode_finish(UA_Server *server, UA_Session *session, const UA_NodeId *nodeId) {
+/* Nodes from a bulk load are finished in the order of their _finish calls. The
+ * children from the nodeset are finished and constructed by their own entry.
+ * So only the constructors of the node itself are called, unless children were
+ * copied from the type definition. */
+static UA_StatusCode
+finishNode(UA_Server *server, UA_Session *session,
+           const UA_NodeId *nodeId, UA_Boolean bulk) {
     UA_StatusCode retval = UA_STATUSCODE_GOOD;
+    server->bulkChildrenAdded = false;
 
     /* Get the node */
     const UA_Node *node = UA_NODESTORE_GET(server, nodeId);
@@ -40034,7 +42819,12 @@ AddNode_finish(UA_Server *server, UA_Session *session, const UA_NodeId *nodeId)
 
     /* Call the constructor(s) */
  constructor:
-    retval = recursiveCallConstructors(server, session, node, type);
+    if(bulk && !server->bulkChildrenAdded) {
+        if(!node->constructed)
+            retval = callConstructors(server, session, node, type);
+    } else {
+        retval = recursiveCallConstructors(server, session, node, type);
+    }
     if(retval != UA_STATUSCODE_GOOD) {
         UA_LOG_NODEID_WRAP(&node->nodeId, UA_LOG_INFO_SESSION(&server->config.logger, session,
                            "AddNodes: Calling the node constructor(s) of %.*s failed "
@@ -40053,6 +42843,11 @@ AddNode_finish(UA_Server *server, UA_Session *session, const UA_NodeId *nodeId)
     return retval;
 }
 
+UA_StatusCode
+AddNode_finish(UA_Server *server, UA_Session *session, const UA_NodeId *nodeId) {
+    return finishNode(server, session, nodeId, false);
+}
+
 static void
 Operation_addNode(UA_Server *server, UA_Session *session, void *nodeContext,
                   const UA_AddNodesItem *item, UA_AddNodesResult *result) {
@@ -40169,10 +42964,77 @@ UA_Server_addNode_begin(UA_Server *server, const UA_NodeClass nodeClass,
     return retval;
 }
 
+static UA_StatusCode
+deferFinish(UA_Server *server, const UA_NodeId *nodeId) {
+    if(server->bulkNodesSize == server->bulkNodesCapacity) {
+        size_t newCapacity = (server->bulkNodesCapacity > 0) ?
+            server->bulkNodesCapacity * 2 : 64;
+        UA_NodeId *newNodes = (UA_NodeId*)
+            UA_realloc(server->bulkNodes, newCapacity * sizeof(UA_NodeId));
+        if(!newNodes)
+            return UA_STATUSCODE_BADOUTOFMEMORY;
+        server->bulkNodes = newNodes;
+        server->bulkNodesCapacity = newCapacity;
+    }
+    UA_StatusCode retval =
+        UA_NodeId_copy(nodeId, &server->bulkNodes[server->bulkNodesSize]);
+    if(retval == UA_STATUSCODE_GOOD)
+        server->bulkNodesSize++;
+    return retval;
+}
+
 UA_StatusCode
 UA_Server_addNode_finish(UA_Server *server, const UA_NodeId nodeId) {
     UA_LOCK(server->serviceMutex);
-    UA_StatusCode retval = AddNode_finish(server, &server->adminSession, &nodeId);
+    UA_StatusCode retval;
+    if(server->bulkLoading)
+        retval = deferFinish(server, &nodeId);
+    else
+        retval = AddNode_finish(server, &server->adminSession, &nodeId);
+    UA_UNLOCK(server->serviceMutex);
+    return retval;
+}
+
+UA_StatusCode
+UA_Server_bulkLoad_begin(UA_Server *server) {
+    UA_LOCK(server->serviceMutex);
+    UA_StatusCode retval = UA_STATUSCODE_GOOD;
+    if(server->bulkLoading)
+        retval = UA_STATUSCODE_BADINVALIDSTATE;
+    else
+        server->bulkLoading = true;
+    UA_UNLOCK(server->serviceMutex);
+    return retval;
+}
+
+UA_StatusCode
+UA_Server_bulkLoad_end(UA_Server *server) {
+    UA_LOCK(server->serviceMutex);
+    if(!server->bulkLoading) {
+        UA_UNLOCK(server->serviceMutex);
+        return UA_STATUSCODE_BADINVALIDSTATE;
+    }
+    server->bulkLoading = false;
+
+    /* Finish all nodes in a single sweep. Stop at the first error. The failed
+     * node is removed like in UA_Server_addNode_finish. */
+    UA_StatusCode retval = UA_STATUSCODE_GOOD;
+    for(size_t i = 0; i < server->bulkNodesSize; i++) {
+        retval = finishNode(server, &server->adminSession, &server->bulkNodes[i], true);
+        if(retval != UA_STATUSCODE_GOOD) {
+            UA_LOG_NODEID_WRAP(&server->bulkNodes[i],
+                               UA_LOG_ERROR(&server->config.logger, UA_LOGCATEGORY_SERVER,
+                                            "Bulk load: Finishing the node %.*s failed "
+                                            "with status code %s", (int)nodeIdStr.length,
+                                            nodeIdStr.data, UA_StatusCode_name(retval)));
+            break;
+        }
+    }
+
+    UA_Array_delete(server->bulkNodes, server->bulkNodesSize, &UA_TYPES[UA_TYPES_NODEID]);
+    server->bulkNodes = NULL;
+    server->bulkNodesSize = 0;
+    server->bulkNodesCapacity = 0;
     UA_UNLOCK(server->serviceMutex);
     return retval;
 }
@@ -40199,7 +43061,8 @@ removeIncomingReferences(UA_Server *server, UA_Session *session,
         item.isForward = refs->isInverse;
         item.referenceTypeId = refs->referenceTypeId;
         for(size_t j = 0; j < refs->refTargetsSize; ++j) {
-            item.sourceNodeId = refs->refTargets[j].target.nodeId;
+            UA_NodeId tmpTarget;
+            item.sourceNodeId = *UA_ReferenceTarget_getNodeId(&refs->refTargets[j], &tmpTarget);
             Operation_deleteReference(server, session, NULL, &item, &dummy);
         }
     }
@@ -40408,6 +43271,8 @@ deleteNodeOperation(UA_Server *server, UA_Session *session, void *context,
                                "Delete Nodes: Cannot test for hierarchical "
                                "references. Deleting the node and all child nodes.");
     }
+    if(node->nodeClass == UA_NODECLASS_REFERENCETYPE)
+        invalidateReferenceTypeIndex(server);
     recursiveDeconstructNode(server, session, hierarchicalRefsSize, hierarchicalRefs, node);
     recursiveDeleteNode(server, session, hierarchicalRefsSize, hierarchicalRefs, node,
                         item->deleteTargetReferences);
@@ -40465,12 +43330,18 @@ deleteNode(UA_Server *server, const UA_NodeId nodeId,
 static UA_StatusCode
 addOneWayReference(UA_Server *server, UA_Session *session,
              UA_Node *node, const UA_AddReferencesItem *item) {
+    if(node->nodeClass == UA_NODECLASS_REFERENCETYPE &&
+       UA_NodeId_equal(&item->referenceTypeId, &subtypeId))
+        invalidateReferenceTypeIndex(server);
     return UA_Node_addReference(node, item);
 }
 
 static UA_StatusCode
 deleteOneWayReference(UA_Server *server, UA_Session *session, UA_Node *node,
                       const UA_DeleteReferencesItem *item) {
+    if(node->nodeClass == UA_NODECLASS_REFERENCETYPE &&
+       UA_NodeId_equal(&item->referenceTypeId, &subtypeId))
+        invalidateReferenceTypeIndex(server);
     return UA_Node_deleteReference(node, item);
 }
 
@@ -63870,7 +66741,7 @@ UA_Subscription_deleteMembers(UA_Server *server, UA_Subscription *sub) {
     UA_NotificationMessageEntry *nme, *nme_tmp;
     TAILQ_FOREACH_SAFE(nme, &sub->retransmissionQueue, listEntry, nme_tmp) {
         TAILQ_REMOVE(&sub->retransmissionQueue, nme, listEntry);
-        UA_NotificationMessage_clear(&nme->message);
+        UA_ByteString_clear(&nme->encoded);
         UA_free(nme);
         --sub->session->totalRetransmissionQueueSize;
         --sub->retransmissionQueueSize;
@@ -63942,7 +66813,7 @@ removeOldestRetransmissionMessage(UA_Session *session) {
             TAILQ_LAST(&sub->retransmissionQueue, ListOfNotificationMessages);
         if(!first)
             continue;
-        if(!oldestEntry || oldestEntry->message.publishTime > first->message.publishTime) {
+        if(!oldestEntry || oldestEntry->publishTime > first->publishTime) {
             oldestEntry = first;
             oldestSub = sub;
         }
@@ -63951,7 +66822,7 @@ removeOldestRetransmissionMessage(UA_Session *session) {
     UA_assert(oldestSub);
 
     TAILQ_REMOVE(&oldestSub->retransmissionQueue, oldestEntry, listEntry);
-    UA_NotificationMessage_clear(&oldestEntry->message);
+    UA_ByteString_clear(&oldestEntry->encoded);
     UA_free(oldestEntry);
     --session->totalRetransmissionQueueSize;
     --oldestSub->retransmissionQueueSize;
@@ -63979,7 +66850,7 @@ UA_Subscription_removeRetransmissionMessage(UA_Subscription *sub, UA_UInt32 sequ
     /* Find the retransmission message */
     UA_NotificationMessageEntry *entry;
     TAILQ_FOREACH(entry, &sub->retransmissionQueue, listEntry) {
-        if(entry->message.sequenceNumber == sequenceNumber)
+        if(entry->sequenceNumber == sequenceNumber)
             break;
     }
     if(!entry)
@@ -63989,11 +66860,115 @@ UA_Subscription_removeRetransmissionMessage(UA_Subscription *sub, UA_UInt32 sequ
     TAILQ_REMOVE(&sub->retransmissionQueue, entry, listEntry);
     --sub->session->totalRetransmissionQueueSize;
     --sub->retransmissionQueueSize;
-    UA_NotificationMessage_clear(&entry->message);
+    UA_ByteString_clear(&entry->encoded);
     UA_free(entry);
     return UA_STATUSCODE_GOOD;
 }
 
+/* Size of the NotificationMessage fields before the content of the
+ * notificationData array: sequenceNumber, publishTime and the array length */
+#define UA_NOTIFICATIONMESSAGE_HEADERSIZE 16
+
+static UA_StatusCode
+encodeNotificationMessageHeader(UA_UInt32 sequenceNumber, UA_DateTime publishTime,
+                                UA_Int32 notificationDataLength,
+                                UA_Byte **bufPos, const UA_Byte *bufEnd) {
+    UA_StatusCode retval =
+        UA_encodeBinary(&sequenceNumber, &UA_TYPES[UA_TYPES_UINT32],
+                        bufPos, &bufEnd, NULL, NULL);
+    retval |= UA_encodeBinary(&publishTime, &UA_TYPES[UA_TYPES_DATETIME],
+                              bufPos, &bufEnd, NULL, NULL);
+    retval |= UA_encodeBinary(&notificationDataLength, &UA_TYPES[UA_TYPES_INT32],
+                              bufPos, &bufEnd, NULL, NULL);
+    return retval;
+}
+
+/* Encode a NotificationMessage with a single DataChangeNotification directly
+ * from the notification queue. The MonitoredItemNotifications are written
+ * into the buffer without assembling a DataChangeNotification first. The
+ * encoded notifications are removed from the queue. */
+static UA_StatusCode
+encodeDataChangeMessage(UA_Server *server, UA_Subscription *sub,
+                        UA_UInt32 sequenceNumber, UA_DateTime publishTime,
+                        size_t notifications, UA_ByteString *encoded) {
+    UA_assert(notifications > 0);
+
+    /* Compute the size of the DataChangeNotification. Start with the length
+     * of the monitoredItems and diagnosticInfos arrays. */
+    size_t bodySize = 8;
+    size_t count = 0;
+    UA_Notification *notification;
+    TAILQ_FOREACH(notification, &sub->notificationQueue, globalEntry) {
+        if(count >= notifications)
+            break;
+        bodySize += 4 + UA_calcSizeBinary(&notification->data.value,
+                                          &UA_TYPES[UA_TYPES_DATAVALUE]);
+        count++;
+    }
+    UA_assert(count > 0);
+    if(bodySize > UA_INT32_MAX)
+        return UA_STATUSCODE_BADENCODINGLIMITSEXCEEDED;
+
+    UA_NodeId typeId =
+        UA_NODEID_NUMERIC(0, UA_TYPES[UA_TYPES_DATACHANGENOTIFICATION].binaryEncodingId);
+    size_t size = UA_NOTIFICATIONMESSAGE_HEADERSIZE +
+        UA_calcSizeBinary(&typeId, &UA_TYPES[UA_TYPES_NODEID]) + 5 + bodySize;
+    UA_StatusCode retval = UA_ByteString_allocBuffer(encoded, size);
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
+
+    /* Encode the ExtensionObject header */
+    UA_Byte *bufPos = encoded->data;
+    const UA_Byte *bufEnd = &encoded->data[size];
+    UA_Byte eoEncoding = UA_EXTENSIONOBJECT_ENCODED_BYTESTRING;
+    UA_Int32 bodyLength = (UA_Int32)bodySize;
+    UA_Int32 itemsLength = (UA_Int32)count;
+    retval = encodeNotificationMessageHeader(sequenceNumber, publishTime, 1,
+                                             &bufPos, bufEnd);
+    retval |= UA_encodeBinary(&typeId, &UA_TYPES[UA_TYPES_NODEID],
+                              &bufPos, &bufEnd, NULL, NULL);
+    retval |= UA_encodeBinary(&eoEncoding, &UA_TYPES[UA_TYPES_BYTE],
+                              &bufPos, &bufEnd, NULL, NULL);
+    retval |= UA_encodeBinary(&bodyLength, &UA_TYPES[UA_TYPES_INT32],
+                              &bufPos, &bufEnd, NULL, NULL);
+
+    /* Encode the MonitoredItemNotifications */
+    retval |= UA_encodeBinary(&itemsLength, &UA_TYPES[UA_TYPES_INT32],
+                              &bufPos, &bufEnd, NULL, NULL);
+    notification = TAILQ_FIRST(&sub->notificationQueue);
+    for(size_t i = 0; i < count; i++) {
+        retval |= UA_encodeBinary(&notification->mon->clientHandle,
+                                  &UA_TYPES[UA_TYPES_UINT32],
+                                  &bufPos, &bufEnd, NULL, NULL);
+        retval |= UA_encodeBinary(&notification->data.value,
+                                  &UA_TYPES[UA_TYPES_DATAVALUE],
+                                  &bufPos, &bufEnd, NULL, NULL);
+        notification = TAILQ_NEXT(notification, globalEntry);
+    }
+
+    /* No diagnosticInfos */
+    UA_Int32 diagnosticsLength = -1;
+    retval |= UA_encodeBinary(&diagnosticsLength, &UA_TYPES[UA_TYPES_INT32],
+                              &bufPos, &bufEnd, NULL, NULL);
+    if(retval != UA_STATUSCODE_GOOD) {
+        UA_ByteString_clear(encoded);
+        return retval;
+    }
+    UA_assert(bufPos == bufEnd);
+
+    /* <-- The point of no return --> */
+
+    /* Remove the encoded notifications */
+    for(size_t i = 0; i < count; i++) {
+        notification = TAILQ_FIRST(&sub->notificationQueue);
+        UA_Notification_dequeue(server, notification);
+        UA_Notification_delete(server, notification);
+    }
+    return UA_STATUSCODE_GOOD;
+}
+
+#ifdef UA_ENABLE_SUBSCRIPTIONS_EVENTS
+
 static UA_StatusCode
 prepareNotificationMessage(UA_Server *server, UA_Subscription *sub,
                            UA_NotificationMessage *message, size_t notifications) {
@@ -64115,7 +67090,7 @@ prepareNotificationMessage(UA_Server *server, UA_Subscription *sub,
             dcnPos++;
         }
 
-        UA_Notification_delete(notification);
+        UA_Notification_delete(server, notification);
         totalNotifications++;
     }
 
@@ -64141,6 +67116,99 @@ prepareNotificationMessage(UA_Server *server, UA_Subscription *sub,
     return UA_STATUSCODE_GOOD;
 }
 
+/* Events and StatusChanges are assembled in a NotificationMessage structure
+ * that is then encoded */
+static UA_StatusCode
+encodeNotificationMessage(UA_Server *server, UA_Subscription *sub,
+                          UA_UInt32 sequenceNumber, UA_DateTime publishTime,
+                          size_t notifications, UA_ByteString *encoded) {
+    UA_NotificationMessage message;
+    UA_NotificationMessage_init(&message);
+    UA_StatusCode retval = prepareNotificationMessage(server, sub, &message, notifications);
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
+    message.sequenceNumber = sequenceNumber;
+    message.publishTime = publishTime;
+
+    size_t size = UA_calcSizeBinary(&message, &UA_TYPES[UA_TYPES_NOTIFICATIONMESSAGE]);
+    retval = UA_ByteString_allocBuffer(encoded, size);
+    if(retval == UA_STATUSCODE_GOOD) {
+        UA_Byte *bufPos = encoded->data;
+        const UA_Byte *bufEnd = &encoded->data[size];
+        retval = UA_encodeBinary(&message, &UA_TYPES[UA_TYPES_NOTIFICATIONMESSAGE],
+                                 &bufPos, &bufEnd, NULL, NULL);
+        if(retval != UA_STATUSCODE_GOOD)
+            UA_ByteString_clear(encoded);
+    }
+    UA_NotificationMessage_clear(&message);
+    return retval;
+}
+
+#endif /* UA_ENABLE_SUBSCRIPTIONS_EVENTS */
+
+static UA_StatusCode
+encodeArrayWithContext(UA_MessageContext *mc, const void *array, size_t arraySize,
+                       const UA_DataType *type) {
+    UA_Int32 signedLength = -1;
+    if(arraySize > 0)
+        signedLength = (UA_Int32)arraySize;
+    else if(array == UA_EMPTY_ARRAY_SENTINEL)
+        signedLength = 0;
+    UA_StatusCode retval =
+        UA_MessageContext_encode(mc, &signedLength, &UA_TYPES[UA_TYPES_INT32]);
+    uintptr_t ptr = (uintptr_t)array;
+    for(size_t i = 0; i < arraySize && retval == UA_STATUSCODE_GOOD; i++) {
+        retval = UA_MessageContext_encode(mc, (const void*)ptr, type);
+        ptr += type->memSize;
+    }
+    return retval;
+}
+
+/* Send the PublishResponse with the already encoded NotificationMessage. The
+ * response fields around the NotificationMessage are encoded one by one. */
+static UA_StatusCode
+sendPublishResponse(UA_SecureChannel *channel, UA_UInt32 requestId,
+                    const UA_PublishResponse *response,
+                    const UA_ByteString *encodedMessage) {
+    if(!channel->connection || channel->connection->state == UA_CONNECTION_CLOSED)
+        return UA_STATUSCODE_BADCONNECTIONCLOSED;
+
+    UA_MessageContext mc;
+    UA_StatusCode retval = UA_MessageContext_begin(&mc, channel, requestId,
+                                                   UA_MESSAGETYPE_MSG);
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
+
+    UA_NodeId typeId =
+        UA_NODEID_NUMERIC(0, UA_TYPES[UA_TYPES_PUBLISHRESPONSE].binaryEncodingId);
+    retval = UA_MessageContext_encode(&mc, &typeId, &UA_TYPES[UA_TYPES_NODEID]);
+    if(retval == UA_STATUSCODE_GOOD)
+        retval = UA_MessageContext_encode(&mc, &response->responseHeader,
+                                          &UA_TYPES[UA_TYPES_RESPONSEHEADER]);
+    if(retval == UA_STATUSCODE_GOOD)
+        retval = UA_MessageContext_encode(&mc, &response->subscriptionId,
+                                          &UA_TYPES[UA_TYPES_UINT32]);
+    if(retval == UA_STATUSCODE_GOOD)
+        retval = encodeArrayWithContext(&mc, response->availableSequenceNumbers,
+                                        response->availableSequenceNumbersSize,
+                                        &UA_TYPES[UA_TYPES_UINT32]);
+    if(retval == UA_STATUSCODE_GOOD)
+        retval = UA_MessageContext_encode(&mc, &response->moreNotifications,
+                                          &UA_TYPES[UA_TYPES_BOOLEAN]);
+    if(retval == UA_STATUSCODE_GOOD)
+        retval = UA_MessageContext_encodeRaw(&mc, encodedMessage);
+    if(retval == UA_STATUSCODE_GOOD)
+        retval = encodeArrayWithContext(&mc, response->results, response->resultsSize,
+                                        &UA_TYPES[UA_TYPES_STATUSCODE]);
+    if(retval == UA_STATUSCODE_GOOD)
+        retval = encodeArrayWithContext(&mc, response->diagnosticInfos,
+                                        response->diagnosticInfosSize,
+                                        &UA_TYPES[UA_TYPES_DIAGNOSTICINFO]);
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval; /* The context was cleaned up internally */
+    return UA_MessageContext_finish(&mc);
+}
+
 /* According to OPC Unified Architecture, Part 4 5.13.1.1 i) The value 0 is
  * never used for the sequence number */
 static UA_UInt32
@@ -64227,7 +67295,9 @@ UA_Subscription_publish(UA_Server *server, UA_Subscription *sub) {
 
     /* Prepare the response */
     UA_PublishResponse *response = &pre->response;
-    UA_NotificationMessage *message = &response->notificationMessage;
+    UA_DateTime publishTime = UA_DateTime_now();
+    UA_ByteString encodedMessage = UA_BYTESTRING_NULL;
+    UA_Byte keepAliveMessage[UA_NOTIFICATIONMESSAGE_HEADERSIZE];
     UA_NotificationMessageEntry *retransmission = NULL;
     if(notifications > 0) {
         if(server->config.enableRetransmissionQueue) {
@@ -64243,8 +67313,18 @@ UA_Subscription_publish(UA_Server *server, UA_Subscription *sub) {
             }
         }
 
-        /* Prepare the response */
-        UA_StatusCode retval = prepareNotificationMessage(server, sub, message, notifications);
+        /* Encode the NotificationMessage */
+        UA_StatusCode retval;
+#ifdef UA_ENABLE_SUBSCRIPTIONS_EVENTS
+        if(sub->eventNotifications > 0 || sub->statusChangeNotifications > 0)
+            retval = encodeNotificationMessage(server, sub, sub->nextSequenceNumber,
+                                               publishTime, notifications,
+                                               &encodedMessage);
+        else
+#endif
+            retval = encodeDataChangeMessage(server, sub, sub->nextSequenceNumber,
+                                             publishTime, notifications,
+                                             &encodedMessage);
         if(retval != UA_STATUSCODE_GOOD) {
             UA_LOG_WARNING_SESSION(&server->config.logger, sub->session,
                                    "Subscription %u | Could not prepare the notification message. "
@@ -64256,6 +67336,16 @@ UA_Subscription_publish(UA_Server *server, UA_Subscription *sub) {
             UA_Session_queuePublishReq(sub->session, pre, true); /* Re-enqueue */
             return;
         }
+    } else {
+        /* A keepalive without notificationData */
+        encodedMessage.data = keepAliveMessage;
+        encodedMessage.length = UA_NOTIFICATIONMESSAGE_HEADERSIZE;
+        UA_Byte *bufPos = keepAliveMessage;
+        UA_StatusCode retval =
+            encodeNotificationMessageHeader(sub->nextSequenceNumber, publishTime, -1,
+                                            &bufPos, &keepAliveMessage[UA_NOTIFICATIONMESSAGE_HEADERSIZE]);
+        UA_assert(retval == UA_STATUSCODE_GOOD);
+        (void)retval;
     }
 
     /* <-- The point of no return --> */
@@ -64264,16 +67354,13 @@ UA_Subscription_publish(UA_Server *server, UA_Subscription *sub) {
     UA_assert(sub->readyNotifications >= notifications);
     sub->readyNotifications -= notifications;
 
-    /* Set up the response */
-    response->responseHeader.timestamp = UA_DateTime_now();
+    /* Set up the response. The sequence number of the message was set during
+     * encoding. It starts at 1 which is given during creating a new
+     * subscription. The 1 is required for initial publish response with or
+     * without an monitored item. */
+    response->responseHeader.timestamp = publishTime;
     response->subscriptionId = sub->subscriptionId;
     response->moreNotifications = moreNotifications;
-    message->publishTime = response->responseHeader.timestamp;
-
-    /* Set sequence number to message. Started at 1 which is given
-     * during creating a new subscription. The 1 is required for
-     * initial publish response with or without an monitored item. */
-    message->sequenceNumber = sub->nextSequenceNumber;
 
     if(notifications > 0) {
         /* If the retransmission queue is enabled a retransmission message is allocated */
@@ -64281,7 +67368,9 @@ UA_Subscription_publish(UA_Server *server, UA_Subscription *sub) {
             /* Put the notification message into the retransmission queue. This
              * needs to be done here, so that the message itself is included in the
              * available sequence numbers for acknowledgement. */
-            retransmission->message = response->notificationMessage;
+            retransmission->sequenceNumber = sub->nextSequenceNumber;
+            retransmission->publishTime = publishTime;
+            retransmission->encoded = encodedMessage;
             UA_Subscription_addRetransmissionMessage(server, sub, retransmission);
         }
         /* Only if a notification was created, the sequence number must be increased.
@@ -64298,7 +67387,7 @@ UA_Subscription_publish(UA_Server *server, UA_Subscription *sub) {
         size_t i = 0;
         UA_NotificationMessageEntry *nme;
         TAILQ_FOREACH(nme, &sub->retransmissionQueue, listEntry) {
-            response->availableSequenceNumbers[i] = nme->message.sequenceNumber;
+            response->availableSequenceNumbers[i] = nme->sequenceNumber;
             ++i;
         }
     }
@@ -64308,15 +67397,16 @@ UA_Subscription_publish(UA_Server *server, UA_Subscription *sub) {
                          "Subscription %u | Sending out a publish response "
                          "with %u notifications", sub->subscriptionId,
                          (UA_UInt32)notifications);
-    UA_SecureChannel_sendSymmetricMessage(sub->session->header.channel, pre->requestId,
-                                          UA_MESSAGETYPE_MSG, response,
-                                          &UA_TYPES[UA_TYPES_PUBLISHRESPONSE]);
+    sendPublishResponse(channel, pre->requestId, response, &encodedMessage);
 
     /* Reset subscription state to normal */
     sub->state = UA_SUBSCRIPTIONSTATE_NORMAL;
     sub->currentKeepAliveCount = 0;
 
-    /* Free the response */
+    /* Free the response. The encoded message is owned by the retransmission
+     * queue if it is enabled. */
+    if(notifications > 0 && !retransmission)
+        UA_ByteString_clear(&encodedMessage);
     UA_Array_delete(response->results, response->resultsSize, &UA_TYPES[UA_TYPES_UINT32]);
     UA_free(pre); /* No need for UA_PublishResponse_clear */
 
@@ -64482,8 +67572,7 @@ createEventOverflowNotification(UA_Server *server, UA_Subscription *sub,
      * possible overflows. */
 
     /* Allocate the notification */
-    UA_Notification *overflowNotification = (UA_Notification *)
-        UA_malloc(sizeof(UA_Notification));
+    UA_Notification *overflowNotification = UA_Notification_new(server);
     if(!overflowNotification)
         return UA_STATUSCODE_BADOUTOFMEMORY;;
 
@@ -64492,7 +67581,7 @@ createEventOverflowNotification(UA_Server *server, UA_Subscription *sub,
     UA_EventFieldList_init(&overflowNotification->data.event.fields);
     overflowNotification->data.event.fields.eventFields = UA_Variant_new();
     if(!overflowNotification->data.event.fields.eventFields) {
-        UA_free(overflowNotification);
+        UA_Notification_delete(server, overflowNotification);
         return UA_STATUSCODE_BADOUTOFMEMORY;;
     }
     overflowNotification->data.event.fields.eventFieldsSize = 1;
@@ -64500,8 +67589,7 @@ createEventOverflowNotification(UA_Server *server, UA_Subscription *sub,
         UA_Variant_setScalarCopy(overflowNotification->data.event.fields.eventFields,
                                  &simpleOverflowEventType, &UA_TYPES[UA_TYPES_NODEID]);
     if(retval != UA_STATUSCODE_GOOD) {
-        UA_EventFieldList_clear(&overflowNotification->data.event.fields);
-        UA_free(overflowNotification);
+        UA_Notification_delete(server, overflowNotification);
         return retval;
     }
 
@@ -64598,8 +67686,62 @@ UA_Notification_dequeue(UA_Server *server, UA_Notification *n) {
     }
 }
 
+UA_Notification *
+UA_Notification_new(UA_Server *server) {
+    UA_NotificationPool *pool = &server->notificationPool;
+    if(!pool->freeList) {
+        /* The pool has reached its size limit */
+        if(server->config.maxNotifications != 0 &&
+           pool->size >= server->config.maxNotifications)
+            return NULL;
+
+        /* Add a slab to the pool */
+        pool->poolExhausted++;
+        UA_NotificationSlab *slab = (UA_NotificationSlab*)
+            UA_malloc(sizeof(UA_NotificationSlab));
+        if(!slab)
+            return NULL;
+        slab->next = pool->slabs;
+        pool->slabs = slab;
+        for(size_t i = 0; i < UA_NOTIFICATION_SLABSIZE; i++) {
+            TAILQ_NEXT(&slab->notifications[i], listEntry) = pool->freeList;
+            pool->freeList = &slab->notifications[i];
+        }
+        pool->size += UA_NOTIFICATION_SLABSIZE;
+        pool->freeCount += UA_NOTIFICATION_SLABSIZE;
+    }
+
+    UA_Notification *n = pool->freeList;
+    pool->freeList = TAILQ_NEXT(n, listEntry);
+    pool->freeCount--;
+    return n;
+}
+
 void
-UA_Notification_delete(UA_Notification *n) {
+UA_NotificationPool_clear(UA_NotificationPool *pool) {
+    UA_NotificationSlab *slab = pool->slabs;
+    while(slab) {
+        UA_NotificationSlab *next = slab->next;
+        UA_free(slab);
+        slab = next;
+    }
+    memset(pool, 0, sizeof(UA_NotificationPool));
+}
+
+void
+UA_Server_getNotificationStatistics(UA_Server *server,
+                                    UA_NotificationStatistics *stats) {
+    UA_LOCK(server->serviceMutex);
+    const UA_NotificationPool *pool = &server->notificationPool;
+    stats->poolSize = pool->size;
+    stats->poolFree = pool->freeCount;
+    stats->poolExhausted = pool->poolExhausted;
+    stats->queueOverflows = pool->queueOverflows;
+    UA_UNLOCK(server->serviceMutex);
+}
+
+void
+UA_Notification_delete(UA_Server *server, UA_Notification *n) {
 #ifdef UA_ENABLE_SUBSCRIPTIONS_EVENTS
     UA_MonitoredItem *mon = n->mon;
     if(mon->attributeId == UA_ATTRIBUTEID_EVENTNOTIFIER) {
@@ -64611,7 +67753,11 @@ UA_Notification_delete(UA_Notification *n) {
     {
         UA_DataValue_clear(&n->data.value);
     }
-    UA_free(n);
+
+    UA_NotificationPool *pool = &server->notificationPool;
+    TAILQ_NEXT(n, listEntry) = pool->freeList;
+    pool->freeList = n;
+    pool->freeCount++;
 }
 
 /*****************/
@@ -64640,7 +67786,7 @@ UA_MonitoredItem_delete(UA_Server *server, UA_MonitoredItem *monitoredItem) {
                            listEntry, notification_tmp) {
             /* Remove the item from the queues and free the memory */
             UA_Notification_dequeue(server, notification);
-            UA_Notification_delete(notification);
+            UA_Notification_delete(server, notification);
         }
     }
 
@@ -64751,7 +67897,8 @@ UA_MonitoredItem_ensureQueueSpace(UA_Server *server, UA_MonitoredItem *mon) {
 
         /* Delete the notification */
         UA_Notification_dequeue(server, del);
-        UA_Notification_delete(del);
+        UA_Notification_delete(server, del);
+        server->notificationPool.queueOverflows++;
     }
 
     /* Get the element where the overflow shall be announced (infobits or
@@ -64781,6 +67928,155 @@ UA_MonitoredItem_ensureQueueSpace(UA_Server *server, UA_MonitoredItem *mon) {
     return UA_STATUSCODE_GOOD;
 }
 
+UA_Notification *
+UA_MonitoredItem_recycleNotification(UA_Server *server, UA_MonitoredItem *mon) {
+    UA_assert(mon->attributeId != UA_ATTRIBUTEID_EVENTNOTIFIER);
+    if(mon->queueSize == 0)
+        return NULL;
+
+    /* Select the notification to discard. The new notification is appended
+     * and replaces the newest one if the newest shall be discarded. */
+    UA_Notification *del;
+    if(mon->discardOldest) {
+        del = TAILQ_FIRST(&mon->queue);
+        /* Keep the position in the global queue for the MonitoredItem (see
+         * UA_MonitoredItem_ensureQueueSpace) */
+        UA_Notification *after_del = TAILQ_NEXT(del, listEntry);
+        if(after_del && TAILQ_NEXT(del, globalEntry) != UA_SUBSCRIPTION_QUEUE_SENTINEL) {
+            UA_Subscription *sub = mon->subscription;
+            TAILQ_REMOVE(&sub->notificationQueue, after_del, globalEntry);
+            TAILQ_INSERT_AFTER(&sub->notificationQueue, del, after_del, globalEntry);
+        }
+    } else {
+        del = TAILQ_LAST(&mon->queue, NotificationQueue);
+    }
+
+    UA_Notification_dequeue(server, del);
+    UA_Notification_delete(server, del);
+    server->notificationPool.queueOverflows++;
+
+    /* Set the infobits on the new oldest entry. For the discarded newest
+     * entry, the caller sets them on the new notification. */
+    UA_Notification *indicator = TAILQ_FIRST(&mon->queue);
+    if(mon->discardOldest && indicator && mon->maxQueueSize > 1) {
+        indicator->data.value.hasStatus = true;
+        indicator->data.value.status |=
+            (UA_STATUSCODE_INFOTYPE_DATAVALUE | UA_STATUSCODE_INFOBITS_OVERFLOW);
+    }
+
+    return UA_Notification_new(server);
+}
+
+/*******************/
+/* Sampling Groups */
+/*******************/
+
+static void
+UA_SamplingGroup_delete(UA_Server *server, UA_SamplingGroup *sg) {
+    removeCallback(server, sg->callbackId);
+    LIST_REMOVE(sg, listEntry);
+    UA_free(sg->items);
+    UA_free(sg);
+}
+
+/* Remove the NULL entries of MonitoredItems removed during processing */
+static void
+UA_SamplingGroup_compact(UA_SamplingGroup *sg) {
+    size_t j = 0;
+    size_t sortedSize = 0;
+    for(size_t i = 0; i < sg->itemsSize; i++) {
+        if(!sg->items[i])
+            continue;
+        if(i < sg->sortedSize)
+            sortedSize++;
+        sg->items[j++] = sg->items[i];
+    }
+    sg->itemsSize = j;
+    sg->sortedSize = sortedSize;
+}
+
+static int
+cmpSampledItem(const void *a, const void *b) {
+    const UA_MonitoredItem *monA = *(UA_MonitoredItem* const*)a;
+    const UA_MonitoredItem *monB = *(UA_MonitoredItem* const*)b;
+    return (int)UA_NodeId_order(&monA->monitoredNodeId, &monB->monitoredNodeId);
+}
+
+/* Sort the appended MonitoredItems and merge them into the sorted items. The
+ * merge runs from the back, so only the appended items are buffered. */
+static void
+UA_SamplingGroup_sort(UA_SamplingGroup *sg) {
+    size_t sortedSize = sg->sortedSize;
+    size_t newSize = sg->itemsSize - sortedSize;
+    qsort(&sg->items[sortedSize], newSize, sizeof(UA_MonitoredItem*), cmpSampledItem);
+    if(sortedSize > 0 && newSize > 0 &&
+       cmpSampledItem(&sg->items[sortedSize - 1], &sg->items[sortedSize]) > 0) {
+        UA_MonitoredItem **newItems = (UA_MonitoredItem**)
+            UA_malloc(newSize * sizeof(UA_MonitoredItem*));
+        if(!newItems) {
+            /* Sort everything in place */
+            qsort(sg->items, sg->itemsSize, sizeof(UA_MonitoredItem*), cmpSampledItem);
+            sg->sortedSize = sg->itemsSize;
+            return;
+        }
+        memcpy(newItems, &sg->items[sortedSize], newSize * sizeof(UA_MonitoredItem*));
+        size_t i = sortedSize, j = newSize, k = sg->itemsSize;
+        while(j > 0) {
+            if(i > 0 && cmpSampledItem(&sg->items[i - 1], &newItems[j - 1]) > 0)
+                sg->items[--k] = sg->items[--i];
+            else
+                sg->items[--k] = newItems[--j];
+        }
+        UA_free(newItems);
+    }
+    sg->sortedSize = sg->itemsSize;
+}
+
+/* Sample all MonitoredItems of the group. Consecutive MonitoredItems on the
+ * same node reuse the node pointer. */
+static void
+UA_SamplingGroup_callback(UA_Server *server, UA_SamplingGroup *sg) {
+    UA_LOCK(server->serviceMutex);
+    if(sg->sortedSize < sg->itemsSize)
+        UA_SamplingGroup_sort(sg);
+
+    /* The local MonitoredItem callbacks can add and remove MonitoredItems.
+     * Don't use a cached items pointer. MonitoredItems appended during the
+     * processing are sampled from the next tick on. So a MonitoredItem that
+     * is removed and added again is sampled only once. */
+    sg->processing = true;
+    size_t itemsSize = sg->itemsSize;
+    const UA_Node *node = NULL;
+    for(size_t i = 0; i < itemsSize; i++) {
+        UA_MonitoredItem *mon = sg->items[i];
+        if(!mon)
+            continue;
+        if(!node || !UA_NodeId_equal(&node->nodeId, &mon->monitoredNodeId)) {
+            if(node)
+                UA_NODESTORE_RELEASE(server, node);
+            node = UA_NODESTORE_GET(server, &mon->monitoredNodeId);
+        }
+        UA_Boolean local = (mon->subscription == NULL);
+        monitoredItem_sampleCallbackWithNode(server, mon, node);
+
+        /* The callback of a local MonitoredItem runs without the lock. The
+         * node may have been replaced in the meantime. Get it again. */
+        if(local && node) {
+            UA_NODESTORE_RELEASE(server, node);
+            node = NULL;
+        }
+    }
+    if(node)
+        UA_NODESTORE_RELEASE(server, node);
+    sg->processing = false;
+
+    /* Clean up after MonitoredItems were removed */
+    UA_SamplingGroup_compact(sg);
+    if(sg->itemsSize == 0)
+        UA_SamplingGroup_delete(server, sg);
+    UA_UNLOCK(server->serviceMutex);
+}
+
 UA_StatusCode
 UA_MonitoredItem_registerSampleCallback(UA_Server *server, UA_MonitoredItem *mon) {
     UA_LOCK_ASSERT(server->serviceMutex, 1);
@@ -64791,12 +68087,48 @@ UA_MonitoredItem_registerSampleCallback(UA_Server *server, UA_MonitoredItem *mon
     if(mon->attributeId == UA_ATTRIBUTEID_EVENTNOTIFIER)
         return UA_STATUSCODE_GOOD;
 
-    UA_StatusCode retval =
-        addRepeatedCallback(server, (UA_ServerCallback)UA_MonitoredItem_sampleCallback,
-                            mon, mon->samplingInterval, &mon->sampleCallbackId);
-    if(retval == UA_STATUSCODE_GOOD)
-        mon->sampleCallbackIsRegistered = true;
-    return retval;
+    /* Find the SamplingGroup for the interval */
+    UA_SamplingGroup *sg;
+    LIST_FOREACH(sg, &server->samplingGroups, listEntry) {
+        if(sg->samplingInterval == mon->samplingInterval)
+            break;
+    }
+
+    /* Create a new SamplingGroup */
+    if(!sg) {
+        sg = (UA_SamplingGroup*)UA_calloc(1, sizeof(UA_SamplingGroup));
+        if(!sg)
+            return UA_STATUSCODE_BADOUTOFMEMORY;
+        sg->samplingInterval = mon->samplingInterval;
+        UA_StatusCode retval =
+            addRepeatedCallback(server, (UA_ServerCallback)UA_SamplingGroup_callback,
+                                sg, sg->samplingInterval, &sg->callbackId);
+        if(retval != UA_STATUSCODE_GOOD) {
+            UA_free(sg);
+            return retval;
+        }
+        LIST_INSERT_HEAD(&server->samplingGroups, sg, listEntry);
+    }
+
+    /* Append the MonitoredItem */
+    if(sg->itemsSize == sg->itemsCapacity) {
+        size_t newCapacity = (sg->itemsCapacity > 0) ? sg->itemsCapacity * 2 : 8;
+        UA_MonitoredItem **newItems = (UA_MonitoredItem**)
+            UA_realloc(sg->items, newCapacity * sizeof(UA_MonitoredItem*));
+        if(!newItems) {
+            if(sg->itemsSize == 0 && !sg->processing)
+                UA_SamplingGroup_delete(server, sg);
+            return UA_STATUSCODE_BADOUTOFMEMORY;
+        }
+        sg->items = newItems;
+        sg->itemsCapacity = newCapacity;
+    }
+    sg->items[sg->itemsSize] = mon;
+    sg->itemsSize++;
+
+    mon->samplingGroup = sg;
+    mon->sampleCallbackIsRegistered = true;
+    return UA_STATUSCODE_GOOD;
 }
 
 void
@@ -64804,8 +68136,28 @@ UA_MonitoredItem_unregisterSampleCallback(UA_Server *server, UA_MonitoredItem *m
     UA_LOCK_ASSERT(server->serviceMutex, 1);
     if(!mon->sampleCallbackIsRegistered)
         return;
-    removeCallback(server, mon->sampleCallbackId);
     mon->sampleCallbackIsRegistered = false;
+
+    UA_SamplingGroup *sg = mon->samplingGroup;
+    mon->samplingGroup = NULL;
+    for(size_t i = 0; i < sg->itemsSize; i++) {
+        if(sg->items[i] != mon)
+            continue;
+        /* The group is currently processed. Compact afterwards. */
+        if(sg->processing) {
+            sg->items[i] = NULL;
+            return;
+        }
+        memmove(&sg->items[i], &sg->items[i+1],
+                (sg->itemsSize - i - 1) * sizeof(UA_MonitoredItem*));
+        sg->itemsSize--;
+        if(i < sg->sortedSize)
+            sg->sortedSize--;
+        break;
+    }
+
+    if(sg->itemsSize == 0)
+        UA_SamplingGroup_delete(server, sg);
 }
 
 #endif /* UA_ENABLE_SUBSCRIPTIONS */
@@ -64828,40 +68180,65 @@ UA_MonitoredItem_unregisterSampleCallback(UA_Server *server, UA_MonitoredItem *m
 
 #define UA_VALUENCODING_MAXSTACK 512
 
-/* Convert to double first. We might loose differences for large Int64 that
- * cannot be precisely expressed as double. */
+/* Deadband kernels for the numeric types. The loops accumulate without an
+ * early exit so that the compiler can vectorize them. Convert to double first.
+ * We might loose differences for large Int64 that cannot be precisely
+ * expressed as double. */
+#define UA_DEADBAND_KERNEL(NAME, TYPE)                                  \
+    static UA_Boolean                                                   \
+    outOfDeadBand_##NAME(const void *data1, const void *data2,          \
+                         size_t length, const UA_Double deadband) {     \
+        const TYPE *a = (const TYPE*)data1;                             \
+        const TYPE *b = (const TYPE*)data2;                             \
+        int out = 0;                                                    \
+        for(size_t i = 0; i < length; ++i) {                            \
+            UA_Double v = (UA_Double)a[i] - (UA_Double)b[i];            \
+            out |= (v > deadband) | (v < -deadband);                    \
+        }                                                               \
+        return (out != 0);                                              \
+    }
+
+UA_DEADBAND_KERNEL(Boolean, UA_Boolean)
+UA_DEADBAND_KERNEL(SByte, UA_SByte)
+UA_DEADBAND_KERNEL(Byte, UA_Byte)
+UA_DEADBAND_KERNEL(Int16, UA_Int16)
+UA_DEADBAND_KERNEL(UInt16, UA_UInt16)
+UA_DEADBAND_KERNEL(Int32, UA_Int32)
+UA_DEADBAND_KERNEL(UInt32, UA_UInt32)
+UA_DEADBAND_KERNEL(Int64, UA_Int64)
+UA_DEADBAND_KERNEL(UInt64, UA_UInt64)
+UA_DEADBAND_KERNEL(Float, UA_Float)
+UA_DEADBAND_KERNEL(Double, UA_Double)
+
 static UA_Boolean
-outOfDeadBand(const void *data1, const void *data2,
+outOfDeadBand(const void *data1, const void *data2, size_t length,
               const UA_DataType *type, const UA_Double deadband) {
-    UA_Double v;
-    if(type == &UA_TYPES[UA_TYPES_BOOLEAN]) {
-        v = (UA_Double)*(const UA_Boolean*)data1 - (UA_Double)*(const UA_Boolean*)data2;
-    } else if(type == &UA_TYPES[UA_TYPES_SBYTE]) {
-        v = (UA_Double)*(const UA_SByte*)data1 - (UA_Double)*(const UA_SByte*)data2;
-    } else if(type == &UA_TYPES[UA_TYPES_BYTE]) {
-        v = (UA_Double)*(const UA_Byte*)data1 - (UA_Double)*(const UA_Byte*)data2;
-    } else if(type == &UA_TYPES[UA_TYPES_INT16]) {
-        v = (UA_Double)*(const UA_Int16*)data1 - (UA_Double)*(const UA_Int16*)data2;
-    } else if(type == &UA_TYPES[UA_TYPES_UINT16]) {
-        v = (UA_Double)*(const UA_UInt16*)data1 - (UA_Double)*(const UA_UInt16*)data2;
-    } else if(type == &UA_TYPES[UA_TYPES_INT32]) {
-        v = (UA_Double)*(const UA_Int32*)data1 - (UA_Double)*(const UA_Int32*)data2;
-    } else if(type == &UA_TYPES[UA_TYPES_UINT32]) {
-        v = (UA_Double)*(const UA_UInt32*)data1 - (UA_Double)*(const UA_UInt32*)data2;
-    } else if(type == &UA_TYPES[UA_TYPES_INT64]) {
-        v = (UA_Double)*(const UA_Int64*)data1 - (UA_Double)*(const UA_Int64*)data2;
-    } else if(type == &UA_TYPES[UA_TYPES_UINT64]) {
-        v = (UA_Double)*(const UA_UInt64*)data1 - (UA_Double)*(const UA_UInt64*)data2;
-    } else if(type == &UA_TYPES[UA_TYPES_FLOAT]) {
-        v = (UA_Double)*(const UA_Float*)data1 - (UA_Double)*(const UA_Float*)data2;
-    } else if(type == &UA_TYPES[UA_TYPES_DOUBLE]) {
-        v = (UA_Double)*(const UA_Double*)data1 - (UA_Double)*(const UA_Double*)data2;
-    } else {
+    switch(type->typeKind) {
+    case UA_DATATYPEKIND_BOOLEAN:
+        return outOfDeadBand_Boolean(data1, data2, length, deadband);
+    case UA_DATATYPEKIND_SBYTE:
+        return outOfDeadBand_SByte(data1, data2, length, deadband);
+    case UA_DATATYPEKIND_BYTE:
+        return outOfDeadBand_Byte(data1, data2, length, deadband);
+    case UA_DATATYPEKIND_INT16:
+        return outOfDeadBand_Int16(data1, data2, length, deadband);
+    case UA_DATATYPEKIND_UINT16:
+        return outOfDeadBand_UInt16(data1, data2, length, deadband);
+    case UA_DATATYPEKIND_INT32:
+        return outOfDeadBand_Int32(data1, data2, length, deadband);
+    case UA_DATATYPEKIND_UINT32:
+        return outOfDeadBand_UInt32(data1, data2, length, deadband);
+    case UA_DATATYPEKIND_INT64:
+        return outOfDeadBand_Int64(data1, data2, length, deadband);
+    case UA_DATATYPEKIND_UINT64:
+        return outOfDeadBand_UInt64(data1, data2, length, deadband);
+    case UA_DATATYPEKIND_FLOAT:
+        return outOfDeadBand_Float(data1, data2, length, deadband);
+    case UA_DATATYPEKIND_DOUBLE:
+        return outOfDeadBand_Double(data1, data2, length, deadband);
+    default:
         return false;
     }
-    if(v < 0.0)
-        v = -v;
-    return (v > deadband);
 }
 
 static UA_Boolean
@@ -64876,14 +68253,86 @@ updateNeededForFilteredValue(const UA_Variant *value, const UA_Variant *oldValue
     size_t length = 1;
     if(!UA_Variant_isScalar(value))
         length = value->arrayLength;
-    uintptr_t data = (uintptr_t)value->data;
-    for(size_t i = 0; i < length; ++i) {
-        if(outOfDeadBand((const void*)data, oldValue->data, value->type, deadbandValue))
-            return true;
-        data += value->type->memSize;
+    return outOfDeadBand(value->data, oldValue->data, length,
+                         value->type, deadbandValue);
+}
+
+/* Values of fixed-size types without ArrayDimensions are compared in their
+ * memory representation instead of the binary encoding. */
+static UA_Boolean
+isFixedSizeSample(const UA_DataValue *value) {
+    if(!value->hasValue)
+        return true;
+    const UA_Variant *v = &value->value;
+    if(!v->type || v->arrayDimensionsSize > 0)
+        return false;
+    if(!UA_Variant_isScalar(v) && v->arrayLength == 0)
+        return false;
+    return (v->type->overlayable || v->type == &UA_TYPES[UA_TYPES_BOOLEAN]);
+}
+
+static size_t
+fixedSizeSampleLength(const UA_DataValue *value) {
+    if(!value->hasValue)
+        return 0;
+    size_t length = 1;
+    if(!UA_Variant_isScalar(&value->value))
+        length = value->value.arrayLength;
+    return length * value->value.type->memSize;
+}
+
+static UA_Boolean
+fixedSizeSampleChanged(const UA_MonitoredItem *mon, const UA_DataValue *value) {
+    const UA_SampledValueHeader *last = &mon->lastSampledHeader;
+    if(!last->valid ||
+       last->hasValue != value->hasValue ||
+       last->hasStatus != value->hasStatus ||
+       last->hasSourceTimestamp != value->hasSourceTimestamp ||
+       last->hasSourcePicoseconds != value->hasSourcePicoseconds)
+        return true;
+    if(value->hasStatus && last->status != value->status)
+        return true;
+    if(value->hasSourceTimestamp && last->sourceTimestamp != value->sourceTimestamp)
+        return true;
+    if(value->hasSourcePicoseconds &&
+       last->sourcePicoseconds != value->sourcePicoseconds)
+        return true;
+    if(!value->hasValue)
+        return false;
+    size_t length = fixedSizeSampleLength(value);
+    return (last->type != value->value.type ||
+            last->arrayLength != value->value.arrayLength ||
+            mon->lastSampledValue.length != length ||
+            memcmp(mon->lastSampledValue.data, value->value.data, length) != 0);
+}
+
+/* Store the sample in lastSampledValue. The buffer is reused if the length
+ * matches. If this fails, the next sample is detected as a change. */
+static void
+storeFixedSizeSample(UA_MonitoredItem *mon, const UA_DataValue *value) {
+    UA_SampledValueHeader *last = &mon->lastSampledHeader;
+    size_t length = fixedSizeSampleLength(value);
+    if(mon->lastSampledValue.length != length) {
+        UA_ByteString_clear(&mon->lastSampledValue);
+        if(length > 0 &&
+           UA_ByteString_allocBuffer(&mon->lastSampledValue, length) != UA_STATUSCODE_GOOD) {
+            last->valid = false;
+            return;
+        }
     }
+    if(length > 0)
+        memcpy(mon->lastSampledValue.data, value->value.data, length);
 
-    return false;
+    last->valid = true;
+    last->hasValue = value->hasValue;
+    last->hasStatus = value->hasStatus;
+    last->hasSourceTimestamp = value->hasSourceTimestamp;
+    last->hasSourcePicoseconds = value->hasSourcePicoseconds;
+    last->status = value->status;
+    last->sourceTimestamp = value->sourceTimestamp;
+    last->sourcePicoseconds = value->sourcePicoseconds;
+    last->type = value->value.type;
+    last->arrayLength = value->value.arrayLength;
 }
 
 /* When a change is detected, encoding contains the heap-allocated binary
@@ -64891,18 +68340,38 @@ updateNeededForFilteredValue(const UA_Variant *value, const UA_Variant *oldValue
 static UA_StatusCode
 detectValueChangeWithFilter(UA_Server *server, UA_Session *session, UA_MonitoredItem *mon,
                             UA_DataValue *value, UA_ByteString *encoding, UA_Boolean *changed) {
+    UA_Boolean fixedSize = isFixedSizeSample(value);
+
     /* Check for absolute deadband */
     if(UA_DataType_isNumeric(value->value.type) &&
        mon->filter.dataChangeFilter.deadbandType == UA_DEADBANDTYPE_ABSOLUTE) {
         UA_assert(value->value.type);
         if(mon->filter.dataChangeFilter.trigger == UA_DATACHANGETRIGGER_STATUSVALUE ||
            mon->filter.dataChangeFilter.trigger == UA_DATACHANGETRIGGER_STATUSVALUETIMESTAMP) {
-            if(!updateNeededForFilteredValue(&value->value, &mon->lastValue,
+            /* Fixed-size samples are compared with lastSampledValue */
+            const UA_Variant *lastValue = &mon->lastValue;
+            UA_Variant lastFixedSize;
+            if(fixedSize) {
+                UA_Variant_init(&lastFixedSize);
+                if(mon->lastSampledHeader.valid && mon->lastSampledHeader.hasValue) {
+                    lastFixedSize.type = mon->lastSampledHeader.type;
+                    lastFixedSize.arrayLength = mon->lastSampledHeader.arrayLength;
+                    lastFixedSize.data = mon->lastSampledValue.data;
+                }
+                lastValue = &lastFixedSize;
+            }
+            if(!updateNeededForFilteredValue(&value->value, lastValue,
                                              mon->filter.dataChangeFilter.deadbandValue))
                 return UA_STATUSCODE_GOOD;
         }
     }
 
+    /* Compare fixed-size samples in place. No encoding is required. */
+    if(fixedSize) {
+        *changed = fixedSizeSampleChanged(mon, value);
+        return UA_STATUSCODE_GOOD;
+    }
+
     /* Stack-allocate some memory for the value encoding. We might heap-allocate
      * more memory if needed. This is just enough for scalars and small
      * structures. */
@@ -64937,9 +68406,11 @@ detectValueChangeWithFilter(UA_Server *server, UA_Session *session, UA_Monitored
         return retval;
     }
 
-    /* Has the value changed? */
+    /* Has the value changed? If the last sample was fixed-size,
+     * lastSampledValue holds its memory representation and cannot be compared
+     * with the encoding. */
     valueEncoding.length = (uintptr_t)bufPos - (uintptr_t)valueEncoding.data;
-    *changed = (!mon->lastSampledValue.data ||
+    *changed = (mon->lastSampledHeader.valid || !mon->lastSampledValue.data ||
                 !UA_String_equal(&valueEncoding, &mon->lastSampledValue));
 
     /* No change */
@@ -64958,25 +68429,26 @@ detectValueChangeWithFilter(UA_Server *server, UA_Session *session, UA_Monitored
 }
 
 /* Has this sample changed from the last one? The method may allocate additional
- * space for the encoding buffer. Detect the change in encoding->data. */
+ * space for the encoding buffer. Detect the change in encoding->data. The
+ * filter is applied to the value, so it should be a shallow copy. */
 static UA_StatusCode
     detectValueChange(UA_Server *server, UA_Session *session, UA_MonitoredItem *mon,
-                  UA_DataValue value, UA_ByteString *encoding, UA_Boolean *changed) {
+                  UA_DataValue *value, UA_ByteString *encoding, UA_Boolean *changed) {
     UA_LOCK_ASSERT(server->serviceMutex, 1);
 
     /* Apply Filter */
     if(mon->filter.dataChangeFilter.trigger == UA_DATACHANGETRIGGER_STATUS)
-        value.hasValue = false;
+        value->hasValue = false;
 
-    value.hasServerTimestamp = false;
-    value.hasServerPicoseconds = false;
+    value->hasServerTimestamp = false;
+    value->hasServerPicoseconds = false;
     if(mon->filter.dataChangeFilter.trigger < UA_DATACHANGETRIGGER_STATUSVALUETIMESTAMP) {
-        value.hasSourceTimestamp = false;
-        value.hasSourcePicoseconds = false;
+        value->hasSourceTimestamp = false;
+        value->hasSourcePicoseconds = false;
     }
 
     /* Detect the value change */
-    return detectValueChangeWithFilter(server, session, mon, &value, encoding, changed);
+    return detectValueChangeWithFilter(server, session, mon, value, encoding, changed);
 }
 
 /* movedValue returns whether the sample was moved to the notification. The
@@ -64991,9 +68463,11 @@ sampleCallbackWithValue(UA_Server *server, UA_Session *session,
     UA_ByteString binValueEncoding = UA_BYTESTRING_NULL;
 
     /* Has the value changed? Allocates memory in binValueEncoding if necessary.
-     * value is edited internally so we make a shallow copy. */
+     * The filter is applied to a shallow copy of the value. */
+    UA_DataValue filteredValue = *value;
     UA_Boolean changed = false;
-    UA_StatusCode retval = detectValueChange(server, session, mon, *value, &binValueEncoding, &changed);
+    UA_StatusCode retval = detectValueChange(server, session, mon, &filteredValue,
+                                             &binValueEncoding, &changed);
     if(retval != UA_STATUSCODE_GOOD) {
         UA_LOG_WARNING_SESSION(&server->config.logger, session, "Subscription %u | "
                                "MonitoredItem %i | Value change detection failed with StatusCode %s",
@@ -65011,12 +68485,19 @@ sampleCallbackWithValue(UA_Server *server, UA_Session *session,
     /* The MonitoredItem is attached to a subscription (not server-local).
      * Prepare a notification and enqueue it. */
     if(sub) {
-        /* Allocate a new notification */
-        UA_Notification *newNotification = (UA_Notification *)UA_malloc(sizeof(UA_Notification));
+        /* Allocate a new notification. If the pool is at its size limit,
+         * reuse a notification from the queue of the MonitoredItem. */
+        UA_Boolean recycled = false;
+        UA_Notification *newNotification = UA_Notification_new(server);
+        if(!newNotification) {
+            newNotification = UA_MonitoredItem_recycleNotification(server, mon);
+            recycled = true;
+        }
         if(!newNotification) {
             UA_ByteString_clear(&binValueEncoding);
             return UA_STATUSCODE_BADOUTOFMEMORY;
         }
+        newNotification->mon = mon;
 
         if(value->value.storageType == UA_VARIANT_DATA) {
             newNotification->data.value = *value; /* Move the value to the notification */
@@ -65025,29 +68506,42 @@ sampleCallbackWithValue(UA_Server *server, UA_Session *session,
             retval = UA_DataValue_copy(value, &newNotification->data.value);
             if(retval != UA_STATUSCODE_GOOD) {
                 UA_ByteString_clear(&binValueEncoding);
-                UA_free(newNotification);
+                UA_Notification_delete(server, newNotification);
                 return retval;
             }
         }
 
         /* <-- Point of no return --> */
 
+        if(recycled && !mon->discardOldest && mon->maxQueueSize > 1) {
+            newNotification->data.value.hasStatus = true;
+            newNotification->data.value.status |=
+                (UA_STATUSCODE_INFOTYPE_DATAVALUE | UA_STATUSCODE_INFOBITS_OVERFLOW);
+        }
+
         UA_LOG_DEBUG_SESSION(&server->config.logger, session, "Subscription %u | "
                              "MonitoredItem %i | Enqueue a new notification",
                              sub ? sub->subscriptionId : 0, mon->monitoredItemId);
 
-        newNotification->mon = mon;
         UA_Notification_enqueue(server, sub, mon, newNotification);
     }
 
-    /* Store the encoding for comparison */
-    UA_ByteString_clear(&mon->lastSampledValue);
-    mon->lastSampledValue = binValueEncoding;
+    /* Store the sample for comparison. Fixed-size samples are stored in their
+     * memory representation. Otherwise the encoding is stored. */
+    UA_Boolean fixedSize = isFixedSizeSample(&filteredValue);
+    if(fixedSize) {
+        storeFixedSizeSample(mon, &filteredValue);
+    } else {
+        UA_ByteString_clear(&mon->lastSampledValue);
+        mon->lastSampledValue = binValueEncoding;
+        mon->lastSampledHeader.valid = false;
+    }
 
     /* Store the value for filter comparison (we don't want to decode
      * lastSampledValue in every iteration). Don't test the return code here. If
      * this fails, lastValue is empty and a notification will be forced for the
-     * next deadband comparison. */
+     * next deadband comparison. Fixed-size samples are compared with
+     * lastSampledValue. */
     if((mon->filter.dataChangeFilter.deadbandType == UA_DEADBANDTYPE_NONE ||
         mon->filter.dataChangeFilter.deadbandType == UA_DEADBANDTYPE_ABSOLUTE ||
         mon->filter.dataChangeFilter.deadbandType == UA_DEADBANDTYPE_PERCENT) &&
@@ -65055,7 +68549,8 @@ sampleCallbackWithValue(UA_Server *server, UA_Session *session,
         mon->filter.dataChangeFilter.trigger == UA_DATACHANGETRIGGER_STATUSVALUE ||
         mon->filter.dataChangeFilter.trigger == UA_DATACHANGETRIGGER_STATUSVALUETIMESTAMP)) {
         UA_Variant_clear(&mon->lastValue);
-        UA_Variant_copy(&value->value, &mon->lastValue);
+        if(!fixedSize)
+            UA_Variant_copy(&value->value, &mon->lastValue);
 #ifdef UA_ENABLE_DA
         mon->lastStatus = value->status;
 #endif
@@ -65091,6 +68586,16 @@ UA_MonitoredItem_sampleCallback(UA_Server *server, UA_MonitoredItem *monitoredIt
 void
 monitoredItem_sampleCallback(UA_Server *server, UA_MonitoredItem *monitoredItem) {
     UA_LOCK_ASSERT(server->serviceMutex, 1);
+    const UA_Node *node = UA_NODESTORE_GET(server, &monitoredItem->monitoredNodeId);
+    monitoredItem_sampleCallbackWithNode(server, monitoredItem, node);
+    if(node)
+        UA_NODESTORE_RELEASE(server, node);
+}
+
+void
+monitoredItem_sampleCallbackWithNode(UA_Server *server, UA_MonitoredItem *monitoredItem,
+                                     const UA_Node *node) {
+    UA_LOCK_ASSERT(server->serviceMutex, 1);
 
     UA_Subscription *sub = monitoredItem->subscription;
     UA_Session *session = &server->adminSession;
@@ -65103,9 +68608,6 @@ monitoredItem_sampleCallback(UA_Server *server, UA_MonitoredItem *monitoredItem)
 
     UA_assert(monitoredItem->attributeId != UA_ATTRIBUTEID_EVENTNOTIFIER);
 
-    /* Get the node */
-    const UA_Node *node = UA_NODESTORE_GET(server, &monitoredItem->monitoredNodeId);
-
     /* Sample the value. The sample can still point into the node. */
     UA_DataValue value;
     UA_DataValue_init(&value);
@@ -65134,8 +68636,6 @@ monitoredItem_sampleCallback(UA_Server *server, UA_MonitoredItem *monitoredItem)
     /* Delete the sample if it was not moved to the notification. */
     if(!movedValue)
         UA_DataValue_clear(&value); /* Does nothing for UA_VARIANT_DATA_NODELETE */
-    if(node)
-        UA_NODESTORE_RELEASE(server, node);
 }
 
 #endif /* UA_ENABLE_SUBSCRIPTIONS */
@@ -66438,6 +69938,7 @@ UA_Nodestore_ZipTree(UA_Nodestore *ns) {
     ns->getNode = zipNsGetNode;
     ns->releaseNode = zipNsReleaseNode;
     ns->getNodeCopy = zipNsGetNodeCopy;
+    ns->getNodeValueCopy = NULL;
     ns->insertNode = zipNsInsertNode;
     ns->replaceNode = zipNsReplaceNode;
     ns->removeNode = zipNsRemoveNode;
@@ -66470,6 +69971,9 @@ UA_Nodestore_ZipTree(UA_Nodestore *ns) {
 
 typedef struct UA_NodeMapEntry {
     struct UA_NodeMapEntry *orig; /* the version this is a copy from (or NULL) */
+    struct UA_NodeMapEntry *owner; /* If only the value is owned: the version
+                                    * that owns the other (shared) members.
+                                    * The owner is pinned with a refCount. */
     UA_UInt16 refCount; /* How many consumers have a reference to the node? */
     UA_Boolean deleted; /* Node was marked as deleted and can be deleted when refCount == 0 */
     UA_Node node;
@@ -66629,10 +70133,26 @@ createEntry(UA_NodeClass nodeClass) {
     return entry;
 }
 
+static void
+cleanupNodeMapEntry(UA_NodeMapEntry *entry);
+
 static void
 deleteNodeMapEntry(UA_NodeMapEntry *entry) {
-    UA_Node_clear(&entry->node);
+    UA_NodeMapEntry *owner = entry->owner;
+    if(!owner) {
+        UA_Node_clear(&entry->node);
+        UA_free(entry);
+        return;
+    }
+
+    /* Only the value is owned. Release the pin on the owner of the other
+     * members afterwards. */
+    UA_VariableNode *vn = (UA_VariableNode*)&entry->node;
+    if(vn->valueSource == UA_VALUESOURCE_DATA)
+        UA_DataValue_clear(&vn->value.data.value);
     UA_free(entry);
+    --owner->refCount;
+    cleanupNodeMapEntry(owner);
 }
 
 static void
@@ -66729,6 +70249,46 @@ UA_NodeMap_getNodeCopy(void *context, const UA_NodeId *nodeid,
     return retval;
 }
 
+/* The copy shares all members except the value with the original. The
+ * original is pinned until the copy is replaced or deleted. */
+static UA_StatusCode
+UA_NodeMap_getNodeValueCopy(void *context, const UA_NodeId *nodeid,
+                            UA_Node **outNode) {
+    UA_NodeMap *ns = (UA_NodeMap*)context;
+    UA_NodeMapSlot *slot = findOccupiedSlot(ns, nodeid);
+    if(!slot)
+        return UA_STATUSCODE_BADNODEIDUNKNOWN;
+    UA_NodeMapEntry *entry = slot->entry;
+    size_t nodeSize;
+    if(entry->node.nodeClass == UA_NODECLASS_VARIABLE)
+        nodeSize = sizeof(UA_VariableNode);
+    else if(entry->node.nodeClass == UA_NODECLASS_VARIABLETYPE)
+        nodeSize = sizeof(UA_VariableTypeNode);
+    else
+        return UA_STATUSCODE_BADNODECLASSINVALID;
+
+    UA_NodeMapEntry *newItem = createEntry(entry->node.nodeClass);
+    if(!newItem)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    memcpy(&newItem->node, &entry->node, nodeSize);
+    UA_VariableNode *vn = (UA_VariableNode*)&newItem->node;
+    if(vn->valueSource == UA_VALUESOURCE_DATA) {
+        UA_StatusCode retval =
+            UA_DataValue_copy(&((UA_VariableNode*)&entry->node)->value.data.value,
+                              &vn->value.data.value);
+        if(retval != UA_STATUSCODE_GOOD) {
+            UA_free(newItem);
+            return retval;
+        }
+    }
+
+    newItem->orig = entry; /* Store the pointer to the original */
+    newItem->owner = entry;
+    ++entry->refCount;
+    *outNode = &newItem->node;
+    return UA_STATUSCODE_GOOD;
+}
+
 static UA_StatusCode
 UA_NodeMap_removeNode(void *context, const UA_NodeId *nodeid) {
     UA_NodeMap *ns = (UA_NodeMap*)context;
@@ -66831,6 +70391,16 @@ UA_NodeMap_replaceNode(void *context, UA_Node *node) {
         return UA_STATUSCODE_BADINTERNALERROR;
     }
 
+    /* A copy of only the value takes over the shared members. The previous
+     * version keeps its value for the remaining readers and pins the new
+     * version (instead of being pinned by it) until it is freed. */
+    if(newEntry->owner) {
+        newEntry->owner = NULL;
+        oldEntry->owner = newEntry;
+        ++newEntry->refCount;
+        --oldEntry->refCount;
+    }
+
     /* Replace the entry */
     slot->entry = newEntry;
     UA_atomic_sync();
@@ -66896,6 +70466,7 @@ UA_Nodestore_HashMap(UA_Nodestore *ns) {
     ns->getNode = UA_NodeMap_getNode;
     ns->releaseNode = UA_NodeMap_releaseNode;
     ns->getNodeCopy = UA_NodeMap_getNodeCopy;
+    ns->getNodeValueCopy = UA_NodeMap_getNodeValueCopy;
     ns->insertNode = UA_NodeMap_insertNode;
     ns->replaceNode = UA_NodeMap_replaceNode;
     ns->removeNode = UA_NodeMap_removeNode;
@@ -66903,6 +70474,540 @@ UA_Nodestore_HashMap(UA_Nodestore *ns) {
     return UA_STATUSCODE_GOOD;
 }
 
+/*********************************** amalgamated original file "C:/open62541/plugins/ua_nodestore_openaddressing.c" ***********************************/
+
+/* This work is licensed under a Creative Commons CCZero 1.0 Universal License.
+ * See http://creativecommons.org/publicdomain/zero/1.0/ for more information.
+ */
+
+
+#ifdef __SSE2__
+# include <emmintrin.h>
+#endif
+
+/* container_of */
+#define container_of(ptr, type, member) \
+    (type *)((uintptr_t)ptr - offsetof(type,member))
+
+/* The open-addressing Nodestore holds the nodes in a power-of-two sized table.
+ * Next to every slot is a control byte. It contains 7 bits of the NodeId hash
+ * (the tag) or marks the slot as empty or deleted. A lookup compares a group
+ * of control bytes at once and only looks at the slots with a matching tag.
+ * The groups are compared with SSE2 where available and with bit-operations
+ * on 64bit words otherwise. Numeric NodeIds are additionally stored as a key
+ * in the slot. So the node is not dereferenced to compare them.
+ *
+ * The groups are probed with triangular steps. Since the number of groups is
+ * a power of two, all groups are visited. The search ends at a group that
+ * contains an empty slot. */
+
+typedef struct OANodeEntry {
+    struct OANodeEntry *orig; /* the version this is a copy from (or NULL) */
+    UA_UInt16 refCount; /* How many consumers have a reference to the node? */
+    UA_Boolean deleted; /* Node was marked as deleted and can be deleted when refCount == 0 */
+    UA_Node node;
+} OANodeEntry;
+
+typedef struct {
+    UA_UInt64 key; /* Namespace and identifier of numeric NodeIds, otherwise 0 */
+    OANodeEntry *entry;
+    UA_UInt32 nodeIdHash;
+} OANodeSlot;
+
+typedef struct {
+    UA_Byte *ctrl;      /* One control byte per slot */
+    OANodeSlot *slots;
+    UA_UInt32 size;     /* Power of two and at least one group */
+    UA_UInt32 count;    /* Slots with a node */
+    UA_UInt32 deleted;  /* Slots marked as deleted */
+} OANodeTable;
+
+#define OA_MINSIZE 64
+#define OA_CTRL_EMPTY ((UA_Byte)0x80)
+#define OA_CTRL_DELETED ((UA_Byte)0xFE)
+#define OA_TAG(hash) ((UA_Byte)((hash) >> 25)) /* Upper 7 bits of the hash */
+#define OA_NUMERICKEY ((UA_UInt64)1 << 48)
+
+/*********************/
+/* Control Bytes     */
+/*********************/
+
+/* The match functions return a bitmask with bit i set if the control byte i of
+ * the group matches. */
+
+#ifdef __SSE2__
+
+#define OA_GROUPSIZE 16
+
+static UA_UInt32
+oaMatch(const UA_Byte *group, UA_Byte value) {
+    __m128i ctrl = _mm_loadu_si128((const __m128i*)group);
+    return (UA_UInt32)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)value)));
+}
+
+/* Empty or deleted slots have the high bit set */
+static UA_UInt32
+oaMatchFree(const UA_Byte *group) {
+    return (UA_UInt32)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)group));
+}
+
+#else
+
+#define OA_GROUPSIZE 8
+#define OA_LSB UINT64_C(0x0101010101010101)
+#define OA_LOW7 UINT64_C(0x7F7F7F7F7F7F7F7F)
+#define OA_HIGH UINT64_C(0x8080808080808080)
+
+/* Reduce a word with the high bit set in the matching bytes to the bitmask */
+static UA_UInt32
+oaBitmask(UA_UInt64 high) {
+    if(!high)
+        return 0;
+#if UA_LITTLE_ENDIAN
+    return (UA_UInt32)(((high >> 7) * UINT64_C(0x0102040810204080)) >> 56);
+#else
+    UA_UInt32 mask = 0;
+    for(size_t i = 0; i < OA_GROUPSIZE; i++) {
+        if(high & ((UA_UInt64)0x80 << (8 * (OA_GROUPSIZE - 1 - i))))
+            mask |= (UA_UInt32)1 << i;
+    }
+    return mask;
+#endif
+}
+
+static UA_UInt32
+oaMatch(const UA_Byte *group, UA_Byte value) {
+    UA_UInt64 x;
+    memcpy(&x, group, sizeof(UA_UInt64));
+    x ^= OA_LSB * value;
+    /* High bit set for the bytes that are zero. No carry between the bytes. */
+    UA_UInt64 t = (x & OA_LOW7) + OA_LOW7;
+    return oaBitmask(~(t | x | OA_LOW7));
+}
+
+/* Empty or deleted slots have the high bit set */
+static UA_UInt32
+oaMatchFree(const UA_Byte *group) {
+    UA_UInt64 x;
+    memcpy(&x, group, sizeof(UA_UInt64));
+    return oaBitmask(x & OA_HIGH);
+}
+
+#endif
+
+/* UA_NodeId_hash leaves the entropy of numeric identifiers in the upper bits.
+ * Mix so that the lower bits (group index) and the upper bits (tag) are both
+ * usable. */
+static UA_UInt32
+oaHash(const UA_NodeId *nodeId) {
+    UA_UInt32 h = UA_NodeId_hash(nodeId);
+    h ^= h >> 16;
+    h *= 0x85ebca6b;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35;
+    h ^= h >> 16;
+    return h;
+}
+
+static UA_UInt64
+oaKey(const UA_NodeId *nodeId) {
+    if(nodeId->identifierType != UA_NODEIDTYPE_NUMERIC)
+        return 0;
+    return OA_NUMERICKEY | ((UA_UInt64)nodeId->namespaceIndex << 32) |
+        nodeId->identifier.numeric;
+}
+
+/*******************/
+/* Table Utilities */
+/*******************/
+
+/* Returns the slot index or t->size if not found */
+static UA_UInt32
+oaFind(const OANodeTable *t, const UA_NodeId *nodeId, UA_UInt32 h, UA_UInt64 key) {
+    UA_Byte tag = OA_TAG(h);
+    UA_UInt32 groupMask = (t->size / OA_GROUPSIZE) - 1;
+    UA_UInt32 g = h & groupMask;
+    for(UA_UInt32 step = 1; step <= groupMask + 1; step++) {
+        const UA_Byte *group = &t->ctrl[g * OA_GROUPSIZE];
+        UA_UInt32 m = oaMatch(group, tag);
+        for(UA_UInt32 i = g * OA_GROUPSIZE; m; i++, m >>= 1) {
+            if(!(m & 1))
+                continue;
+            const OANodeSlot *slot = &t->slots[i];
+            if(key) {
+                if(slot->key == key)
+                    return i;
+            } else if(!slot->key && slot->nodeIdHash == h &&
+                      UA_NodeId_equal(&slot->entry->node.nodeId, nodeId)) {
+                return i;
+            }
+        }
+        if(oaMatch(group, OA_CTRL_EMPTY))
+            return t->size; /* No further entry possible */
+        g = (g + step) & groupMask;
+    }
+    return t->size;
+}
+
+/* Returns the first empty or deleted slot on the probe sequence. The table is
+ * never full, so this always succeeds. */
+static UA_UInt32
+oaFindFree(const OANodeTable *t, UA_UInt32 h) {
+    UA_UInt32 groupMask = (t->size / OA_GROUPSIZE) - 1;
+    UA_UInt32 g = h & groupMask;
+    for(UA_UInt32 step = 1; ; step++) {
+        UA_UInt32 m = oaMatchFree(&t->ctrl[g * OA_GROUPSIZE]);
+        if(m) {
+            UA_UInt32 i = g * OA_GROUPSIZE;
+            for(; !(m & 1); m >>= 1)
+                i++;
+            return i;
+        }
+        g = (g + step) & groupMask;
+    }
+}
+
+static void
+oaSetSlot(OANodeTable *t, UA_UInt32 i, OANodeEntry *entry,
+          UA_UInt32 h, UA_UInt64 key) {
+    t->slots[i].entry = entry;
+    t->slots[i].nodeIdHash = h;
+    t->slots[i].key = key;
+    UA_atomic_sync(); /* Set the slot before the control byte */
+    t->ctrl[i] = OA_TAG(h);
+}
+
+/* Rebuild the table with the new size. Removes the deleted slots. */
+static UA_StatusCode
+oaResize(OANodeTable *t, UA_UInt32 nsize) {
+    UA_Byte *nctrl = (UA_Byte*)UA_malloc(nsize);
+    OANodeSlot *nslots = (OANodeSlot*)UA_calloc(nsize, sizeof(OANodeSlot));
+    if(!nctrl || !nslots) {
+        UA_free(nctrl);
+        UA_free(nslots);
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    }
+    memset(nctrl, OA_CTRL_EMPTY, nsize);
+
+    OANodeTable nt;
+    nt.ctrl = nctrl;
+    nt.slots = nslots;
+    nt.size = nsize;
+    nt.count = t->count;
+    nt.deleted = 0;
+    for(UA_UInt32 i = 0; i < t->size; i++) {
+        if(t->ctrl[i] & 0x80)
+            continue;
+        OANodeSlot *s = &t->slots[i];
+        UA_UInt32 j = oaFindFree(&nt, s->nodeIdHash);
+        nt.slots[j] = *s;
+        nt.ctrl[j] = OA_TAG(s->nodeIdHash);
+    }
+
+    UA_free(t->ctrl);
+    UA_free(t->slots);
+    *t = nt;
+    return UA_STATUSCODE_GOOD;
+}
+
+/* The size for the number of nodes with an occupancy of at most 50% */
+static UA_UInt32
+oaSizeFor(UA_UInt32 count) {
+    UA_UInt32 size = OA_MINSIZE;
+    while(size < count * 2 && size < ((UA_UInt32)1 << 31))
+        size <<= 1;
+    return size;
+}
+
+static OANodeEntry *
+oaNewEntry(UA_NodeClass nodeClass) {
+    size_t size = sizeof(OANodeEntry) - sizeof(UA_Node);
+    switch(nodeClass) {
+    case UA_NODECLASS_OBJECT:
+        size += sizeof(UA_ObjectNode);
+        break;
+    case UA_NODECLASS_VARIABLE:
+        size += sizeof(UA_VariableNode);
+        break;
+    case UA_NODECLASS_METHOD:
+        size += sizeof(UA_MethodNode);
+        break;
+    case UA_NODECLASS_OBJECTTYPE:
+        size += sizeof(UA_ObjectTypeNode);
+        break;
+    case UA_NODECLASS_VARIABLETYPE:
+        size += sizeof(UA_VariableTypeNode);
+        break;
+    case UA_NODECLASS_REFERENCETYPE:
+        size += sizeof(UA_ReferenceTypeNode);
+        break;
+    case UA_NODECLASS_DATATYPE:
+        size += sizeof(UA_DataTypeNode);
+        break;
+    case UA_NODECLASS_VIEW:
+        size += sizeof(UA_ViewNode);
+        break;
+    default:
+        return NULL;
+    }
+    OANodeEntry *entry = (OANodeEntry*)UA_calloc(1, size);
+    if(!entry)
+        return NULL;
+    entry->node.nodeClass = nodeClass;
+    return entry;
+}
+
+static void
+oaDeleteEntry(OANodeEntry *entry) {
+    UA_Node_clear(&entry->node);
+    UA_free(entry);
+}
+
+static void
+oaCleanupEntry(OANodeEntry *entry) {
+    if(entry->deleted && entry->refCount == 0)
+        oaDeleteEntry(entry);
+}
+
+/***********************/
+/* Interface functions */
+/***********************/
+
+static UA_Node *
+oaNsNewNode(void *context, UA_NodeClass nodeClass) {
+    OANodeEntry *entry = oaNewEntry(nodeClass);
+    if(!entry)
+        return NULL;
+    return &entry->node;
+}
+
+static void
+oaNsDeleteNode(void *context, UA_Node *node) {
+    OANodeEntry *entry = container_of(node, OANodeEntry, node);
+    UA_assert(&entry->node == node);
+    oaDeleteEntry(entry);
+}
+
+static const UA_Node *
+oaNsGetNode(void *context, const UA_NodeId *nodeId) {
+    OANodeTable *t = (OANodeTable*)context;
+    UA_UInt32 i = oaFind(t, nodeId, oaHash(nodeId), oaKey(nodeId));
+    if(i == t->size)
+        return NULL;
+    OANodeEntry *entry = t->slots[i].entry;
+    ++entry->refCount;
+    return &entry->node;
+}
+
+static void
+oaNsReleaseNode(void *context, const UA_Node *node) {
+    if(!node)
+        return;
+    OANodeEntry *entry = container_of(node, OANodeEntry, node);
+    UA_assert(&entry->node == node);
+    UA_assert(entry->refCount > 0);
+    --entry->refCount;
+    oaCleanupEntry(entry);
+}
+
+static UA_StatusCode
+oaNsGetNodeCopy(void *context, const UA_NodeId *nodeId, UA_Node **outNode) {
+    OANodeTable *t = (OANodeTable*)context;
+    UA_UInt32 i = oaFind(t, nodeId, oaHash(nodeId), oaKey(nodeId));
+    if(i == t->size)
+        return UA_STATUSCODE_BADNODEIDUNKNOWN;
+    OANodeEntry *entry = t->slots[i].entry;
+    OANodeEntry *newItem = oaNewEntry(entry->node.nodeClass);
+    if(!newItem)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    UA_StatusCode retval = UA_Node_copy(&entry->node, &newItem->node);
+    if(retval == UA_STATUSCODE_GOOD) {
+        newItem->orig = entry; /* Store the pointer to the original */
+        *outNode = &newItem->node;
+    } else {
+        oaDeleteEntry(newItem);
+    }
+    return retval;
+}
+
+static UA_StatusCode
+oaNsRemoveNode(void *context, const UA_NodeId *nodeId) {
+    OANodeTable *t = (OANodeTable*)context;
+    UA_UInt32 i = oaFind(t, nodeId, oaHash(nodeId), oaKey(nodeId));
+    if(i == t->size)
+        return UA_STATUSCODE_BADNODEIDUNKNOWN;
+
+    OANodeEntry *entry = t->slots[i].entry;
+    t->ctrl[i] = OA_CTRL_DELETED;
+    UA_atomic_sync(); /* Set the tombstone before cleaning up. E.g. if the
+                       * nodestore is accessed from an interrupt. */
+    t->slots[i].entry = NULL;
+    entry->deleted = true;
+    oaCleanupEntry(entry);
+    --t->count;
+    ++t->deleted;
+
+    /* Downsize the table if it is very empty. Can fail. Just continue with
+     * the bigger table. */
+    if(t->count * 8 < t->size && t->size > OA_MINSIZE)
+        oaResize(t, oaSizeFor(t->count));
+    return UA_STATUSCODE_GOOD;
+}
+
+static UA_StatusCode
+oaNsInsertNode(void *context, UA_Node *node, UA_NodeId *addedNodeId) {
+    OANodeTable *t = (OANodeTable*)context;
+    OANodeEntry *newEntry = container_of(node, OANodeEntry, node);
+
+    /* Keep at least 1/8 of the slots empty. Deleted slots are reclaimed with
+     * the resize. */
+    if((t->count + t->deleted + 1) * 8 > t->size * 7) {
+        if(oaResize(t, oaSizeFor(t->count + 1)) != UA_STATUSCODE_GOOD) {
+            oaDeleteEntry(newEntry);
+            return UA_STATUSCODE_BADINTERNALERROR;
+        }
+    }
+
+    UA_UInt32 h;
+    UA_UInt64 key;
+    if(node->nodeId.identifierType == UA_NODEIDTYPE_NUMERIC &&
+       node->nodeId.identifier.numeric == 0) {
+        /* Create a random nodeid: Start at least with 50,000 to make sure we
+         * don not conflict with nodes from the spec. At most count identifiers
+         * are taken. So we find a free identifier after count+1 attempts. */
+        UA_UInt32 identifier = 50000 + t->count;
+        for(UA_UInt32 attempt = 0; ; attempt++, identifier++) {
+            if(identifier == 0)
+                identifier = 50000;
+            node->nodeId.identifier.numeric = identifier;
+            h = oaHash(&node->nodeId);
+            key = oaKey(&node->nodeId);
+            if(oaFind(t, &node->nodeId, h, key) == t->size)
+                break;
+            if(attempt > t->count) {
+                oaDeleteEntry(newEntry);
+                return UA_STATUSCODE_BADNODEIDEXISTS;
+            }
+        }
+    } else {
+        h = oaHash(&node->nodeId);
+        key = oaKey(&node->nodeId);
+        if(oaFind(t, &node->nodeId, h, key) != t->size) {
+            oaDeleteEntry(newEntry);
+            return UA_STATUSCODE_BADNODEIDEXISTS;
+        }
+    }
+
+    /* Copy the NodeId */
+    UA_StatusCode retval = UA_STATUSCODE_GOOD;
+    if(addedNodeId) {
+        retval = UA_NodeId_copy(&node->nodeId, addedNodeId);
+        if(retval != UA_STATUSCODE_GOOD) {
+            oaDeleteEntry(newEntry);
+            return retval;
+        }
+    }
+
+    /* Insert the node */
+    UA_UInt32 i = oaFindFree(t, h);
+    if(t->ctrl[i] == OA_CTRL_DELETED)
+        --t->deleted;
+    oaSetSlot(t, i, newEntry, h, key);
+    ++t->count;
+    return retval;
+}
+
+static UA_StatusCode
+oaNsReplaceNode(void *context, UA_Node *node) {
+    OANodeTable *t = (OANodeTable*)context;
+    OANodeEntry *newEntry = container_of(node, OANodeEntry, node);
+
+    /* Find the node */
+    UA_UInt32 i = oaFind(t, &node->nodeId, oaHash(&node->nodeId), oaKey(&node->nodeId));
+    if(i == t->size) {
+        oaDeleteEntry(newEntry);
+        return UA_STATUSCODE_BADNODEIDUNKNOWN;
+    }
+
+    /* The node was already updated since the copy was made? */
+    OANodeEntry *oldEntry = t->slots[i].entry;
+    if(oldEntry != newEntry->orig) {
+        oaDeleteEntry(newEntry);
+        return UA_STATUSCODE_BADINTERNALERROR;
+    }
+
+    /* Replace the entry */
+    t->slots[i].entry = newEntry;
+    UA_atomic_sync();
+    oldEntry->deleted = true;
+    oaCleanupEntry(oldEntry);
+    return UA_STATUSCODE_GOOD;
+}
+
+static void
+oaNsIterate(void *context, UA_NodestoreVisitor visitor, void *visitorContext) {
+    OANodeTable *t = (OANodeTable*)context;
+    for(UA_UInt32 i = 0; i < t->size; ++i) {
+        if(t->ctrl[i] & 0x80)
+            continue;
+        /* The visitor can delete the node. So refcount here. */
+        OANodeEntry *entry = t->slots[i].entry;
+        entry->refCount++;
+        visitor(visitorContext, &entry->node);
+        entry->refCount--;
+        oaCleanupEntry(entry);
+    }
+}
+
+static void
+oaNsClear(void *context) {
+    OANodeTable *t = (OANodeTable*)context;
+    for(UA_UInt32 i = 0; i < t->size; ++i) {
+        if(t->ctrl[i] & 0x80)
+            continue;
+        /* On debugging builds, check that all nodes were release */
+        UA_assert(t->slots[i].entry->refCount == 0);
+        /* Delete the node */
+        oaDeleteEntry(t->slots[i].entry);
+    }
+    UA_free(t->ctrl);
+    UA_free(t->slots);
+    UA_free(t);
+}
+
+UA_StatusCode
+UA_Nodestore_OpenAddressing(UA_Nodestore *ns) {
+    /* Allocate and initialize the table */
+    OANodeTable *t = (OANodeTable*)UA_calloc(1, sizeof(OANodeTable));
+    if(!t)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    t->size = OA_MINSIZE;
+    t->ctrl = (UA_Byte*)UA_malloc(OA_MINSIZE);
+    t->slots = (OANodeSlot*)UA_calloc(OA_MINSIZE, sizeof(OANodeSlot));
+    if(!t->ctrl || !t->slots) {
+        UA_free(t->ctrl);
+        UA_free(t->slots);
+        UA_free(t);
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    }
+    memset(t->ctrl, OA_CTRL_EMPTY, OA_MINSIZE);
+
+    /* Populate the nodestore */
+    ns->context = t;
+    ns->clear = oaNsClear;
+    ns->newNode = oaNsNewNode;
+    ns->deleteNode = oaNsDeleteNode;
+    ns->getNode = oaNsGetNode;
+    ns->releaseNode = oaNsReleaseNode;
+    ns->getNodeCopy = oaNsGetNodeCopy;
+    ns->getNodeValueCopy = NULL;
+    ns->insertNode = oaNsInsertNode;
+    ns->replaceNode = oaNsReplaceNode;
+    ns->removeNode = oaNsRemoveNode;
+    ns->iterate = oaNsIterate;
+    return UA_STATUSCODE_GOOD;
+}
+
 /*********************************** amalgamated original file "C:/open62541/plugins/ua_config_default.c" ***********************************/
 
 /* This work is licensed under a Creative Commons CCZero 1.0 Universal License.
@@ -67108,6 +71213,7 @@ setDefaultConfig(UA_ServerConfig *conf) {
     /* Limits for MonitoredItems */
     conf->samplingIntervalLimits = UA_DURATIONRANGE(50.0, 24.0 * 3600.0 * 1000.0);
     conf->queueSizeLimits = UA_UINT32RANGE(1, 100);
+    conf->maxNotifications = 0; /* unlimited */
 
 #ifdef UA_ENABLE_DISCOVERY
     conf->discovery.cleanupTimeout = 60 * 60;
@@ -70717,6 +74823,13 @@ UA_SecurityPolicy_Basic256Sha256(UA_SecurityPolicy *policy, const UA_ByteString
  */
 
 
+/* Batched sending and receiving with sendmmsg/recvmmsg. Other platforms loop
+ * over the single-message functions. */
+#if defined(UA_ARCHITECTURE_POSIX) && defined(__linux__) && defined(MSG_WAITFORONE)
+# define UA_PUBSUB_UDP_MMSG
+#endif
+#define UA_PUBSUB_UDP_BATCHSIZE 16
+
 // UDP multicast network layer specific internal data
 typedef struct {
     int ai_family;                        //Protocol family for socket.  IPv4/IPv6
@@ -71067,6 +75180,24 @@ UA_PubSubChannelUDPMC_send(UA_PubSubChannel *channel, UA_ExtensionObject *transp
  * @param timeout in usec | on windows platforms are only multiples of 1000usec possible
  * @return
  */
+static UA_StatusCode
+UA_PubSubChannelUDPMC_wait(UA_PubSubChannel *channel, UA_UInt32 timeout) {
+    if(timeout == 0)
+        return UA_STATUSCODE_GOOD;
+    fd_set fdset;
+    FD_ZERO(&fdset);
+    UA_fd_set(channel->sockfd, &fdset);
+    struct timeval tmptv = {(long int)(timeout / 1000000),
+                            (long int)(timeout % 1000000)};
+    int resultsize = UA_select(channel->sockfd+1, &fdset, NULL,
+                            NULL, &tmptv);
+    if(resultsize == 0)
+        return UA_STATUSCODE_GOODNONCRITICALTIMEOUT;
+    if(resultsize == -1)
+        return UA_STATUSCODE_BADINTERNALERROR;
+    return UA_STATUSCODE_GOOD;
+}
+
 static UA_StatusCode
 UA_PubSubChannelUDPMC_receive(UA_PubSubChannel *channel, UA_ByteString *message, UA_ExtensionObject *transportSettigns, UA_UInt32 timeout){
     if(!(channel->state == UA_PUBSUB_CHANNEL_PUB || channel->state == UA_PUBSUB_CHANNEL_PUB_SUB)) {
@@ -71075,22 +75206,10 @@ UA_PubSubChannelUDPMC_receive(UA_PubSubChannel *channel, UA_ByteString *message,
     }
     UA_PubSubChannelDataUDPMC *channelConfigUDPMC = (UA_PubSubChannelDataUDPMC *) channel->handle;
 
-    if(timeout > 0) {
-        fd_set fdset;
-        FD_ZERO(&fdset);
-        UA_fd_set(channel->sockfd, &fdset);
-        struct timeval tmptv = {(long int)(timeout / 1000000),
-                                (long int)(timeout % 1000000)};
-        int resultsize = UA_select(channel->sockfd+1, &fdset, NULL,
-                                NULL, &tmptv);
-        if(resultsize == 0) {
-            message->length = 0;
-            return UA_STATUSCODE_GOODNONCRITICALTIMEOUT;
-        }
-        if (resultsize == -1) {
-            message->length = 0;
-            return UA_STATUSCODE_BADINTERNALERROR;
-        }
+    UA_StatusCode retval = UA_PubSubChannelUDPMC_wait(channel, timeout);
+    if(retval != UA_STATUSCODE_GOOD) {
+        message->length = 0;
+        return retval;
     }
 
     if(channelConfigUDPMC->ai_family == PF_INET){
@@ -71109,6 +75228,123 @@ UA_PubSubChannelUDPMC_receive(UA_PubSubChannel *channel, UA_ByteString *message,
     return UA_STATUSCODE_GOOD;
 }
 
+/**
+ * Send several messages to the connection defined address. Uses one sendmmsg
+ * call per batch where available.
+ *
+ * @return UA_STATUSCODE_GOOD if all messages were sent
+ */
+static UA_StatusCode
+UA_PubSubChannelUDPMC_sendMany(UA_PubSubChannel *channel, UA_ExtensionObject *transportSettigns,
+                               const UA_ByteString *bufs, size_t bufsSize) {
+#ifdef UA_PUBSUB_UDP_MMSG
+    UA_PubSubChannelDataUDPMC *channelConfigUDPMC = (UA_PubSubChannelDataUDPMC *) channel->handle;
+    if(!(channel->state == UA_PUBSUB_CHANNEL_PUB || channel->state == UA_PUBSUB_CHANNEL_PUB_SUB)){
+        UA_LOG_WARNING(UA_Log_Stdout, UA_LOGCATEGORY_SERVER, "PubSub Connection sending failed. Invalid state.");
+        return UA_STATUSCODE_BADINTERNALERROR;
+    }
+    struct mmsghdr msgs[UA_PUBSUB_UDP_BATCHSIZE];
+    struct iovec iovs[UA_PUBSUB_UDP_BATCHSIZE];
+    size_t sent = 0;
+    while(sent < bufsSize) {
+        size_t batchSize = bufsSize - sent;
+        if(batchSize > UA_PUBSUB_UDP_BATCHSIZE)
+            batchSize = UA_PUBSUB_UDP_BATCHSIZE;
+        memset(msgs, 0, sizeof(struct mmsghdr) * batchSize);
+        for(size_t i = 0; i < batchSize; i++) {
+            iovs[i].iov_base = bufs[sent + i].data;
+            iovs[i].iov_len = bufs[sent + i].length;
+            msgs[i].msg_hdr.msg_name = channelConfigUDPMC->ai_addr;
+            msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_storage);
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        int n = sendmmsg(channel->sockfd, msgs, (unsigned int)batchSize, 0);
+        if(n <= 0) {
+            if(n == -1 && UA_ERRNO == UA_INTERRUPTED)
+                continue;
+            UA_LOG_WARNING(UA_Log_Stdout, UA_LOGCATEGORY_SERVER, "PubSub Connection sending failed.");
+            return UA_STATUSCODE_BADINTERNALERROR;
+        }
+        sent += (size_t)n;
+    }
+    return UA_STATUSCODE_GOOD;
+#else
+    for(size_t i = 0; i < bufsSize; i++) {
+        UA_StatusCode retval = UA_PubSubChannelUDPMC_send(channel, transportSettigns, &bufs[i]);
+        if(retval != UA_STATUSCODE_GOOD)
+            return retval;
+    }
+    return UA_STATUSCODE_GOOD;
+#endif
+}
+
+/**
+ * Receive several messages. Only the first message is awaited, the remaining
+ * messages are taken from the socket without blocking. Uses recvmmsg where
+ * available.
+ *
+ * @param timeout in usec for the first message
+ * @return UA_STATUSCODE_GOOD if success
+ */
+static UA_StatusCode
+UA_PubSubChannelUDPMC_receiveMany(UA_PubSubChannel *channel, UA_ByteString *messages,
+                                  size_t messagesSize, size_t *receivedSize,
+                                  UA_ExtensionObject *transportSettigns, UA_UInt32 timeout) {
+    *receivedSize = 0;
+    if(!(channel->state == UA_PUBSUB_CHANNEL_PUB || channel->state == UA_PUBSUB_CHANNEL_PUB_SUB)) {
+        UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_SERVER, "PubSub Connection receive failed. Invalid state.");
+        return UA_STATUSCODE_BADINTERNALERROR;
+    }
+    UA_PubSubChannelDataUDPMC *channelConfigUDPMC = (UA_PubSubChannelDataUDPMC *) channel->handle;
+    if(messagesSize == 0 || channelConfigUDPMC->ai_family != PF_INET)
+        return UA_STATUSCODE_GOOD; //TODO implement recieve for IPv6
+
+    UA_StatusCode retval = UA_PubSubChannelUDPMC_wait(channel, timeout);
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
+
+#ifdef UA_PUBSUB_UDP_MMSG
+    struct mmsghdr msgs[UA_PUBSUB_UDP_BATCHSIZE];
+    struct iovec iovs[UA_PUBSUB_UDP_BATCHSIZE];
+    int flags = MSG_WAITFORONE;
+    while(*receivedSize < messagesSize) {
+        size_t batchSize = messagesSize - *receivedSize;
+        if(batchSize > UA_PUBSUB_UDP_BATCHSIZE)
+            batchSize = UA_PUBSUB_UDP_BATCHSIZE;
+        memset(msgs, 0, sizeof(struct mmsghdr) * batchSize);
+        for(size_t i = 0; i < batchSize; i++) {
+            iovs[i].iov_base = messages[*receivedSize + i].data;
+            iovs[i].iov_len = messages[*receivedSize + i].length;
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        int n = recvmmsg(channel->sockfd, msgs, (unsigned int)batchSize, flags, NULL);
+        if(n <= 0)
+            break;
+        for(int i = 0; i < n; i++)
+            messages[*receivedSize + (size_t)i].length = msgs[i].msg_len;
+        *receivedSize += (size_t)n;
+        if((size_t)n < batchSize)
+            break;
+        flags = MSG_DONTWAIT;
+    }
+#else
+    int flags = 0;
+    while(*receivedSize < messagesSize) {
+        UA_ByteString *message = &messages[*receivedSize];
+        ssize_t messageLength = UA_recvfrom(channel->sockfd, message->data,
+                                            message->length, flags, NULL, NULL);
+        if(messageLength <= 0)
+            break;
+        message->length = (size_t) messageLength;
+        (*receivedSize)++;
+        flags = MSG_DONTWAIT;
+    }
+#endif
+    return UA_STATUSCODE_GOOD;
+}
+
 /**
  * Close channel and free the channel data.
  *
@@ -71144,6 +75380,8 @@ TransportLayerUDPMC_addChannel(UA_PubSubConnectionConfig *connectionConfig) {
         pubSubChannel->unregist = UA_PubSubChannelUDPMC_unregist;
         pubSubChannel->send = UA_PubSubChannelUDPMC_send;
         pubSubChannel->receive = UA_PubSubChannelUDPMC_receive;
+        pubSubChannel->sendMany = UA_PubSubChannelUDPMC_sendMany;
+        pubSubChannel->receiveMany = UA_PubSubChannelUDPMC_receiveMany;
         pubSubChannel->close = UA_PubSubChannelUDPMC_close;
         pubSubChannel->connectionConfig = connectionConfig;
     }
@@ -71159,6 +75397,624 @@ UA_PubSubTransportLayerUDPMP() {
     return pubSubTransportLayer;
 }
 
+/*********************************** amalgamated original file "C:/open62541/plugins/ua_pubsub_ethernet.c" ***********************************/
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright 2018 (c) Kontron Europe GmbH (Author: Rudolf Hoyler)
+ */
+
+
+#ifdef UA_ENABLE_PUBSUB_ETH_UADP
+
+/* Raw sockets on Linux, the link layer of the netif on lwIP */
+#if defined(UA_ARCHITECTURE_POSIX) && defined(__linux__)
+# include <sys/ioctl.h>
+# include <net/if.h>
+# include <linux/if_packet.h>
+# define UA_PUBSUB_ETHERNET_PACKET
+#elif defined(UA_ARCHITECTURE_FREERTOSLWIP)
+# include <lwip/netif.h>
+# include <lwip/pbuf.h>
+# include <lwip/sys.h>
+# define UA_PUBSUB_ETHERNET_LWIP
+#else
+# error "The Ethernet PubSub transport is only available on Linux and lwIP"
+#endif
+
+#define UA_ETHERTYPE_UADP 0xB62C
+#define UA_ETHERTYPE_VLAN 0x8100
+#define UA_ETHERNET_ADDRESSSIZE 6
+#define UA_ETHERNET_HEADERSIZE 14
+#define UA_ETHERNET_VLANTAGSIZE 4
+#define UA_ETHERNET_MAXPAYLOAD 1500
+#define UA_PUBSUB_ETHERNET_BATCHSIZE 16
+#define UA_PUBSUB_ETHERNET_RXQUEUESIZE 16
+
+// Ethernet network layer specific internal data
+typedef struct {
+    /* The header of every sent frame. Built once when the channel is opened:
+     * destination, source, optional 802.1Q tag and the EtherType. */
+    UA_Byte header[UA_ETHERNET_HEADERSIZE + UA_ETHERNET_VLANTAGSIZE];
+    size_t headerLength;
+    UA_Byte targetAddress[UA_ETHERNET_ADDRESSSIZE];
+#ifdef UA_PUBSUB_ETHERNET_PACKET
+    struct sockaddr_ll sll;
+#else
+    struct netif *netif;
+    sys_mbox_t rxQueue; /* received frames, valid between regist and unregist */
+#endif
+} UA_PubSubChannelDataEthernet;
+
+/* Parse a MAC address of the form 01-23-45-67-89-ab */
+static UA_StatusCode
+parseEthernetAddress(const UA_String *str, UA_Byte *address) {
+    if(str->length != 3 * UA_ETHERNET_ADDRESSSIZE - 1)
+        return UA_STATUSCODE_BADINTERNALERROR;
+    for(size_t i = 0; i < UA_ETHERNET_ADDRESSSIZE; i++) {
+        UA_Byte value = 0;
+        for(size_t j = 0; j < 2; j++) {
+            UA_Byte c = str->data[3 * i + j];
+            value = (UA_Byte)(value << 4);
+            if(c >= '0' && c <= '9')
+                value |= (UA_Byte)(c - '0');
+            else if(c >= 'a' && c <= 'f')
+                value |= (UA_Byte)(c - 'a' + 10);
+            else if(c >= 'A' && c <= 'F')
+                value |= (UA_Byte)(c - 'A' + 10);
+            else
+                return UA_STATUSCODE_BADINTERNALERROR;
+        }
+        if(i < UA_ETHERNET_ADDRESSSIZE - 1 && str->data[3 * i + 2] != '-')
+            return UA_STATUSCODE_BADINTERNALERROR;
+        address[i] = value;
+    }
+    return UA_STATUSCODE_GOOD;
+}
+
+/* Build the header template. A VLAN tag is only added if the address contains
+ * a VLAN ID or a priority. */
+static void
+buildHeaderTemplate(UA_PubSubChannelDataEthernet *channelDataEthernet,
+                    const UA_Byte *sourceAddress, UA_UInt16 vid, UA_Byte pcp) {
+    UA_Byte *pos = channelDataEthernet->header;
+    memcpy(pos, channelDataEthernet->targetAddress, UA_ETHERNET_ADDRESSSIZE);
+    pos += UA_ETHERNET_ADDRESSSIZE;
+    memcpy(pos, sourceAddress, UA_ETHERNET_ADDRESSSIZE);
+    pos += UA_ETHERNET_ADDRESSSIZE;
+    if(vid != 0 || pcp != 0) {
+        UA_UInt16 tci = (UA_UInt16)((pcp << 13) | (vid & 0x0FFF));
+        *pos++ = (UA_Byte)(UA_ETHERTYPE_VLAN >> 8);
+        *pos++ = (UA_Byte)UA_ETHERTYPE_VLAN;
+        *pos++ = (UA_Byte)(tci >> 8);
+        *pos++ = (UA_Byte)tci;
+    }
+    *pos++ = (UA_Byte)(UA_ETHERTYPE_UADP >> 8);
+    *pos++ = (UA_Byte)UA_ETHERTYPE_UADP;
+    channelDataEthernet->headerLength = (size_t)(pos - channelDataEthernet->header);
+}
+
+#ifdef UA_PUBSUB_ETHERNET_LWIP
+
+/* lwIP has no raw sockets on the link layer. Received frames are taken from
+ * the input function of the netif. Only one channel can receive at a time.
+ * The input function runs in the input thread of the netif driver, so the
+ * receiver and its queue are only touched under the lwIP core lock. */
+static UA_PubSubChannelDataEthernet *lwipReceiver;
+static netif_input_fn lwipNetifInput;
+
+static u16_t
+lwipPayloadOffset(const struct pbuf *p) {
+    const UA_Byte *frame = (const UA_Byte *)p->payload + ETH_PAD_SIZE;
+    if(p->len >= ETH_PAD_SIZE + UA_ETHERNET_HEADERSIZE + UA_ETHERNET_VLANTAGSIZE &&
+       frame[12] == (UA_Byte)(UA_ETHERTYPE_VLAN >> 8) && frame[13] == (UA_Byte)UA_ETHERTYPE_VLAN)
+        return ETH_PAD_SIZE + UA_ETHERNET_HEADERSIZE + UA_ETHERNET_VLANTAGSIZE;
+    return ETH_PAD_SIZE + UA_ETHERNET_HEADERSIZE;
+}
+
+static err_t
+lwipEthernetInput(struct pbuf *p, struct netif *netif) {
+    if(p->len >= ETH_PAD_SIZE + UA_ETHERNET_HEADERSIZE) {
+        const UA_Byte *type = (const UA_Byte *)p->payload + lwipPayloadOffset(p) - 2;
+        if(type[0] == (UA_Byte)(UA_ETHERTYPE_UADP >> 8) &&
+           type[1] == (UA_Byte)UA_ETHERTYPE_UADP) {
+            LOCK_TCPIP_CORE();
+            UA_PubSubChannelDataEthernet *channelDataEthernet = lwipReceiver;
+            if(channelDataEthernet && channelDataEthernet->netif == netif) {
+                /* Drop the frame if the receiver does not keep up */
+                if(sys_mbox_trypost(&channelDataEthernet->rxQueue, p) != ERR_OK)
+                    pbuf_free(p);
+                UNLOCK_TCPIP_CORE();
+                return ERR_OK;
+            }
+            UNLOCK_TCPIP_CORE();
+        }
+    }
+    /* Forwarded outside of the core lock, tcpip_input may take it itself */
+    return lwipNetifInput(p, netif);
+}
+
+#endif /* UA_PUBSUB_ETHERNET_LWIP */
+
+/**
+ * Open communication socket based on the connectionConfig. The connection
+ * properties are not used.
+ *
+ * @return ref to created channel, NULL on error
+ */
+static UA_PubSubChannel *
+UA_PubSubChannelEthernet_open(const UA_PubSubConnectionConfig *connectionConfig) {
+    UA_NetworkAddressUrlDataType address;
+    if(UA_Variant_hasScalarType(&connectionConfig->address, &UA_TYPES[UA_TYPES_NETWORKADDRESSURLDATATYPE])){
+        address = *(UA_NetworkAddressUrlDataType *)connectionConfig->address.data;
+    } else {
+        UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_SERVER, "PubSub Connection creation failed. Invalid Address.");
+        return NULL;
+    }
+
+    UA_String target;
+    UA_UInt16 vid = 0;
+    UA_Byte pcp = 0;
+    UA_Byte targetAddress[UA_ETHERNET_ADDRESSSIZE];
+    if(UA_parseEndpointUrlEthernet(&address.url, &target, &vid, &pcp) != UA_STATUSCODE_GOOD ||
+       parseEthernetAddress(&target, targetAddress) != UA_STATUSCODE_GOOD) {
+        UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_SERVER, "PubSub Connection creation failed. Invalid URL.");
+        return NULL;
+    }
+    if(address.networkInterface.length >= 16) {
+        UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_SERVER,
+                     "PubSub Connection creation failed. Invalid network interface.");
+        return NULL;
+    }
+    char interfaceAsChar[16];
+    memcpy(interfaceAsChar, address.networkInterface.data, address.networkInterface.length);
+    interfaceAsChar[address.networkInterface.length] = 0;
+
+    //allocate and init memory for the Ethernet specific internal data
+    UA_PubSubChannelDataEthernet *channelDataEthernet =
+            (UA_PubSubChannelDataEthernet *) UA_calloc(1, sizeof(UA_PubSubChannelDataEthernet));
+    if(!channelDataEthernet){
+        UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_SERVER, "PubSub Connection creation failed. Out of memory.");
+        return NULL;
+    }
+    memcpy(channelDataEthernet->targetAddress, targetAddress, UA_ETHERNET_ADDRESSSIZE);
+
+    UA_PubSubChannel *newChannel = (UA_PubSubChannel *) UA_calloc(1, sizeof(UA_PubSubChannel));
+    if(!newChannel){
+        UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_SERVER, "PubSub Connection creation failed. Out of memory.");
+        UA_free(channelDataEthernet);
+        return NULL;
+    }
+
+#ifdef UA_PUBSUB_ETHERNET_PACKET
+    /* The socket only sees frames with the UADP EtherType */
+    newChannel->sockfd = UA_socket(PF_PACKET, SOCK_RAW, UA_htons(UA_ETHERTYPE_UADP));
+    if(newChannel->sockfd == UA_INVALID_SOCKET) {
+        UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_SERVER,
+                     "PubSub Connection creation failed. Cannot create the raw socket.");
+        UA_free(channelDataEthernet);
+        UA_free(newChannel);
+        return NULL;
+    }
+
+    /* Get the index and the address of the interface */
+    struct ifreq ifreq;
+    memset(&ifreq, 0, sizeof(struct ifreq));
+    strncpy(ifreq.ifr_name, interfaceAsChar, IFNAMSIZ - 1);
+    if(ioctl(newChannel->sockfd, SIOCGIFINDEX, &ifreq) < 0) {
+        UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_SERVER,
+                     "PubSub Connection creation failed. Unknown network interface.");
+        UA_close(newChannel->sockfd);
+        UA_free(channelDataEthernet);
+        UA_free(newChannel);
+        return NULL;
+    }
+    struct sockaddr_ll *sll = &channelDataEthernet->sll;
+    sll->sll_family = AF_PACKET;
+    sll->sll_protocol = UA_htons(UA_ETHERTYPE_UADP);
+    sll->sll_ifindex = ifreq.ifr_ifindex;
+    sll->sll_halen = UA_ETHERNET_ADDRESSSIZE;
+    memcpy(sll->sll_addr, targetAddress, UA_ETHERNET_ADDRESSSIZE);
+    if(ioctl(newChannel->sockfd, SIOCGIFHWADDR, &ifreq) < 0) {
+        UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_SERVER,
+                     "PubSub Connection creation failed. Cannot get the interface address.");
+        UA_close(newChannel->sockfd);
+        UA_free(channelDataEthernet);
+        UA_free(newChannel);
+        return NULL;
+    }
+    buildHeaderTemplate(channelDataEthernet, (const UA_Byte *)ifreq.ifr_hwaddr.sa_data, vid, pcp);
+
+    /* Only receive from the selected interface */
+    if(UA_bind(newChannel->sockfd, (const struct sockaddr *)sll, sizeof(struct sockaddr_ll)) != 0) {
+        UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_SERVER,
+                     "PubSub Connection creation failed. Cannot bind the raw socket.");
+        UA_close(newChannel->sockfd);
+        UA_free(channelDataEthernet);
+        UA_free(newChannel);
+        return NULL;
+    }
+
+    /* The priority selects the traffic class of the interface queue */
+    if(pcp != 0) {
+        int priority = pcp;
+        if(UA_setsockopt(newChannel->sockfd, SOL_SOCKET, SO_PRIORITY,
+                         (const char *)&priority, sizeof(priority)) < 0) {
+            UA_LOG_WARNING(UA_Log_Stdout, UA_LOGCATEGORY_SERVER,
+                           "PubSub Connection creation problem. Priority setup failed.");
+        }
+    }
+#else
+    struct netif *netif = netif_default;
+    if(address.networkInterface.length > 0)
+        netif = netif_find(interfaceAsChar);
+    if(!netif || !netif->linkoutput) {
+        UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_SERVER,
+                     "PubSub Connection creation failed. Unknown network interface.");
+        UA_free(channelDataEthernet);
+        UA_free(newChannel);
+        return NULL;
+    }
+    channelDataEthernet->netif = netif;
+    sys_mbox_set_invalid(&channelDataEthernet->rxQueue);
+    buildHeaderTemplate(channelDataEthernet, netif->hwaddr, vid, pcp);
+    newChannel->sockfd = UA_INVALID_SOCKET;
+#endif
+
+    //link channel and internal channel data
+    newChannel->handle = channelDataEthernet;
+    newChannel->state = UA_PUBSUB_CHANNEL_PUB;
+    return newChannel;
+}
+
+/**
+ * Subscribe to the target address. Joins the group if the target is a
+ * multicast address.
+ *
+ * @return UA_STATUSCODE_GOOD on success
+ */
+static UA_StatusCode
+UA_PubSubChannelEthernet_regist(UA_PubSubChannel *channel, UA_ExtensionObject *transportSettings,
+        void (*notUsedHere)(UA_ByteString *encodedBuffer, UA_ByteString *topic)) {
+    if(!(channel->state == UA_PUBSUB_CHANNEL_PUB || channel->state == UA_PUBSUB_CHANNEL_RDY)){
+        UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_SERVER, "PubSub Connection regist failed.");
+        return UA_STATUSCODE_BADINTERNALERROR;
+    }
+    UA_PubSubChannelDataEthernet *channelDataEthernet = (UA_PubSubChannelDataEthernet *) channel->handle;
+#ifdef UA_PUBSUB_ETHERNET_PACKET
+    if(channelDataEthernet->targetAddress[0] & 0x01) {
+        struct packet_mreq mreq;
+        memset(&mreq, 0, sizeof(struct packet_mreq));
+        mreq.mr_ifindex = channelDataEthernet->sll.sll_ifindex;
+        mreq.mr_type = PACKET_MR_MULTICAST;
+        mreq.mr_alen = UA_ETHERNET_ADDRESSSIZE;
+        memcpy(mreq.mr_address, channelDataEthernet->targetAddress, UA_ETHERNET_ADDRESSSIZE);
+        if(UA_setsockopt(channel->sockfd, SOL_PACKET, PACKET_ADD_MEMBERSHIP,
+                         (const char *)&mreq, sizeof(struct packet_mreq)) < 0) {
+            UA_LOG_WARNING(UA_Log_Stdout, UA_LOGCATEGORY_SERVER,
+                           "PubSub Connection not on multicast");
+        }
+    }
+#else
+    if(sys_mbox_new(&channelDataEthernet->rxQueue, UA_PUBSUB_ETHERNET_RXQUEUESIZE) != ERR_OK) {
+        UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_SERVER, "PubSub Connection regist failed.");
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    }
+    LOCK_TCPIP_CORE();
+    if(lwipReceiver) {
+        UNLOCK_TCPIP_CORE();
+        sys_mbox_free(&channelDataEthernet->rxQueue);
+        sys_mbox_set_invalid(&channelDataEthernet->rxQueue);
+        UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_SERVER,
+                     "PubSub Connection regist failed. Another channel is registered.");
+        return UA_STATUSCODE_BADINTERNALERROR;
+    }
+    /* The saved input function is never reset. A frame that is still on its
+     * way through lwipEthernetInput after unregist is forwarded to it. */
+    if(channelDataEthernet->netif->input != lwipEthernetInput)
+        lwipNetifInput = channelDataEthernet->netif->input;
+    lwipReceiver = channelDataEthernet;
+    channelDataEthernet->netif->input = lwipEthernetInput;
+    UNLOCK_TCPIP_CORE();
+#endif
+    return UA_STATUSCODE_GOOD;
+}
+
+/**
+ * Remove current subscription.
+ *
+ * @return UA_STATUSCODE_GOOD on success
+ */
+static UA_StatusCode
+UA_PubSubChannelEthernet_unregist(UA_PubSubChannel *channel, UA_ExtensionObject *transportSettings) {
+    UA_PubSubChannelDataEthernet *channelDataEthernet = (UA_PubSubChannelDataEthernet *) channel->handle;
+#ifdef UA_PUBSUB_ETHERNET_PACKET
+    if(channelDataEthernet->targetAddress[0] & 0x01) {
+        struct packet_mreq mreq;
+        memset(&mreq, 0, sizeof(struct packet_mreq));
+        mreq.mr_ifindex = channelDataEthernet->sll.sll_ifindex;
+        mreq.mr_type = PACKET_MR_MULTICAST;
+        mreq.mr_alen = UA_ETHERNET_ADDRESSSIZE;
+        memcpy(mreq.mr_address, channelDataEthernet->targetAddress, UA_ETHERNET_ADDRESSSIZE);
+        if(UA_setsockopt(channel->sockfd, SOL_PACKET, PACKET_DROP_MEMBERSHIP,
+                         (const char *)&mreq, sizeof(struct packet_mreq)) < 0) {
+            UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_SERVER, "PubSub Connection unregist failed.");
+            return UA_STATUSCODE_BADINTERNALERROR;
+        }
+    }
+#else
+    LOCK_TCPIP_CORE();
+    if(lwipReceiver != channelDataEthernet) {
+        UNLOCK_TCPIP_CORE();
+        UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_SERVER, "PubSub Connection unregist failed.");
+        return UA_STATUSCODE_BADINTERNALERROR;
+    }
+    channelDataEthernet->netif->input = lwipNetifInput;
+    lwipReceiver = NULL;
+    UNLOCK_TCPIP_CORE();
+    /* No frame can be posted anymore. Drain the queue before freeing it. */
+    void *frame;
+    while(sys_arch_mbox_tryfetch(&channelDataEthernet->rxQueue, &frame) != SYS_MBOX_EMPTY)
+        pbuf_free((struct pbuf *)frame);
+    sys_mbox_free(&channelDataEthernet->rxQueue);
+    sys_mbox_set_invalid(&channelDataEthernet->rxQueue);
+#endif
+    return UA_STATUSCODE_GOOD;
+}
+
+/**
+ * Send messages to the connection defined address. The prebuilt header is
+ * sent in front of the message without copying the message.
+ *
+ * @return UA_STATUSCODE_GOOD if success
+ */
+static UA_StatusCode
+UA_PubSubChannelEthernet_send(UA_PubSubChannel *channel, UA_ExtensionObject *transportSettigns,
+                              const UA_ByteString *buf) {
+    UA_PubSubChannelDataEthernet *channelDataEthernet = (UA_PubSubChannelDataEthernet *) channel->handle;
+    if(!(channel->state == UA_PUBSUB_CHANNEL_PUB || channel->state == UA_PUBSUB_CHANNEL_PUB_SUB)){
+        UA_LOG_WARNING(UA_Log_Stdout, UA_LOGCATEGORY_SERVER, "PubSub Connection sending failed. Invalid state.");
+        return UA_STATUSCODE_BADINTERNALERROR;
+    }
+    if(buf->length > UA_ETHERNET_MAXPAYLOAD) {
+        UA_LOG_WARNING(UA_Log_Stdout, UA_LOGCATEGORY_SERVER,
+                       "PubSub Connection sending failed. Message exceeds the Ethernet MTU.");
+        return UA_STATUSCODE_BADENCODINGLIMITSEXCEEDED;
+    }
+#ifdef UA_PUBSUB_ETHERNET_PACKET
+    struct iovec iovs[2];
+    iovs[0].iov_base = channelDataEthernet->header;
+    iovs[0].iov_len = channelDataEthernet->headerLength;
+    iovs[1].iov_base = buf->data;
+    iovs[1].iov_len = buf->length;
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(struct msghdr));
+    msg.msg_name = &channelDataEthernet->sll;
+    msg.msg_namelen = sizeof(struct sockaddr_ll);
+    msg.msg_iov = iovs;
+    msg.msg_iovlen = 2;
+    ssize_t n = sendmsg(channel->sockfd, &msg, 0);
+    if(n != (ssize_t)(channelDataEthernet->headerLength + buf->length)) {
+        UA_LOG_WARNING(UA_Log_Stdout, UA_LOGCATEGORY_SERVER, "PubSub Connection sending failed.");
+        return UA_STATUSCODE_BADINTERNALERROR;
+    }
+#else
+    /* The driver may keep the frame after linkoutput returns. So the frame is
+     * assembled in a pbuf of its own. Leading ETH_PAD_SIZE bytes are skipped
+     * by the driver. */
+    u16_t headerEnd = (u16_t)(ETH_PAD_SIZE + channelDataEthernet->headerLength);
+    struct pbuf *p = pbuf_alloc(PBUF_RAW, (u16_t)(headerEnd + buf->length), PBUF_RAM);
+    if(!p) {
+        UA_LOG_WARNING(UA_Log_Stdout, UA_LOGCATEGORY_SERVER,
+                       "PubSub Connection sending failed. Out of memory.");
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    }
+    UA_Byte *frame = (UA_Byte *)p->payload;
+    memcpy(&frame[ETH_PAD_SIZE], channelDataEthernet->header, channelDataEthernet->headerLength);
+    memcpy(&frame[headerEnd], buf->data, buf->length);
+    err_t err = channelDataEthernet->netif->linkoutput(channelDataEthernet->netif, p);
+    pbuf_free(p);
+    if(err != ERR_OK) {
+        UA_LOG_WARNING(UA_Log_Stdout, UA_LOGCATEGORY_SERVER, "PubSub Connection sending failed.");
+        return UA_STATUSCODE_BADINTERNALERROR;
+    }
+#endif
+    return UA_STATUSCODE_GOOD;
+}
+
+/**
+ * Send several messages to the connection defined address. Uses one sendmmsg
+ * call per batch on Linux.
+ *
+ * @return UA_STATUSCODE_GOOD if all messages were sent
+ */
+static UA_StatusCode
+UA_PubSubChannelEthernet_sendMany(UA_PubSubChannel *channel, UA_ExtensionObject *transportSettigns,
+                                  const UA_ByteString *bufs, size_t bufsSize) {
+#if defined(UA_PUBSUB_ETHERNET_PACKET) && defined(MSG_WAITFORONE)
+    UA_PubSubChannelDataEthernet *channelDataEthernet = (UA_PubSubChannelDataEthernet *) channel->handle;
+    if(!(channel->state == UA_PUBSUB_CHANNEL_PUB || channel->state == UA_PUBSUB_CHANNEL_PUB_SUB)){
+        UA_LOG_WARNING(UA_Log_Stdout, UA_LOGCATEGORY_SERVER, "PubSub Connection sending failed. Invalid state.");
+        return UA_STATUSCODE_BADINTERNALERROR;
+    }
+    struct mmsghdr msgs[UA_PUBSUB_ETHERNET_BATCHSIZE];
+    struct iovec iovs[UA_PUBSUB_ETHERNET_BATCHSIZE][2];
+    size_t sent = 0;
+    while(sent < bufsSize) {
+        size_t batchSize = bufsSize - sent;
+        if(batchSize > UA_PUBSUB_ETHERNET_BATCHSIZE)
+            batchSize = UA_PUBSUB_ETHERNET_BATCHSIZE;
+        memset(msgs, 0, sizeof(struct mmsghdr) * batchSize);
+        for(size_t i = 0; i < batchSize; i++) {
+            if(bufs[sent + i].length > UA_ETHERNET_MAXPAYLOAD) {
+                UA_LOG_WARNING(UA_Log_Stdout, UA_LOGCATEGORY_SERVER,
+                               "PubSub Connection sending failed. Message exceeds the Ethernet MTU.");
+                return UA_STATUSCODE_BADENCODINGLIMITSEXCEEDED;
+            }
+            iovs[i][0].iov_base = channelDataEthernet->header;
+            iovs[i][0].iov_len = channelDataEthernet->headerLength;
+            iovs[i][1].iov_base = bufs[sent + i].data;
+            iovs[i][1].iov_len = bufs[sent + i].length;
+            msgs[i].msg_hdr.msg_name = &channelDataEthernet->sll;
+            msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_ll);
+            msgs[i].msg_hdr.msg_iov = iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 2;
+        }
+        int n = sendmmsg(channel->sockfd, msgs, (unsigned int)batchSize, 0);
+        if(n <= 0) {
+            if(n == -1 && UA_ERRNO == UA_INTERRUPTED)
+                continue;
+            UA_LOG_WARNING(UA_Log_Stdout, UA_LOGCATEGORY_SERVER, "PubSub Connection sending failed.");
+            return UA_STATUSCODE_BADINTERNALERROR;
+        }
+        sent += (size_t)n;
+    }
+    return UA_STATUSCODE_GOOD;
+#else
+    for(size_t i = 0; i < bufsSize; i++) {
+        UA_StatusCode retval = UA_PubSubChannelEthernet_send(channel, transportSettigns, &bufs[i]);
+        if(retval != UA_STATUSCODE_GOOD)
+            return retval;
+    }
+    return UA_STATUSCODE_GOOD;
+#endif
+}
+
+/**
+ * Receive messages. The regist function should be called before. The
+ * Ethernet header is removed from the message.
+ *
+ * @param timeout in usec
+ * @return
+ */
+static UA_StatusCode
+UA_PubSubChannelEthernet_receive(UA_PubSubChannel *channel, UA_ByteString *message,
+                                 UA_ExtensionObject *transportSettigns, UA_UInt32 timeout) {
+    if(!(channel->state == UA_PUBSUB_CHANNEL_PUB || channel->state == UA_PUBSUB_CHANNEL_PUB_SUB)) {
+        UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_SERVER, "PubSub Connection receive failed. Invalid state.");
+        return UA_STATUSCODE_BADINTERNALERROR;
+    }
+#ifdef UA_PUBSUB_ETHERNET_PACKET
+    if(timeout > 0) {
+        fd_set fdset;
+        FD_ZERO(&fdset);
+        UA_fd_set(channel->sockfd, &fdset);
+        struct timeval tmptv = {(long int)(timeout / 1000000),
+                                (long int)(timeout % 1000000)};
+        int resultsize = UA_select(channel->sockfd+1, &fdset, NULL, NULL, &tmptv);
+        if(resultsize == 0) {
+            message->length = 0;
+            return UA_STATUSCODE_GOODNONCRITICALTIMEOUT;
+        }
+        if(resultsize == -1) {
+            message->length = 0;
+            return UA_STATUSCODE_BADINTERNALERROR;
+        }
+    }
+
+    /* The kernel removes the VLAN tag of received frames. So the header is
+     * always UA_ETHERNET_HEADERSIZE long. */
+    UA_Byte header[UA_ETHERNET_HEADERSIZE];
+    struct iovec iovs[2];
+    iovs[0].iov_base = header;
+    iovs[0].iov_len = UA_ETHERNET_HEADERSIZE;
+    iovs[1].iov_base = message->data;
+    iovs[1].iov_len = message->length;
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(struct msghdr));
+    msg.msg_iov = iovs;
+    msg.msg_iovlen = 2;
+    ssize_t frameLength = recvmsg(channel->sockfd, &msg, MSG_DONTWAIT);
+    if(frameLength > UA_ETHERNET_HEADERSIZE)
+        message->length = (size_t)frameLength - UA_ETHERNET_HEADERSIZE;
+    else
+        message->length = 0;
+#else
+    UA_PubSubChannelDataEthernet *channelDataEthernet = (UA_PubSubChannelDataEthernet *) channel->handle;
+    if(!sys_mbox_valid(&channelDataEthernet->rxQueue)) {
+        UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_SERVER, "PubSub Connection receive failed. Not registered.");
+        message->length = 0;
+        return UA_STATUSCODE_BADINTERNALERROR;
+    }
+    void *frame = NULL;
+    u32_t res;
+    if(timeout == 0)
+        res = sys_arch_mbox_tryfetch(&channelDataEthernet->rxQueue, &frame);
+    else /* a timeout of 0 ms would block forever */
+        res = sys_arch_mbox_fetch(&channelDataEthernet->rxQueue, &frame, (timeout + 999) / 1000);
+    if(res == SYS_ARCH_TIMEOUT || !frame) {
+        message->length = 0;
+        return UA_STATUSCODE_GOODNONCRITICALTIMEOUT;
+    }
+    struct pbuf *p = (struct pbuf *)frame;
+    u16_t offset = lwipPayloadOffset(p);
+    size_t length = p->tot_len > offset ? (size_t)(p->tot_len - offset) : 0;
+    if(length > message->length)
+        length = message->length;
+    message->length = pbuf_copy_partial(p, message->data, (u16_t)length, offset);
+    pbuf_free(p);
+#endif
+    return UA_STATUSCODE_GOOD;
+}
+
+/**
+ * Close channel and free the channel data.
+ *
+ * @return UA_STATUSCODE_GOOD if success
+ */
+static UA_StatusCode
+UA_PubSubChannelEthernet_close(UA_PubSubChannel *channel) {
+    UA_PubSubChannelDataEthernet *channelDataEthernet = (UA_PubSubChannelDataEthernet *) channel->handle;
+#ifdef UA_PUBSUB_ETHERNET_PACKET
+    if(UA_close(channel->sockfd) != 0){
+        UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_SERVER, "PubSub Connection delete failed.");
+        return UA_STATUSCODE_BADINTERNALERROR;
+    }
+#else
+    if(lwipReceiver == channelDataEthernet)
+        UA_PubSubChannelEthernet_unregist(channel, NULL);
+#endif
+    //cleanup the internal NetworkLayer data
+    UA_free(channelDataEthernet);
+    UA_free(channel);
+    return UA_STATUSCODE_GOOD;
+}
+
+/**
+ * Generate a new channel. based on the given configuration.
+ *
+ * @param connectionConfig connection configuration
+ * @return  ref to created channel, NULL on error
+ */
+static UA_PubSubChannel *
+TransportLayerEthernet_addChannel(UA_PubSubConnectionConfig *connectionConfig) {
+    UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "PubSub channel requested");
+    UA_PubSubChannel * pubSubChannel = UA_PubSubChannelEthernet_open(connectionConfig);
+    if(pubSubChannel){
+        pubSubChannel->regist = UA_PubSubChannelEthernet_regist;
+        pubSubChannel->unregist = UA_PubSubChannelEthernet_unregist;
+        pubSubChannel->send = UA_PubSubChannelEthernet_send;
+        pubSubChannel->receive = UA_PubSubChannelEthernet_receive;
+        pubSubChannel->sendMany = UA_PubSubChannelEthernet_sendMany;
+        pubSubChannel->close = UA_PubSubChannelEthernet_close;
+        pubSubChannel->connectionConfig = connectionConfig;
+    }
+    return pubSubChannel;
+}
+
+//Ethernet channel factory
+UA_PubSubTransportLayer
+UA_PubSubTransportLayerEthernet() {
+    UA_PubSubTransportLayer pubSubTransportLayer;
+    pubSubTransportLayer.transportProfileUri = UA_STRING("http://opcfoundation.org/UA-Profile/Transport/pubsub-eth-uadp");
+    pubSubTransportLayer.createPubSubChannel = &TransportLayerEthernet_addChannel;
+    return pubSubTransportLayer;
+}
+
+#endif /* UA_ENABLE_PUBSUB_ETH_UADP */
+
 /*********************************** amalgamated original file "C:/open62541/arch/freertosLWIP/ua_clock.c" ***********************************/
 
 /* This work is licensed under a Creative Commons CCZero 1.0 Universal License.
@@ -71181,12 +76037,13 @@ UA_DateTime UA_DateTime_now(void) {
     return (tv.tv_sec * UA_DATETIME_SEC) + (tv.tv_usec * UA_DATETIME_USEC) + UA_DATETIME_UNIX_EPOCH;
 }
 
-#else /* UA_ARCHITECTURE_FREERTOSLWIP_POSIX_CLOCK */
+#endif /* UA_ARCHITECTURE_FREERTOSLWIP_POSIX_CLOCK */
+
+#ifndef UA_ARCHITECTURE_FREERTOSLWIP_POSIX_CLOCK
 
 /* The current time in UTC time */
 UA_DateTime UA_DateTime_now(void) {
-  UA_DateTime microSeconds = ((UA_DateTime)xTaskGetTickCount()) * (1000000 / configTICK_RATE_HZ);
-  return ((microSeconds / 1000000) * UA_DATETIME_SEC) + ((microSeconds % 1000000) * UA_DATETIME_USEC) + UA_DATETIME_UNIX_EPOCH;
+  return UA_DateTime_nowMonotonic() + UA_DATETIME_UNIX_EPOCH;
 }
 
 #endif /* UA_ARCHITECTURE_FREERTOSLWIP_POSIX_CLOCK */
@@ -71199,6 +76056,9 @@ UA_Int64 UA_DateTime_localTimeUtcOffset(void) {
 /* CPU clock invariant to system time changes. Use only to measure durations,
  * not absolute time. */
 UA_DateTime UA_DateTime_nowMonotonic(void) {
+  UA_DateTime now;
+  if(UA_DateTime_readClockSource(&now))
+    return now;
   return (((UA_DateTime)xTaskGetTickCount()) * 1000 / configTICK_RATE_HZ) * UA_DATETIME_MSEC;
 }
 
@@ -71271,10 +76131,111 @@ unsigned int lwip_if_nametoindex(const char *ifname){
 
 #include <string.h>  // memset
 
+#ifdef UA_ENABLE_NETWORK_EPOLL
+# ifndef __linux__
+#  error "UA_ENABLE_NETWORK_EPOLL requires Linux. Use the select backend instead."
+# endif
+# include <sys/epoll.h>
+# define UA_EPOLL_MAXEVENTS 64
+#endif
+
 #ifndef MSG_NOSIGNAL
 #define MSG_NOSIGNAL 0
 #endif
 
+/***************/
+/* Buffer Pool */
+/***************/
+
+/* Fixed-size send/recv buffers, allocated in one block when the server network
+ * layer starts. Free buffers are kept in a singly-linked list that is stored
+ * inside the buffers. Requests larger than the buffer size, or that find the
+ * pool empty, fall back to the heap. */
+
+#ifndef UA_NETWORK_TCP_BUFFERPOOLSIZE
+# define UA_NETWORK_TCP_BUFFERPOOLSIZE 8 /* Default number of pooled buffers */
+#endif
+
+typedef struct UA_PooledBuffer {
+    struct UA_PooledBuffer *next;
+} UA_PooledBuffer;
+
+typedef struct {
+    UA_Byte *memory;
+    size_t bufferSize;
+    size_t buffersSize;
+    UA_PooledBuffer *freeBuffers;
+    size_t hits;
+    size_t misses;
+    UA_LOCK_TYPE(poolLock)
+} UA_BufferPool;
+
+static UA_StatusCode
+UA_BufferPool_init(UA_BufferPool *pool, size_t buffersSize, size_t bufferSize) {
+    memset(pool, 0, sizeof(UA_BufferPool));
+    UA_LOCK_INIT(pool->poolLock)
+    if(buffersSize == 0 || bufferSize == 0)
+        return UA_STATUSCODE_GOOD;
+
+    /* Keep the free-list pointers aligned */
+    bufferSize = (bufferSize + sizeof(void*) - 1) & ~(sizeof(void*) - 1);
+    if(buffersSize > SIZE_MAX / bufferSize)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    pool->memory = (UA_Byte*)UA_malloc(buffersSize * bufferSize);
+    if(!pool->memory)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    pool->bufferSize = bufferSize;
+    pool->buffersSize = buffersSize;
+    for(size_t i = buffersSize; i > 0; i--) {
+        UA_PooledBuffer *b = (UA_PooledBuffer*)&pool->memory[(i - 1) * bufferSize];
+        b->next = pool->freeBuffers;
+        pool->freeBuffers = b;
+    }
+    return UA_STATUSCODE_GOOD;
+}
+
+static void
+UA_BufferPool_clear(UA_BufferPool *pool) {
+    UA_free(pool->memory);
+    UA_LOCK_DESTROY(pool->poolLock)
+    memset(pool, 0, sizeof(UA_BufferPool));
+}
+
+static UA_StatusCode
+UA_BufferPool_alloc(UA_BufferPool *pool, size_t length, UA_ByteString *buf) {
+    UA_LOCK(pool->poolLock);
+    if(length > 0 && length <= pool->bufferSize && pool->freeBuffers) {
+        UA_PooledBuffer *b = pool->freeBuffers;
+        pool->freeBuffers = b->next;
+        pool->hits++;
+        UA_UNLOCK(pool->poolLock);
+        buf->data = (UA_Byte*)b;
+        buf->length = length;
+        return UA_STATUSCODE_GOOD;
+    }
+    pool->misses++;
+    UA_UNLOCK(pool->poolLock);
+    return UA_ByteString_allocBuffer(buf, length);
+}
+
+static void
+UA_BufferPool_release(UA_BufferPool *pool, UA_ByteString *buf) {
+    if(!buf->data)
+        return;
+    if(!pool->memory || buf->data < pool->memory ||
+       buf->data >= &pool->memory[pool->buffersSize * pool->bufferSize]) {
+        UA_ByteString_deleteMembers(buf);
+        return;
+    }
+    UA_PooledBuffer *b = (UA_PooledBuffer*)buf->data;
+    UA_LOCK(pool->poolLock);
+    b->next = pool->freeBuffers;
+    pool->freeBuffers = b;
+    UA_UNLOCK(pool->poolLock);
+    buf->data = NULL;
+    buf->length = 0;
+}
+
 /****************************/
 /* Generic Socket Functions */
 /****************************/
@@ -71303,7 +76264,7 @@ connection_releaserecvbuffer(UA_Connection *connection,
 static UA_StatusCode
 connection_write(UA_Connection *connection, UA_ByteString *buf) {
     if(connection->state == UA_CONNECTION_CLOSED) {
-        UA_ByteString_deleteMembers(buf);
+        connection->releaseSendBuffer(connection, buf);
         return UA_STATUSCODE_BADCONNECTIONCLOSED;
     }
 
@@ -71322,7 +76283,7 @@ connection_write(UA_Connection *connection, UA_ByteString *buf) {
                      bytes_to_send, flags);
             if(n < 0 && UA_ERRNO != UA_INTERRUPTED && UA_ERRNO != UA_AGAIN) {
                 connection->close(connection);
-                UA_ByteString_deleteMembers(buf);
+                connection->releaseSendBuffer(connection, buf);
                 return UA_STATUSCODE_BADCONNECTIONCLOSED;
             }
         } while(n < 0);
@@ -71330,38 +76291,88 @@ connection_write(UA_Connection *connection, UA_ByteString *buf) {
     } while(nWritten < buf->length);
 
     /* Free the buffer */
-    UA_ByteString_deleteMembers(buf);
+    connection->releaseSendBuffer(connection, buf);
     return UA_STATUSCODE_GOOD;
 }
 
+#ifndef UA_CONNECTION_MAXIOV
+# define UA_CONNECTION_MAXIOV 16 /* Buffers per writev call */
+#endif
+
+/* Send several buffers with a single writev where the architecture supports
+ * it. Otherwise the buffers are sent one after the other. All buffers are
+ * freed. */
 static UA_StatusCode
-connection_recv(UA_Connection *connection, UA_ByteString *response,
-                UA_UInt32 timeout) {
-    if(connection->state == UA_CONNECTION_CLOSED)
-        return UA_STATUSCODE_BADCONNECTIONCLOSED;
+connection_writeMany(UA_Connection *connection, UA_ByteString *bufs,
+                     size_t bufsSize) {
+    UA_StatusCode retval = UA_STATUSCODE_GOOD;
+    size_t sent = 0; /* Buffers that have been handed to connection_write */
+    if(connection->state == UA_CONNECTION_CLOSED) {
+        retval = UA_STATUSCODE_BADCONNECTIONCLOSED;
+        goto cleanup;
+    }
 
-    /* Listen on the socket for the given timeout until a message arrives */
-    fd_set fdset;
-    FD_ZERO(&fdset);
-    UA_fd_set(connection->sockfd, &fdset);
-    UA_UInt32 timeout_usec = timeout * 1000;
-    struct timeval tmptv = {(long int)(timeout_usec / 1000000),
-                            (int)(timeout_usec % 1000000)};
-    int resultsize = UA_select(connection->sockfd+1, &fdset, NULL, NULL, &tmptv);
+#ifdef UA_writev
+    {
+        struct iovec iov[UA_CONNECTION_MAXIOV];
+        size_t current = 0;       /* First buffer that is not completely sent */
+        size_t currentOffset = 0; /* Bytes already sent from that buffer */
+        while(current < bufsSize) {
+            int iovcnt = 0;
+            for(size_t i = current; i < bufsSize && iovcnt < UA_CONNECTION_MAXIOV; i++) {
+                size_t skip = (i == current) ? currentOffset : 0;
+                iov[iovcnt].iov_base = &bufs[i].data[skip];
+                iov[iovcnt].iov_len = bufs[i].length - skip;
+                iovcnt++;
+            }
 
-    /* No result */
-    if(resultsize == 0)
-        return UA_STATUSCODE_GOODNONCRITICALTIMEOUT;
+            ssize_t n = UA_writev(connection->sockfd, iov, iovcnt);
+            if(n < 0) {
+                if(UA_ERRNO == UA_INTERRUPTED || UA_ERRNO == UA_AGAIN)
+                    continue;
+                connection->close(connection);
+                retval = UA_STATUSCODE_BADCONNECTIONCLOSED;
+                goto cleanup;
+            }
 
-    if(resultsize == -1) {
-        /* The call to select was interrupted. Act as if it timed out. */
-        if(UA_ERRNO == EINTR)
-            return UA_STATUSCODE_GOODNONCRITICALTIMEOUT;
+            /* Advance over the written bytes. Partial writes continue within
+             * the current buffer. */
+            size_t written = (size_t)n;
+            while(current < bufsSize &&
+                  written >= bufs[current].length - currentOffset) {
+                written -= bufs[current].length - currentOffset;
+                currentOffset = 0;
+                current++;
+            }
+            currentOffset += written;
+        }
+    }
+#else
+    for(; sent < bufsSize; sent++) {
+        retval = connection_write(connection, &bufs[sent]);
+        if(retval != UA_STATUSCODE_GOOD) {
+            sent++;
+            break;
+        }
+    }
+#endif
 
-        /* The error cannot be recovered. Close the connection. */
-        connection->close(connection);
+ cleanup:
+    for(size_t i = sent; i < bufsSize; i++)
+        connection->releaseSendBuffer(connection, &bufs[i]);
+    return retval;
+}
+
+/* Receive from a socket that is known to have pending activity. The server
+ * network layer calls this directly after its own select/epoll, so that no
+ * additional select per socket is required. If no buffer is given, it is
+ * taken from the pool (if defined) or allocated. The buffer is released with
+ * connection->releaseRecvBuffer. */
+static UA_StatusCode
+connection_recvReady(UA_Connection *connection, UA_ByteString *response,
+                     UA_UInt32 timeout, UA_BufferPool *pool) {
+    if(connection->state == UA_CONNECTION_CLOSED)
         return UA_STATUSCODE_BADCONNECTIONCLOSED;
-    }
 
     UA_Boolean internallyAllocated = !response->length;
 
@@ -71371,7 +76382,8 @@ connection_recv(UA_Connection *connection, UA_ByteString *response,
         UA_SecureChannel *channel = connection->channel;
         if(channel && channel->config.recvBufferSize > 0)
             bufferSize = channel->config.recvBufferSize;
-        UA_StatusCode res = UA_ByteString_allocBuffer(response, bufferSize);
+        UA_StatusCode res = pool ? UA_BufferPool_alloc(pool, bufferSize, response) :
+            UA_ByteString_allocBuffer(response, bufferSize);
         if(res != UA_STATUSCODE_GOOD)
             return res;
     }
@@ -71382,7 +76394,7 @@ connection_recv(UA_Connection *connection, UA_ByteString *response,
     /* The remote side closed the connection */
     if(ret == 0) {
         if(internallyAllocated)
-            UA_ByteString_deleteMembers(response);
+            connection->releaseRecvBuffer(connection, response);
         connection->close(connection);
         return UA_STATUSCODE_BADCONNECTIONCLOSED;
     }
@@ -71390,7 +76402,7 @@ connection_recv(UA_Connection *connection, UA_ByteString *response,
     /* Error case */
     if(ret < 0) {
         if(internallyAllocated)
-            UA_ByteString_deleteMembers(response);
+            connection->releaseRecvBuffer(connection, response);
         if(UA_ERRNO == UA_INTERRUPTED || (timeout > 0) ?
            false : (UA_ERRNO == UA_EAGAIN || UA_ERRNO == UA_WOULDBLOCK))
             return UA_STATUSCODE_GOOD; /* statuscode_good but no data -> retry */
@@ -71403,6 +76415,38 @@ connection_recv(UA_Connection *connection, UA_ByteString *response,
     return UA_STATUSCODE_GOOD;
 }
 
+static UA_StatusCode
+connection_recv(UA_Connection *connection, UA_ByteString *response,
+                UA_UInt32 timeout) {
+    if(connection->state == UA_CONNECTION_CLOSED)
+        return UA_STATUSCODE_BADCONNECTIONCLOSED;
+
+    /* Listen on the socket for the given timeout until a message arrives */
+    fd_set fdset;
+    FD_ZERO(&fdset);
+    UA_fd_set(connection->sockfd, &fdset);
+    UA_UInt32 timeout_usec = timeout * 1000;
+    struct timeval tmptv = {(long int)(timeout_usec / 1000000),
+                            (int)(timeout_usec % 1000000)};
+    int resultsize = UA_select(connection->sockfd+1, &fdset, NULL, NULL, &tmptv);
+
+    /* No result */
+    if(resultsize == 0)
+        return UA_STATUSCODE_GOODNONCRITICALTIMEOUT;
+
+    if(resultsize == -1) {
+        /* The call to select was interrupted. Act as if it timed out. */
+        if(UA_ERRNO == EINTR)
+            return UA_STATUSCODE_GOODNONCRITICALTIMEOUT;
+
+        /* The error cannot be recovered. Close the connection. */
+        connection->close(connection);
+        return UA_STATUSCODE_BADCONNECTIONCLOSED;
+    }
+
+    return connection_recvReady(connection, response, timeout, NULL);
+}
+
 
 /***************************/
 /* Server NetworkLayer TCP */
@@ -71423,8 +76467,68 @@ typedef struct {
     UA_SOCKET serverSockets[FD_SETSIZE];
     UA_UInt16 serverSocketsSize;
     LIST_HEAD(, ConnectionEntry) connections;
+    size_t bufferPoolSize; /* Number of pooled buffers, 0 disables the pool */
+    UA_BufferPool bufferPool;
+#ifdef UA_ENABLE_NETWORK_EPOLL
+    /* The server and connection sockets are registered persistently. The
+     * event data points to the ConnectionEntry, or to the entry in
+     * serverSockets for the listening sockets. If the epoll instance cannot be
+     * created, the layer falls back to select. */
+    int epollfd;
+#endif
 } ServerNetworkLayerTCP;
 
+#ifdef UA_ENABLE_NETWORK_EPOLL
+static UA_StatusCode
+epollRegister(ServerNetworkLayerTCP *layer, UA_SOCKET sockfd, void *data) {
+    if(layer->epollfd < 0)
+        return UA_STATUSCODE_GOOD;
+    struct epoll_event event;
+    memset(&event, 0, sizeof(struct epoll_event));
+    event.events = EPOLLIN | EPOLLRDHUP;
+    event.data.ptr = data;
+    if(epoll_ctl(layer->epollfd, EPOLL_CTL_ADD, sockfd, &event) != 0) {
+        UA_LOG_SOCKET_ERRNO_WRAP(
+            UA_LOG_WARNING(layer->logger, UA_LOGCATEGORY_NETWORK,
+                           "Socket %i | Could not register with epoll: %s",
+                           (int)sockfd, errno_str));
+        return UA_STATUSCODE_BADINTERNALERROR;
+    }
+    return UA_STATUSCODE_GOOD;
+}
+#endif
+
+/* Remove a connection from the layer and hand it over to the server. The
+ * connection memory is freed by the server via connection->free. */
+static void
+removeConnectionEntry(ServerNetworkLayerTCP *layer, UA_Server *server,
+                      ConnectionEntry *e) {
+    LIST_REMOVE(e, pointers);
+#ifdef UA_ENABLE_NETWORK_EPOLL
+    if(layer->epollfd >= 0)
+        epoll_ctl(layer->epollfd, EPOLL_CTL_DEL, e->connection.sockfd, NULL);
+#endif
+    UA_close(e->connection.sockfd);
+    UA_Server_removeConnection(server, &e->connection);
+}
+
+static UA_StatusCode
+ServerNetworkLayerTCP_getSendBuffer(UA_Connection *connection,
+                                    size_t length, UA_ByteString *buf) {
+    ServerNetworkLayerTCP *layer = (ServerNetworkLayerTCP*)connection->handle;
+    UA_SecureChannel *channel = connection->channel;
+    if(channel && channel->config.sendBufferSize < length)
+        return UA_STATUSCODE_BADCOMMUNICATIONERROR;
+    return UA_BufferPool_alloc(&layer->bufferPool, length, buf);
+}
+
+static void
+ServerNetworkLayerTCP_releaseBuffer(UA_Connection *connection,
+                                    UA_ByteString *buf) {
+    ServerNetworkLayerTCP *layer = (ServerNetworkLayerTCP*)connection->handle;
+    UA_BufferPool_release(&layer->bufferPool, buf);
+}
+
 static void
 ServerNetworkLayerTCP_freeConnection(UA_Connection *connection) {
     UA_free(connection);
@@ -71491,14 +76595,23 @@ ServerNetworkLayerTCP_add(UA_ServerNetworkLayer *nl, ServerNetworkLayerTCP *laye
     c->sockfd = newsockfd;
     c->handle = layer;
     c->send = connection_write;
+    c->sendMany = connection_writeMany;
     c->close = ServerNetworkLayerTCP_close;
     c->free = ServerNetworkLayerTCP_freeConnection;
-    c->getSendBuffer = connection_getsendbuffer;
-    c->releaseSendBuffer = connection_releasesendbuffer;
-    c->releaseRecvBuffer = connection_releaserecvbuffer;
+    c->getSendBuffer = ServerNetworkLayerTCP_getSendBuffer;
+    c->releaseSendBuffer = ServerNetworkLayerTCP_releaseBuffer;
+    c->releaseRecvBuffer = ServerNetworkLayerTCP_releaseBuffer;
     c->state = UA_CONNECTION_OPENING;
     c->openingDate = UA_DateTime_nowMonotonic();
 
+#ifdef UA_ENABLE_NETWORK_EPOLL
+    if(epollRegister(layer, newsockfd, e) != UA_STATUSCODE_GOOD) {
+        UA_close(newsockfd);
+        UA_free(e);
+        return UA_STATUSCODE_BADINTERNALERROR;
+    }
+#endif
+
     /* Add to the linked list */
     LIST_INSERT_HEAD(&layer->connections, e, pointers);
     return UA_STATUSCODE_GOOD;
@@ -71574,15 +76687,70 @@ addServerSocket(ServerNetworkLayerTCP *layer, struct addrinfo *ai) {
     }
 
     layer->serverSockets[layer->serverSocketsSize] = newsock;
+#ifdef UA_ENABLE_NETWORK_EPOLL
+    if(epollRegister(layer, newsock,
+                     &layer->serverSockets[layer->serverSocketsSize]) != UA_STATUSCODE_GOOD) {
+        UA_close(newsock);
+        return;
+    }
+#endif
     layer->serverSocketsSize++;
 }
 
+static UA_StatusCode
+setDiscoveryUrl(UA_ServerNetworkLayer *nl, const UA_String *customHostname,
+                UA_UInt16 port, const UA_Logger *logger) {
+    UA_String du = UA_STRING_NULL;
+    char discoveryUrlBuffer[256];
+    if (customHostname->length) {
+        du.length = (size_t)UA_snprintf(discoveryUrlBuffer, 255, "opc.tcp://%.*s:%d/",
+                                        (int)customHostname->length,
+                                        customHostname->data,
+                                        port);
+        du.data = (UA_Byte*)discoveryUrlBuffer;
+    }else{
+        char hostnameBuffer[256];
+        if(UA_gethostname(hostnameBuffer, 255) == 0) {
+            du.length = (size_t)UA_snprintf(discoveryUrlBuffer, 255, "opc.tcp://%s:%d/",
+                                            hostnameBuffer, port);
+            du.data = (UA_Byte*)discoveryUrlBuffer;
+        } else {
+            UA_LOG_ERROR(logger, UA_LOGCATEGORY_NETWORK, "Could not get the hostname");
+            return UA_STATUSCODE_BADINTERNALERROR;
+        }
+    }
+    return UA_String_copy(&du, &nl->discoveryUrl);
+}
+
 static UA_StatusCode
 ServerNetworkLayerTCP_start(UA_ServerNetworkLayer *nl, const UA_String *customHostname) {
   UA_initialize_architecture_network();
 
     ServerNetworkLayerTCP *layer = (ServerNetworkLayerTCP *)nl->handle;
 
+    /* Allocate the buffer pool once. The buffers are large enough for the
+     * configured send and receive chunks. */
+    if(!layer->bufferPool.memory && layer->bufferPoolSize > 0) {
+        size_t bufferSize = nl->localConnectionConfig.recvBufferSize;
+        if(nl->localConnectionConfig.sendBufferSize > bufferSize)
+            bufferSize = nl->localConnectionConfig.sendBufferSize;
+        if(UA_BufferPool_init(&layer->bufferPool, layer->bufferPoolSize,
+                              bufferSize) != UA_STATUSCODE_GOOD)
+            UA_LOG_WARNING(layer->logger, UA_LOGCATEGORY_NETWORK,
+                           "Could not allocate the buffer pool, buffers are "
+                           "allocated per message");
+    }
+
+#ifdef UA_ENABLE_NETWORK_EPOLL
+    layer->epollfd = epoll_create1(EPOLL_CLOEXEC);
+    if(layer->epollfd < 0) {
+        UA_LOG_SOCKET_ERRNO_WRAP(
+            UA_LOG_WARNING(layer->logger, UA_LOGCATEGORY_NETWORK,
+                           "Could not create the epoll instance, falling back "
+                           "to select: %s", errno_str));
+    }
+#endif
+
     /* Get addrinfo of the server and create server sockets */
     char portno[6];
     UA_snprintf(portno, 6, "%d", layer->port);
@@ -71605,26 +76773,9 @@ ServerNetworkLayerTCP_start(UA_ServerNetworkLayer *nl, const UA_String *customHo
     UA_freeaddrinfo(res);
 
     /* Get the discovery url from the hostname */
-    UA_String du = UA_STRING_NULL;
-    char discoveryUrlBuffer[256];
-    if (customHostname->length) {
-        du.length = (size_t)UA_snprintf(discoveryUrlBuffer, 255, "opc.tcp://%.*s:%d/",
-                                        (int)customHostname->length,
-                                        customHostname->data,
-                                        layer->port);
-        du.data = (UA_Byte*)discoveryUrlBuffer;
-    }else{
-        char hostnameBuffer[256];
-        if(UA_gethostname(hostnameBuffer, 255) == 0) {
-            du.length = (size_t)UA_snprintf(discoveryUrlBuffer, 255, "opc.tcp://%s:%d/",
-                                            hostnameBuffer, layer->port);
-            du.data = (UA_Byte*)discoveryUrlBuffer;
-        } else {
-            UA_LOG_ERROR(layer->logger, UA_LOGCATEGORY_NETWORK, "Could not get the hostname");
-            return UA_STATUSCODE_BADINTERNALERROR;
-        }
-    }
-    UA_String_copy(&du, &nl->discoveryUrl);
+    UA_StatusCode retval = setDiscoveryUrl(nl, customHostname, layer->port, layer->logger);
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
 
     UA_LOG_INFO(layer->logger, UA_LOGCATEGORY_NETWORK,
                 "TCP network layer listening on %.*s",
@@ -71653,6 +76804,104 @@ setFDSet(ServerNetworkLayerTCP *layer, fd_set *fdset) {
     return highestfd;
 }
 
+static void
+acceptConnection(UA_ServerNetworkLayer *nl, ServerNetworkLayerTCP *layer,
+                 UA_SOCKET serverSocket) {
+    struct sockaddr_storage remote;
+    socklen_t remote_size = sizeof(remote);
+    UA_SOCKET newsockfd = UA_accept(serverSocket,
+                                    (struct sockaddr*)&remote, &remote_size);
+    if(newsockfd == UA_INVALID_SOCKET)
+        return;
+
+    UA_LOG_TRACE(layer->logger, UA_LOGCATEGORY_NETWORK,
+                 "Connection %i | New TCP connection on server socket %i",
+                 (int)newsockfd, (int)serverSocket);
+
+    ServerNetworkLayerTCP_add(nl, layer, (UA_Int32)newsockfd, &remote);
+}
+
+static void
+processConnection(ServerNetworkLayerTCP *layer, UA_Server *server,
+                  ConnectionEntry *e) {
+    UA_LOG_TRACE(layer->logger, UA_LOGCATEGORY_NETWORK,
+                 "Connection %i | Activity on the socket",
+                 (int)(e->connection.sockfd));
+
+    UA_ByteString buf = UA_BYTESTRING_NULL;
+    UA_StatusCode retval = connection_recvReady(&e->connection, &buf, 0,
+                                                &layer->bufferPool);
+
+    if(retval == UA_STATUSCODE_GOOD) {
+        /* Process packets */
+        UA_Server_processBinaryMessage(server, &e->connection, &buf);
+        e->connection.releaseRecvBuffer(&e->connection, &buf);
+    } else if(retval == UA_STATUSCODE_BADCONNECTIONCLOSED) {
+        /* The socket is shutdown but not closed */
+        UA_LOG_INFO(layer->logger, UA_LOGCATEGORY_NETWORK,
+                    "Connection %i | Closed",
+                    (int)(e->connection.sockfd));
+        removeConnectionEntry(layer, server, e);
+    }
+}
+
+static UA_Boolean
+helloTimedOut(ServerNetworkLayerTCP *layer, UA_Server *server,
+              ConnectionEntry *e, UA_DateTime now) {
+    if((e->connection.state != UA_CONNECTION_OPENING) ||
+       (now <= (e->connection.openingDate + (NOHELLOTIMEOUT * UA_DATETIME_MSEC))))
+        return false;
+    UA_LOG_INFO(layer->logger, UA_LOGCATEGORY_NETWORK,
+                "Connection %i | Closed by the server (no Hello Message)",
+                (int)(e->connection.sockfd));
+    removeConnectionEntry(layer, server, e);
+    return true;
+}
+
+#ifdef UA_ENABLE_NETWORK_EPOLL
+/* Only the sockets with pending events are returned from epoll_wait. The
+ * remaining walk over the connections checks the Hello timeout and does not
+ * issue syscalls. */
+static UA_StatusCode
+ServerNetworkLayerTCP_listenEpoll(UA_ServerNetworkLayer *nl, UA_Server *server,
+                                  UA_UInt16 timeout) {
+    ServerNetworkLayerTCP *layer = (ServerNetworkLayerTCP *)nl->handle;
+    struct epoll_event events[UA_EPOLL_MAXEVENTS];
+    int n = epoll_wait(layer->epollfd, events, UA_EPOLL_MAXEVENTS, (int)timeout);
+    if(n < 0) {
+        UA_LOG_SOCKET_ERRNO_WRAP(
+            UA_LOG_DEBUG(layer->logger, UA_LOGCATEGORY_NETWORK,
+                         "Socket epoll_wait failed with %s", errno_str));
+        // we will retry, so do not return bad
+        return UA_STATUSCODE_GOOD;
+    }
+
+    for(int i = 0; i < n; i++) {
+        void *data = events[i].data.ptr;
+
+        /* Accept new connections via the server sockets */
+        UA_Boolean isServerSocket = false;
+        for(UA_UInt16 j = 0; j < layer->serverSocketsSize; j++) {
+            if(data != &layer->serverSockets[j])
+                continue;
+            acceptConnection(nl, layer, layer->serverSockets[j]);
+            isServerSocket = true;
+            break;
+        }
+
+        /* Read from established sockets */
+        if(!isServerSocket)
+            processConnection(layer, server, (ConnectionEntry*)data);
+    }
+
+    ConnectionEntry *e, *e_tmp;
+    UA_DateTime now = UA_DateTime_nowMonotonic();
+    LIST_FOREACH_SAFE(e, &layer->connections, pointers, e_tmp)
+        helloTimedOut(layer, server, e, now);
+    return UA_STATUSCODE_GOOD;
+}
+#endif
+
 static UA_StatusCode
 ServerNetworkLayerTCP_listen(UA_ServerNetworkLayer *nl, UA_Server *server,
                              UA_UInt16 timeout) {
@@ -71662,6 +76911,11 @@ ServerNetworkLayerTCP_listen(UA_ServerNetworkLayer *nl, UA_Server *server,
     if (layer->serverSocketsSize == 0)
         return UA_STATUSCODE_GOOD;
 
+#ifdef UA_ENABLE_NETWORK_EPOLL
+    if(layer->epollfd >= 0)
+        return ServerNetworkLayerTCP_listenEpoll(nl, server, timeout);
+#endif
+
     /* Listen on open sockets (including the server) */
     fd_set fdset, errset;
     UA_Int32 highestfd = setFDSet(layer, &fdset);
@@ -71679,60 +76933,21 @@ ServerNetworkLayerTCP_listen(UA_ServerNetworkLayer *nl, UA_Server *server,
     for(UA_UInt16 i = 0; i < layer->serverSocketsSize; i++) {
         if(!UA_fd_isset(layer->serverSockets[i], &fdset))
             continue;
-
-        struct sockaddr_storage remote;
-        socklen_t remote_size = sizeof(remote);
-        UA_SOCKET newsockfd = UA_accept((UA_SOCKET)layer->serverSockets[i],
-                                  (struct sockaddr*)&remote, &remote_size);
-        if(newsockfd == UA_INVALID_SOCKET)
-            continue;
-
-        UA_LOG_TRACE(layer->logger, UA_LOGCATEGORY_NETWORK,
-                    "Connection %i | New TCP connection on server socket %i",
-                    (int)newsockfd, (int)(layer->serverSockets[i]));
-
-        ServerNetworkLayerTCP_add(nl, layer, (UA_Int32)newsockfd, &remote);
+        acceptConnection(nl, layer, (UA_SOCKET)layer->serverSockets[i]);
     }
 
     /* Read from established sockets */
     ConnectionEntry *e, *e_tmp;
     UA_DateTime now = UA_DateTime_nowMonotonic();
     LIST_FOREACH_SAFE(e, &layer->connections, pointers, e_tmp) {
-        if ((e->connection.state == UA_CONNECTION_OPENING) &&
-            (now > (e->connection.openingDate + (NOHELLOTIMEOUT * UA_DATETIME_MSEC)))){
-            UA_LOG_INFO(layer->logger, UA_LOGCATEGORY_NETWORK,
-                        "Connection %i | Closed by the server (no Hello Message)",
-                         (int)(e->connection.sockfd));
-            LIST_REMOVE(e, pointers);
-            UA_close(e->connection.sockfd);
-            UA_Server_removeConnection(server, &e->connection);
+        if(helloTimedOut(layer, server, e, now))
             continue;
-        }
 
         if(!UA_fd_isset(e->connection.sockfd, &errset) &&
            !UA_fd_isset(e->connection.sockfd, &fdset))
           continue;
 
-        UA_LOG_TRACE(layer->logger, UA_LOGCATEGORY_NETWORK,
-                    "Connection %i | Activity on the socket",
-                    (int)(e->connection.sockfd));
-
-        UA_ByteString buf = UA_BYTESTRING_NULL;
-        UA_StatusCode retval = connection_recv(&e->connection, &buf, 0);
-
-        if(retval == UA_STATUSCODE_GOOD) {
-            /* Process packets */
-            UA_Server_processBinaryMessage(server, &e->connection, &buf);
-            connection_releaserecvbuffer(&e->connection, &buf);
-        } else if(retval == UA_STATUSCODE_BADCONNECTIONCLOSED) {
-            /* The socket is shutdown but not closed */
-            UA_LOG_INFO(layer->logger, UA_LOGCATEGORY_NETWORK,
-                        "Connection %i | Closed",
-                        (int)(e->connection.sockfd));
-            LIST_REMOVE(e, pointers);
-            UA_close(e->connection.sockfd);
-            UA_Server_removeConnection(server, &e->connection);
-        }
+        processConnection(layer, server, e);
     }
     return UA_STATUSCODE_GOOD;
 }
@@ -71759,6 +76974,13 @@ ServerNetworkLayerTCP_stop(UA_ServerNetworkLayer *nl, UA_Server *server) {
      * the connection. */
     ServerNetworkLayerTCP_listen(nl, server, 0);
 
+#ifdef UA_ENABLE_NETWORK_EPOLL
+    if(layer->epollfd >= 0) {
+        UA_close(layer->epollfd);
+        layer->epollfd = -1;
+    }
+#endif
+
     UA_deinitialize_architecture_network();
 }
 
@@ -71777,10 +76999,38 @@ ServerNetworkLayerTCP_deleteMembers(UA_ServerNetworkLayer *nl) {
         UA_free(e);
     }
 
+    UA_LOG_DEBUG(layer->logger, UA_LOGCATEGORY_NETWORK,
+                 "Buffer pool: %lu hits, %lu misses",
+                 (unsigned long)layer->bufferPool.hits,
+                 (unsigned long)layer->bufferPool.misses);
+    UA_BufferPool_clear(&layer->bufferPool);
+
     /* Free the layer */
     UA_free(layer);
 }
 
+void
+UA_ServerNetworkLayerTCP_setBufferPoolSize(UA_ServerNetworkLayer *nl, size_t buffers) {
+    ServerNetworkLayerTCP *layer = (ServerNetworkLayerTCP *)nl->handle;
+    if(layer)
+        layer->bufferPoolSize = buffers;
+}
+
+void
+UA_ServerNetworkLayerTCP_getBufferPoolStatistics(const UA_ServerNetworkLayer *nl,
+                                                 UA_NetworkBufferPoolStatistics *stats) {
+    memset(stats, 0, sizeof(UA_NetworkBufferPoolStatistics));
+    ServerNetworkLayerTCP *layer = (ServerNetworkLayerTCP *)nl->handle;
+    if(!layer)
+        return;
+    UA_LOCK(layer->bufferPool.poolLock);
+    stats->buffers = layer->bufferPool.buffersSize;
+    stats->bufferSize = layer->bufferPool.bufferSize;
+    stats->hits = layer->bufferPool.hits;
+    stats->misses = layer->bufferPool.misses;
+    UA_UNLOCK(layer->bufferPool.poolLock);
+}
+
 UA_ServerNetworkLayer
 UA_ServerNetworkLayerTCP(UA_ConnectionConfig config, UA_UInt16 port,
                          UA_Logger *logger) {
@@ -71801,10 +77051,662 @@ UA_ServerNetworkLayerTCP(UA_ConnectionConfig config, UA_UInt16 port,
 
     layer->logger = logger;
     layer->port = port;
+    layer->bufferPoolSize = UA_NETWORK_TCP_BUFFERPOOLSIZE;
+#ifdef UA_ENABLE_NETWORK_EPOLL
+    layer->epollfd = -1;
+#endif
 
     return nl;
 }
 
+#ifdef UA_ARCHITECTURE_FREERTOSLWIP
+
+/****************************/
+/* Server NetworkLayer lwIP */
+/****************************/
+
+/* The layer uses the raw TCP API of lwIP instead of the socket emulation. The
+ * lwIP callbacks run in the tcpip thread. They only queue the received pbufs
+ * and count the acknowledged bytes. The server thread takes the core lock
+ * (LWIP_TCPIP_CORE_LOCKING) for every call into the raw API and processes the
+ * pbufs without copying them into a receive buffer. Send buffers are handed to
+ * tcp_write without TCP_WRITE_FLAG_COPY. They are kept until lwIP reports
+ * them as acknowledged and then returned to the buffer pool.
+ *
+ * The socket state is allocated separately from the UA_Connection. The
+ * connection is handed to the server when it is closed, but lwIP may still
+ * reference the socket and its send buffers until the remaining data is
+ * acknowledged. */
+
+#include <lwip/tcp.h>
+
+#if !LWIP_TCPIP_CORE_LOCKING
+# error "The lwIP server network layer requires LWIP_TCPIP_CORE_LOCKING"
+#endif
+
+#ifndef UA_NETWORK_LWIP_MAXUNACKED
+# define UA_NETWORK_LWIP_MAXUNACKED 8 /* Send buffers per connection held by lwIP */
+#endif
+
+#define UA_NETWORK_LWIP_SENDTIMEOUT 5000  /* ms to wait for space in the send buffer */
+#define UA_NETWORK_LWIP_CLOSETIMEOUT 5000 /* ms to wait for the remaining acks
+                                           * before a closed connection is aborted */
+
+struct ServerNetworkLayerLwIP;
+
+typedef struct LwIPSocket {
+    LIST_ENTRY(LwIPSocket) pointers; /* In the list of closed sockets */
+    struct ServerNetworkLayerLwIP *layer;
+    struct tcp_pcb *pcb; /* NULL once the pcb is closed or was freed by lwIP */
+    struct pbuf *received; /* Received and not yet processed */
+    UA_Boolean remoteClosed;
+    UA_Boolean closeRequested; /* Close the pcb once all data is acknowledged */
+    UA_DateTime closeDate;
+
+    /* Signalled by the lwIP callbacks while a write waits for acknowledged
+     * data. Separate from the activity of the layer, so that a waiting write
+     * does not consume the wakeups of listen. */
+    sys_sem_t writable;
+    UA_Boolean writeWaiting;
+
+    /* Buffers handed to tcp_write. The byte counters wrap around. */
+    UA_ByteString unacked[UA_NETWORK_LWIP_MAXUNACKED];
+    size_t unackedStart;
+    size_t unackedSize;
+    u32_t queued;   /* Bytes handed to tcp_write */
+    u32_t acked;    /* Bytes acknowledged by the remote side */
+    u32_t released; /* Bytes of the released buffers */
+} LwIPSocket;
+
+typedef struct LwIPConnectionEntry {
+    UA_Connection connection;
+    LIST_ENTRY(LwIPConnectionEntry) pointers;
+    LwIPSocket *socket;
+} LwIPConnectionEntry;
+
+typedef struct ServerNetworkLayerLwIP {
+    const UA_Logger *logger;
+    UA_UInt16 port;
+    struct tcp_pcb *listenPcb;
+    sys_sem_t activity; /* Signalled by the lwIP callbacks */
+    UA_Int32 lastConnectionId; /* Used as the sockfd for logging */
+    LIST_HEAD(, LwIPConnectionEntry) accepted; /* Added in the tcpip thread */
+    LIST_HEAD(, LwIPConnectionEntry) connections;
+    LIST_HEAD(, LwIPSocket) closed; /* Waiting for the remaining acks */
+    UA_BufferPool bufferPool;
+} ServerNetworkLayerLwIP;
+
+/* Stop the callbacks and close the pcb. Called with the core lock held or
+ * from a callback in the tcpip thread. Returns ERR_ABRT if the pcb had to be
+ * aborted. */
+static err_t
+LwIPSocket_detach(LwIPSocket *s) {
+    struct tcp_pcb *pcb = s->pcb;
+    if(!pcb)
+        return ERR_OK;
+    s->pcb = NULL;
+    tcp_arg(pcb, NULL);
+    tcp_recv(pcb, NULL);
+    tcp_sent(pcb, NULL);
+    tcp_err(pcb, NULL);
+    if(tcp_close(pcb) == ERR_OK)
+        return ERR_OK;
+    tcp_abort(pcb);
+    return ERR_ABRT;
+}
+
+/* Return the acknowledged send buffers to the pool. All buffers are released
+ * once lwIP no longer references them. Called from the server thread with the
+ * core lock held. */
+static void
+LwIPSocket_releaseAcked(LwIPSocket *s) {
+    while(s->unackedSize > 0) {
+        UA_ByteString *buf = &s->unacked[s->unackedStart];
+        u32_t length = (u32_t)buf->length;
+        if(s->pcb && (u32_t)(s->acked - s->released) < length)
+            break;
+        s->released += length;
+        UA_BufferPool_release(&s->layer->bufferPool, buf);
+        s->unackedStart = (s->unackedStart + 1) % UA_NETWORK_LWIP_MAXUNACKED;
+        s->unackedSize--;
+    }
+}
+
+/* Drop the received data that is not yet processed */
+static void
+LwIPSocket_dropReceived(LwIPSocket *s) {
+    if(!s->received)
+        return;
+    if(s->pcb)
+        tcp_recved(s->pcb, s->received->tot_len);
+    pbuf_free(s->received);
+    s->received = NULL;
+}
+
+static err_t
+lwipRecv(void *arg, struct tcp_pcb *pcb, struct pbuf *p, err_t err) {
+    LwIPSocket *s = (LwIPSocket*)arg;
+    if(!s) {
+        if(p)
+            pbuf_free(p);
+        return ERR_OK;
+    }
+    if(!p) {
+        s->remoteClosed = true;
+    } else if(s->closeRequested) {
+        /* Nobody processes the data anymore */
+        tcp_recved(pcb, p->tot_len);
+        pbuf_free(p);
+        return ERR_OK;
+    } else if(s->received) {
+        pbuf_cat(s->received, p);
+    } else {
+        s->received = p;
+    }
+    sys_sem_signal(&s->layer->activity);
+    return ERR_OK;
+}
+
+static err_t
+lwipSent(void *arg, struct tcp_pcb *pcb, u16_t len) {
+    LwIPSocket *s = (LwIPSocket*)arg;
+    if(!s)
+        return ERR_OK;
+    s->acked += len;
+    sys_sem_signal(&s->layer->activity);
+    if(s->writeWaiting) {
+        s->writeWaiting = false;
+        sys_sem_signal(&s->writable);
+    }
+    /* Complete a requested close */
+    if(s->closeRequested && s->acked == s->queued)
+        return LwIPSocket_detach(s);
+    return ERR_OK;
+}
+
+/* The pcb was freed by lwIP (reset or abort) */
+static void
+lwipErr(void *arg, err_t err) {
+    LwIPSocket *s = (LwIPSocket*)arg;
+    if(!s)
+        return;
+    s->pcb = NULL;
+    s->remoteClosed = true;
+    sys_sem_signal(&s->layer->activity);
+    if(s->writeWaiting) {
+        s->writeWaiting = false;
+        sys_sem_signal(&s->writable);
+    }
+}
+
+static err_t
+lwipAccept(void *arg, struct tcp_pcb *newpcb, err_t err) {
+    ServerNetworkLayerLwIP *layer = (ServerNetworkLayerLwIP*)arg;
+    if(err != ERR_OK || !newpcb)
+        return ERR_VAL;
+
+    /* Allocate and initialize the connection */
+    LwIPConnectionEntry *e = (LwIPConnectionEntry*)
+        UA_calloc(1, sizeof(LwIPConnectionEntry));
+    LwIPSocket *s = (LwIPSocket*)UA_calloc(1, sizeof(LwIPSocket));
+    if(!e || !s || sys_sem_new(&s->writable, 0) != ERR_OK) {
+        UA_free(e);
+        UA_free(s);
+        tcp_abort(newpcb);
+        return ERR_ABRT;
+    }
+    s->layer = layer;
+    s->pcb = newpcb;
+    e->socket = s;
+
+    /* Do not merge packets on the socket (disable Nagle's algorithm) */
+    tcp_nagle_disable(newpcb);
+    tcp_arg(newpcb, s);
+    tcp_recv(newpcb, lwipRecv);
+    tcp_sent(newpcb, lwipSent);
+    tcp_err(newpcb, lwipErr);
+
+    /* The server thread takes over the connection in the next listen */
+    LIST_INSERT_HEAD(&layer->accepted, e, pointers);
+    sys_sem_signal(&layer->activity);
+    return ERR_OK;
+}
+
+/* Wait until lwIP reports acknowledged data on the socket. Called with the
+ * core lock held, the lock is released while waiting. */
+static void
+lwipWaitWritable(LwIPSocket *s) {
+    tcp_output(s->pcb);
+    s->writeWaiting = true;
+    UNLOCK_TCPIP_CORE();
+    sys_arch_sem_wait(&s->writable, 10);
+    LOCK_TCPIP_CORE();
+    s->writeWaiting = false;
+}
+
+/* Write the buffer with the core lock held. The buffer is kept until it is
+ * acknowledged. The lock is released while waiting for space in the send
+ * buffer of the pcb. */
+static UA_StatusCode
+lwipWrite(LwIPSocket *s, UA_ByteString *buf, UA_Boolean more) {
+    ServerNetworkLayerLwIP *layer = s->layer;
+    UA_DateTime deadline = UA_DateTime_nowMonotonic() +
+        (UA_NETWORK_LWIP_SENDTIMEOUT * UA_DATETIME_MSEC);
+
+    /* Wait for a free entry to keep the buffer */
+    LwIPSocket_releaseAcked(s);
+    while(s->unackedSize == UA_NETWORK_LWIP_MAXUNACKED) {
+        if(!s->pcb || UA_DateTime_nowMonotonic() > deadline) {
+            UA_BufferPool_release(&layer->bufferPool, buf);
+            return UA_STATUSCODE_BADCONNECTIONCLOSED;
+        }
+        lwipWaitWritable(s);
+        LwIPSocket_releaseAcked(s);
+    }
+    s->unacked[(s->unackedStart + s->unackedSize) % UA_NETWORK_LWIP_MAXUNACKED] = *buf;
+    s->unackedSize++;
+
+    /* Hand the buffer to lwIP in pieces that fit into the send buffer */
+    size_t written = 0;
+    while(written < buf->length) {
+        if(!s->pcb || UA_DateTime_nowMonotonic() > deadline)
+            return UA_STATUSCODE_BADCONNECTIONCLOSED;
+        size_t n = buf->length - written;
+        if(n > tcp_sndbuf(s->pcb))
+            n = tcp_sndbuf(s->pcb);
+        if(n > 0) {
+            u8_t flags = (more || written + n < buf->length) ? TCP_WRITE_FLAG_MORE : 0;
+            err_t err = tcp_write(s->pcb, &buf->data[written], (u16_t)n, flags);
+            if(err == ERR_OK) {
+                written += n;
+                s->queued += (u32_t)n;
+                continue;
+            }
+            if(err != ERR_MEM)
+                return UA_STATUSCODE_BADCONNECTIONCLOSED;
+        }
+
+        /* Wait until data is acknowledged */
+        lwipWaitWritable(s);
+    }
+    if(!more && s->pcb)
+        tcp_output(s->pcb);
+    return UA_STATUSCODE_GOOD;
+}
+
+static UA_StatusCode
+ServerNetworkLayerLwIP_send(UA_Connection *connection, UA_ByteString *buf) {
+    LwIPSocket *s = ((LwIPConnectionEntry*)connection)->socket;
+    if(connection->state == UA_CONNECTION_CLOSED) {
+        connection->releaseSendBuffer(connection, buf);
+        return UA_STATUSCODE_BADCONNECTIONCLOSED;
+    }
+    LOCK_TCPIP_CORE();
+    UA_StatusCode retval = lwipWrite(s, buf, false);
+    UNLOCK_TCPIP_CORE();
+    if(retval != UA_STATUSCODE_GOOD)
+        connection->close(connection);
+    return retval;
+}
+
+/* All buffers are written before the pcb is flushed */
+static UA_StatusCode
+ServerNetworkLayerLwIP_sendMany(UA_Connection *connection, UA_ByteString *bufs,
+                                size_t bufsSize) {
+    LwIPSocket *s = ((LwIPConnectionEntry*)connection)->socket;
+    UA_StatusCode retval = UA_STATUSCODE_GOOD;
+    size_t sent = 0;
+    if(connection->state == UA_CONNECTION_CLOSED) {
+        retval = UA_STATUSCODE_BADCONNECTIONCLOSED;
+    } else {
+        LOCK_TCPIP_CORE();
+        for(; sent < bufsSize; sent++) {
+            retval = lwipWrite(s, &bufs[sent], sent + 1 < bufsSize);
+            if(retval != UA_STATUSCODE_GOOD) {
+                sent++;
+                break;
+            }
+        }
+        UNLOCK_TCPIP_CORE();
+        if(retval != UA_STATUSCODE_GOOD)
+            connection->close(connection);
+    }
+    for(size_t i = sent; i < bufsSize; i++)
+        connection->releaseSendBuffer(connection, &bufs[i]);
+    return retval;
+}
+
+static UA_StatusCode
+ServerNetworkLayerLwIP_getSendBuffer(UA_Connection *connection,
+                                     size_t length, UA_ByteString *buf) {
+    ServerNetworkLayerLwIP *layer = (ServerNetworkLayerLwIP*)connection->handle;
+    UA_SecureChannel *channel = connection->channel;
+    if(channel && channel->config.sendBufferSize < length)
+        return UA_STATUSCODE_BADCOMMUNICATIONERROR;
+    return UA_BufferPool_alloc(&layer->bufferPool, length, buf);
+}
+
+static void
+ServerNetworkLayerLwIP_releaseBuffer(UA_Connection *connection,
+                                     UA_ByteString *buf) {
+    ServerNetworkLayerLwIP *layer = (ServerNetworkLayerLwIP*)connection->handle;
+    UA_BufferPool_release(&layer->bufferPool, buf);
+}
+
+static void
+ServerNetworkLayerLwIP_freeConnection(UA_Connection *connection) {
+    UA_free(connection);
+}
+
+/* The pcb is closed once the sent data is acknowledged. The connection is
+ * removed from the layer in the next listen. */
+static void
+ServerNetworkLayerLwIP_close(UA_Connection *connection) {
+    if(connection->state == UA_CONNECTION_CLOSED)
+        return;
+    connection->state = UA_CONNECTION_CLOSED;
+    LwIPSocket *s = ((LwIPConnectionEntry*)connection)->socket;
+    LOCK_TCPIP_CORE();
+    LwIPSocket_dropReceived(s);
+    s->closeRequested = true;
+    s->closeDate = UA_DateTime_nowMonotonic();
+    if(s->acked == s->queued)
+        LwIPSocket_detach(s);
+    UNLOCK_TCPIP_CORE();
+}
+
+/* Hand the connection over to the server. The socket is kept until lwIP no
+ * longer references the send buffers. */
+static void
+removeLwIPConnectionEntry(ServerNetworkLayerLwIP *layer, UA_Server *server,
+                          LwIPConnectionEntry *e) {
+    LIST_REMOVE(e, pointers);
+    ServerNetworkLayerLwIP_close(&e->connection);
+    LwIPSocket *s = e->socket;
+    LOCK_TCPIP_CORE();
+    LwIPSocket_releaseAcked(s);
+    LIST_INSERT_HEAD(&layer->closed, s, pointers);
+    UNLOCK_TCPIP_CORE();
+    UA_Server_removeConnection(server, &e->connection);
+}
+
+static void
+processLwIPConnection(ServerNetworkLayerLwIP *layer, UA_Server *server,
+                      LwIPConnectionEntry *e) {
+    LwIPSocket *s = e->socket;
+    LOCK_TCPIP_CORE();
+    struct pbuf *p = s->received;
+    s->received = NULL;
+    UA_Boolean remoteClosed = s->remoteClosed;
+    LwIPSocket_releaseAcked(s);
+    UNLOCK_TCPIP_CORE();
+
+    if(p) {
+        UA_LOG_TRACE(layer->logger, UA_LOGCATEGORY_NETWORK,
+                     "Connection %i | Activity on the socket",
+                     (int)(e->connection.sockfd));
+        UA_ByteString buf;
+        if(!p->next) {
+            /* Process the pbuf in place */
+            buf.data = (UA_Byte*)p->payload;
+            buf.length = p->len;
+            UA_Server_processBinaryMessage(server, &e->connection, &buf);
+        } else if(UA_BufferPool_alloc(&layer->bufferPool, p->tot_len,
+                                      &buf) == UA_STATUSCODE_GOOD) {
+            /* Join the chain. Else the chunks that cross pbufs are buffered
+             * again for every pbuf. */
+            pbuf_copy_partial(p, buf.data, p->tot_len, 0);
+            UA_Server_processBinaryMessage(server, &e->connection, &buf);
+            UA_BufferPool_release(&layer->bufferPool, &buf);
+        } else {
+            /* The data cannot be dropped without breaking the message
+             * stream. So close the connection instead of acknowledging it. */
+            UA_LOG_WARNING(layer->logger, UA_LOGCATEGORY_NETWORK,
+                           "Connection %i | Could not allocate a buffer for "
+                           "the received data, closing",
+                           (int)(e->connection.sockfd));
+            ServerNetworkLayerLwIP_close(&e->connection);
+        }
+        LOCK_TCPIP_CORE();
+        if(s->pcb && e->connection.state != UA_CONNECTION_CLOSED)
+            tcp_recved(s->pcb, p->tot_len);
+        pbuf_free(p);
+        UNLOCK_TCPIP_CORE();
+    }
+
+    if(remoteClosed || e->connection.state == UA_CONNECTION_CLOSED) {
+        UA_LOG_INFO(layer->logger, UA_LOGCATEGORY_NETWORK,
+                    "Connection %i | Closed",
+                    (int)(e->connection.sockfd));
+        removeLwIPConnectionEntry(layer, server, e);
+    }
+}
+
+/* Free the closed sockets once lwIP has released them. Sockets whose data is
+ * not acknowledged within the timeout are aborted. */
+static void
+freeClosedLwIPSockets(ServerNetworkLayerLwIP *layer, UA_DateTime now,
+                      UA_Boolean force) {
+    LwIPSocket *s, *s_tmp;
+    LOCK_TCPIP_CORE();
+    LIST_FOREACH_SAFE(s, &layer->closed, pointers, s_tmp) {
+        if(s->pcb && (force || now > s->closeDate +
+                      (UA_NETWORK_LWIP_CLOSETIMEOUT * UA_DATETIME_MSEC))) {
+            struct tcp_pcb *pcb = s->pcb;
+            s->pcb = NULL;
+            tcp_arg(pcb, NULL);
+            tcp_recv(pcb, NULL);
+            tcp_sent(pcb, NULL);
+            tcp_err(pcb, NULL);
+            tcp_abort(pcb);
+        }
+        LwIPSocket_releaseAcked(s);
+        if(s->pcb)
+            continue;
+        LIST_REMOVE(s, pointers);
+        LwIPSocket_dropReceived(s);
+        sys_sem_free(&s->writable);
+        UA_free(s);
+    }
+    UNLOCK_TCPIP_CORE();
+}
+
+static UA_StatusCode
+ServerNetworkLayerLwIP_start(UA_ServerNetworkLayer *nl, const UA_String *customHostname) {
+    ServerNetworkLayerLwIP *layer = (ServerNetworkLayerLwIP *)nl->handle;
+
+    /* Allocate the buffer pool once */
+    if(!layer->bufferPool.memory) {
+        size_t bufferSize = nl->localConnectionConfig.recvBufferSize;
+        if(nl->localConnectionConfig.sendBufferSize > bufferSize)
+            bufferSize = nl->localConnectionConfig.sendBufferSize;
+        if(UA_BufferPool_init(&layer->bufferPool, UA_NETWORK_TCP_BUFFERPOOLSIZE,
+                              bufferSize) != UA_STATUSCODE_GOOD)
+            UA_LOG_WARNING(layer->logger, UA_LOGCATEGORY_NETWORK,
+                           "Could not allocate the buffer pool, buffers are "
+                           "allocated per message");
+    }
+
+    if(sys_sem_new(&layer->activity, 0) != ERR_OK) {
+        UA_LOG_ERROR(layer->logger, UA_LOGCATEGORY_NETWORK,
+                     "Could not create the semaphore of the network layer");
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    }
+
+    /* Create the listening pcb */
+    LOCK_TCPIP_CORE();
+    struct tcp_pcb *pcb = tcp_new();
+    if(!pcb || tcp_bind(pcb, IP_ADDR_ANY, layer->port) != ERR_OK) {
+        if(pcb)
+            tcp_close(pcb);
+        UNLOCK_TCPIP_CORE();
+        UA_LOG_WARNING(layer->logger, UA_LOGCATEGORY_NETWORK,
+                       "Error binding the server pcb");
+        sys_sem_free(&layer->activity);
+        return UA_STATUSCODE_BADINTERNALERROR;
+    }
+    layer->port = pcb->local_port;
+    layer->listenPcb = tcp_listen_with_backlog(pcb, MAXBACKLOG);
+    if(!layer->listenPcb) {
+        tcp_close(pcb);
+        UNLOCK_TCPIP_CORE();
+        UA_LOG_WARNING(layer->logger, UA_LOGCATEGORY_NETWORK,
+                       "Error listening on the server pcb");
+        sys_sem_free(&layer->activity);
+        return UA_STATUSCODE_BADINTERNALERROR;
+    }
+    tcp_arg(layer->listenPcb, layer);
+    tcp_accept(layer->listenPcb, lwipAccept);
+    UNLOCK_TCPIP_CORE();
+
+    /* Get the discovery url from the hostname */
+    UA_StatusCode retval = setDiscoveryUrl(nl, customHostname, layer->port, layer->logger);
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
+
+    UA_LOG_INFO(layer->logger, UA_LOGCATEGORY_NETWORK,
+                "lwIP network layer listening on %.*s",
+                (int)nl->discoveryUrl.length, nl->discoveryUrl.data);
+    return UA_STATUSCODE_GOOD;
+}
+
+/* Take over the connections that were accepted in the tcpip thread */
+static void
+takeOverAcceptedConnections(ServerNetworkLayerLwIP *layer) {
+    LwIPConnectionEntry *e;
+    LOCK_TCPIP_CORE();
+    while((e = LIST_FIRST(&layer->accepted))) {
+        LIST_REMOVE(e, pointers);
+        UA_Connection *c = &e->connection;
+        c->sockfd = ++layer->lastConnectionId;
+        c->handle = layer;
+        c->send = ServerNetworkLayerLwIP_send;
+        c->sendMany = ServerNetworkLayerLwIP_sendMany;
+        c->close = ServerNetworkLayerLwIP_close;
+        c->free = ServerNetworkLayerLwIP_freeConnection;
+        c->getSendBuffer = ServerNetworkLayerLwIP_getSendBuffer;
+        c->releaseSendBuffer = ServerNetworkLayerLwIP_releaseBuffer;
+        c->releaseRecvBuffer = ServerNetworkLayerLwIP_releaseBuffer;
+        c->state = UA_CONNECTION_OPENING;
+        c->openingDate = UA_DateTime_nowMonotonic();
+        LIST_INSERT_HEAD(&layer->connections, e, pointers);
+        UA_LOG_INFO(layer->logger, UA_LOGCATEGORY_NETWORK,
+                    "Connection %i | New connection over TCP",
+                    (int)c->sockfd);
+    }
+    UNLOCK_TCPIP_CORE();
+}
+
+static UA_StatusCode
+ServerNetworkLayerLwIP_listen(UA_ServerNetworkLayer *nl, UA_Server *server,
+                              UA_UInt16 timeout) {
+    ServerNetworkLayerLwIP *layer = (ServerNetworkLayerLwIP *)nl->handle;
+
+    /* Wait for activity. A timeout of zero would block in lwIP. */
+    if(layer->listenPcb && timeout > 0)
+        sys_arch_sem_wait(&layer->activity, timeout);
+
+    takeOverAcceptedConnections(layer);
+
+    /* Process the received data */
+    LwIPConnectionEntry *e, *e_tmp;
+    UA_DateTime now = UA_DateTime_nowMonotonic();
+    LIST_FOREACH_SAFE(e, &layer->connections, pointers, e_tmp) {
+        if(e->connection.state == UA_CONNECTION_OPENING &&
+           now > (e->connection.openingDate + (NOHELLOTIMEOUT * UA_DATETIME_MSEC))) {
+            UA_LOG_INFO(layer->logger, UA_LOGCATEGORY_NETWORK,
+                        "Connection %i | Closed by the server (no Hello Message)",
+                        (int)(e->connection.sockfd));
+            removeLwIPConnectionEntry(layer, server, e);
+            continue;
+        }
+        processLwIPConnection(layer, server, e);
+    }
+
+    freeClosedLwIPSockets(layer, now, false);
+    return UA_STATUSCODE_GOOD;
+}
+
+static void
+ServerNetworkLayerLwIP_stop(UA_ServerNetworkLayer *nl, UA_Server *server) {
+    ServerNetworkLayerLwIP *layer = (ServerNetworkLayerLwIP *)nl->handle;
+    UA_LOG_INFO(layer->logger, UA_LOGCATEGORY_NETWORK,
+                "Shutting down the lwIP network layer");
+
+    /* Close the listening pcb */
+    LOCK_TCPIP_CORE();
+    if(layer->listenPcb) {
+        tcp_arg(layer->listenPcb, NULL);
+        tcp_accept(layer->listenPcb, NULL);
+        tcp_close(layer->listenPcb);
+        layer->listenPcb = NULL;
+    }
+    UNLOCK_TCPIP_CORE();
+
+    /* Close open connections. The next listen removes them. */
+    takeOverAcceptedConnections(layer);
+    LwIPConnectionEntry *e;
+    LIST_FOREACH(e, &layer->connections, pointers)
+        ServerNetworkLayerLwIP_close(&e->connection);
+    ServerNetworkLayerLwIP_listen(nl, server, 0);
+}
+
+/* run only when the server is stopped */
+static void
+ServerNetworkLayerLwIP_deleteMembers(UA_ServerNetworkLayer *nl) {
+    ServerNetworkLayerLwIP *layer = (ServerNetworkLayerLwIP *)nl->handle;
+    UA_String_deleteMembers(&nl->discoveryUrl);
+
+    /* Abort the remaining connections. The server is no longer running. So
+     * this is safe. */
+    LwIPConnectionEntry *e, *e_tmp;
+    LIST_FOREACH_SAFE(e, &layer->accepted, pointers, e_tmp) {
+        LIST_REMOVE(e, pointers);
+        LIST_INSERT_HEAD(&layer->connections, e, pointers);
+    }
+    LIST_FOREACH_SAFE(e, &layer->connections, pointers, e_tmp) {
+        LIST_REMOVE(e, pointers);
+        LOCK_TCPIP_CORE();
+        LIST_INSERT_HEAD(&layer->closed, e->socket, pointers);
+        UNLOCK_TCPIP_CORE();
+        UA_free(e);
+    }
+    freeClosedLwIPSockets(layer, UA_DateTime_nowMonotonic(), true);
+
+    if(sys_sem_valid(&layer->activity))
+        sys_sem_free(&layer->activity);
+    UA_BufferPool_clear(&layer->bufferPool);
+
+    /* Free the layer */
+    UA_free(layer);
+}
+
+UA_ServerNetworkLayer
+UA_ServerNetworkLayerLwIP(UA_ConnectionConfig config, UA_UInt16 port,
+                          UA_Logger *logger) {
+    UA_ServerNetworkLayer nl;
+    memset(&nl, 0, sizeof(UA_ServerNetworkLayer));
+    nl.clear = ServerNetworkLayerLwIP_deleteMembers;
+    nl.localConnectionConfig = config;
+    nl.start = ServerNetworkLayerLwIP_start;
+    nl.listen = ServerNetworkLayerLwIP_listen;
+    nl.stop = ServerNetworkLayerLwIP_stop;
+    nl.handle = NULL;
+
+    ServerNetworkLayerLwIP *layer = (ServerNetworkLayerLwIP*)
+        UA_calloc(1,sizeof(ServerNetworkLayerLwIP));
+    if(!layer)
+        return nl;
+    nl.handle = layer;
+
+    layer->logger = logger;
+    layer->port = port;
+    sys_sem_set_invalid(&layer->activity);
+    return nl;
+}
+
+#endif /* UA_ARCHITECTURE_FREERTOSLWIP */
+
 typedef struct TCPClientConnection {
     struct addrinfo hints, *server;
     UA_DateTime connStart;
@@ -72005,6 +77907,7 @@ UA_ClientConnectionTCP_init(UA_ConnectionConfig config, const UA_String endpoint
 
     connection.state = UA_CONNECTION_OPENING;
     connection.send = connection_write;
+    connection.sendMany = connection_writeMany;
     connection.recv = connection_recv;
     connection.close = ClientNetworkLayerTCP_close;
     connection.free = ClientNetworkLayerTCP_free;
@@ -72066,6 +77969,7 @@ UA_ClientConnectionTCP(UA_ConnectionConfig config, const UA_String endpointUrl,
     memset(&connection, 0, sizeof(UA_Connection));
     connection.state = UA_CONNECTION_CLOSED;
     connection.send = connection_write;
+    connection.sendMany = connection_writeMany;
     connection.recv = connection_recv;
     connection.close = ClientNetworkLayerTCP_close;
     connection.free = ClientNetworkLayerTCP_free;
@@ -55,6 +55,7 @@
 /* #undef UA_ENABLE_ENCRYPTION */
 /* #undef UA_ENABLE_HISTORIZING */
 /* #undef UA_ENABLE_MICRO_EMB_DEV_PROFILE */
+/* #undef UA_ENABLE_COMPACT_REFERENCES */
 /* #undef UA_ENABLE_EXPERIMENTAL_HISTORIZING */
 /* #undef UA_ENABLE_SUBSCRIPTIONS_EVENTS */
 /* #undef UA_ENABLE_JSON_ENCODING */
@@ -76,6 +77,8 @@
 #define UA_ENABLE_DISCOVERY
 /* #undef UA_ENABLE_DISCOVERY_MULTICAST */
 /* #undef UA_ENABLE_WEBSOCKET_SERVER */
+/* #undef UA_ENABLE_NETWORK_EPOLL */
+/* #undef UA_ENABLE_TIMER_WHEEL */
 /* #undef UA_ENABLE_QUERY */
 /* #undef UA_ENABLE_MALLOC_SINGLETON */
 #define UA_ENABLE_DISCOVERY_SEMAPHORE
@@ -261,6 +264,7 @@ void UA_free(void* ptr); //de-allocate memory previously allocated with UA_mallo
 #define UA_ERR_CONNECTION_PROGRESS EINPROGRESS
 
 #define UA_send lwip_send
+#define UA_writev lwip_writev
 #define UA_recv lwip_recv
 #define UA_sendto lwip_sendto
 #define UA_recvfrom lwip_recvfrom
@@ -912,6 +916,24 @@ UA_atomic_cmpxchg(void * volatile * addr, void *expected, void *newptr) {
 #endif
 }
 
+static UA_INLINE size_t
+UA_atomic_cmpxchgSize(volatile size_t *addr, size_t expected, size_t newval) {
+#if UA_MULTITHREADING >= 200
+#ifdef _MSC_VER /* Visual Studio */
+    return (size_t)_InterlockedCompareExchangePointer((void * volatile *)addr,
+                                                      (void*)newval, (void*)expected);
+#else /* GCC/Clang */
+    return __sync_val_compare_and_swap(addr, expected, newval);
+#endif
+#else
+    size_t old = *addr;
+    if(old == expected) {
+        *addr = newval;
+    }
+    return old;
+#endif
+}
+
 static UA_INLINE uint32_t
 UA_atomic_addUInt32(volatile uint32_t *addr, uint32_t increase) {
 #if UA_MULTITHREADING >= 200
@@ -12780,6 +12802,50 @@ UA_Int64 UA_EXPORT UA_DateTime_localTimeUtcOffset(void);
  * not absolute time. */
 UA_DateTime UA_EXPORT UA_DateTime_nowMonotonic(void);
 
+/* A free-running hardware counter as the time base of the monotonic clock.
+ * The FreeRTOS/lwIP architecture uses it for UA_DateTime_now and
+ * UA_DateTime_nowMonotonic. Without a clock source, the time is derived from
+ * the FreeRTOS tick count.
+ *
+ * Counters with less than 64 bits are extended in software. A wrap-around
+ * between two readings is detected from the count. If the counter can wrap
+ * more than once between two readings, the coarse time is required to add
+ * the missed wrap-arounds. Without it, the clock has to be read at least once
+ * per wrap-around of the counter. */
+typedef struct {
+    UA_UInt64 (*read)(void *context);
+    void *context;
+    UA_UInt64 frequency; /* Counter increments per second */
+    UA_UInt64 mask;      /* Valid counter bits, e.g. 0xFFFFFFFF for 32 bit */
+
+    /* Optional. A coarse monotonic time, e.g. from the tick count of the OS.
+     * The clock starts at the coarse time when the source is set. The
+     * resolution has to be well below half a wrap-around of the counter. */
+    UA_DateTime (*coarseTime)(void *context);
+
+    /* Optional. Protects the wrap-around detection against concurrent readers,
+     * e.g. with a critical section. */
+    void (*lock)(void *context);
+    void (*unlock)(void *context);
+} UA_ClockSource;
+
+/* Set before the server is started */
+void UA_EXPORT UA_DateTime_setClockSource(const UA_ClockSource *source);
+
+/* The monotonic time of the clock source. Returns false if no clock source is
+ * set. */
+UA_Boolean UA_EXPORT UA_DateTime_readClockSource(UA_DateTime *monotonic);
+
+/* A counter that advances only when changed by hand. Used as the clock source
+ * (with the counter as context) to test on a host. */
+typedef struct {
+    UA_UInt64 count;
+    UA_DateTime coarseTime;
+} UA_SimulatedCounter;
+
+UA_UInt64 UA_EXPORT UA_SimulatedCounter_read(void *counter);
+UA_DateTime UA_EXPORT UA_SimulatedCounter_coarseTime(void *counter);
+
 /* Represents a Datetime as a structure */
 typedef struct UA_DateTimeStruct {
     UA_UInt16 nanoSec;
@@ -24619,6 +24685,20 @@ UA_Server_createDataChangeMonitoredItem(UA_Server *server,
 UA_StatusCode UA_EXPORT UA_THREADSAFE
 UA_Server_deleteMonitoredItem(UA_Server *server, UA_UInt32 monitoredItemId);
 
+/* The notifications of all subscriptions are taken from a server-wide pool.
+ * The pool grows by slabs of notifications up to config.maxNotifications. The
+ * slabs are kept until the server is deleted. */
+typedef struct {
+    size_t poolSize;       /* Notifications in the pool */
+    size_t poolFree;       /* Notifications currently unused */
+    size_t poolExhausted;  /* The pool had to grow */
+    size_t queueOverflows; /* Notifications discarded from a full queue */
+} UA_NotificationStatistics;
+
+void UA_EXPORT UA_THREADSAFE
+UA_Server_getNotificationStatistics(UA_Server *server,
+                                    UA_NotificationStatistics *stats);
+
 #endif
 
 /**
@@ -24943,6 +25023,53 @@ UA_Server_addNode_begin(UA_Server *server, const UA_NodeClass nodeClass,
 UA_StatusCode UA_EXPORT UA_THREADSAFE
 UA_Server_addNode_finish(UA_Server *server, const UA_NodeId nodeId);
 
+/**
+ * Generated nodesets (e.g. from the nodeset compiler) can be loaded in bulk.
+ * Between UA_Server_bulkLoad_begin and _end, the nodes are trusted to come
+ * from a validated nodeset:
+ *
+ *  - The _begin method skips the checks of the parent reference and of the
+ *    abstract TypeDefinitions.
+ *  - The _finish method only records the node.
+ *
+ * The _end method then finishes all recorded nodes in a single sweep, in the
+ * order of the _finish calls. Missing mandatory children are copied from the
+ * TypeDefinition as usual. But the constructors are called only for the node
+ * itself, since the children from the nodeset have their own entry (generated
+ * code finishes the children before their parent). The sweep stops at the
+ * first node that fails and returns its status code. */
+UA_StatusCode UA_EXPORT UA_THREADSAFE
+UA_Server_bulkLoad_begin(UA_Server *server);
+
+UA_StatusCode UA_EXPORT UA_THREADSAFE
+UA_Server_bulkLoad_end(UA_Server *server);
+
+/**
+ * The nodes of namespace 0 can be stored as a binary image. This makes the
+ * startup independent of the generated code. The image is created from the
+ * generated code in a temporary nodestore, without touching the nodes of the
+ * server. Store the image (e.g. in flash) and set it as ``ns0Snapshot`` in the
+ * server configuration. The image contains the nodes, references and values
+ * in the binary encoding. DataSources, method callbacks and node contexts are
+ * not part of the image. For namespace 0, they are set up after loading like
+ * before. Node constructors are not called again for the loaded nodes.
+ *
+ * The image is guarded by a format version, the library version, a fingerprint
+ * of the build options that shape namespace 0 and the node structures, and a
+ * checksum. If the image does not match, the server logs a warning and uses
+ * the generated code instead. An image has to be created again whenever the
+ * generated namespace 0 changes.
+ *
+ * Only namespace 0 is covered. Nodesets of the application are still added
+ * by their generated code, preferably in a bulk load. Values written by the
+ * application after the nodes are created are not part of the image.
+ *
+ * The image is created with the nodestore of the server temporarily swapped
+ * out. So it can only be created before ``UA_Server_run_startup`` and while
+ * no other thread uses the server. Afterwards, BadInvalidState is returned. */
+UA_StatusCode UA_EXPORT
+UA_Server_createNS0Snapshot(UA_Server *server, UA_ByteString *image);
+
 #ifdef UA_ENABLE_METHODCALLS
 
 UA_StatusCode UA_EXPORT UA_THREADSAFE
@@ -25495,6 +25622,17 @@ struct UA_Connection {
      * @return Returns an error code or UA_STATUSCODE_GOOD. */
     UA_StatusCode (*send)(UA_Connection *connection, UA_ByteString *buf);
 
+    /* Sends several message buffers over the connection in one operation
+     * (scatter/gather). The buffers are sent in order and are always freed,
+     * even if sending fails. Optional, can be NULL.
+     *
+     * @param connection The connection
+     * @param bufs The message buffers
+     * @param bufsSize The number of message buffers
+     * @return Returns an error code or UA_STATUSCODE_GOOD. */
+    UA_StatusCode (*sendMany)(UA_Connection *connection, UA_ByteString *bufs,
+                              size_t bufsSize);
+
     /* Receive a message from the remote connection
      *
      * @param connection The connection
@@ -26552,6 +26690,109 @@ UA_Server_setWriterGroupOperational(UA_Server *server, const UA_NodeId writerGro
 UA_StatusCode UA_EXPORT
 UA_Server_setWriterGroupDisabled(UA_Server *server, const UA_NodeId writerGroup);
 
+/**
+ * Isochronous Publish Scheduler
+ * ^^^^^^^^^^^^^^^^^^^^^^^^^^^^^
+ * The publish callbacks of WriterGroups with ``UA_PUBSUB_RT_FIXED_SIZE`` can
+ * run outside of the server main loop. Then a slow service request does not
+ * delay the publish instant. If the scheduler is set in the server config,
+ * these WriterGroups register their publish callback with the scheduler
+ * instead of the server timer.
+ *
+ * The scheduler runs in cycles of a fixed cycle time. The cycles start at
+ * multiples of the cycle time (of the monotonic clock) plus the phase offset.
+ * The publishing interval of the WriterGroups must be a multiple of the cycle
+ * time. The scheduler is driven by calling ``UA_PubSubScheduler_cycle`` at the
+ * start of each cycle, e.g. from a high-priority task woken by a timer
+ * interrupt. The delay of every cycle is recorded in a histogram.
+ *
+ * Removing a callback and stopping the scheduler wait for a cycle that runs
+ * concurrently. So a removed callback is not executed after the removal has
+ * returned. Both must not be called from within a scheduler callback. If the
+ * publishing interval of a WriterGroup is no multiple of the cycle time, the
+ * WriterGroup is published from the server timer instead. */
+
+#ifndef UA_PUBSUB_SCHEDULER_MAXCALLBACKS
+# define UA_PUBSUB_SCHEDULER_MAXCALLBACKS 8
+#endif
+
+#ifndef UA_PUBSUB_SCHEDULER_HISTOGRAMSIZE
+# define UA_PUBSUB_SCHEDULER_HISTOGRAMSIZE 16
+#endif
+
+typedef struct {
+    volatile UA_ServerCallback callback; /* NULL for unused entries */
+    UA_Server *server;
+    void *data;
+    UA_UInt64 callbackId;
+    UA_UInt64 cycles; /* The callback runs every n cycles */
+} UA_PubSubSchedulerEntry;
+
+typedef struct UA_PubSubScheduler {
+    UA_DateTime cycleTime;
+    UA_DateTime phaseOffset;
+    UA_DateTime bucketWidth; /* Lateness covered by a histogram bucket */
+
+    UA_PubSubSchedulerEntry entries[UA_PUBSUB_SCHEDULER_MAXCALLBACKS];
+    UA_UInt64 lastCallbackId;
+
+    volatile UA_Boolean running;
+    volatile UA_UInt32 cycleSequence; /* Odd while the callbacks of a cycle run */
+    void *task; /* Handle of the driving task (if any) */
+    UA_DateTime nextCycle;
+    UA_UInt64 cycleCount;
+
+    /* Statistics. The last bucket counts all later cycles. */
+    UA_UInt64 histogram[UA_PUBSUB_SCHEDULER_HISTOGRAMSIZE];
+    UA_DateTime maxLateness;
+    UA_UInt64 missedCycles; /* Skipped because the previous cycle overran */
+} UA_PubSubScheduler;
+
+/* The bucket width defaults to 1/16th of the cycle time if set to zero */
+void UA_EXPORT
+UA_PubSubScheduler_init(UA_PubSubScheduler *scheduler, UA_DateTime cycleTime,
+                        UA_DateTime phaseOffset, UA_DateTime bucketWidth);
+
+UA_StatusCode UA_EXPORT
+UA_PubSubScheduler_addCallback(UA_PubSubScheduler *scheduler, UA_Server *server,
+                               UA_ServerCallback callback, void *data,
+                               UA_Double interval_ms, UA_UInt64 *callbackId);
+
+void UA_EXPORT
+UA_PubSubScheduler_removeCallback(UA_PubSubScheduler *scheduler, UA_UInt64 callbackId);
+
+/* Compute the first cycle after now and reset the statistics */
+void UA_EXPORT
+UA_PubSubScheduler_start(UA_PubSubScheduler *scheduler, UA_DateTime now);
+
+/* Let the driver return. Waits for a running cycle to finish. */
+void UA_EXPORT
+UA_PubSubScheduler_stop(UA_PubSubScheduler *scheduler);
+
+/* Run the callbacks due in the current cycle if the cycle has started. Cycles
+ * that have passed in the meantime are skipped. */
+void UA_EXPORT
+UA_PubSubScheduler_cycle(UA_PubSubScheduler *scheduler, UA_DateTime now);
+
+#ifdef UA_ARCHITECTURE_POSIX
+/* Drive the scheduler from the calling thread with clock_nanosleep until it is
+ * stopped */
+void UA_EXPORT
+UA_PubSubScheduler_runPosix(UA_PubSubScheduler *scheduler);
+#endif
+
+#ifdef UA_ARCHITECTURE_FREERTOSLWIP
+/* Task function to drive the scheduler. Create the task with the scheduler as
+ * parameter and a priority above the server task. The task waits for
+ * UA_PubSubScheduler_notifyFromISR from a timer interrupt. Without the
+ * interrupt, it wakes up with the tick. */
+void UA_EXPORT
+UA_PubSubScheduler_task(void *scheduler);
+
+void UA_EXPORT
+UA_PubSubScheduler_notifyFromISR(UA_PubSubScheduler *scheduler);
+#endif
+
 /**
  * .. _dsw:    UA_Boolean configurationFrozen;
 
@@ -26648,6 +26889,15 @@ UA_StatusCode
 UA_Server_DataSetReader_createTargetVariables(UA_Server *server, UA_NodeId dataSetReaderIdentifier,
                                              UA_TargetVariablesDataType* targetVariables);
 
+/* Register an external DataValue for a field of the DataSetReader. If the
+ * ReaderGroup is frozen with the rtLevel UA_PUBSUB_RT_FIXED_SIZE, the received
+ * field is copied into the data of the DataValue instead of being written to
+ * the TargetVariables. The DataValue must contain a scalar of the field type
+ * and must stay valid as long as the DataSetReader exists. */
+UA_StatusCode
+UA_Server_DataSetReader_setExternalDataValue(UA_Server *server, UA_NodeId dataSetReaderIdentifier,
+                                             size_t fieldIndex, UA_DataValue *externalDataValue);
+
 /* To Do:Implementation of SubscribedDataSetMirrorType
  * UA_StatusCode
  * A_PubSubDataSetReader_createDataSetMirror(UA_Server *server, UA_NodeId dataSetReaderIdentifier,
@@ -26657,12 +26907,26 @@ UA_Server_DataSetReader_createTargetVariables(UA_Server *server, UA_NodeId dataS
  * ReaderGroup
  * -----------
  * All ReaderGroups are created within a PubSubConnection and automatically
- * deleted if the connection is removed. */
+ * deleted if the connection is removed.
+ *
+ * With the rtLevel UA_PUBSUB_RT_FIXED_SIZE, freezing the ReaderGroup
+ * precomputes the layout of the NetworkMessage expected by each DataSetReader.
+ * Received messages are matched against the layout and the field values are
+ * copied into the external DataValues without decoding the message.
+ * ---> Requirements: One DataSetMessage per NetworkMessage with variant field
+ * encoding. All fields must be fixed-size scalars with a registered external
+ * DataValue. Promoted fields and security are not supported.
+ * ---> Restrictions: The configuration must be frozen and changes are not
+ * allowed while the ReaderGroup is frozen. */
 
 /* ReaderGroup configuration */
 typedef struct {
     UA_String name;
     UA_PubSubSecurityParameters securityParameters;
+    /* This flag is 'read only' and is set internally based on the PubSub state. */
+    UA_Boolean configurationFrozen;
+    /* non std. field */
+    UA_PubSubRTLevel rtLevel;
 } UA_ReaderGroupConfig;
 
 /* Add DataSetReader to the ReaderGroup */
@@ -26696,6 +26960,12 @@ UA_Server_addReaderGroup(UA_Server *server, UA_NodeId connectionIdentifier,
 UA_StatusCode
 UA_Server_removeReaderGroup(UA_Server *server, UA_NodeId groupIdentifier);
 
+UA_StatusCode
+UA_Server_freezeReaderGroupConfiguration(UA_Server *server, const UA_NodeId readerGroup);
+
+UA_StatusCode
+UA_Server_unfreezeReaderGroupConfiguration(UA_Server *server, const UA_NodeId readerGroup);
+
 #endif /* UA_ENABLE_PUBSUB */
 
 _UA_END_DECLS
@@ -26770,6 +27040,18 @@ struct UA_PubSubChannel {
     UA_StatusCode (*receive)(UA_PubSubChannel * channel, UA_ByteString *,
                              UA_ExtensionObject *transportSettings, UA_UInt32 timeout);
 
+    /* Sending out several messages at once. Optional, can be NULL. */
+    UA_StatusCode (*sendMany)(UA_PubSubChannel *channel, UA_ExtensionObject *transportSettings,
+                              const UA_ByteString *bufs, size_t bufsSize);
+
+    /* Receive up to messagesSize messages at once. Optional, can be NULL. The
+     * length of each ByteString is the capacity of its buffer and is set to
+     * the length of the received message. Only the first message is awaited
+     * with the timeout. */
+    UA_StatusCode (*receiveMany)(UA_PubSubChannel *channel, UA_ByteString *messages,
+                                 size_t messagesSize, size_t *receivedSize,
+                                 UA_ExtensionObject *transportSettings, UA_UInt32 timeout);
+
     /* Closing the connection and implicit free of the channel structures. */
     UA_StatusCode (*close)(UA_PubSubChannel *channel);
 
@@ -27115,13 +27397,83 @@ struct UA_MonitoredItem;
  * not known or not important. The ``nodeClass`` attribute is used to ensure the
  * correctness of casting from ``UA_Node`` to a specific node type. */
 
-/* Ordered tree structure for fast member check */
+/* Ordered tree structure for fast member check.
+ *
+ * With UA_ENABLE_COMPACT_REFERENCES, targets in the local server with a
+ * numeric identifier (the vast majority) are stored inline as a (namespace,
+ * identifier) pair. Only string/guid/bytestring and remote targets keep a full
+ * ExpandedNodeId on the heap. Use the accessor functions below instead of
+ * touching the members directly. */
 typedef struct UA_ReferenceTarget {
     ZIP_ENTRY(UA_ReferenceTarget) zipfields;
     UA_UInt32 targetHash; /* Hash of the target nodeid */
+#ifdef UA_ENABLE_COMPACT_REFERENCES
+    UA_UInt32 targetId;            /* Numeric identifier if targetExt == NULL */
+    UA_UInt16 targetNs;            /* Namespace index if targetExt == NULL */
+    UA_ExpandedNodeId *targetExt;  /* All other targets */
+#else
     UA_ExpandedNodeId target;
+#endif
 } UA_ReferenceTarget;
 
+/* Returns the NodeId of the target. The temporary NodeId is used as storage
+ * for compact targets and has to live as long as the returned pointer. */
+static UA_INLINE const UA_NodeId *
+UA_ReferenceTarget_getNodeId(const UA_ReferenceTarget *rt, UA_NodeId *tmp) {
+#ifdef UA_ENABLE_COMPACT_REFERENCES
+    if(rt->targetExt)
+        return &rt->targetExt->nodeId;
+    *tmp = UA_NODEID_NUMERIC(rt->targetNs, rt->targetId);
+    return tmp;
+#else
+    (void)tmp;
+    return &rt->target.nodeId;
+#endif
+}
+
+/* Same as above for the full ExpandedNodeId */
+static UA_INLINE const UA_ExpandedNodeId *
+UA_ReferenceTarget_getTarget(const UA_ReferenceTarget *rt, UA_ExpandedNodeId *tmp) {
+#ifdef UA_ENABLE_COMPACT_REFERENCES
+    if(rt->targetExt)
+        return rt->targetExt;
+    *tmp = UA_EXPANDEDNODEID_NUMERIC(rt->targetNs, rt->targetId);
+    return tmp;
+#else
+    (void)tmp;
+    return &rt->target;
+#endif
+}
+
+/* Is the target in the local server? */
+static UA_INLINE UA_Boolean
+UA_ReferenceTarget_isLocal(const UA_ReferenceTarget *rt) {
+#ifdef UA_ENABLE_COMPACT_REFERENCES
+    if(!rt->targetExt)
+        return true;
+    return (rt->targetExt->serverIndex == 0 &&
+            rt->targetExt->namespaceUri.data == NULL);
+#else
+    return (rt->target.serverIndex == 0 &&
+            rt->target.namespaceUri.data == NULL);
+#endif
+}
+
+/* Compare the NodeId of the target. Compact targets are compared without
+ * materializing the NodeId. */
+static UA_INLINE UA_Boolean
+UA_ReferenceTarget_equalNodeId(const UA_ReferenceTarget *rt, const UA_NodeId *id) {
+#ifdef UA_ENABLE_COMPACT_REFERENCES
+    if(!rt->targetExt)
+        return (id->identifierType == UA_NODEIDTYPE_NUMERIC &&
+                id->namespaceIndex == rt->targetNs &&
+                id->identifier.numeric == rt->targetId);
+    return UA_NodeId_equal(&rt->targetExt->nodeId, id);
+#else
+    return UA_NodeId_equal(&rt->target.nodeId, id);
+#endif
+}
+
 ZIP_HEAD(UA_ReferenceTargetHead, UA_ReferenceTarget);
 typedef struct UA_ReferenceTargetHead UA_ReferenceTargetHead;
 ZIP_PROTTYPE(UA_ReferenceTargetHead, UA_ReferenceTarget, UA_ReferenceTarget)
@@ -27521,6 +27873,15 @@ typedef struct {
     UA_StatusCode (*getNodeCopy)(void *nsCtx, const UA_NodeId *nodeId,
                                  UA_Node **outNode);
 
+    /* Optional. Returns an editable copy of a VariableNode or VariableTypeNode
+     * where only the value is copied. All other members are shared with the
+     * original and must not be changed. The copy is replaced or deleted like
+     * the result of getNodeCopy. Readers of the previous version keep a
+     * consistent view until they release the node. Returns
+     * UA_STATUSCODE_BADNODECLASSINVALID for the other node classes. */
+    UA_StatusCode (*getNodeValueCopy)(void *nsCtx, const UA_NodeId *nodeId,
+                                      UA_Node **outNode);
+
     /* Inserts a new node into the nodestore. If the NodeId is zero, then a
      * fresh numeric NodeId is assigned. If insertion fails, the node is
      * deleted. */
@@ -27708,6 +28069,10 @@ struct UA_ServerConfig {
     /*PubSub network layer */
     size_t pubsubTransportLayersSize;
     UA_PubSubTransportLayer *pubsubTransportLayers;
+
+    /* Runs the publish callbacks of fixed-size WriterGroups (optional, not
+     * cleaned up with the config) */
+    UA_PubSubScheduler *pubsubScheduler;
 #endif
 
     /* Available security policies */
@@ -27745,6 +28110,11 @@ struct UA_ServerConfig {
     /* Nodestore */
     UA_Nodestore nodestore;
 
+    /* Optional image of the nodes of namespace 0. See
+     * UA_Server_createNS0Snapshot. The memory is not owned by the server and
+     * only read during the initialization. */
+    UA_ByteString ns0Snapshot;
+
     /* Certificate Verification */
     UA_CertificateVerification certificateVerification;
 
@@ -27792,6 +28162,9 @@ struct UA_ServerConfig {
     UA_UInt32 maxMonitoredItemsPerSubscription;
     UA_DurationRange samplingIntervalLimits; /* in ms (must not be less than 5) */
     UA_UInt32Range queueSizeLimits; /* Negotiated with the client */
+    UA_UInt32 maxNotifications; /* Size of the notification pool. 0 -> unlimited
+                                 * size. Beyond, a new notification replaces a
+                                 * queued one of the same MonitoredItem. */
 
     /* Limits for PublishRequests */
     UA_UInt32 maxPublishReqPerSession;
@@ -30309,6 +30682,15 @@ UA_Nodestore_HashMap(UA_Nodestore *ns);
 UA_EXPORT UA_StatusCode
 UA_Nodestore_ZipTree(UA_Nodestore *ns);
 
+/* The OpenAddressing Nodestore holds all nodes in RAM in a power-of-two sized
+ * hash-table. A control byte per entry holds a part of the NodeId hash. Lookups
+ * compare a group of control bytes at once and dereference only matching
+ * candidates. Numeric NodeIds are compared without dereferencing the node.
+ * This reduces cache misses for large address spaces. Like the HashMap
+ * Nodestore, the table is resized when nodes are added/removed. */
+UA_EXPORT UA_StatusCode
+UA_Nodestore_OpenAddressing(UA_Nodestore *ns);
+
 _UA_END_DECLS
 
 
@@ -30699,6 +31081,34 @@ UA_PubSubTransportLayerUDPMP(void);
 _UA_END_DECLS
 
 
+/*********************************** amalgamated original file "C:/open62541/plugins/include/open62541/plugin/pubsub_ethernet.h" ***********************************/
+
+/* This work is licensed under a Creative Commons CCZero 1.0 Universal License.
+ * See http://creativecommons.org/publicdomain/zero/1.0/ for more information.
+ *
+ *    Copyright 2018 (c) Kontron Europe GmbH (Author: Rudolf Hoyler)
+ */
+
+
+#ifdef UA_ENABLE_PUBSUB_ETH_UADP
+
+_UA_BEGIN_DECLS
+
+/* Sends and receives UADP NetworkMessages directly in Ethernet frames with
+ * the EtherType 0xB62C. The address of the connection has the form
+ * "opc.eth://01-00-5E-7F-00-01[:<VID>[.<PCP>]]". With a VLAN ID, the frames
+ * carry an IEEE 802.1Q tag with the given priority code point. The
+ * networkInterface of the address selects the interface by name ("eth0" on
+ * Linux, the two-letter netif name followed by its number on lwIP). The
+ * default netif is used if no interface is given on lwIP. */
+UA_PubSubTransportLayer UA_EXPORT
+UA_PubSubTransportLayerEthernet(void);
+
+_UA_END_DECLS
+
+#endif /* UA_ENABLE_PUBSUB_ETH_UADP */
+
+
 /*********************************** amalgamated original file "C:/open62541/include/open62541/network_tcp.h" ***********************************/
 
 /* This work is licensed under a Creative Commons CCZero 1.0 Universal License.
@@ -30714,6 +31124,36 @@ _UA_BEGIN_DECLS
 UA_ServerNetworkLayer UA_EXPORT
 UA_ServerNetworkLayerTCP(UA_ConnectionConfig config, UA_UInt16 port, UA_Logger *logger);
 
+/* The TCP server network layer keeps a pool of fixed-size buffers for the
+ * send and receive chunks of its connections. The buffers are allocated in one
+ * block when the layer is started and are sized for the larger of the
+ * configured send and receive buffer sizes. Set the number of buffers before
+ * the server is started (0 disables the pool). */
+void UA_EXPORT
+UA_ServerNetworkLayerTCP_setBufferPoolSize(UA_ServerNetworkLayer *nl, size_t buffers);
+
+typedef struct {
+    size_t buffers;    /* Number of pooled buffers */
+    size_t bufferSize; /* Size of each pooled buffer */
+    size_t hits;       /* Buffers taken from the pool */
+    size_t misses;     /* Buffers allocated from the heap instead */
+} UA_NetworkBufferPoolStatistics;
+
+void UA_EXPORT
+UA_ServerNetworkLayerTCP_getBufferPoolStatistics(const UA_ServerNetworkLayer *nl,
+                                                 UA_NetworkBufferPoolStatistics *stats);
+
+#ifdef UA_ARCHITECTURE_FREERTOSLWIP
+/* Server network layer on the raw TCP API of lwIP. Received pbufs are
+ * processed in place and send buffers are handed to lwIP without copying.
+ * The send buffers are taken from a pool of UA_NETWORK_TCP_BUFFERPOOLSIZE
+ * buffers and are held until the remote side acknowledges them. Requires
+ * LWIP_TCPIP_CORE_LOCKING. Replace the default TCP layer in the server config
+ * with this layer before the server is started. */
+UA_ServerNetworkLayer UA_EXPORT
+UA_ServerNetworkLayerLwIP(UA_ConnectionConfig config, UA_UInt16 port, UA_Logger *logger);
+#endif
+
 UA_Connection UA_EXPORT
 UA_ClientConnectionTCP(UA_ConnectionConfig config, const UA_String endpointUrl,
                        UA_UInt32 timeout, UA_Logger *logger);
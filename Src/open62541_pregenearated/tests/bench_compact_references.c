@@ -0,0 +1,146 @@
+/* This work is licensed under a Creative Commons CCZero 1.0 Universal License.
+ * See http://creativecommons.org/publicdomain/zero/1.0/ for more information.
+ *
+ * Host benchmark of the memory used by reference targets and of the browse
+ * throughput. Build with and without -DUA_ENABLE_COMPACT_REFERENCES and
+ * compare the output. Run from this directory with:
+ *
+ *   gcc -O2 -std=gnu99 -DUA_ARCHITECTURE_FREERTOSLWIP -DUA_ENABLE_COMPACT_REFERENCES \
+ *       -DconfigUSE_PORT_OPTIMISED_TASK_SELECTION=0 -DconfigAPPLICATION_ALLOCATED_HEAP=3 \
+ *       -I.. -I../../Sdk_workspace/OpcServer_bsp/microblaze_0/include \
+ *       -ffunction-sections -fdata-sections -Wl,--gc-sections \
+ *       bench_compact_references.c ../open62541.c -o bench_compact_references
+ *   ./bench_compact_references
+ *
+ * The heap is measured with mallinfo2 of glibc 2.33 or later. The FreeRTOS
+ * functions used by the server are replaced by stubs. */
+
+#include <open62541.h>
+
+#include <malloc.h>
+#include <stdio.h>
+#include <time.h>
+
+/* lwIP declares errno without a definition */
+int errno;
+
+TickType_t
+xTaskGetTickCount(void) {
+    return 0;
+}
+
+void
+vTaskDelay(const TickType_t ticks) {
+    (void)ticks;
+}
+
+/* Browse until this many targets are returned */
+#define BROWSETARGETS 2000000
+
+static const UA_NodeId source = {1, UA_NODEIDTYPE_NUMERIC, {1}};
+static const UA_NodeId organizes = {0, UA_NODEIDTYPE_NUMERIC, {UA_NS0ID_ORGANIZES}};
+
+/* Large arrays are mapped outside of the heap arena */
+static size_t
+heapUsed(void) {
+    struct mallinfo2 mi = mallinfo2();
+    return mi.uordblks + mi.hblkhd;
+}
+
+static double
+now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/* Add the references in a single copy of the source node. Every n-th target
+ * has a string NodeId, the others have numeric NodeIds. */
+static UA_StatusCode
+addReferences(UA_Server *server, size_t count, size_t stringEvery) {
+    UA_Nodestore *ns = &UA_Server_getConfig(server)->nodestore;
+    UA_Node *node = NULL;
+    UA_StatusCode retval = ns->getNodeCopy(ns->context, &source, &node);
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
+
+    UA_AddReferencesItem item;
+    UA_AddReferencesItem_init(&item);
+    item.sourceNodeId = source;
+    item.referenceTypeId = organizes;
+    item.isForward = true;
+    char name[16];
+    for(size_t i = 0; i < count && retval == UA_STATUSCODE_GOOD; i++) {
+        if(stringEvery > 0 && i % stringEvery == 0) {
+            snprintf(name, sizeof(name), "t%u", (unsigned)i);
+            item.targetNodeId = UA_EXPANDEDNODEID_STRING(1, name);
+        } else {
+            item.targetNodeId = UA_EXPANDEDNODEID_NUMERIC(1, (UA_UInt32)(1000 + i));
+        }
+        retval = UA_Node_addReference(node, &item);
+    }
+    if(retval != UA_STATUSCODE_GOOD) {
+        ns->deleteNode(ns->context, node);
+        return retval;
+    }
+    return ns->replaceNode(ns->context, node);
+}
+
+static void
+run(size_t count, size_t stringEvery) {
+    UA_Server *server = UA_Server_new();
+    UA_ObjectAttributes oa = UA_ObjectAttributes_default;
+    UA_Server_addObjectNode(server, source, UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER),
+                            organizes, UA_QUALIFIEDNAME(1, "Source"),
+                            UA_NODEID_NUMERIC(0, UA_NS0ID_FOLDERTYPE), oa, NULL, NULL);
+
+    size_t before = heapUsed();
+    UA_StatusCode retval = addReferences(server, count, stringEvery);
+    size_t after = heapUsed();
+    if(retval != UA_STATUSCODE_GOOD) {
+        printf("Adding the references failed with %s\n", UA_StatusCode_name(retval));
+        UA_Server_delete(server);
+        return;
+    }
+
+    /* The targets do not exist. So the browse measures the walk over the
+     * targets and the lookup in the nodestore. */
+    UA_BrowseDescription bd;
+    UA_BrowseDescription_init(&bd);
+    bd.nodeId = source;
+    bd.browseDirection = UA_BROWSEDIRECTION_FORWARD;
+    bd.referenceTypeId = organizes;
+    bd.resultMask = UA_BROWSERESULTMASK_ALL;
+    size_t returned = 0;
+    double start = now();
+    while(returned < BROWSETARGETS) {
+        UA_BrowseResult br = UA_Server_browse(server, 0, &bd);
+        returned += br.referencesSize;
+        UA_StatusCode res = br.statusCode;
+        UA_BrowseResult_clear(&br);
+        if(res != UA_STATUSCODE_GOOD || returned == 0) {
+            printf("Browsing failed with %s\n", UA_StatusCode_name(res));
+            break;
+        }
+    }
+    double elapsed = now() - start;
+
+    printf("%6u targets, %3u%% strings: %6.1f bytes/target, %8.0f targets/s browsed\n",
+           (unsigned)count, stringEvery > 0 ? (unsigned)(100 / stringEvery) : 0u,
+           (double)(after - before) / (double)count, (double)returned / elapsed);
+    UA_Server_delete(server);
+}
+
+int main(void) {
+#ifdef UA_ENABLE_COMPACT_REFERENCES
+    printf("Compact references\n");
+#else
+    printf("Full references\n");
+#endif
+    const size_t counts[] = {100, 1000, 10000};
+    for(size_t i = 0; i < sizeof(counts) / sizeof(counts[0]); i++) {
+        run(counts[i], 0);
+        run(counts[i], 10);
+    }
+    return 0;
+}
@@ -0,0 +1,185 @@
+/* This work is licensed under a Creative Commons CCZero 1.0 Universal License.
+ * See http://creativecommons.org/publicdomain/zero/1.0/ for more information.
+ *
+ * Host test of the browse results for references that cannot be resolved.
+ * Build and run from this directory with:
+ *
+ *   gcc -std=gnu99 -DUA_ARCHITECTURE_FREERTOSLWIP \
+ *       -DconfigUSE_PORT_OPTIMISED_TASK_SELECTION=0 -DconfigAPPLICATION_ALLOCATED_HEAP=3 \
+ *       -I.. -I../../Sdk_workspace/OpcServer_bsp/microblaze_0/include \
+ *       -ffunction-sections -fdata-sections -Wl,--gc-sections \
+ *       check_browse_targets.c ../open62541.c -o check_browse_targets
+ *   ./check_browse_targets
+ *
+ * The server runs without a network layer. The FreeRTOS functions it uses are
+ * replaced by stubs. */
+
+#include <open62541.h>
+
+#include <stdio.h>
+
+/* lwIP declares errno without a definition */
+int errno;
+
+TickType_t
+xTaskGetTickCount(void) {
+    return 0;
+}
+
+void
+vTaskDelay(const TickType_t ticks) {
+    (void)ticks;
+}
+
+static int failures = 0;
+
+#define CHECK(cond) do {                                                \
+        if(!(cond)) {                                                   \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            failures++;                                                 \
+        }                                                               \
+    } while(0)
+
+#define SOURCE 100
+#define OBJECT 101
+#define VARIABLE 102
+#define MISSING 103
+#define REMOTE 104
+
+static UA_Server *server;
+
+/* Source node with references to a local object, a local variable, a deleted
+ * node and a node on a remote server */
+static void
+addNodes(void) {
+    UA_ObjectAttributes oa = UA_ObjectAttributes_default;
+    CHECK(UA_Server_addObjectNode(server, UA_NODEID_NUMERIC(1, SOURCE),
+                                  UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER),
+                                  UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES),
+                                  UA_QUALIFIEDNAME(1, "Source"),
+                                  UA_NODEID_NUMERIC(0, UA_NS0ID_FOLDERTYPE),
+                                  oa, NULL, NULL) == UA_STATUSCODE_GOOD);
+    CHECK(UA_Server_addObjectNode(server, UA_NODEID_NUMERIC(1, OBJECT),
+                                  UA_NODEID_NUMERIC(1, SOURCE),
+                                  UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES),
+                                  UA_QUALIFIEDNAME(1, "Object"),
+                                  UA_NODEID_NUMERIC(0, UA_NS0ID_BASEOBJECTTYPE),
+                                  oa, NULL, NULL) == UA_STATUSCODE_GOOD);
+    UA_VariableAttributes va = UA_VariableAttributes_default;
+    CHECK(UA_Server_addVariableNode(server, UA_NODEID_NUMERIC(1, VARIABLE),
+                                    UA_NODEID_NUMERIC(1, SOURCE),
+                                    UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES),
+                                    UA_QUALIFIEDNAME(1, "Variable"),
+                                    UA_NODEID_NUMERIC(0, UA_NS0ID_BASEDATAVARIABLETYPE),
+                                    va, NULL, NULL) == UA_STATUSCODE_GOOD);
+
+    /* Delete the node but keep the reference */
+    CHECK(UA_Server_addObjectNode(server, UA_NODEID_NUMERIC(1, MISSING),
+                                  UA_NODEID_NUMERIC(1, SOURCE),
+                                  UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES),
+                                  UA_QUALIFIEDNAME(1, "Missing"),
+                                  UA_NODEID_NUMERIC(0, UA_NS0ID_BASEOBJECTTYPE),
+                                  oa, NULL, NULL) == UA_STATUSCODE_GOOD);
+    CHECK(UA_Server_deleteNode(server, UA_NODEID_NUMERIC(1, MISSING),
+                               false) == UA_STATUSCODE_GOOD);
+
+    /* The AddReferences service does not accept remote targets. So add the
+     * reference in the nodestore. */
+    UA_AddReferencesItem item;
+    UA_AddReferencesItem_init(&item);
+    item.sourceNodeId = UA_NODEID_NUMERIC(1, SOURCE);
+    item.referenceTypeId = UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES);
+    item.isForward = true;
+    item.targetNodeId = UA_EXPANDEDNODEID_NUMERIC(1, REMOTE);
+    item.targetNodeId.serverIndex = 1;
+    UA_Nodestore *ns = &UA_Server_getConfig(server)->nodestore;
+    UA_Node *node = NULL;
+    CHECK(ns->getNodeCopy(ns->context, &item.sourceNodeId, &node) == UA_STATUSCODE_GOOD);
+    if(!node)
+        return;
+    CHECK(UA_Node_addReference(node, &item) == UA_STATUSCODE_GOOD);
+    CHECK(ns->replaceNode(ns->context, node) == UA_STATUSCODE_GOOD);
+}
+
+static const UA_ReferenceDescription *
+findTarget(const UA_BrowseResult *br, UA_UInt32 id) {
+    for(size_t i = 0; i < br->referencesSize; i++) {
+        const UA_ExpandedNodeId *target = &br->references[i].nodeId;
+        if(target->nodeId.namespaceIndex == 1 &&
+           target->nodeId.identifierType == UA_NODEIDTYPE_NUMERIC &&
+           target->nodeId.identifier.numeric == id)
+            return &br->references[i];
+    }
+    return NULL;
+}
+
+/* The references that cannot be resolved are returned for every mask */
+static void
+testMasks(void) {
+    const UA_UInt32 resultMasks[] = {
+        UA_BROWSERESULTMASK_NONE, UA_BROWSERESULTMASK_REFERENCETYPEID,
+        UA_BROWSERESULTMASK_BROWSENAME, UA_BROWSERESULTMASK_ALL};
+    const UA_UInt32 nodeClassMasks[] = {
+        UA_NODECLASS_UNSPECIFIED, UA_NODECLASS_OBJECT,
+        UA_NODECLASS_OBJECT | UA_NODECLASS_VARIABLE};
+
+    for(size_t i = 0; i < sizeof(resultMasks) / sizeof(resultMasks[0]); i++) {
+        for(size_t j = 0; j < sizeof(nodeClassMasks) / sizeof(nodeClassMasks[0]); j++) {
+            UA_BrowseDescription bd;
+            UA_BrowseDescription_init(&bd);
+            bd.nodeId = UA_NODEID_NUMERIC(1, SOURCE);
+            bd.browseDirection = UA_BROWSEDIRECTION_FORWARD;
+            bd.referenceTypeId = UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES);
+            bd.resultMask = resultMasks[i];
+            bd.nodeClassMask = nodeClassMasks[j];
+            UA_BrowseResult br = UA_Server_browse(server, 0, &bd);
+            CHECK(br.statusCode == UA_STATUSCODE_GOOD);
+
+            UA_Boolean variables = (nodeClassMasks[j] == UA_NODECLASS_UNSPECIFIED ||
+                                    (nodeClassMasks[j] & UA_NODECLASS_VARIABLE) != 0);
+            CHECK(br.referencesSize == (variables ? 4 : 3));
+            CHECK(findTarget(&br, OBJECT) != NULL);
+            CHECK((findTarget(&br, VARIABLE) != NULL) == variables);
+
+            const UA_ReferenceDescription *missing = findTarget(&br, MISSING);
+            const UA_ReferenceDescription *remote = findTarget(&br, REMOTE);
+            CHECK(missing != NULL);
+            CHECK(remote != NULL);
+            if(!missing || !remote) {
+                UA_BrowseResult_clear(&br);
+                continue;
+            }
+            CHECK(remote->nodeId.serverIndex == 1);
+
+            /* Only the fields without access to the target are set */
+            CHECK(missing->nodeClass == UA_NODECLASS_UNSPECIFIED);
+            CHECK(remote->nodeClass == UA_NODECLASS_UNSPECIFIED);
+            CHECK(UA_QualifiedName_isNull(&missing->browseName));
+            CHECK(UA_QualifiedName_isNull(&remote->browseName));
+            if(resultMasks[i] & UA_BROWSERESULTMASK_REFERENCETYPEID) {
+                UA_NodeId organizes = UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES);
+                CHECK(UA_NodeId_equal(&missing->referenceTypeId, &organizes));
+                CHECK(UA_NodeId_equal(&remote->referenceTypeId, &organizes));
+            }
+
+            /* The resolved target has the requested fields */
+            const UA_ReferenceDescription *object = findTarget(&br, OBJECT);
+            if(object && (resultMasks[i] & UA_BROWSERESULTMASK_BROWSENAME))
+                CHECK(!UA_QualifiedName_isNull(&object->browseName));
+            UA_BrowseResult_clear(&br);
+        }
+    }
+}
+
+int main(void) {
+    server = UA_Server_new();
+    addNodes();
+    testMasks();
+    UA_Server_delete(server);
+    if(failures > 0) {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
@@ -0,0 +1,144 @@
+/* This work is licensed under a Creative Commons CCZero 1.0 Universal License.
+ * See http://creativecommons.org/publicdomain/zero/1.0/ for more information.
+ *
+ * Host test of the clock source with a simulated 32 bit counter. Build and run
+ * from this directory with:
+ *
+ *   gcc -std=gnu99 -DUA_ARCHITECTURE_FREERTOSLWIP \
+ *       -DconfigUSE_PORT_OPTIMISED_TASK_SELECTION=0 -DconfigAPPLICATION_ALLOCATED_HEAP=3 \
+ *       -I.. -I../../Sdk_workspace/OpcServer_bsp/microblaze_0/include \
+ *       -ffunction-sections -Wl,--gc-sections \
+ *       check_clock_source.c ../open62541.c -o check_clock_source
+ *   ./check_clock_source
+ *
+ * Only the clock source is linked. The FreeRTOS and lwIP functions used by the
+ * rest of the library are discarded by --gc-sections. */
+
+#include <open62541.h>
+
+#include <stdio.h>
+
+/* lwIP declares errno without a definition */
+int errno;
+
+#define FREQUENCY 100000000 /* 100 MHz as the AXI timer */
+#define PERIOD (((UA_UInt64)1) << 32)
+#define TICK (10 * UA_DATETIME_MSEC)
+
+static int failures = 0;
+
+#define CHECK(cond) do {                                                \
+        if(!(cond)) {                                                   \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            failures++;                                                 \
+        }                                                               \
+    } while(0)
+
+static UA_SimulatedCounter counter;
+
+static UA_DateTime
+readNow(void) {
+    UA_DateTime now = 0;
+    CHECK(UA_DateTime_readClockSource(&now));
+    return now;
+}
+
+/* Advance the counter and the tick-based coarse time by the given duration */
+static void
+advance(UA_UInt64 counts) {
+    counter.count = (counter.count + counts) & 0xFFFFFFFF;
+    counter.coarseTime += (UA_DateTime)(counts / (FREQUENCY / 10000000));
+}
+
+static void
+setSource(UA_Boolean coarse) {
+    UA_ClockSource source = {UA_SimulatedCounter_read, &counter, FREQUENCY, 0xFFFFFFFF,
+                             coarse ? UA_SimulatedCounter_coarseTime : NULL, NULL, NULL};
+    UA_DateTime_setClockSource(&source);
+}
+
+/* 10 counts at 100 MHz are one DateTime increment of 100 ns */
+static void
+testResolution(void) {
+    counter.count = 12345;
+    counter.coarseTime = 0;
+    setSource(false);
+    UA_DateTime start = readNow();
+    CHECK(start == 0);
+    advance(10);
+    CHECK(readNow() - start == 1);
+    advance(FREQUENCY);
+    CHECK(readNow() - start == UA_DATETIME_SEC + 1);
+}
+
+/* One wrap-around between two readings is detected from the count */
+static void
+testWrapAround(void) {
+    counter.count = 0xFFFFFF00;
+    counter.coarseTime = 0;
+    setSource(false);
+    UA_DateTime start = readNow();
+    advance(0x200);
+    UA_DateTime now = readNow();
+    CHECK(now - start == 51); /* 512 counts */
+    for(size_t i = 0; i < 10; i++) {
+        advance(PERIOD - 1000);
+        UA_DateTime next = readNow();
+        CHECK(next > now);
+        now = next;
+    }
+}
+
+/* Several wrap-arounds between two readings are added from the coarse time.
+ * The coarse time has only the resolution of the tick. */
+static void
+testMissedWrapArounds(void) {
+    counter.count = 0x1000;
+    counter.coarseTime = 5 * TICK;
+    setSource(true);
+    UA_DateTime start = readNow();
+    CHECK(start == 5 * TICK);
+
+    UA_UInt64 elapsed = 3 * PERIOD + 123456789;
+    advance(elapsed);
+    counter.coarseTime -= counter.coarseTime % TICK;
+    UA_DateTime now = readNow();
+    CHECK(now - start == (UA_DateTime)(elapsed / 10));
+
+    /* Without the coarse time, only one wrap-around is detected */
+    counter.count = 0x1000;
+    setSource(false);
+    start = readNow();
+    advance(elapsed);
+    CHECK(readNow() - start != (UA_DateTime)(elapsed / 10));
+}
+
+/* The time never goes backwards for readings at irregular intervals */
+static void
+testMonotonic(void) {
+    counter.count = 0;
+    counter.coarseTime = 0;
+    setSource(true);
+    UA_DateTime last = readNow();
+    UA_UInt64 step = 1;
+    for(size_t i = 0; i < 100000; i++) {
+        step = (step * 6364136223846793005ULL + 1442695040888963407ULL);
+        advance((step >> 20) % (2 * PERIOD));
+        UA_DateTime now = readNow();
+        CHECK(now >= last);
+        last = now;
+    }
+}
+
+int main(void) {
+    testResolution();
+    testWrapAround();
+    testMissedWrapArounds();
+    testMonotonic();
+    if(failures > 0) {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
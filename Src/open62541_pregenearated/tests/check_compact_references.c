@@ -0,0 +1,296 @@
+/* This work is licensed under a Creative Commons CCZero 1.0 Universal License.
+ * See http://creativecommons.org/publicdomain/zero/1.0/ for more information.
+ *
+ * Host test of the reference targets with numeric, string and remote targets.
+ * Build and run from this directory with:
+ *
+ *   gcc -std=gnu99 -DUA_ARCHITECTURE_FREERTOSLWIP -DUA_ENABLE_COMPACT_REFERENCES \
+ *       -DconfigUSE_PORT_OPTIMISED_TASK_SELECTION=0 -DconfigAPPLICATION_ALLOCATED_HEAP=3 \
+ *       -I.. -I../../Sdk_workspace/OpcServer_bsp/microblaze_0/include \
+ *       -ffunction-sections -fdata-sections -Wl,--gc-sections \
+ *       check_compact_references.c -o check_compact_references
+ *   ./check_compact_references
+ *
+ * Without -DUA_ENABLE_COMPACT_REFERENCES, the same checks run against the
+ * full ExpandedNodeId targets. The library source is included to reach the
+ * ordering of the targets. The FreeRTOS functions used by the server are
+ * replaced by stubs. */
+
+#include "../open62541.c"
+
+#include <stdio.h>
+
+/* lwIP declares errno without a definition */
+int errno;
+
+TickType_t
+xTaskGetTickCount(void) {
+    return 0;
+}
+
+void
+vTaskDelay(const TickType_t ticks) {
+    (void)ticks;
+}
+
+static int failures = 0;
+
+#define CHECK(cond) do {                                                \
+        if(!(cond)) {                                                   \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            failures++;                                                 \
+        }                                                               \
+    } while(0)
+
+#define NUMERICTARGETS 200
+#define STRINGTARGETS 50
+#define REMOTETARGETS 2
+
+static UA_Server *server;
+static const UA_NodeId source = {1, UA_NODEIDTYPE_NUMERIC, {1}};
+static const UA_NodeId organizes = {0, UA_NODEIDTYPE_NUMERIC, {UA_NS0ID_ORGANIZES}};
+
+/* Which targets are expected in the browse result */
+static UA_Boolean numericExpected[NUMERICTARGETS];
+static UA_Boolean stringExpected[STRINGTARGETS];
+static UA_Boolean remoteExpected[REMOTETARGETS];
+
+static UA_NodeId
+numericTarget(size_t i) {
+    return UA_NODEID_NUMERIC(1, (UA_UInt32)(1000 + i));
+}
+
+/* The returned NodeId points to a static buffer */
+static UA_NodeId
+stringTarget(size_t i) {
+    static char name[16];
+    snprintf(name, sizeof(name), "target-%u", (unsigned)i);
+    return UA_NODEID_STRING(1, name);
+}
+
+static UA_ExpandedNodeId
+remoteTarget(size_t i) {
+    UA_ExpandedNodeId id = (i == 0) ? UA_EXPANDEDNODEID_NUMERIC(1, 1000) :
+        UA_EXPANDEDNODEID_STRING(1, "remote");
+    id.serverIndex = 1;
+    return id;
+}
+
+static void
+addObject(const UA_NodeId id) {
+    UA_ObjectAttributes oa = UA_ObjectAttributes_default;
+    CHECK(UA_Server_addObjectNode(server, id, source, organizes,
+                                  UA_QUALIFIEDNAME(1, "Target"),
+                                  UA_NODEID_NUMERIC(0, UA_NS0ID_BASEOBJECTTYPE),
+                                  oa, NULL, NULL) == UA_STATUSCODE_GOOD);
+}
+
+/* The AddReferences service does not accept remote targets. So they are
+ * edited in the nodestore. */
+static void
+editRemoteReference(size_t i, UA_Boolean add) {
+    UA_Nodestore *ns = &server->config.nodestore;
+    UA_Node *node = NULL;
+    CHECK(ns->getNodeCopy(ns->context, &source, &node) == UA_STATUSCODE_GOOD);
+    if(!node)
+        return;
+    if(add) {
+        UA_AddReferencesItem item;
+        UA_AddReferencesItem_init(&item);
+        item.sourceNodeId = source;
+        item.referenceTypeId = organizes;
+        item.isForward = true;
+        item.targetNodeId = remoteTarget(i);
+        CHECK(UA_Node_addReference(node, &item) == UA_STATUSCODE_GOOD);
+    } else {
+        UA_DeleteReferencesItem item;
+        UA_DeleteReferencesItem_init(&item);
+        item.sourceNodeId = source;
+        item.referenceTypeId = organizes;
+        item.isForward = true;
+        item.targetNodeId = remoteTarget(i);
+        CHECK(UA_Node_deleteReference(node, &item) == UA_STATUSCODE_GOOD);
+    }
+    CHECK(ns->replaceNode(ns->context, node) == UA_STATUSCODE_GOOD);
+}
+
+static void
+addTargets(void) {
+    UA_ObjectAttributes oa = UA_ObjectAttributes_default;
+    CHECK(UA_Server_addObjectNode(server, source,
+                                  UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER),
+                                  organizes, UA_QUALIFIEDNAME(1, "Source"),
+                                  UA_NODEID_NUMERIC(0, UA_NS0ID_FOLDERTYPE),
+                                  oa, NULL, NULL) == UA_STATUSCODE_GOOD);
+    for(size_t i = 0; i < NUMERICTARGETS; i++) {
+        addObject(numericTarget(i));
+        numericExpected[i] = true;
+    }
+    for(size_t i = 0; i < STRINGTARGETS; i++) {
+        addObject(stringTarget(i));
+        stringExpected[i] = true;
+    }
+    for(size_t i = 0; i < REMOTETARGETS; i++) {
+        editRemoteReference(i, true);
+        remoteExpected[i] = true;
+    }
+
+    /* A second reference to a target is a duplicate in both directions */
+    CHECK(UA_Server_addReference(server, source, organizes,
+                                 UA_EXPANDEDNODEID_NUMERIC(1, 1000), true) ==
+          UA_STATUSCODE_BADDUPLICATEREFERENCENOTALLOWED);
+    UA_ExpandedNodeId stringId;
+    UA_ExpandedNodeId_init(&stringId);
+    stringId.nodeId = stringTarget(0);
+    CHECK(UA_Server_addReference(server, source, organizes, stringId, true) ==
+          UA_STATUSCODE_BADDUPLICATEREFERENCENOTALLOWED);
+}
+
+static void
+deleteTargets(void) {
+    for(size_t i = 0; i < NUMERICTARGETS; i += 2) {
+        CHECK(UA_Server_deleteReference(server, source, organizes, true,
+                                        UA_EXPANDEDNODEID_NUMERIC(1, (UA_UInt32)(1000 + i)),
+                                        true) == UA_STATUSCODE_GOOD);
+        numericExpected[i] = false;
+    }
+    for(size_t i = 0; i < STRINGTARGETS; i += 3) {
+        UA_ExpandedNodeId id;
+        UA_ExpandedNodeId_init(&id);
+        id.nodeId = stringTarget(i);
+        CHECK(UA_Server_deleteReference(server, source, organizes, true,
+                                        id, true) == UA_STATUSCODE_GOOD);
+        stringExpected[i] = false;
+    }
+    editRemoteReference(1, false);
+    remoteExpected[1] = false;
+}
+
+/* Every expected target is returned exactly once and nothing else */
+static void
+checkBrowse(void) {
+    UA_BrowseDescription bd;
+    UA_BrowseDescription_init(&bd);
+    bd.nodeId = source;
+    bd.browseDirection = UA_BROWSEDIRECTION_FORWARD;
+    bd.referenceTypeId = organizes;
+    bd.resultMask = UA_BROWSERESULTMASK_ALL;
+    UA_BrowseResult br = UA_Server_browse(server, 0, &bd);
+    CHECK(br.statusCode == UA_STATUSCODE_GOOD);
+
+    size_t numericFound[NUMERICTARGETS] = {0};
+    size_t stringFound[STRINGTARGETS] = {0};
+    size_t remoteFound[REMOTETARGETS] = {0};
+    for(size_t i = 0; i < br.referencesSize; i++) {
+        const UA_ExpandedNodeId *id = &br.references[i].nodeId;
+        UA_Boolean found = false;
+        for(size_t j = 0; j < REMOTETARGETS; j++) {
+            UA_ExpandedNodeId remote = remoteTarget(j);
+            if(UA_ExpandedNodeId_order(id, &remote) == UA_ORDER_EQ) {
+                remoteFound[j]++;
+                found = true;
+            }
+        }
+        if(found)
+            continue;
+        CHECK(id->serverIndex == 0);
+        CHECK(!UA_QualifiedName_isNull(&br.references[i].browseName));
+        for(size_t j = 0; j < NUMERICTARGETS; j++) {
+            UA_NodeId numeric = numericTarget(j);
+            if(UA_NodeId_equal(&id->nodeId, &numeric)) {
+                numericFound[j]++;
+                found = true;
+            }
+        }
+        for(size_t j = 0; j < STRINGTARGETS; j++) {
+            UA_NodeId string = stringTarget(j);
+            if(UA_NodeId_equal(&id->nodeId, &string)) {
+                stringFound[j]++;
+                found = true;
+            }
+        }
+        CHECK(found);
+    }
+    for(size_t i = 0; i < NUMERICTARGETS; i++)
+        CHECK(numericFound[i] == (numericExpected[i] ? 1 : 0));
+    for(size_t i = 0; i < STRINGTARGETS; i++)
+        CHECK(stringFound[i] == (stringExpected[i] ? 1 : 0));
+    for(size_t i = 0; i < REMOTETARGETS; i++)
+        CHECK(remoteFound[i] == (remoteExpected[i] ? 1 : 0));
+    UA_BrowseResult_clear(&br);
+
+    /* The inverse references of the local targets */
+    UA_ExpandedNodeId parent = {{1, UA_NODEIDTYPE_NUMERIC, {1}}, {0, NULL}, 0};
+    for(size_t i = 0; i < NUMERICTARGETS; i++) {
+        bd.nodeId = numericTarget(i);
+        bd.browseDirection = UA_BROWSEDIRECTION_INVERSE;
+        br = UA_Server_browse(server, 0, &bd);
+        CHECK(br.statusCode == UA_STATUSCODE_GOOD);
+        size_t parents = 0;
+        for(size_t j = 0; j < br.referencesSize; j++) {
+            if(UA_ExpandedNodeId_order(&br.references[j].nodeId, &parent) == UA_ORDER_EQ)
+                parents++;
+        }
+        CHECK(parents == (numericExpected[i] ? 1 : 0));
+        UA_BrowseResult_clear(&br);
+    }
+}
+
+/* Targets are ordered by their hash first. Targets with the same hash are
+ * ordered like their ExpandedNodeId, whether they are compact or not. */
+static void
+testOrdering(void) {
+    UA_ExpandedNodeId ids[6];
+    ids[0] = UA_EXPANDEDNODEID_NUMERIC(1, 5);
+    ids[1] = UA_EXPANDEDNODEID_NUMERIC(2, 1);
+    ids[2] = UA_EXPANDEDNODEID_STRING(1, "a");
+    ids[3] = UA_EXPANDEDNODEID_STRING(0, "b");
+    ids[4] = remoteTarget(0);
+    ids[5] = remoteTarget(1);
+
+    /* Force the same hash for all */
+    UA_ReferenceTarget targets[6];
+    for(size_t i = 0; i < 6; i++) {
+        memset(&targets[i], 0, sizeof(UA_ReferenceTarget));
+        ReferenceTarget_initDummy(&targets[i], &ids[i]);
+        targets[i].targetHash = 0;
+    }
+
+    for(size_t i = 0; i < 6; i++) {
+        for(size_t j = 0; j < 6; j++) {
+            enum ZIP_CMP c = cmpRefTarget(&targets[i], &targets[j]);
+            CHECK(c == (enum ZIP_CMP)UA_ExpandedNodeId_order(&ids[i], &ids[j]));
+            CHECK(c == (enum ZIP_CMP)-cmpRefTarget(&targets[j], &targets[i]));
+        }
+    }
+
+    /* Every target is found in a tree of targets with colliding hashes */
+    UA_ReferenceTargetHead head;
+    ZIP_INIT(&head);
+    for(size_t i = 0; i < 6; i++)
+        ZIP_INSERT(UA_ReferenceTargetHead, &head, &targets[i],
+                   ZIP_FFS32(UA_UInt32_random()));
+    for(size_t i = 0; i < 6; i++) {
+        UA_ReferenceTarget key;
+        memset(&key, 0, sizeof(UA_ReferenceTarget));
+        ReferenceTarget_initDummy(&key, &ids[i]);
+        key.targetHash = 0;
+        CHECK(ZIP_FIND(UA_ReferenceTargetHead, &head, &key) == &targets[i]);
+    }
+}
+
+int main(void) {
+    server = UA_Server_new();
+    addTargets();
+    checkBrowse();
+    deleteTargets();
+    checkBrowse();
+    testOrdering();
+    UA_Server_delete(server);
+    if(failures > 0) {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
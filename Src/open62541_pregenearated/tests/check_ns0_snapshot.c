@@ -0,0 +1,211 @@
+/* This work is licensed under a Creative Commons CCZero 1.0 Universal License.
+ * See http://creativecommons.org/publicdomain/zero/1.0/ for more information.
+ *
+ * Host test of the image of namespace 0. Build and run from this directory
+ * with:
+ *
+ *   gcc -std=gnu99 -DUA_ARCHITECTURE_FREERTOSLWIP \
+ *       -DconfigUSE_PORT_OPTIMISED_TASK_SELECTION=0 -DconfigAPPLICATION_ALLOCATED_HEAP=3 \
+ *       -I.. -I../../Sdk_workspace/OpcServer_bsp/microblaze_0/include \
+ *       -ffunction-sections -fdata-sections -Wl,--gc-sections \
+ *       check_ns0_snapshot.c -o check_ns0_snapshot
+ *   ./check_ns0_snapshot
+ *
+ * The library source is included to reach the loader of the image. The server
+ * runs without a network layer. The FreeRTOS functions it uses are replaced by
+ * stubs. */
+
+#include "../open62541.c"
+
+#include <stdio.h>
+
+/* lwIP declares errno without a definition */
+int errno;
+
+TickType_t
+xTaskGetTickCount(void) {
+    return 0;
+}
+
+void
+vTaskDelay(const TickType_t ticks) {
+    (void)ticks;
+}
+
+static int failures = 0;
+
+#define CHECK(cond) do {                                                \
+        if(!(cond)) {                                                   \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            failures++;                                                 \
+        }                                                               \
+    } while(0)
+
+static UA_Server *server;
+static UA_ByteString image;
+
+static void
+countNode(void *visitorCtx, const UA_Node *node) {
+    (*(size_t*)visitorCtx)++;
+}
+
+static size_t
+countNodes(UA_Server *s) {
+    size_t count = 0;
+    s->config.nodestore.iterate(s->config.nodestore.context, countNode, &count);
+    return count;
+}
+
+static UA_UInt32
+readHeader(const UA_ByteString *img, size_t field) {
+    UA_UInt32 value = 0;
+    size_t offset = field * 4;
+    UA_decodeBinary(img, &offset, &value, &UA_TYPES[UA_TYPES_UINT32], NULL);
+    return value;
+}
+
+static void
+writeHeader(UA_ByteString *img, size_t field, UA_UInt32 value) {
+    UA_Byte *pos = &img->data[field * 4];
+    const UA_Byte *end = pos + 4;
+    UA_encodeBinary(&value, &UA_TYPES[UA_TYPES_UINT32], &pos, &end, NULL, NULL);
+}
+
+/* Load the image into an empty nodestore. Returns the number of nodes left in
+ * the nodestore afterwards. */
+static UA_StatusCode
+loadIntoEmpty(const UA_ByteString *img, size_t *nodesLeft) {
+    UA_Nodestore ns;
+    UA_StatusCode retval = UA_Nodestore_HashMap(&ns);
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
+    UA_Nodestore serverNs = server->config.nodestore;
+    server->config.nodestore = ns;
+    retval = loadNS0Snapshot(server, img);
+    *nodesLeft = countNodes(server);
+    server->config.nodestore = serverNs;
+    ns.clear(ns.context);
+    invalidateReferenceTypeIndex(server);
+    return retval;
+}
+
+/* A server started from the image has the same nodes as a server started from
+ * the generated code */
+static void
+testRoundTrip(void) {
+    size_t nodesLeft = 0;
+    CHECK(loadIntoEmpty(&image, &nodesLeft) == UA_STATUSCODE_GOOD);
+    CHECK(nodesLeft == readHeader(&image, 4));
+
+    UA_ServerConfig config;
+    memset(&config, 0, sizeof(UA_ServerConfig));
+    config.logger = UA_Log_Stdout_;
+    CHECK(UA_Nodestore_HashMap(&config.nodestore) == UA_STATUSCODE_GOOD);
+    config.ns0Snapshot = image;
+    UA_Server *loaded = UA_Server_newWithConfig(&config);
+    CHECK(loaded != NULL);
+    if(!loaded)
+        return;
+    CHECK(countNodes(loaded) == countNodes(server));
+
+    /* The DataSources are set up again after loading */
+    UA_Variant value;
+    CHECK(UA_Server_readValue(loaded, UA_NODEID_NUMERIC(0, UA_NS0ID_SERVER_SERVERSTATUS_CURRENTTIME),
+                              &value) == UA_STATUSCODE_GOOD);
+    CHECK(value.type == &UA_TYPES[UA_TYPES_DATETIME]);
+    UA_Variant_clear(&value);
+    UA_Server_delete(loaded);
+}
+
+/* A flipped bit in the payload fails the checksum before any node is added */
+static void
+testChecksum(void) {
+    UA_ByteString img;
+    CHECK(UA_ByteString_copy(&image, &img) == UA_STATUSCODE_GOOD);
+    img.data[img.length / 2] ^= 1;
+    size_t nodesLeft = 1;
+    CHECK(loadIntoEmpty(&img, &nodesLeft) == UA_STATUSCODE_BADDECODINGERROR);
+    CHECK(nodesLeft == 0);
+    UA_ByteString_clear(&img);
+}
+
+/* An image of another build is rejected */
+static void
+testFingerprint(void) {
+    UA_ByteString img;
+    CHECK(UA_ByteString_copy(&image, &img) == UA_STATUSCODE_GOOD);
+    writeHeader(&img, 3, readHeader(&img, 3) ^ 1);
+    size_t nodesLeft = 1;
+    CHECK(loadIntoEmpty(&img, &nodesLeft) == UA_STATUSCODE_BADDATAENCODINGUNSUPPORTED);
+    CHECK(nodesLeft == 0);
+    UA_ByteString_clear(&img);
+}
+
+/* A truncated image does not match the length in the header */
+static void
+testTruncated(void) {
+    UA_ByteString img = image;
+    size_t nodesLeft = 1;
+    img.length = image.length - 1;
+    CHECK(loadIntoEmpty(&img, &nodesLeft) == UA_STATUSCODE_BADDECODINGERROR);
+    CHECK(nodesLeft == 0);
+    img.length = NS0_SNAPSHOT_HEADERSIZE - 1;
+    CHECK(loadIntoEmpty(&img, &nodesLeft) == UA_STATUSCODE_BADDECODINGERROR);
+    CHECK(nodesLeft == 0);
+}
+
+/* A node that cannot be decoded in the middle of a consistent image. The
+ * nodes loaded before are removed again. */
+static void
+testRollback(void) {
+    UA_ByteString img;
+    CHECK(UA_ByteString_copy(&image, &img) == UA_STATUSCODE_GOOD);
+
+    /* Find the middle node. Every node starts with its length. */
+    size_t offset = NS0_SNAPSHOT_HEADERSIZE;
+    UA_UInt32 nodesSize = readHeader(&img, 4);
+    for(size_t i = 0; i < nodesSize / 2; i++) {
+        UA_UInt32 length = 0;
+        UA_decodeBinary(&img, &offset, &length, &UA_TYPES[UA_TYPES_UINT32], NULL);
+        offset += length;
+    }
+
+    /* Set an invalid NodeClass and fix the checksum */
+    img.data[offset + 4] = 0x7f;
+    writeHeader(&img, 6, UA_ByteString_hash(0, &img.data[NS0_SNAPSHOT_HEADERSIZE],
+                                            img.length - NS0_SNAPSHOT_HEADERSIZE));
+    size_t nodesLeft = 1;
+    CHECK(loadIntoEmpty(&img, &nodesLeft) == UA_STATUSCODE_BADDECODINGERROR);
+    CHECK(nodesLeft == 0);
+    UA_ByteString_clear(&img);
+}
+
+/* The image cannot be created after the server was started */
+static void
+testAfterStartup(void) {
+    UA_ByteString img;
+    CHECK(UA_Server_run_startup(server) == UA_STATUSCODE_GOOD);
+    CHECK(UA_Server_createNS0Snapshot(server, &img) == UA_STATUSCODE_BADINVALIDSTATE);
+    CHECK(img.length == 0);
+    UA_Server_run_shutdown(server);
+}
+
+int main(void) {
+    server = UA_Server_new();
+    CHECK(UA_Server_createNS0Snapshot(server, &image) == UA_STATUSCODE_GOOD);
+    CHECK(image.length > NS0_SNAPSHOT_HEADERSIZE);
+    testRoundTrip();
+    testChecksum();
+    testFingerprint();
+    testTruncated();
+    testRollback();
+    testAfterStartup();
+    UA_ByteString_clear(&image);
+    UA_Server_delete(server);
+    if(failures > 0) {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
@@ -0,0 +1,225 @@
+/* This work is licensed under a Creative Commons CCZero 1.0 Universal License.
+ * See http://creativecommons.org/publicdomain/zero/1.0/ for more information.
+ *
+ * Host test of the isochronous publish scheduler with a simulated time. Build
+ * and run from this directory with:
+ *
+ *   gcc -std=gnu99 -DUA_ARCHITECTURE_FREERTOSLWIP \
+ *       -DconfigUSE_PORT_OPTIMISED_TASK_SELECTION=0 -DconfigAPPLICATION_ALLOCATED_HEAP=3 \
+ *       -I.. -I../../Sdk_workspace/OpcServer_bsp/microblaze_0/include \
+ *       -ffunction-sections -fdata-sections -Wl,--gc-sections \
+ *       check_pubsub_scheduler.c ../open62541.c -o check_pubsub_scheduler
+ *   ./check_pubsub_scheduler
+ *
+ * Only the scheduler is linked. vTaskDelay is replaced by a stub that ends a
+ * concurrently running cycle after a few delays. */
+
+#include <open62541.h>
+
+#include <stdio.h>
+
+/* lwIP declares errno without a definition */
+int errno;
+
+#define CYCLE (1 * UA_DATETIME_MSEC)
+
+static int failures = 0;
+
+#define CHECK(cond) do {                                                \
+        if(!(cond)) {                                                   \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            failures++;                                                 \
+        }                                                               \
+    } while(0)
+
+static UA_PubSubScheduler scheduler;
+
+/* Number of delays after which the simulated concurrent cycle ends */
+static size_t delaysUntilCycleEnd;
+static size_t delays;
+static TickType_t minDelay;
+
+void
+vTaskDelay(const TickType_t ticks) {
+    delays++;
+    if(ticks < minDelay)
+        minDelay = ticks;
+    if(delays == delaysUntilCycleEnd)
+        scheduler.cycleSequence++;
+}
+
+static size_t runsA, runsB;
+static UA_Boolean sequenceOdd;
+
+static void
+callbackA(UA_Server *server, void *data) {
+    runsA++;
+    sequenceOdd = (scheduler.cycleSequence & 1) != 0;
+}
+
+static void
+callbackB(UA_Server *server, void *data) {
+    runsB++;
+}
+
+static void
+reset(void) {
+    UA_PubSubScheduler_init(&scheduler, CYCLE, 0, 0);
+    runsA = runsB = 0;
+    delays = 0;
+    delaysUntilCycleEnd = 0;
+    minDelay = (TickType_t)~0;
+}
+
+/* The interval must be a multiple of the cycle time */
+static void
+testAddCallback(void) {
+    reset();
+    CHECK(scheduler.bucketWidth == CYCLE / UA_PUBSUB_SCHEDULER_HISTOGRAMSIZE);
+    UA_UInt64 id = 0;
+    CHECK(UA_PubSubScheduler_addCallback(&scheduler, NULL, callbackA, NULL,
+                                         1.5, &id) == UA_STATUSCODE_BADINVALIDARGUMENT);
+    CHECK(UA_PubSubScheduler_addCallback(&scheduler, NULL, callbackA, NULL,
+                                         0.0, &id) == UA_STATUSCODE_BADINVALIDARGUMENT);
+    CHECK(UA_PubSubScheduler_addCallback(&scheduler, NULL, callbackA, NULL,
+                                         3.0, &id) == UA_STATUSCODE_GOOD);
+    CHECK(id != 0);
+    CHECK(scheduler.entries[0].cycles == 3);
+    for(size_t i = 1; i < UA_PUBSUB_SCHEDULER_MAXCALLBACKS; i++)
+        CHECK(UA_PubSubScheduler_addCallback(&scheduler, NULL, callbackB, NULL,
+                                             1.0, NULL) == UA_STATUSCODE_GOOD);
+    CHECK(UA_PubSubScheduler_addCallback(&scheduler, NULL, callbackB, NULL, 1.0,
+                                         NULL) == UA_STATUSCODE_BADRESOURCEUNAVAILABLE);
+}
+
+/* The cycles start at multiples of the cycle time plus the phase offset. The
+ * callbacks run every n cycles. */
+static void
+testCycle(void) {
+    reset();
+    scheduler.phaseOffset = CYCLE / 4;
+    CHECK(UA_PubSubScheduler_addCallback(&scheduler, NULL, callbackA, NULL,
+                                         1.0, NULL) == UA_STATUSCODE_GOOD);
+    CHECK(UA_PubSubScheduler_addCallback(&scheduler, NULL, callbackB, NULL,
+                                         2.0, NULL) == UA_STATUSCODE_GOOD);
+
+    UA_DateTime now = 10 * CYCLE + CYCLE / 2;
+    UA_PubSubScheduler_start(&scheduler, now);
+    CHECK(scheduler.nextCycle == 11 * CYCLE + CYCLE / 4);
+
+    /* Not yet due */
+    UA_PubSubScheduler_cycle(&scheduler, scheduler.nextCycle - 1);
+    CHECK(runsA == 0);
+
+    for(size_t i = 0; i < 4; i++)
+        UA_PubSubScheduler_cycle(&scheduler, scheduler.nextCycle);
+    CHECK(runsA == 4);
+    CHECK(runsB == 2);
+    CHECK(sequenceOdd);
+    CHECK((scheduler.cycleSequence & 1) == 0);
+    CHECK(scheduler.missedCycles == 0);
+    CHECK(scheduler.histogram[0] == 4);
+}
+
+/* Cycles that have passed are skipped and not executed in a burst */
+static void
+testSkip(void) {
+    reset();
+    CHECK(UA_PubSubScheduler_addCallback(&scheduler, NULL, callbackA, NULL,
+                                         1.0, NULL) == UA_STATUSCODE_GOOD);
+    CHECK(UA_PubSubScheduler_addCallback(&scheduler, NULL, callbackB, NULL,
+                                         2.0, NULL) == UA_STATUSCODE_GOOD);
+    UA_PubSubScheduler_start(&scheduler, 0);
+    CHECK(scheduler.nextCycle == CYCLE);
+
+    /* The first cycle overruns into the fourth */
+    UA_PubSubScheduler_cycle(&scheduler, 4 * CYCLE + CYCLE / 2);
+    CHECK(runsA == 1);
+    CHECK(runsB == 1);
+    CHECK(scheduler.missedCycles == 3);
+    CHECK(scheduler.cycleCount == 4);
+    CHECK(scheduler.nextCycle == 5 * CYCLE);
+
+    /* The cycle count keeps the callbacks every n cycles in phase */
+    UA_PubSubScheduler_cycle(&scheduler, 5 * CYCLE);
+    UA_PubSubScheduler_cycle(&scheduler, 6 * CYCLE);
+    CHECK(runsA == 3);
+    CHECK(runsB == 2);
+}
+
+/* The lateness of every cycle is counted in the histogram. The last bucket
+ * counts all later cycles. */
+static void
+testHistogram(void) {
+    reset();
+    UA_DateTime width = scheduler.bucketWidth;
+    UA_PubSubScheduler_start(&scheduler, 0);
+    UA_PubSubScheduler_cycle(&scheduler, scheduler.nextCycle);
+    UA_PubSubScheduler_cycle(&scheduler, scheduler.nextCycle + width - 1);
+    UA_PubSubScheduler_cycle(&scheduler, scheduler.nextCycle + 3 * width);
+    UA_PubSubScheduler_cycle(&scheduler, scheduler.nextCycle + 3 * width + 1);
+    UA_PubSubScheduler_cycle(&scheduler, scheduler.nextCycle + CYCLE / 2);
+    CHECK(scheduler.histogram[0] == 2);
+    CHECK(scheduler.histogram[3] == 2);
+    CHECK(scheduler.histogram[UA_PUBSUB_SCHEDULER_HISTOGRAMSIZE / 2] == 1);
+    CHECK(scheduler.maxLateness == CYCLE / 2);
+    CHECK(scheduler.missedCycles == 0);
+
+    /* A cycle later than the histogram */
+    UA_PubSubScheduler_cycle(&scheduler, scheduler.nextCycle + CYCLE - 1);
+    CHECK(scheduler.histogram[UA_PUBSUB_SCHEDULER_HISTOGRAMSIZE - 1] == 1);
+
+    /* The statistics are reset on start */
+    UA_PubSubScheduler_start(&scheduler, 0);
+    CHECK(scheduler.histogram[0] == 0);
+    CHECK(scheduler.maxLateness == 0);
+}
+
+/* Removing a callback waits for a concurrently running cycle. Every delay
+ * lasts at least one tick. */
+static void
+testRemove(void) {
+    reset();
+    UA_UInt64 idA = 0, idB = 0;
+    CHECK(UA_PubSubScheduler_addCallback(&scheduler, NULL, callbackA, NULL,
+                                         1.0, &idA) == UA_STATUSCODE_GOOD);
+    CHECK(UA_PubSubScheduler_addCallback(&scheduler, NULL, callbackB, NULL,
+                                         1.0, &idB) == UA_STATUSCODE_GOOD);
+    UA_PubSubScheduler_start(&scheduler, 0);
+
+    /* No cycle runs */
+    UA_PubSubScheduler_removeCallback(&scheduler, idB);
+    CHECK(delays == 0);
+
+    /* A cycle runs concurrently and ends after three delays */
+    scheduler.cycleSequence = 1;
+    delaysUntilCycleEnd = 3;
+    UA_PubSubScheduler_removeCallback(&scheduler, idA);
+    CHECK(delays == 3);
+    CHECK(minDelay >= 1);
+    CHECK(scheduler.cycleSequence == 2);
+
+    UA_PubSubScheduler_cycle(&scheduler, scheduler.nextCycle);
+    CHECK(runsA == 0);
+    CHECK(runsB == 0);
+
+    /* The entries are reused */
+    CHECK(UA_PubSubScheduler_addCallback(&scheduler, NULL, callbackB, NULL,
+                                         1.0, NULL) == UA_STATUSCODE_GOOD);
+    UA_PubSubScheduler_cycle(&scheduler, scheduler.nextCycle);
+    CHECK(runsB == 1);
+}
+
+int main(void) {
+    testAddCallback();
+    testCycle();
+    testSkip();
+    testHistogram();
+    testRemove();
+    if(failures > 0) {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
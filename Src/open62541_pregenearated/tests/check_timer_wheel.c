@@ -0,0 +1,233 @@
+/* This work is licensed under a Creative Commons CCZero 1.0 Universal License.
+ * See http://creativecommons.org/publicdomain/zero/1.0/ for more information.
+ *
+ * Host test of the timing wheel with a simulated time. Build and run from this
+ * directory with:
+ *
+ *   gcc -std=gnu99 -DUA_ARCHITECTURE_FREERTOSLWIP \
+ *       -DconfigUSE_PORT_OPTIMISED_TASK_SELECTION=0 -DconfigAPPLICATION_ALLOCATED_HEAP=3 \
+ *       -I.. -I../../Sdk_workspace/OpcServer_bsp/microblaze_0/include \
+ *       -ffunction-sections -fdata-sections -Wl,--gc-sections \
+ *       check_timer_wheel.c -o check_timer_wheel
+ *   ./check_timer_wheel
+ *
+ * The library source is included with UA_ENABLE_TIMER_WHEEL to reach the
+ * timer. xTaskGetTickCount is replaced by a stub that returns the simulated
+ * time for the repeated callbacks. */
+
+#define UA_ENABLE_TIMER_WHEEL
+#include "../open62541.c"
+
+#include <stdio.h>
+
+/* lwIP declares errno without a definition */
+int errno;
+
+static TickType_t tickCount;
+
+TickType_t
+xTaskGetTickCount(void) {
+    return tickCount;
+}
+
+void
+vTaskDelay(const TickType_t ticks) {
+    (void)ticks;
+}
+
+static int failures = 0;
+
+#define CHECK(cond) do {                                                \
+        if(!(cond)) {                                                   \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            failures++;                                                 \
+        }                                                               \
+    } while(0)
+
+#define MS UA_DATETIME_MSEC
+#define MAXRUNS 32
+
+static UA_Timer timer;
+
+/* The labels of the executed callbacks in order */
+static uintptr_t runs[MAXRUNS];
+static size_t runsSize;
+
+static void
+execute(void *executionApplication, UA_ApplicationCallback cb,
+        void *application, void *data) {
+    cb(application, data);
+}
+
+static void
+record(void *application, void *data) {
+    if(runsSize < MAXRUNS)
+        runs[runsSize] = (uintptr_t)data;
+    runsSize++;
+}
+
+static UA_UInt64
+addTimed(UA_DateTime date, uintptr_t label) {
+    UA_UInt64 id = 0;
+    CHECK(UA_Timer_addTimedCallback(&timer, record, NULL, (void*)label,
+                                    date, &id) == UA_STATUSCODE_GOOD);
+    CHECK(id != 0);
+    return id;
+}
+
+static void
+reset(void) {
+    UA_Timer_deleteMembers(&timer);
+    runsSize = 0;
+    tickCount = 0;
+}
+
+/* The callbacks are executed in the order of their time. Callbacks with the
+ * same time are executed in the order in which they were added. */
+static void
+testInsert(void) {
+    reset();
+    addTimed(3 * MS, 3);
+    addTimed(1 * MS + 2000, 2);
+    addTimed(1 * MS + 1000, 1);
+    addTimed(5 * MS, 4);
+    addTimed(5 * MS, 5);
+    addTimed(5 * MS, 6);
+
+    /* Not yet due. The earliest time is returned. */
+    CHECK(UA_Timer_process(&timer, 1 * MS, execute, NULL) == 1 * MS + 1000);
+    CHECK(runsSize == 0);
+
+    CHECK(UA_Timer_process(&timer, 10 * MS, execute, NULL) == UA_INT64_MAX);
+    CHECK(runsSize == 6);
+    for(size_t i = 0; i < 6; i++)
+        CHECK(runs[i] == i + 1);
+}
+
+static UA_UInt64 removeId;
+
+static void
+removeOther(void *application, void *data) {
+    record(application, data);
+    UA_Timer_removeCallback(&timer, removeId);
+}
+
+/* Removed callbacks are not executed. Also when they are removed by a callback
+ * that is due in the same tick. */
+static void
+testRemove(void) {
+    reset();
+    addTimed(2 * MS, 1);
+    UA_UInt64 id = addTimed(2 * MS, 2);
+    addTimed(2 * MS, 3);
+    UA_Timer_removeCallback(&timer, id);
+    UA_Timer_removeCallback(&timer, id);
+    CHECK(UA_Timer_process(&timer, 2 * MS, execute, NULL) == UA_INT64_MAX);
+    CHECK(runsSize == 2);
+    CHECK(runs[0] == 1);
+    CHECK(runs[1] == 3);
+
+    /* The entry is reused with a new id. The old id does not remove it. */
+    UA_UInt64 newId = addTimed(4 * MS, 4);
+    CHECK(newId != id);
+    UA_Timer_removeCallback(&timer, id);
+    CHECK(UA_Timer_process(&timer, 4 * MS, execute, NULL) == UA_INT64_MAX);
+    CHECK(runsSize == 3);
+
+    /* The first callback removes the second before it is executed */
+    CHECK(UA_Timer_addTimedCallback(&timer, removeOther, NULL, (void*)5,
+                                    6 * MS, NULL) == UA_STATUSCODE_GOOD);
+    removeId = addTimed(6 * MS + 1, 6);
+    addTimed(6 * MS + 2, 7);
+    CHECK(UA_Timer_process(&timer, 7 * MS, execute, NULL) == UA_INT64_MAX);
+    CHECK(runsSize == 5);
+    CHECK(runs[3] == 5);
+    CHECK(runs[4] == 7);
+}
+
+static UA_DateTime addedDate;
+
+static void
+addPast(void *application, void *data) {
+    record(application, data);
+    addTimed(addedDate, 2);
+}
+
+/* Repeated callbacks are re-armed with the interval. Cycles that have passed
+ * are skipped. */
+static void
+testRearm(void) {
+    reset();
+    UA_UInt64 id = 0;
+    CHECK(UA_Timer_addRepeatedCallback(&timer, record, NULL, (void*)1,
+                                       20.0, &id) == UA_STATUSCODE_GOOD);
+    CHECK(UA_Timer_process(&timer, 19 * MS, execute, NULL) == 20 * MS);
+    CHECK(runsSize == 0);
+    CHECK(UA_Timer_process(&timer, 20 * MS, execute, NULL) == 40 * MS);
+    CHECK(runsSize == 1);
+
+    /* Late by more than two intervals. For a later tick, the start of the
+     * tick is returned. */
+    CHECK(UA_Timer_process(&timer, 95 * MS, execute, NULL) == 95 * MS + 1);
+    CHECK(runsSize == 2);
+    CHECK(UA_Timer_process(&timer, 95 * MS + 1, execute, NULL) == 115 * MS);
+    CHECK(runsSize == 3);
+
+    /* The new interval starts now. The tick count has a resolution of 10ms. */
+    tickCount = 10;
+    CHECK(UA_Timer_changeRepeatedCallbackInterval(&timer, id, 50.0) == UA_STATUSCODE_GOOD);
+    CHECK(UA_Timer_process(&timer, 149 * MS, execute, NULL) == 150 * MS);
+    CHECK(UA_Timer_process(&timer, 150 * MS, execute, NULL) == 200 * MS);
+    CHECK(runsSize == 4);
+    UA_Timer_removeCallback(&timer, id);
+    CHECK(UA_Timer_changeRepeatedCallbackInterval(&timer, id, 50.0) == UA_STATUSCODE_BADNOTFOUND);
+
+    /* A callback in a skipped tick adds a callback in the past. It goes into
+     * the slot of the current tick and not into a slot already visited. */
+    addedDate = 201 * MS;
+    CHECK(UA_Timer_addTimedCallback(&timer, addPast, NULL, (void*)1,
+                                    202 * MS, NULL) == UA_STATUSCODE_GOOD);
+    CHECK(UA_Timer_process(&timer, 210 * MS, execute, NULL) == UA_INT64_MAX);
+    CHECK(runsSize == 6);
+    CHECK(runs[5] == 2);
+}
+
+/* Callbacks more than one rotation of the wheel ahead share the slot with
+ * earlier ticks and are only executed when due */
+static void
+testWrapAround(void) {
+    reset();
+    const UA_DateTime rotation = UA_TIMERWHEEL_SLOTS * UA_TIMERWHEEL_TICK;
+    addTimed(rotation + 100 * MS, 1);
+    addTimed(3 * rotation + 5 * MS, 2);
+    CHECK(UA_Timer_process(&timer, 100 * MS, execute, NULL) <= rotation + 100 * MS);
+    CHECK(runsSize == 0);
+    CHECK(UA_Timer_process(&timer, rotation + 100 * MS - 1, execute, NULL) ==
+          rotation + 100 * MS);
+    CHECK(runsSize == 0);
+    CHECK(UA_Timer_process(&timer, rotation + 100 * MS, execute, NULL) <=
+          3 * rotation + 5 * MS);
+    CHECK(runsSize == 1);
+
+    /* A jump over more than one rotation visits every slot once */
+    addTimed(2 * rotation, 3);
+    CHECK(UA_Timer_process(&timer, 3 * rotation + 10 * MS, execute, NULL) == UA_INT64_MAX);
+    CHECK(runsSize == 3);
+    CHECK(runs[1] == 3);
+    CHECK(runs[2] == 2);
+}
+
+int main(void) {
+    UA_Timer_init(&timer);
+    testInsert();
+    testRemove();
+    testRearm();
+    testWrapAround();
+    UA_Timer_deleteMembers(&timer);
+    if(failures > 0) {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}